@@ -0,0 +1,44 @@
+// Host subset of pimoroni-pico's common header.
+
+#pragma once
+#include <stdint.h>
+#include <climits>
+#include <algorithm>
+#include "pico/stdlib.h"
+
+#define PIMORONI_I2C_DEFAULT_INSTANCE i2c0
+
+namespace pimoroni {
+    static const unsigned int PIN_UNUSED = INT_MAX;
+
+    enum Direction {
+        NORMAL_DIR = 0x00,
+        REVERSED_DIR = 0x01,
+    };
+
+    inline uint32_t millis() {
+        return to_ms_since_boot(get_absolute_time());
+    }
+
+    inline uint32_t micros() {
+        return (uint32_t)to_us_since_boot(get_absolute_time());
+    }
+
+    struct pin_pair {
+        union {
+            uint8_t first;
+            uint8_t a;
+            uint8_t positive;
+            uint8_t phase;
+        };
+        union {
+            uint8_t second;
+            uint8_t b;
+            uint8_t negative;
+            uint8_t enable;
+        };
+
+        pin_pair() : first(0), second(0) {}
+        pin_pair(uint8_t first, uint8_t second) : first(first), second(second) {}
+    };
+}
@@ -0,0 +1,71 @@
+// Host stand-in for pimoroni-pico's PWM motor driver. The effective duty (after
+// the deadzone, before wiring polarity) is published to the plant model through
+// HOST_HAL::motorDuty, keyed by the motor's first pin.
+
+#pragma once
+#include "pico/stdlib.h"
+#include "common/pimoroni_common.hpp"
+
+using namespace pimoroni;
+
+namespace motor {
+
+    enum DecayMode {
+        FAST_DECAY = 0,
+        SLOW_DECAY = 1,
+    };
+
+    class Motor {
+    public:
+        static constexpr float DEFAULT_SPEED_SCALE = 1.0f;
+        static constexpr float DEFAULT_ZEROPOINT = 0.0f;
+        static constexpr float DEFAULT_DEADZONE = 0.05f;
+        static constexpr float DEFAULT_FREQUENCY = 25000.0f;
+        static constexpr DecayMode DEFAULT_DECAY_MODE = SLOW_DECAY;
+
+        Motor(const pin_pair &pins, Direction direction = NORMAL_DIR, float speed_scale = DEFAULT_SPEED_SCALE,
+              float zeropoint = DEFAULT_ZEROPOINT, float deadzone = DEFAULT_DEADZONE, float freq = DEFAULT_FREQUENCY,
+              DecayMode mode = DEFAULT_DECAY_MODE, bool ph_en_driver = false);
+        ~Motor();
+
+        bool init();
+
+        pin_pair pins() const { return motor_pins; }
+
+        void enable();
+        void disable();
+        bool is_enabled() const { return enabled; }
+
+        float duty() const { return motor_duty; }
+        void duty(float duty);
+
+        float speed() const { return motor_duty * motor_speed_scale; }
+        void speed(float speed);
+
+        void stop();
+        void coast();
+        void brake();
+        void full_negative() { duty(-1.0f); }
+        void full_positive() { duty(1.0f); }
+
+        Direction direction() const { return motor_direction; }
+        void direction(Direction direction) { motor_direction = direction; }
+
+        float speed_scale() const { return motor_speed_scale; }
+        void speed_scale(float speed_scale) { motor_speed_scale = speed_scale; }
+
+        float deadzone() const { return motor_deadzone; }
+        void deadzone(float deadzone) { motor_deadzone = deadzone; }
+
+    private:
+        void publish() const;
+
+        pin_pair motor_pins;
+        Direction motor_direction;
+        float motor_speed_scale;
+        float motor_deadzone;
+        float motor_duty = 0.0f;
+        bool enabled = false;
+    };
+
+}
@@ -0,0 +1,89 @@
+// Host stand-in for pimoroni-pico's PIO quadrature encoder. The count is
+// supplied by the plant model through HOST_HAL::setEncoderCount; captures
+// derive delta and frequency from virtual time exactly like the real driver.
+
+#pragma once
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "common/pimoroni_common.hpp"
+
+using namespace pimoroni;
+
+namespace encoder {
+
+    class Encoder {
+    public:
+        static constexpr float DEFAULT_COUNTS_PER_REV = 24;
+        static const uint16_t DEFAULT_FREQ_DIVIDER = 1;
+
+        class Capture {
+        public:
+            Capture() : captured_count(0), captured_delta(0), captured_frequency(0.0f), counts_per_rev(INT32_MAX) {}
+            Capture(int32_t count, int32_t delta, float frequency, float counts_per_rev)
+                : captured_count(count), captured_delta(delta), captured_frequency(frequency),
+                  counts_per_rev(counts_per_rev) {}
+
+            int32_t count() const { return captured_count; }
+            int32_t delta() const { return captured_delta; }
+            float frequency() const { return captured_frequency; }
+
+            float revolutions() const { return (float)count() / counts_per_rev; }
+            float degrees() const { return revolutions() * 360.0f; }
+            float radians() const { return revolutions() * (float)M_TWOPI; }
+
+            float revolutions_delta() const { return (float)delta() / counts_per_rev; }
+            float degrees_delta() const { return revolutions_delta() * 360.0f; }
+            float radians_delta() const { return revolutions_delta() * (float)M_TWOPI; }
+
+            float revolutions_per_second() const { return frequency() / counts_per_rev; }
+            float revolutions_per_minute() const { return revolutions_per_second() * 60.0f; }
+            float degrees_per_second() const { return revolutions_per_second() * 360.0f; }
+            float radians_per_second() const { return revolutions_per_second() * (float)M_TWOPI; }
+
+        private:
+            int32_t captured_count;
+            int32_t captured_delta;
+            float captured_frequency;
+            float counts_per_rev;
+        };
+
+        Encoder(PIO pio, uint sm, const pin_pair &pins, uint common_pin = PIN_UNUSED, Direction direction = NORMAL_DIR,
+                float counts_per_rev = DEFAULT_COUNTS_PER_REV, bool count_microsteps = false,
+                uint16_t freq_divider = DEFAULT_FREQ_DIVIDER);
+        ~Encoder() = default;
+
+        bool init();
+
+        pin_pair pins() const { return enc_pins; }
+        uint common_pin() const { return enc_common_pin; }
+
+        int32_t count() const;
+        int32_t delta();
+        void zero();
+
+        float revolutions() const { return (float)count() / enc_counts_per_rev; }
+        float degrees() const { return revolutions() * 360.0f; }
+        float radians() const { return revolutions() * (float)M_TWOPI; }
+
+        Direction direction() const { return enc_direction; }
+        void direction(Direction direction) { enc_direction = direction; }
+
+        float counts_per_rev() const { return enc_counts_per_rev; }
+        void counts_per_rev(float counts_per_rev) { enc_counts_per_rev = counts_per_rev; }
+
+        Capture capture();
+
+    private:
+        int32_t raw_count() const;
+
+        pin_pair enc_pins;
+        uint enc_common_pin;
+        Direction enc_direction;
+        float enc_counts_per_rev;
+        int32_t count_offset = 0;
+        int32_t last_count = 0;
+        int32_t last_capture_count = 0;
+        uint64_t last_capture_us = 0;
+    };
+
+}
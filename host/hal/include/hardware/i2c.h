@@ -0,0 +1,53 @@
+// Host I2C controller. Transfers are routed to whatever simulated device is
+// attached at the target address (see HOST_HAL::attachI2CDevice) and consume
+// virtual bus time at the configured baud rate, so a slow transfer inside a
+// timer callback delays the next callback exactly as it would on the RP2040.
+
+#ifndef OSOD_HOST_HARDWARE_I2C_H
+#define OSOD_HOST_HARDWARE_I2C_H
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct i2c_inst {
+    uint index;
+    uint baudrate;
+    bool enabled;
+} i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+#define i2c_default i2c0
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+void i2c_deinit(i2c_inst_t *i2c);
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate);
+
+static inline uint i2c_hw_index(i2c_inst_t *i2c) {
+    return i2c->index;
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop,
+                         uint timeout_us);
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop,
+                        uint timeout_us);
+
+static inline int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    return i2c_write_timeout_us(i2c, addr, src, len, nostop, 0);
+}
+
+static inline int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    return i2c_read_timeout_us(i2c, addr, dst, len, nostop, 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OSOD_HOST_HARDWARE_I2C_H
@@ -0,0 +1,26 @@
+#ifndef OSOD_HOST_HARDWARE_PIO_H
+#define OSOD_HOST_HARDWARE_PIO_H
+
+#include "pico.h"
+
+typedef struct pio_hw {
+    uint index;
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern pio_hw_t pio0_inst;
+extern pio_hw_t pio1_inst;
+
+#ifdef __cplusplus
+}
+#endif
+
+#define pio0 (&pio0_inst)
+#define pio1 (&pio1_inst)
+
+#endif //OSOD_HOST_HARDWARE_PIO_H
@@ -0,0 +1,32 @@
+#ifndef OSOD_HOST_HARDWARE_TIMER_H
+#define OSOD_HOST_HARDWARE_TIMER_H
+
+#include "pico/time.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline uint64_t time_us_64(void) {
+    return to_us_since_boot(get_absolute_time());
+}
+
+static inline uint32_t time_us_32(void) {
+    return (uint32_t)time_us_64();
+}
+
+void busy_wait_us(uint64_t delay_us);
+
+static inline void busy_wait_us_32(uint32_t delay_us) {
+    busy_wait_us(delay_us);
+}
+
+static inline void busy_wait_ms(uint32_t delay_ms) {
+    busy_wait_us((uint64_t)delay_ms * 1000);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OSOD_HOST_HARDWARE_TIMER_H
@@ -0,0 +1,49 @@
+// Host UART. Received bytes are injected by the simulation through
+// HOST_HAL::uartInject, which raises the UART's IRQ handler if one is enabled.
+
+#ifndef OSOD_HOST_HARDWARE_UART_H
+#define OSOD_HOST_HARDWARE_UART_H
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct uart_inst {
+    uint index;
+} uart_inst_t;
+
+extern uart_inst_t uart0_inst;
+extern uart_inst_t uart1_inst;
+
+#define uart0 (&uart0_inst)
+#define uart1 (&uart1_inst)
+
+typedef enum {
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+} uart_parity_t;
+
+static inline uint uart_get_index(uart_inst_t *uart) {
+    return uart->index;
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+void uart_deinit(uart_inst_t *uart);
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data);
+bool uart_is_readable(uart_inst_t *uart);
+char uart_getc(uart_inst_t *uart);
+void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OSOD_HOST_HARDWARE_UART_H
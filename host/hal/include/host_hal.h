@@ -0,0 +1,100 @@
+// Simulation-side interface to the host HAL.
+//
+// The firmware only ever sees the Pico SDK / Pimoroni shim headers; this file is
+// what a simulation (or any host harness) uses to drive them: advance virtual
+// time, attach simulated I2C devices, inject receiver/UART input, feed encoder
+// counts from a plant model and read back the motor and servo commands.
+
+#ifndef OSOD_HOST_HAL_H
+#define OSOD_HOST_HAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "hardware/i2c.h"
+#include "hardware/uart.h"
+
+namespace HOST_HAL {
+
+    // ---- virtual clock ----
+
+    uint64_t nowUs();
+
+    // Run the clock forward to targetUs, firing every repeating timer that falls due on the way, in the
+    // order it would fire on the RP2040. Time never runs backwards: if firmware work already consumed past
+    // targetUs, only overdue timers fire.
+    void runUntil(uint64_t targetUs);
+
+    inline void advanceUs(uint64_t us) {
+        runUntil(nowUs() + us);
+    }
+
+    // Charge busy time (bus transfers, busy-waits inside an interrupt) to the current execution context.
+    // Timers that fall due meanwhile are not fired until the context returns, so an overrunning callback
+    // shows up as late timers - the same jitter the hardware would exhibit.
+    void consumeUs(uint64_t us);
+
+    // True while a timer, GPIO or UART callback is executing.
+    bool inInterrupt();
+
+    // ---- I2C ----
+
+    class I2CDevice {
+    public:
+        virtual ~I2CDevice() = default;
+        // Each call is one complete transaction; return the byte count transferred or a PICO_ERROR_* code.
+        virtual int write(const uint8_t* src, size_t len) = 0;
+        virtual int read(uint8_t* dst, size_t len) = 0;
+    };
+
+    void attachI2CDevice(i2c_inst_t* i2c, uint8_t address, I2CDevice* device);
+
+    struct I2CStats {
+        uint32_t transactions;
+        uint32_t errors;
+        uint64_t bytes;
+        uint64_t busyUs;
+    };
+
+    I2CStats i2cStats(i2c_inst_t* i2c);
+
+    // Perform a write-then-read transaction (either half may be empty) against the attached device without
+    // charging the bus time to the caller, as a DMA- or interrupt-driven controller would. busUs receives
+    // the time the bus is occupied; the caller decides when the transaction completes. Returns the bytes
+    // read, the bytes written for a write-only transaction, or a PICO_ERROR_* code.
+    int i2cTransaction(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t writeLen, uint8_t* dst,
+                       size_t readLen, uint64_t& busUs);
+
+    // Bus time for a transaction of len data bytes (plus the address byte) at the bus's current baud rate.
+    uint64_t i2cTransferUs(i2c_inst_t* i2c, size_t len);
+
+    // ---- GPIO / UART ----
+
+    // Drive an input pin from outside the chip; raises the GPIO callback on enabled edges.
+    void gpioDrive(uint pin, bool level);
+    bool gpioOutputLevel(uint pin);
+
+    // Deliver received bytes, invoking the UART IRQ handler when RX interrupts are enabled.
+    void uartInject(uart_inst_t* uart, const uint8_t* data, size_t len);
+
+    // Deliver bytes to the stdio console, where getchar_timeout_us() picks them up.
+    void consoleInject(const char* data, size_t len);
+
+    // ---- actuators and sensors, keyed by the first pin of the device ----
+
+    void setEncoderCount(uint pin, int32_t count);
+    int32_t encoderCount(uint pin);
+
+    void setMotorDuty(uint pin, float duty);
+    float motorDuty(uint pin);
+
+    void setServo(uint pin, float value, bool enabled);
+    float servoValue(uint pin);
+    bool servoEnabled(uint pin);
+
+    // Latch a CPPM frame: values are the decoder's normalised -1..1 channel readings.
+    void setReceiverChannels(const float* values, size_t count);
+    float receiverChannel(uint channel);
+    uint64_t receiverFrameUs();
+}
+
+#endif //OSOD_HOST_HAL_H
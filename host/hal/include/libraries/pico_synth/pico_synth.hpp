@@ -0,0 +1,7 @@
+// Only the constant the firmware borrows from pico_synth is provided.
+
+#pragma once
+
+namespace pimoroni {
+    constexpr float pi = 3.14159265358979323846f;
+}
@@ -0,0 +1,45 @@
+// Host stand-in for the Pico SDK base header. Only the pieces the firmware
+// actually touches are provided; everything else is deliberately missing so a
+// new SDK dependency shows up as a host build failure rather than silently.
+
+#ifndef OSOD_HOST_PICO_H
+#define OSOD_HOST_PICO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifndef M_TWOPI
+#define M_TWOPI 6.28318530717958647692
+#endif
+
+#ifndef count_of
+#define count_of(a) (sizeof(a)/sizeof((a)[0]))
+#endif
+
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+
+#define NUM_BANK0_GPIOS 30
+
+static inline void tight_loop_contents(void) {
+}
+
+// everything runs on one host thread, which stands in for core0
+static inline uint get_core_num(void) {
+    return 0;
+}
+
+enum pico_error_codes {
+    PICO_OK = 0,
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_TIMEOUT = -1,
+    PICO_ERROR_GENERIC = -2,
+    PICO_ERROR_NO_DATA = -3,
+    PICO_ERROR_NOT_PERMITTED = -4,
+    PICO_ERROR_INVALID_ARG = -5,
+    PICO_ERROR_IO = -6,
+};
+
+#endif //OSOD_HOST_PICO_H
@@ -0,0 +1,21 @@
+// The simulation has a single thread of execution, so launching core1 only
+// records its entry point; the simulation interleaves core1's work itself.
+
+#ifndef OSOD_HOST_PICO_MULTICORE_H
+#define OSOD_HOST_PICO_MULTICORE_H
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void multicore_launch_core1(void (*entry)(void));
+
+void multicore_reset_core1(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OSOD_HOST_PICO_MULTICORE_H
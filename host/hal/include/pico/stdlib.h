@@ -0,0 +1,27 @@
+#ifndef OSOD_HOST_PICO_STDLIB_H
+#define OSOD_HOST_PICO_STDLIB_H
+
+#include <stdio.h>
+#include "pico.h"
+#include "pico/types.h"
+#include "pico/time.h"
+#include "hardware/timer.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline bool stdio_init_all(void) {
+    return true;
+}
+
+// Returns the next byte injected with HOST_HAL::consoleInject(), or PICO_ERROR_TIMEOUT. Never waits.
+int getchar_timeout_us(uint32_t timeout_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OSOD_HOST_PICO_STDLIB_H
@@ -0,0 +1,68 @@
+// The simulation runs every execution context on one host thread, so the
+// synchronisation primitives only need to exist, not to exclude anything.
+
+#ifndef OSOD_HOST_PICO_SYNC_H
+#define OSOD_HOST_PICO_SYNC_H
+
+#include "pico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct critical_section {
+    bool initialised;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *crit_sec) {
+    crit_sec->initialised = true;
+}
+
+static inline void critical_section_enter_blocking(critical_section_t *crit_sec) {
+    (void)crit_sec;
+}
+
+static inline void critical_section_exit(critical_section_t *crit_sec) {
+    (void)crit_sec;
+}
+
+static inline void critical_section_deinit(critical_section_t *crit_sec) {
+    crit_sec->initialised = false;
+}
+
+typedef struct mutex {
+    bool owned;
+} mutex_t;
+
+#define auto_init_mutex(name) mutex_t name = { false }
+
+static inline void mutex_init(mutex_t *mtx) {
+    mtx->owned = false;
+}
+
+static inline bool mutex_try_enter(mutex_t *mtx, uint32_t *owner_out) {
+    (void)owner_out;
+    if (mtx->owned) {
+        return false;
+    }
+    mtx->owned = true;
+    return true;
+}
+
+static inline void mutex_enter_blocking(mutex_t *mtx) {
+    // nothing else can run while we wait, so a held mutex here would never be released
+    mtx->owned = true;
+}
+
+static inline void mutex_exit(mutex_t *mtx) {
+    mtx->owned = false;
+}
+
+static inline void __dmb(void) {
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //OSOD_HOST_PICO_SYNC_H
@@ -0,0 +1,24 @@
+#ifndef OSOD_HOST_PICO_TYPES_H
+#define OSOD_HOST_PICO_TYPES_H
+
+#include "pico.h"
+
+typedef uint64_t absolute_time_t;
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000);
+}
+
+static inline void update_us_since_boot(absolute_time_t *t, uint64_t us_since_boot) {
+    *t = us_since_boot;
+}
+
+static inline absolute_time_t from_us_since_boot(uint64_t us_since_boot) {
+    return us_since_boot;
+}
+
+#endif //OSOD_HOST_PICO_TYPES_H
@@ -0,0 +1,31 @@
+// Host stand-in for the pico-cppm decoder. Channel values come from the
+// simulated transmitter through HOST_HAL::setReceiverChannels.
+
+#ifndef OSOD_HOST_CPPM_DECODER_H
+#define OSOD_HOST_CPPM_DECODER_H
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+class CPPMDecoder {
+public:
+    CPPMDecoder(uint gpio_pin, PIO pio, uint channel_count, double sync_period_us, double min_period_us,
+                double max_period_us);
+
+    static void sharedInit(uint irq_index);
+
+    void startListening();
+    void stopListening();
+
+    double getChannelValue(uint channel) const;
+    double getChannelUs(uint channel) const;
+    uint64_t getFrameAgeUs() const;
+
+private:
+    uint channel_count;
+    double min_period_us;
+    double max_period_us;
+    bool listening = false;
+};
+
+#endif //OSOD_HOST_CPPM_DECODER_H
@@ -0,0 +1,79 @@
+// Host stand-in for pimoroni-pico's servo driver. The commanded value and the
+// enable state are published through HOST_HAL::servoValue/servoEnabled.
+
+#pragma once
+#include "pico/stdlib.h"
+#include "common/pimoroni_common.hpp"
+
+namespace servo {
+
+    enum CalibrationType {
+        ANGULAR = 0,
+        LINEAR,
+        CONTINUOUS,
+    };
+
+    class Calibration {
+    public:
+        struct Pair {
+            float pulse;
+            float value;
+        };
+
+        explicit Calibration(CalibrationType default_type = ANGULAR);
+
+        void apply_two_pairs(float min_pulse, float max_pulse, float min_value, float max_value);
+        void apply_three_pairs(float min_pulse, float mid_pulse, float max_pulse, float min_value, float mid_value,
+                               float max_value);
+
+        float value_to_pulse(float value) const;
+        float pulse_to_value(float pulse) const;
+
+        float first_value() const { return pairs[0].value; }
+        float mid_value() const { return pairs[count / 2].value; }
+        float last_value() const { return pairs[count - 1].value; }
+
+    private:
+        Pair pairs[3];
+        uint count = 0;
+    };
+
+    class Servo {
+    public:
+        static constexpr float DEFAULT_FREQUENCY = 50.0f;
+
+        explicit Servo(uint pin, CalibrationType default_type = ANGULAR, float freq = DEFAULT_FREQUENCY);
+        ~Servo();
+
+        bool init();
+
+        uint pin() const { return servo_pin; }
+
+        void enable();
+        void disable();
+        bool is_enabled() const { return enabled; }
+
+        float pulse() const { return servo_pulse; }
+        void pulse(float pulse);
+
+        float value() const { return servo_value; }
+        void value(float value);
+
+        void to_min() { value(servo_calibration.first_value()); }
+        void to_mid() { value(servo_calibration.mid_value()); }
+        void to_max() { value(servo_calibration.last_value()); }
+
+        Calibration &calibration() { return servo_calibration; }
+        const Calibration &calibration() const { return servo_calibration; }
+
+    private:
+        void publish() const;
+
+        uint servo_pin;
+        Calibration servo_calibration;
+        float servo_value = 0.0f;
+        float servo_pulse = 0.0f;
+        bool enabled = false;
+    };
+
+}
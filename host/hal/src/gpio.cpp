@@ -0,0 +1,109 @@
+#include <array>
+#include "hardware/gpio.h"
+#include "host_hal.h"
+#include "host_hal_detail.h"
+
+namespace {
+    struct Pin {
+        bool output = false;
+        bool outputLevel = false;
+        bool driven = false;
+        bool drivenLevel = false;
+        bool pullUp = false;
+        uint32_t irqEvents = 0;
+    };
+
+    std::array<Pin, NUM_BANK0_GPIOS> pins;
+    gpio_irq_callback_t irqCallback = nullptr;
+
+    bool level(const Pin& pin) {
+        if (pin.output) {
+            return pin.outputLevel;
+        }
+        return pin.driven ? pin.drivenLevel : pin.pullUp;
+    }
+}
+
+namespace HOST_HAL {
+    void gpioDrive(uint gpio, bool value) {
+        Pin& pin = pins[gpio];
+        const bool before = level(pin);
+        pin.driven = true;
+        pin.drivenLevel = value;
+        const bool after = level(pin);
+
+        uint32_t events = 0;
+        if (before && !after) events |= GPIO_IRQ_EDGE_FALL;
+        if (!before && after) events |= GPIO_IRQ_EDGE_RISE;
+        events |= after ? GPIO_IRQ_LEVEL_HIGH : GPIO_IRQ_LEVEL_LOW;
+        events &= pin.irqEvents;
+        if (events != 0 && irqCallback != nullptr) {
+            HOST_HAL_DETAIL::runInInterrupt([&] { irqCallback(gpio, events); });
+        }
+    }
+
+    bool gpioOutputLevel(uint gpio) {
+        return pins[gpio].outputLevel;
+    }
+}
+
+extern "C" {
+
+void gpio_init(uint gpio) {
+    pins[gpio].output = false;
+    pins[gpio].outputLevel = false;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    pins[gpio].output = out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    pins[gpio].outputLevel = value;
+}
+
+bool gpio_get(uint gpio) {
+    return level(pins[gpio]);
+}
+
+void gpio_pull_up(uint gpio) {
+    pins[gpio].pullUp = true;
+}
+
+void gpio_pull_down(uint gpio) {
+    pins[gpio].pullUp = false;
+}
+
+void gpio_disable_pulls(uint gpio) {
+    pins[gpio].pullUp = false;
+}
+
+void gpio_set_inover(uint gpio, uint value) {
+    (void)gpio;
+    (void)value;
+}
+
+void gpio_set_outover(uint gpio, uint value) {
+    (void)gpio;
+    (void)value;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    if (enabled) {
+        pins[gpio].irqEvents |= event_mask;
+    } else {
+        pins[gpio].irqEvents &= ~event_mask;
+    }
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback) {
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+    irqCallback = callback;
+}
+
+}
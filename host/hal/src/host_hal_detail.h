@@ -0,0 +1,19 @@
+// Internal glue shared between the host HAL translation units.
+
+#ifndef OSOD_HOST_HAL_DETAIL_H
+#define OSOD_HOST_HAL_DETAIL_H
+
+namespace HOST_HAL_DETAIL {
+    void enterInterrupt();
+    void exitInterrupt();
+
+    // Runs an external event handler (GPIO edge, UART RX) the way the NVIC would: in interrupt context.
+    template<typename Handler>
+    void runInInterrupt(Handler&& handler) {
+        enterInterrupt();
+        handler();
+        exitInterrupt();
+    }
+}
+
+#endif //OSOD_HOST_HAL_DETAIL_H
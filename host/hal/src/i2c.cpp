@@ -0,0 +1,148 @@
+#include <array>
+#include "hardware/i2c.h"
+#include "host_hal.h"
+
+i2c_inst_t i2c0_inst = {0, 100000, false};
+i2c_inst_t i2c1_inst = {1, 100000, false};
+
+namespace {
+    // Every byte on the wire is 8 data bits plus the ACK bit.
+    constexpr uint64_t BITS_PER_BYTE = 9;
+
+    struct Bus {
+        std::array<HOST_HAL::I2CDevice*, 128> devices{};
+        HOST_HAL::I2CStats stats{};
+    };
+
+    std::array<Bus, 2> buses;
+
+    Bus& busFor(i2c_inst_t* i2c) {
+        return buses[i2c->index];
+    }
+
+    int transfer(i2c_inst_t* i2c, uint8_t addr, size_t len, uint timeout_us, HOST_HAL::I2CDevice*& device) {
+        Bus& bus = busFor(i2c);
+        device = addr < bus.devices.size() ? bus.devices[addr] : nullptr;
+        bus.stats.transactions++;
+
+        if (!i2c->enabled || device == nullptr) {
+            // address byte goes out and is not acknowledged
+            const uint64_t nackUs = HOST_HAL::i2cTransferUs(i2c, 0);
+            HOST_HAL::consumeUs(nackUs);
+            bus.stats.busyUs += nackUs;
+            bus.stats.errors++;
+            return PICO_ERROR_GENERIC;
+        }
+
+        const uint64_t busUs = HOST_HAL::i2cTransferUs(i2c, len);
+        if (timeout_us != 0 && busUs > timeout_us) {
+            HOST_HAL::consumeUs(timeout_us);
+            bus.stats.busyUs += timeout_us;
+            bus.stats.errors++;
+            return PICO_ERROR_TIMEOUT;
+        }
+        HOST_HAL::consumeUs(busUs);
+        bus.stats.busyUs += busUs;
+        return PICO_OK;
+    }
+
+    void account(i2c_inst_t* i2c, int result) {
+        Bus& bus = busFor(i2c);
+        if (result < 0) {
+            bus.stats.errors++;
+        } else {
+            bus.stats.bytes += static_cast<uint64_t>(result);
+        }
+    }
+}
+
+namespace HOST_HAL {
+    void attachI2CDevice(i2c_inst_t* i2c, uint8_t address, I2CDevice* device) {
+        busFor(i2c).devices[address & 0x7f] = device;
+    }
+
+    I2CStats i2cStats(i2c_inst_t* i2c) {
+        return busFor(i2c).stats;
+    }
+
+    int i2cTransaction(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t writeLen, uint8_t* dst,
+                       size_t readLen, uint64_t& busUs) {
+        Bus& bus = busFor(i2c);
+        I2CDevice* device = addr < bus.devices.size() ? bus.devices[addr] : nullptr;
+        bus.stats.transactions++;
+
+        if (!i2c->enabled || device == nullptr) {
+            busUs = i2cTransferUs(i2c, 0);
+            bus.stats.busyUs += busUs;
+            bus.stats.errors++;
+            return PICO_ERROR_GENERIC;
+        }
+
+        // a repeated start costs another address byte
+        busUs = i2cTransferUs(i2c, writeLen + readLen + (writeLen > 0 && readLen > 0 ? 1 : 0));
+        bus.stats.busyUs += busUs;
+
+        int result = 0;
+        if (writeLen > 0) {
+            result = device->write(src, writeLen);
+            account(i2c, result);
+            if (result < 0) {
+                return result;
+            }
+        }
+        if (readLen > 0) {
+            result = device->read(dst, readLen);
+            account(i2c, result);
+        }
+        return result;
+    }
+
+    uint64_t i2cTransferUs(i2c_inst_t* i2c, size_t len) {
+        const uint64_t bits = (len + 1) * BITS_PER_BYTE;
+        return (bits * 1000000 + i2c->baudrate - 1) / i2c->baudrate;
+    }
+}
+
+extern "C" {
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c->enabled = true;
+    return i2c_set_baudrate(i2c, baudrate);
+}
+
+void i2c_deinit(i2c_inst_t *i2c) {
+    i2c->enabled = false;
+}
+
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate) {
+    i2c->baudrate = baudrate == 0 ? 1 : baudrate;
+    return i2c->baudrate;
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop,
+                         uint timeout_us) {
+    (void)nostop;
+    HOST_HAL::I2CDevice* device;
+    int result = transfer(i2c, addr, len, timeout_us, device);
+    if (result < 0) {
+        return result;
+    }
+    result = device->write(src, len);
+    account(i2c, result);
+    return result;
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop,
+                        uint timeout_us) {
+    (void)nostop;
+    HOST_HAL::I2CDevice* device;
+    int result = transfer(i2c, addr, len, timeout_us, device);
+    if (result < 0) {
+        return result;
+    }
+    result = device->read(dst, len);
+    account(i2c, result);
+    return result;
+}
+
+}
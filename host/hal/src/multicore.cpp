@@ -0,0 +1,16 @@
+// core1 is never actually started on the host: its entry point is an endless loop
+// that would never hand control back. The simulation calls core1's services itself.
+
+#include "pico/multicore.h"
+
+namespace {
+    void (*core1Entry)(void) = nullptr;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    core1Entry = entry;
+}
+
+void multicore_reset_core1(void) {
+    core1Entry = nullptr;
+}
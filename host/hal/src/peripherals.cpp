@@ -0,0 +1,332 @@
+// Motor, encoder, servo and CPPM receiver shims, plus the pin-keyed registry the
+// plant model uses to exchange commands and measurements with them.
+
+#include <array>
+#include <cmath>
+#include "hardware/pio.h"
+#include "encoder.hpp"
+#include "drivers/motor/motor.hpp"
+#include "servo.hpp"
+#include "pico_cppm/cppm_decoder.h"
+#include "host_hal.h"
+
+pio_hw_t pio0_inst = {0};
+pio_hw_t pio1_inst = {1};
+
+namespace {
+    constexpr size_t MAX_RECEIVER_CHANNELS = 16;
+
+    struct Registry {
+        std::array<int32_t, NUM_BANK0_GPIOS> encoderCounts{};
+        std::array<float, NUM_BANK0_GPIOS> motorDuties{};
+        std::array<float, NUM_BANK0_GPIOS> servoValues{};
+        std::array<bool, NUM_BANK0_GPIOS> servoEnabled{};
+        std::array<float, MAX_RECEIVER_CHANNELS> receiverChannels{};
+        uint64_t receiverFrameUs = 0;
+    };
+
+    Registry registry;
+}
+
+namespace HOST_HAL {
+    void setEncoderCount(uint pin, int32_t count) {
+        registry.encoderCounts[pin] = count;
+    }
+
+    int32_t encoderCount(uint pin) {
+        return registry.encoderCounts[pin];
+    }
+
+    void setMotorDuty(uint pin, float duty) {
+        registry.motorDuties[pin] = duty;
+    }
+
+    float motorDuty(uint pin) {
+        return registry.motorDuties[pin];
+    }
+
+    void setServo(uint pin, float value, bool enabled) {
+        registry.servoValues[pin] = value;
+        registry.servoEnabled[pin] = enabled;
+    }
+
+    float servoValue(uint pin) {
+        return registry.servoValues[pin];
+    }
+
+    bool servoEnabled(uint pin) {
+        return registry.servoEnabled[pin];
+    }
+
+    void setReceiverChannels(const float* values, size_t count) {
+        for (size_t i = 0; i < count && i < MAX_RECEIVER_CHANNELS; i++) {
+            registry.receiverChannels[i] = values[i];
+        }
+        registry.receiverFrameUs = nowUs();
+    }
+
+    float receiverChannel(uint channel) {
+        return channel < MAX_RECEIVER_CHANNELS ? registry.receiverChannels[channel] : 0.0f;
+    }
+
+    uint64_t receiverFrameUs() {
+        return registry.receiverFrameUs;
+    }
+}
+
+// ---- encoder ----
+
+namespace encoder {
+    Encoder::Encoder(PIO pio, uint sm, const pin_pair &pins, uint common_pin, Direction direction, float counts_per_rev,
+                     bool count_microsteps, uint16_t freq_divider)
+        : enc_pins(pins), enc_common_pin(common_pin), enc_direction(direction), enc_counts_per_rev(counts_per_rev) {
+        (void)pio;
+        (void)sm;
+        (void)count_microsteps;
+        (void)freq_divider;
+    }
+
+    bool Encoder::init() {
+        count_offset = HOST_HAL::encoderCount(enc_pins.first);
+        last_count = 0;
+        last_capture_count = 0;
+        last_capture_us = HOST_HAL::nowUs();
+        return true;
+    }
+
+    int32_t Encoder::raw_count() const {
+        return HOST_HAL::encoderCount(enc_pins.first) - count_offset;
+    }
+
+    int32_t Encoder::count() const {
+        const int32_t raw = raw_count();
+        return enc_direction == NORMAL_DIR ? raw : -raw;
+    }
+
+    int32_t Encoder::delta() {
+        const int32_t current = count();
+        const int32_t change = current - last_count;
+        last_count = current;
+        return change;
+    }
+
+    void Encoder::zero() {
+        count_offset = HOST_HAL::encoderCount(enc_pins.first);
+        last_count = 0;
+        last_capture_count = 0;
+    }
+
+    Encoder::Capture Encoder::capture() {
+        const int32_t current = count();
+        const uint64_t now = HOST_HAL::nowUs();
+        const int32_t change = current - last_capture_count;
+        const uint64_t elapsedUs = now - last_capture_us;
+        const float frequency = elapsedUs > 0 ? static_cast<float>(change) * 1e6f / static_cast<float>(elapsedUs) : 0.0f;
+        last_capture_count = current;
+        last_capture_us = now;
+        return {current, change, frequency, enc_counts_per_rev};
+    }
+}
+
+// ---- motor ----
+
+namespace motor {
+    Motor::Motor(const pin_pair &pins, Direction direction, float speed_scale, float zeropoint, float deadzone,
+                 float freq, DecayMode mode, bool ph_en_driver)
+        : motor_pins(pins), motor_direction(direction), motor_speed_scale(speed_scale), motor_deadzone(deadzone) {
+        (void)zeropoint;
+        (void)freq;
+        (void)mode;
+        (void)ph_en_driver;
+    }
+
+    Motor::~Motor() {
+        HOST_HAL::setMotorDuty(motor_pins.first, 0.0f);
+    }
+
+    bool Motor::init() {
+        publish();
+        return true;
+    }
+
+    void Motor::enable() {
+        enabled = true;
+        publish();
+    }
+
+    void Motor::disable() {
+        enabled = false;
+        publish();
+    }
+
+    void Motor::duty(float duty) {
+        motor_duty = std::clamp(duty, -1.0f, 1.0f);
+        enabled = true;
+        publish();
+    }
+
+    void Motor::speed(float speed) {
+        duty(speed / motor_speed_scale);
+    }
+
+    void Motor::stop() {
+        duty(0.0f);
+    }
+
+    void Motor::coast() {
+        motor_duty = 0.0f;
+        enabled = false;
+        publish();
+    }
+
+    void Motor::brake() {
+        stop();
+    }
+
+    void Motor::publish() const {
+        // the wiring polarity set by Direction cancels against the encoder's, so the plant sees the commanded sense
+        const float output = (!enabled || std::fabs(motor_duty) < motor_deadzone) ? 0.0f : motor_duty;
+        HOST_HAL::setMotorDuty(motor_pins.first, output);
+    }
+}
+
+// ---- servo ----
+
+namespace servo {
+    Calibration::Calibration(CalibrationType default_type) {
+        switch (default_type) {
+            case LINEAR:
+                apply_two_pairs(500.0f, 2500.0f, 0.0f, 1.0f);
+                break;
+            case CONTINUOUS:
+                apply_three_pairs(500.0f, 1500.0f, 2500.0f, -1.0f, 0.0f, 1.0f);
+                break;
+            case ANGULAR:
+            default:
+                apply_three_pairs(500.0f, 1500.0f, 2500.0f, -90.0f, 0.0f, 90.0f);
+                break;
+        }
+    }
+
+    void Calibration::apply_two_pairs(float min_pulse, float max_pulse, float min_value, float max_value) {
+        pairs[0] = {min_pulse, min_value};
+        pairs[1] = {max_pulse, max_value};
+        count = 2;
+    }
+
+    void Calibration::apply_three_pairs(float min_pulse, float mid_pulse, float max_pulse, float min_value,
+                                        float mid_value, float max_value) {
+        pairs[0] = {min_pulse, min_value};
+        pairs[1] = {mid_pulse, mid_value};
+        pairs[2] = {max_pulse, max_value};
+        count = 3;
+    }
+
+    float Calibration::value_to_pulse(float value) const {
+        value = std::clamp(value, std::min(first_value(), last_value()), std::max(first_value(), last_value()));
+        for (uint i = 0; i + 1 < count; i++) {
+            const Pair &lo = pairs[i];
+            const Pair &hi = pairs[i + 1];
+            if ((value >= lo.value && value <= hi.value) || (value <= lo.value && value >= hi.value)) {
+                const float span = hi.value - lo.value;
+                return span == 0.0f ? lo.pulse : lo.pulse + (value - lo.value) * (hi.pulse - lo.pulse) / span;
+            }
+        }
+        return pairs[count - 1].pulse;
+    }
+
+    float Calibration::pulse_to_value(float pulse) const {
+        for (uint i = 0; i + 1 < count; i++) {
+            const Pair &lo = pairs[i];
+            const Pair &hi = pairs[i + 1];
+            if ((pulse >= lo.pulse && pulse <= hi.pulse) || (pulse <= lo.pulse && pulse >= hi.pulse)) {
+                const float span = hi.pulse - lo.pulse;
+                return span == 0.0f ? lo.value : lo.value + (pulse - lo.pulse) * (hi.value - lo.value) / span;
+            }
+        }
+        return pairs[count - 1].value;
+    }
+
+    Servo::Servo(uint pin, CalibrationType default_type, float freq)
+        : servo_pin(pin), servo_calibration(default_type) {
+        (void)freq;
+    }
+
+    Servo::~Servo() {
+        HOST_HAL::setServo(servo_pin, servo_value, false);
+    }
+
+    bool Servo::init() {
+        publish();
+        return true;
+    }
+
+    void Servo::enable() {
+        enabled = true;
+        publish();
+    }
+
+    void Servo::disable() {
+        enabled = false;
+        publish();
+    }
+
+    void Servo::pulse(float pulse) {
+        servo_pulse = pulse;
+        servo_value = servo_calibration.pulse_to_value(pulse);
+        enabled = true;
+        publish();
+    }
+
+    void Servo::value(float value) {
+        servo_pulse = servo_calibration.value_to_pulse(value);
+        servo_value = servo_calibration.pulse_to_value(servo_pulse);
+        enabled = true;
+        publish();
+    }
+
+    void Servo::publish() const {
+        HOST_HAL::setServo(servo_pin, servo_value, enabled);
+    }
+}
+
+// ---- CPPM receiver ----
+
+CPPMDecoder::CPPMDecoder(uint gpio_pin, PIO pio, uint channel_count, double sync_period_us, double min_period_us,
+                         double max_period_us)
+    : channel_count(channel_count), min_period_us(min_period_us), max_period_us(max_period_us) {
+    (void)gpio_pin;
+    (void)pio;
+    (void)sync_period_us;
+}
+
+void CPPMDecoder::sharedInit(uint irq_index) {
+    (void)irq_index;
+}
+
+void CPPMDecoder::startListening() {
+    listening = true;
+}
+
+void CPPMDecoder::stopListening() {
+    listening = false;
+}
+
+double CPPMDecoder::getChannelValue(uint channel) const {
+    if (!listening || channel >= channel_count) {
+        return 0.0;
+    }
+    return HOST_HAL::receiverChannel(channel);
+}
+
+double CPPMDecoder::getChannelUs(uint channel) const {
+    const double mid = (min_period_us + max_period_us) / 2.0;
+    return mid + getChannelValue(channel) * (max_period_us - min_period_us) / 2.0;
+}
+
+uint64_t CPPMDecoder::getFrameAgeUs() const {
+    if (!listening || HOST_HAL::receiverFrameUs() == 0) {
+        return 0;
+    }
+    return HOST_HAL::nowUs() - HOST_HAL::receiverFrameUs();
+}
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <vector>
+#include "pico/time.h"
+#include "hardware/timer.h"
+#include "host_hal.h"
+
+namespace {
+    uint64_t currentUs = 0;
+    int interruptDepth = 0;
+    std::vector<repeating_timer_t*> timers;
+
+    struct Alarm {
+        alarm_id_t id;
+        uint64_t fireUs;
+        alarm_callback_t callback;
+        void* userData;
+    };
+
+    std::vector<Alarm> alarms;
+    alarm_id_t nextAlarmId = 1;
+
+    repeating_timer_t* nextDueTimer(uint64_t limitUs) {
+        repeating_timer_t* due = nullptr;
+        for (auto* timer : timers) {
+            if (timer->next_fire_us <= limitUs && (due == nullptr || timer->next_fire_us < due->next_fire_us)) {
+                due = timer;
+            }
+        }
+        return due;
+    }
+
+    Alarm* nextDueAlarm(uint64_t limitUs) {
+        Alarm* due = nullptr;
+        for (auto& alarm : alarms) {
+            if (alarm.fireUs <= limitUs && (due == nullptr || alarm.fireUs < due->fireUs)) {
+                due = &alarm;
+            }
+        }
+        return due;
+    }
+
+    void fireAlarm(alarm_id_t id) {
+        auto it = std::find_if(alarms.begin(), alarms.end(), [id](const Alarm& alarm) { return alarm.id == id; });
+        const Alarm alarm = *it;
+        alarms.erase(it);
+        currentUs = std::max(currentUs, alarm.fireUs);
+        interruptDepth++;
+        const int64_t again = alarm.callback(alarm.id, alarm.userData);
+        interruptDepth--;
+        if (again != 0) {
+            const uint64_t fireUs = again > 0 ? alarm.fireUs + static_cast<uint64_t>(again)
+                                              : currentUs + static_cast<uint64_t>(-again);
+            alarms.push_back({alarm.id, fireUs, alarm.callback, alarm.userData});
+        }
+    }
+
+    void fire(repeating_timer_t* timer) {
+        const uint64_t scheduledUs = timer->next_fire_us;
+        currentUs = std::max(currentUs, scheduledUs);
+        interruptDepth++;
+        const bool repeat = timer->callback(timer);
+        interruptDepth--;
+        if (!repeat) {
+            cancel_repeating_timer(timer);
+        }
+        if (!timer->active) {
+            return;
+        }
+        // Same rescheduling rule as the SDK alarm pool: a positive delay is measured from the end of the
+        // callback, a negative one from the previous scheduled start.
+        if (timer->delay_us < 0) {
+            timer->next_fire_us = scheduledUs + static_cast<uint64_t>(-timer->delay_us);
+        } else {
+            timer->next_fire_us = currentUs + static_cast<uint64_t>(timer->delay_us);
+        }
+    }
+}
+
+namespace HOST_HAL {
+    uint64_t nowUs() {
+        return currentUs;
+    }
+
+    void runUntil(uint64_t targetUs) {
+        if (interruptDepth > 0) {
+            consumeUs(targetUs > currentUs ? targetUs - currentUs : 0);
+            return;
+        }
+        while (true) {
+            const uint64_t limitUs = std::max(targetUs, currentUs);
+            auto* timer = nextDueTimer(limitUs);
+            const Alarm* alarm = nextDueAlarm(limitUs);
+            if (alarm != nullptr && (timer == nullptr || alarm->fireUs < timer->next_fire_us)) {
+                fireAlarm(alarm->id);
+            } else if (timer != nullptr) {
+                fire(timer);
+            } else {
+                break;
+            }
+        }
+        currentUs = std::max(currentUs, targetUs);
+    }
+
+    void consumeUs(uint64_t us) {
+        currentUs += us;
+    }
+
+    bool inInterrupt() {
+        return interruptDepth > 0;
+    }
+}
+
+namespace HOST_HAL_DETAIL {
+    // Used by the GPIO and UART shims to run external callbacks in interrupt context.
+    void enterInterrupt() {
+        interruptDepth++;
+    }
+
+    void exitInterrupt() {
+        interruptDepth--;
+    }
+}
+
+extern "C" {
+
+absolute_time_t get_absolute_time(void) {
+    return currentUs;
+}
+
+void sleep_us(uint64_t us) {
+    HOST_HAL::runUntil(currentUs + us);
+}
+
+void sleep_ms(uint32_t ms) {
+    sleep_us(static_cast<uint64_t>(ms) * 1000);
+}
+
+void sleep_until(absolute_time_t target) {
+    HOST_HAL::runUntil(target);
+}
+
+void busy_wait_us(uint64_t delay_us) {
+    HOST_HAL::runUntil(currentUs + delay_us);
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *out) {
+    if (delay_us == 0) {
+        delay_us = 1;
+    }
+    out->delay_us = delay_us;
+    out->callback = callback;
+    out->user_data = user_data;
+    out->next_fire_us = currentUs + static_cast<uint64_t>(delay_us < 0 ? -delay_us : delay_us);
+    out->active = true;
+    if (std::find(timers.begin(), timers.end(), out) == timers.end()) {
+        timers.push_back(out);
+    }
+    return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+    auto it = std::find(timers.begin(), timers.end(), timer);
+    if (it == timers.end()) {
+        return false;
+    }
+    timer->active = false;
+    timers.erase(it);
+    return true;
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+    if (us == 0 && !fire_if_past) {
+        return 0;
+    }
+    const alarm_id_t id = nextAlarmId++;
+    alarms.push_back({id, currentUs + us, callback, user_data});
+    return id;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id) {
+    auto it = std::find_if(alarms.begin(), alarms.end(),
+                           [alarm_id](const Alarm& alarm) { return alarm.id == alarm_id; });
+    if (it == alarms.end()) {
+        return false;
+    }
+    alarms.erase(it);
+    return true;
+}
+
+}
@@ -0,0 +1,133 @@
+#include <array>
+#include <deque>
+#include "hardware/uart.h"
+#include "hardware/irq.h"
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "host_hal_detail.h"
+
+uart_inst_t uart0_inst = {0};
+uart_inst_t uart1_inst = {1};
+
+namespace {
+    struct Uart {
+        std::deque<uint8_t> rx;
+        bool rxIrqEnabled = false;
+    };
+
+    std::array<Uart, 2> uarts;
+    std::deque<uint8_t> console;
+    std::array<irq_handler_t, NUM_IRQS> handlers{};
+    std::array<bool, NUM_IRQS> enabledIrqs{};
+}
+
+namespace HOST_HAL {
+    void consoleInject(const char* data, size_t len) {
+        console.insert(console.end(), data, data + len);
+    }
+
+    void uartInject(uart_inst_t* uart, const uint8_t* data, size_t len) {
+        Uart& port = uarts[uart->index];
+        port.rx.insert(port.rx.end(), data, data + len);
+
+        const uint irq = uart->index == 0 ? UART0_IRQ : UART1_IRQ;
+        if (port.rxIrqEnabled && enabledIrqs[irq] && handlers[irq] != nullptr) {
+            HOST_HAL_DETAIL::runInInterrupt(handlers[irq]);
+        }
+    }
+}
+
+extern "C" {
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void)timeout_us;
+    if (console.empty()) {
+        return PICO_ERROR_TIMEOUT;
+    }
+    const uint8_t c = console.front();
+    console.pop_front();
+    return c;
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate) {
+    uarts[uart->index].rx.clear();
+    return baudrate;
+}
+
+void uart_deinit(uart_inst_t *uart) {
+    uarts[uart->index].rx.clear();
+}
+
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate) {
+    (void)uart;
+    return baudrate;
+}
+
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity) {
+    (void)uart;
+    (void)data_bits;
+    (void)stop_bits;
+    (void)parity;
+}
+
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts) {
+    (void)uart;
+    (void)cts;
+    (void)rts;
+}
+
+void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled) {
+    (void)uart;
+    (void)enabled;
+}
+
+void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data) {
+    (void)tx_needs_data;
+    uarts[uart->index].rxIrqEnabled = rx_has_data;
+}
+
+bool uart_is_readable(uart_inst_t *uart) {
+    return !uarts[uart->index].rx.empty();
+}
+
+char uart_getc(uart_inst_t *uart) {
+    Uart& port = uarts[uart->index];
+    if (port.rx.empty()) {
+        return 0;
+    }
+    const auto c = static_cast<char>(port.rx.front());
+    port.rx.pop_front();
+    return c;
+}
+
+void uart_read_blocking(uart_inst_t *uart, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = static_cast<uint8_t>(uart_getc(uart));
+    }
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len) {
+    (void)uart;
+    (void)src;
+    (void)len;
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    handlers[num] = handler;
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler) {
+    if (handlers[num] == handler) {
+        handlers[num] = nullptr;
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    enabledIrqs[num] = enabled;
+}
+
+bool irq_is_enabled(uint num) {
+    return enabledIrqs[num];
+}
+
+}
@@ -0,0 +1,18 @@
+// Reads flight recorder dumps back out of a telemetry capture, for the tools that replay or score them.
+
+#ifndef OSOD_HOST_FLIGHT_CAPTURE_H
+#define OSOD_HOST_FLIGHT_CAPTURE_H
+
+#include <cstdio>
+#include <vector>
+#include "flight_recorder.h"
+
+namespace SIM {
+
+    // Decodes every flight record in the capture. A capture may hold several dumps, which can overlap, so
+    // records are keyed by tick and the last contiguous run of ticks is returned.
+    std::vector<FLIGHT_RECORDER::TickRecord> loadTicks(FILE* input);
+
+} // SIM
+
+#endif //OSOD_HOST_FLIGHT_CAPTURE_H
@@ -0,0 +1,61 @@
+// Rigid-body model of the robot used to close the loop around the firmware on the host.
+//
+// The rear wheels are first-order lags on the motor duty the stokers command and the body moves
+// on their kinematics, as the state estimator assumes. The front wheels roll with the body at
+// the angle their servos are set to, and any wheel can be made to spin beyond its rolling. The
+// ToF sensors see the walls of a square arena centred on the origin. All angles follow the firmware convention: heading is
+// counter-clockwise positive and a body at heading h travels along (-sin h, cos h).
+
+#ifndef OSOD_HOST_SIM_PLANT_H
+#define OSOD_HOST_SIM_PLANT_H
+
+#include <array>
+#include "drivetrain_config.h"
+#include "types.h"
+
+namespace SIM {
+    using COMMON::MOTOR_POSITION::MotorPosition;
+
+    struct PlantConfig {
+        double wheelTimeConstantS = 0.04;   // motor + gearbox response to a duty step
+        double arenaSize = CONFIG::ARENA_SIZE;
+        // fraction each wheel turns beyond its rolling, indexed by MOTOR_POSITION; 0.3 reads 30% long
+        std::array<double, COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT> wheelSpin{};
+    };
+
+    class Plant {
+    public:
+        Plant(CONFIG::SteeringStyle style, const PlantConfig& config = PlantConfig());
+
+        void setPose(double x, double y, double heading);
+
+        // Read the motor commands from the HAL, integrate the wheels and the body over dtS,
+        // and publish the resulting encoder counts back to the HAL.
+        void step(double dtS);
+
+        double x() const { return poseX; }
+        double y() const { return poseY; }
+        double heading() const { return poseHeading; }
+        double yawRate() const { return bodyYawRate; }
+        double speed() const { return bodySpeed; }
+        double wheelRate(MotorPosition wheel) const { return wheelRates[wheel]; }
+
+        // Distance from the face of a ToF sensor to the wall it points at, in metres.
+        double tofRange(int sensor) const;
+
+    private:
+        double rayToWall(double angle) const;
+
+        CONFIG::SteeringStyle driveDirection;
+        PlantConfig config;
+        double poseX = 0.0;
+        double poseY = 0.0;
+        double poseHeading = 0.0;
+        double bodySpeed = 0.0;
+        double bodyYawRate = 0.0;
+        std::array<double, COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT> wheelRates{};
+        std::array<double, COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT> wheelCounts{};
+    };
+}
+
+#endif //OSOD_HOST_SIM_PLANT_H
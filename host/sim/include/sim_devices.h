@@ -0,0 +1,124 @@
+// Simulated I2C peripherals: the four TF-Luna rangefinders and the BNO08x IMU.
+//
+// Each device samples the plant on its own schedule from service(), which the simulation calls
+// every physics step, and answers I2C transactions with the most recent data the real part
+// would have available.
+
+#ifndef OSOD_HOST_SIM_DEVICES_H
+#define OSOD_HOST_SIM_DEVICES_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+#include "host_hal.h"
+
+namespace SIM {
+
+    class TfLunaDevice : public HOST_HAL::I2CDevice {
+    public:
+        // rangeM returns the true distance from the sensor face in metres
+        TfLunaDevice(std::function<double()> rangeM, uint64_t framePeriodUs = 10000);
+
+        void service(uint64_t nowUs);
+
+        // Spoils a fraction of the frames, alternately with a weak return (strength and distance zero, as the
+        // sensor reports one) and with a spike (a strong return from a random distance short of the wall).
+        void setGlitches(double fraction, uint32_t seed);
+
+        int write(const uint8_t* src, size_t len) override;
+        int read(uint8_t* dst, size_t len) override;
+
+    private:
+        std::function<double()> rangeM;
+        uint64_t framePeriodUs;
+        uint64_t nextFrameUs = 0;
+        double glitchFraction = 0.0;
+        std::mt19937 random;
+        bool nextGlitchWeak = true;
+        uint8_t frame[9]{};
+        uint8_t latched[9]{};
+    };
+
+    struct ImuTruth {
+        double yaw;       // radians, counter-clockwise positive
+        double yawRate;   // radians per second
+    };
+
+    struct Bno08xStats {
+        uint32_t reads;             // read transactions
+        uint32_t emptyReads;        // reads that found nothing to send
+        uint64_t bytesRead;
+        uint32_t packetsDelivered;
+        uint64_t deliverySumUs;     // from a packet being ready to the read that takes its last byte
+        uint64_t maxDeliveryUs;
+    };
+
+    // Speaks enough SHTP for the vendored SH2 driver: the reset advertisement, product ids,
+    // set-feature commands and periodic input reports (batched behind a base-timestamp reference
+    // on the normal input channel, gyro-integrated RV on its own channel).
+    class Bno08xDevice : public HOST_HAL::I2CDevice {
+    public:
+        explicit Bno08xDevice(std::function<ImuTruth()> truth);
+
+        void service(uint64_t nowUs);
+
+        // Drive INT on this pin: pulled low from service() while there is something to read, released
+        // when a read starts.
+        void setInterruptPin(uint pin);
+
+        // Make a complete SHTP packet (header included) readable at atUs, as a scripted byte stream
+        // alongside or instead of the reports the plant generates. The device numbers each transfer itself.
+        void script(uint64_t atUs, std::vector<uint8_t> packet);
+
+        int write(const uint8_t* src, size_t len) override;
+        int read(uint8_t* dst, size_t len) override;
+
+        uint32_t reportsDropped() const { return droppedReports; }
+
+        const Bno08xStats& stats() const { return statistics; }
+
+        void resetStats() { statistics = {}; }
+
+    private:
+        struct Sensor {
+            uint32_t intervalUs = 0;
+            uint64_t nextDueUs = 0;
+            uint8_t sequence = 0;
+        };
+
+        struct PendingReport {
+            uint64_t sampleUs;
+            std::vector<uint8_t> bytes;
+        };
+
+        void reset();
+        void queuePacket(uint8_t channel, const std::vector<uint8_t>& payload, uint64_t readyUs);
+        void queuePacket(uint8_t channel, const std::vector<uint8_t>& payload);
+        void queueAdvertisement();
+        void queueProductIds();
+        void handleControl(const uint8_t* payload, size_t len);
+        std::vector<uint8_t> makeReport(uint8_t sensorId, Sensor& sensor, const ImuTruth& truth) const;
+        bool buildInputPacket(uint64_t interruptUs);
+        bool hasData() const;
+
+        std::function<ImuTruth()> truth;
+        std::map<uint8_t, Sensor> sensors;
+        std::deque<PendingReport> pendingInputs;
+        std::deque<PendingReport> pendingGyroRv;
+        std::deque<PendingReport> scripted;
+        std::deque<PendingReport> outgoing;    // sampleUs is when the packet became ready to read
+        PendingReport current{};
+        size_t currentOffset = 0;
+        uint8_t sequenceNumbers[6]{};
+        uint32_t droppedReports = 0;
+        int interruptPin = -1;
+        bool interruptAsserted = false;
+        uint64_t interruptAssertedUs = 0;
+        Bno08xStats statistics{};
+    };
+}
+
+#endif //OSOD_HOST_SIM_DEVICES_H
@@ -0,0 +1,244 @@
+// BNO08x servicing benchmark: polling every estimator tick against reading from the INT line.
+//
+// The simulated hub plays three scripted SHTP byte streams. The first is gyro-integrated rotation vector
+// packets: two seconds at 100 Hz, two seconds at 40 Hz (slower than the estimator ticks) and a short
+// silence. The second is rotation vector reports behind a base timestamp: two seconds of four-report
+// batches every 10 ms, then two seconds of single reports. The third is a rotation vector every 10 ms with
+// a gyro and a linear acceleration report behind it in the same packet. Each stream is played once with
+// the driver polled from a 10 ms tick (CONFIG::POLLED), and once with it reading from INT. For each it
+// reports the heading reports drained from the driver's queue, the IMU's bus transactions, how many found
+// the hub empty, the bytes on the wire per byte of SHTP cargo, the bus time per report, how long a packet
+// waited from being ready to being read, and how long the tick itself spent on the IMU.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "i2c_engine.h"
+#include "bno080.h"
+#include "drivetrain_config.h"
+#include "utils.h"
+#include "sim_devices.h"
+
+namespace {
+    constexpr uint64_t TICK_US = 10000;
+    constexpr uint64_t STEP_US = 100;
+    constexpr uint64_t REPORT_PHASE_US = 3700;  // the hub's reports don't line up with the estimator's ticks
+    constexpr uint8_t CHANNEL_INPUT_NORMAL = 3;
+    constexpr uint8_t CHANNEL_GYRO_RV = 5;
+    constexpr size_t SHTP_HEADER_LEN = 4;
+
+    struct Segment {
+        uint64_t durationUs;
+        uint64_t intervalUs;        // 0 for silence
+        uint32_t reportsPerPacket;
+        bool extras;                // a gyro and a linear acceleration report follow the rotation vectors
+    };
+
+    struct Stream {
+        const char* name;
+        uint8_t sensorId;
+        std::vector<Segment> segments;
+    };
+
+    const Stream STREAMS[] = {
+            {"gyro RV", SENSOR_REPORTID_GYRO_INTEGRATED_ROTATION_VECTOR,
+             {{2000000, 10000, 1, false}, {2000000, 25000, 1, false}, {300000, 0, 0, false}}},
+            {"rotation vector", SENSOR_REPORTID_ROTATION_VECTOR,
+             {{2000000, 10000, 4, false}, {2000000, 10000, 1, false}}},
+            {"RV+gyro+accel", SENSOR_REPORTID_ROTATION_VECTOR, {{2000000, 10000, 1, true}}},
+    };
+
+    void putQ(std::vector<uint8_t>& out, double value, int qPoint) {
+        const auto raw = static_cast<int16_t>(std::lround(value * (1 << qPoint)));
+        out.push_back(static_cast<uint16_t>(raw) & 0xFF);
+        out.push_back(static_cast<uint16_t>(raw) >> 8);
+    }
+
+    void putQuaternion(std::vector<uint8_t>& out, double yaw) {
+        putQ(out, 0.0, 14);
+        putQ(out, 0.0, 14);
+        putQ(out, std::sin(yaw / 2.0), 14);
+        putQ(out, std::cos(yaw / 2.0), 14);
+    }
+
+    // the simulated hub fills in the sequence number
+    void putHeader(std::vector<uint8_t>& packet, uint8_t channel) {
+        const auto length = static_cast<uint16_t>(packet.size() + SHTP_HEADER_LEN);
+        const uint8_t header[SHTP_HEADER_LEN] = {static_cast<uint8_t>(length & 0xFF),
+                                                 static_cast<uint8_t>(length >> 8), channel, 0};
+        packet.insert(packet.begin(), std::begin(header), std::end(header));
+    }
+
+    // A gyro-integrated RV packet: quaternion Q14, angular velocity Q10.
+    std::vector<uint8_t> gyroRvPacket(double yaw, double yawRate) {
+        std::vector<uint8_t> packet;
+        putQuaternion(packet, yaw);
+        putQ(packet, 0.0, 10);
+        putQ(packet, 0.0, 10);
+        putQ(packet, yawRate, 10);
+        putHeader(packet, CHANNEL_GYRO_RV);
+        return packet;
+    }
+
+    // A base timestamp reference and `reports` rotation vector reports, sampled 2.5 ms apart, optionally
+    // followed by a gyro (Q9 rad/s) and a linear acceleration (Q8 m/s^2) report.
+    std::vector<uint8_t> rotationVectorPacket(uint32_t firstReport, double yaw, uint32_t reports, bool extras) {
+        std::vector<uint8_t> packet = {0xFB, 0, 0, 0, 0};
+        for (uint32_t i = 0; i < reports; i++) {
+            const auto delay = static_cast<uint8_t>(25 * i);    // 100 us units
+            packet.insert(packet.end(), {SENSOR_REPORTID_ROTATION_VECTOR, static_cast<uint8_t>(firstReport + i), 0x03,
+                                         delay});
+            putQuaternion(packet, yaw + 0.001 * i);
+            putQ(packet, 0.05, 12);
+        }
+        if (extras) {
+            packet.insert(packet.end(), {SENSOR_REPORTID_GYROSCOPE_CALIBRATED, static_cast<uint8_t>(firstReport), 0x03, 0});
+            putQ(packet, 0.0, 9);
+            putQ(packet, 0.0, 9);
+            putQ(packet, 0.1, 9);
+            packet.insert(packet.end(), {SENSOR_REPORTID_LINEAR_ACCELERATION, static_cast<uint8_t>(firstReport), 0x03, 0});
+            putQ(packet, 0.2, 8);
+            putQ(packet, 0.0, 8);
+            putQ(packet, 0.0, 8);
+        }
+        putHeader(packet, CHANNEL_INPUT_NORMAL);
+        return packet;
+    }
+
+    struct Script {
+        uint32_t reports;
+        uint64_t cargoBytes;
+        uint64_t durationUs;
+    };
+
+    // Scripts the stream from startUs.
+    Script scriptStream(const Stream& stream, SIM::Bno08xDevice& device, uint64_t startUs) {
+        Script script{};
+        uint64_t segmentUs = startUs;
+        for (const Segment& segment : stream.segments) {
+            const uint64_t endUs = segmentUs + segment.durationUs;
+            for (uint64_t atUs = segmentUs + REPORT_PHASE_US; segment.intervalUs != 0 && atUs < endUs;
+                 atUs += segment.intervalUs) {
+                const double yaw = 0.001 * script.reports;
+                std::vector<uint8_t> packet = stream.sensorId == SENSOR_REPORTID_ROTATION_VECTOR
+                                              ? rotationVectorPacket(script.reports, yaw, segment.reportsPerPacket,
+                                                                     segment.extras)
+                                              : gyroRvPacket(yaw, 0.1);
+                script.cargoBytes += packet.size() - SHTP_HEADER_LEN;
+                script.reports += segment.reportsPerPacket;
+                device.script(atUs, std::move(packet));
+            }
+            segmentUs = endUs;
+        }
+        script.durationUs = segmentUs - startUs + TICK_US;
+        return script;
+    }
+
+    // Steps the hub and runs the estimator's IMU read every tick until the script has played out. Returns
+    // whether every scripted report was decoded.
+    bool run(const Stream& stream, const char* mode, BNO08x& imu, SIM::Bno08xDevice& device,
+             I2C_ENGINE::I2CEngine& engine) {
+        const uint64_t startUs = HOST_HAL::nowUs();
+        const Script script = scriptStream(stream, device, startUs);
+        device.resetStats();
+        const uint64_t busStartUs = HOST_HAL::i2cStats(i2c0).busyUs;
+        const bool polled = !imu.interruptDriven();
+
+        uint32_t decoded = 0;
+        uint32_t ticks = 0;
+        uint64_t tickImuSumUs = 0;
+        uint64_t tickImuMaxUs = 0;
+        uint64_t nextTickUs = startUs + TICK_US;
+        uint64_t simUs = startUs;
+        while (simUs < startUs + script.durationUs) {
+            simUs += STEP_US;
+            device.service(simUs);
+            HOST_HAL::runUntil(simUs);
+            simUs = std::max(simUs, HOST_HAL::nowUs());
+            engine.service();
+            if (simUs < nextTickUs) {
+                continue;
+            }
+            nextTickUs += TICK_US;
+
+            const uint64_t tickUs = HOST_HAL::nowUs();
+            const uint32_t reportLimit = polled ? CONFIG::IMU_REPORTS_PER_TICK : UINT32_MAX;
+            for (uint32_t i = 0; i < reportLimit && imu.getSensorEvent(); i++) {
+            }
+            BNO08xEvent event;
+            while (imu.drainSensorEvents(stream.sensorId, &event, 1) == 1) {
+                decoded++;
+            }
+            const uint64_t spentUs = HOST_HAL::nowUs() - tickUs;
+            tickImuSumUs += spentUs;
+            tickImuMaxUs = std::max(tickImuMaxUs, spentUs);
+            ticks++;
+        }
+        const uint64_t busUs = HOST_HAL::i2cStats(i2c0).busyUs - busStartUs;
+
+        // each transaction also puts the address byte on the wire
+        const SIM::Bno08xStats& stats = device.stats();
+        const uint64_t wireBytes = stats.bytesRead + stats.reads;
+        printf("%-15s %-9s %4u/%u reports, %4u reads (%3u empty), %.2f wire bytes per cargo byte, "
+               "%4.0f us of bus per report; packet wait %4.0f/%5llu us, tick on the IMU %4.0f/%4llu us "
+               "(mean/max)\n",
+               stream.name, mode, decoded, script.reports, stats.reads, stats.emptyReads,
+               static_cast<double>(wireBytes) / static_cast<double>(script.cargoBytes),
+               static_cast<double>(busUs) / script.reports,
+               stats.packetsDelivered > 0 ? static_cast<double>(stats.deliverySumUs) / stats.packetsDelivered : 0.0,
+               static_cast<unsigned long long>(stats.maxDeliveryUs),
+               ticks > 0 ? static_cast<double>(tickImuSumUs) / ticks : 0.0,
+               static_cast<unsigned long long>(tickImuMaxUs));
+        return decoded == script.reports;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 1;
+    }
+
+    SIM::Bno08xDevice device([] { return SIM::ImuTruth{0.0, 0.0}; });
+    HOST_HAL::attachI2CDevice(i2c0, CONFIG::BNO08X_ADDR, &device);
+    device.setInterruptPin(CONFIG::IMU_INT_PIN);
+
+    stdio_init_all();
+    i2c_inst_t* port;
+    initI2C(port, false);
+    auto* engine = new I2C_ENGINE::I2CEngine(port);
+
+    BNO08x imu;
+    if (!imu.begin(CONFIG::BNO08X_ADDR, port, engine)) {
+        fprintf(stderr, "simulated BNO08x did not start\n");
+        return 1;
+    }
+    // each enabled report gets its own event queue; a zero interval leaves the simulated hub's own reports
+    // off, as the streams script every report themselves
+    for (const sh2_SensorId_t sensorId : {SENSOR_REPORTID_GYRO_INTEGRATED_ROTATION_VECTOR,
+                                          SENSOR_REPORTID_ROTATION_VECTOR, SENSOR_REPORTID_GYROSCOPE_CALIBRATED,
+                                          SENSOR_REPORTID_LINEAR_ACCELERATION}) {
+        imu.enableReport(sensorId, 0);
+    }
+    // the start-up traffic is not part of any run
+    while (imu.getSensorEvent()) {
+    }
+    BNO08xEvent event;
+    while (imu.drainSensorEvents(SENSOR_REPORTID_GYRO_INTEGRATED_ROTATION_VECTOR, &event, 1) == 1) {
+    }
+
+    for (const Stream& stream : STREAMS) {
+        run(stream, "polled", imu, device, *engine);
+    }
+    imu.serviceOnInterrupt(CONFIG::IMU_INT_PIN);
+    bool lost = false;
+    for (const Stream& stream : STREAMS) {
+        lost |= !run(stream, "interrupt", imu, device, *engine);
+    }
+    return lost ? 1 : 0;
+}
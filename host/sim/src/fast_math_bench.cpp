@@ -0,0 +1,239 @@
+// Accuracy and throughput benchmark for FAST_MATH.
+//
+// Each function is checked against double-precision libm, over a dense sweep plus random inputs spanning
+// the magnitudes the control code uses. The benchmark prints the worst error it found. It then times the
+// function over a buffer of inputs, next to the single-precision libm call it replaces. The host has an
+// FPU, so the timings only compare the two on this machine. On the RP2040 every libm call here is a
+// soft-float routine, and the integer paths gain much more. Build with -DCMAKE_BUILD_TYPE=Release.
+//
+//   fast_math_bench [CALLS]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "fast_math.h"
+#include "utils.h"
+
+namespace {
+    using namespace FAST_MATH;
+
+    constexpr double TWO_PI = 2.0 * M_PI;
+    constexpr double RADIANS_PER_RAW = TWO_PI / 4294967296.0;
+
+    std::mt19937 random(1);
+
+    float logUniform(const float low, const float high) {
+        std::uniform_real_distribution<float> exponent(std::log(low), std::log(high));
+        return std::exp(exponent(random));
+    }
+
+    int32_t signedLogUniform(const float high) {
+        const auto magnitude = static_cast<int32_t>(logUniform(1.0f, high));
+        return random() & 1u ? magnitude : -magnitude;
+    }
+
+    // difference between two angles, wrapped to [-π, π]
+    double angleError(const double a, const double b) {
+        return std::fabs(std::remainder(a - b, TWO_PI));
+    }
+
+    void accuracy(const char* name, const double error, const char* unit) {
+        printf("  %-34s %10.2e %s\n", name, error, unit);
+    }
+
+    void checkAccuracy() {
+        printf("accuracy (worst case)\n");
+        double sinError = 0.0;
+        double cosError = 0.0;
+        for (int i = -2000000; i <= 2000000; i++) {
+            const float x = static_cast<float>(i) * 6.3e-6f; // about ±4 turns
+            float s;
+            float c;
+            sincos(x, s, c);
+            sinError = std::fmax(sinError, std::fabs(s - std::sin(static_cast<double>(x))));
+            cosError = std::fmax(cosError, std::fabs(c - std::cos(static_cast<double>(x))));
+        }
+        accuracy("sin(float)", sinError, "absolute");
+        accuracy("cos(float)", cosError, "absolute");
+
+        double sinQ16Error = 0.0;
+        double cosQ16Error = 0.0;
+        for (int i = 0; i < 4000000; i++) {
+            const BinaryAngle angle = BinaryAngle::fromRaw(static_cast<uint32_t>(random()));
+            const double radians = angle.raw() * RADIANS_PER_RAW;
+            sinQ16Error = std::fmax(sinQ16Error, std::fabs(sinQ16(angle) / 65536.0 - std::sin(radians)));
+            cosQ16Error = std::fmax(cosQ16Error, std::fabs(cosQ16(angle) / 65536.0 - std::cos(radians)));
+        }
+        accuracy("sinQ16", sinQ16Error, "absolute");
+        accuracy("cosQ16", cosQ16Error, "absolute");
+
+        double atanError = 0.0;
+        for (int i = -2000000; i <= 2000000; i++) {
+            const float x = static_cast<float>(i) * 1.0e-5f;
+            atanError = std::fmax(atanError, std::fabs(FAST_MATH::atan(x) - std::atan(static_cast<double>(x))));
+        }
+        atanError = std::fmax(atanError, std::fabs(FAST_MATH::atan(INFINITY) - M_PI_2));
+        accuracy("atan(float)", atanError, "rad");
+
+        double atan2Error = 0.0;
+        double atan2Q16Error = 0.0;
+        for (int i = 0; i < 4000000; i++) {
+            const float radius = logUniform(1.0e-3f, 1.0e3f);
+            const double direction = std::uniform_real_distribution<double>(-M_PI, M_PI)(random);
+            auto y = static_cast<float>(radius * std::sin(direction));
+            auto x = static_cast<float>(radius * std::cos(direction));
+            if (i % 16 == 0) {
+                // along the axes and diagonals too
+                x = (i / 16) % 3 == 0 ? 0.0f : x;
+                y = (i / 16) % 3 == 1 ? 0.0f : (i / 16) % 3 == 2 ? x : y;
+            }
+            atan2Error = std::fmax(atan2Error, angleError(FAST_MATH::atan2(y, x), std::atan2(y, x)));
+
+            const int32_t yQ = signedLogUniform(2.0e9f);
+            const int32_t xQ = signedLogUniform(2.0e9f);
+            atan2Q16Error = std::fmax(atan2Q16Error, angleError(atan2Q16(yQ, xQ).radians(), std::atan2(yQ, xQ)));
+        }
+        accuracy("atan2(float)", atan2Error, "rad");
+        accuracy("atan2Q16", atan2Q16Error, "rad");
+
+        double rsqrtError = 0.0;
+        double hypotError = 0.0;
+        for (int i = 0; i < 4000000; i++) {
+            const float x = logUniform(1.0e-6f, 1.0e6f);
+            rsqrtError = std::fmax(rsqrtError, std::fabs(rsqrt(x) * std::sqrt(static_cast<double>(x)) - 1.0));
+            const float a = (random() & 1u ? 1.0f : -1.0f) * logUniform(1.0e-4f, 1.0e4f);
+            const float b = (random() & 1u ? 1.0f : -1.0f) * logUniform(1.0e-4f, 1.0e4f);
+            const double exact = std::hypot(static_cast<double>(a), static_cast<double>(b));
+            hypotError = std::fmax(hypotError, std::fabs(FAST_MATH::hypot(a, b) / exact - 1.0));
+        }
+        accuracy("rsqrt(float)", rsqrtError, "relative");
+        accuracy("hypot(float)", hypotError, "relative");
+
+        // fixed-point results are held to a relative error, or one LSB where that is larger
+        double sqrtQ16Error = 0.0;
+        double rsqrtQ16Error = 0.0;
+        double hypotQ16Error = 0.0;
+        for (int i = 0; i < 4000000; i++) {
+            const auto x = static_cast<uint32_t>(logUniform(1.0f, 4.2e9f));
+            const double sqrtExact = std::sqrt(x / 65536.0) * 65536.0;
+            sqrtQ16Error = std::fmax(sqrtQ16Error, std::fabs(sqrtQ16(x) - sqrtExact) / std::fmax(sqrtExact, 1.0 / 4e-5));
+            const double rsqrtExact = 65536.0 / std::sqrt(x / 65536.0);
+            rsqrtQ16Error = std::fmax(rsqrtQ16Error, std::fabs(rsqrtQ16(x) - rsqrtExact) / std::fmax(rsqrtExact, 1.0 / 4e-5));
+            const int32_t a = signedLogUniform(2.1e9f);
+            const int32_t b = signedLogUniform(2.1e9f);
+            const double hypotExact = std::hypot(static_cast<double>(a), static_cast<double>(b));
+            hypotQ16Error = std::fmax(hypotQ16Error, std::fabs(hypotQ16(a, b) - hypotExact) / std::fmax(hypotExact, 1.0 / 4e-5));
+        }
+        accuracy("sqrtQ16", sqrtQ16Error, "relative (or 1 LSB)");
+        accuracy("rsqrtQ16", rsqrtQ16Error, "relative (or 1 LSB)");
+        accuracy("hypotQ16", hypotQ16Error, "relative (or 1 LSB)");
+
+        // the old wrap_pi stepped once, so anything more than a turn and a half out stayed out of range. Its error
+        // grows with the input, so it is also given as a share of the bound in the header, 1.5e-9 rad + 1.8e-7 |x|
+        double wrapError = 0.0;
+        double wrapShare = 0.0;
+        for (int i = -1000000; i <= 1000000; i++) {
+            const float x = static_cast<float>(i) * 1.0e-4f; // ±16 turns
+            const double error = angleError(wrap_pi(x), x);
+            wrapError = std::fmax(wrapError, error);
+            wrapShare = std::fmax(wrapShare, error / (1.5e-9 + 1.8e-7 * std::fabs(x)));
+            const float wrapped = wrap_pi(x);
+            if (wrapped < -M_PI - 1e-6 || wrapped > M_PI + 1e-6) {
+                wrapError = INFINITY;
+            }
+        }
+        accuracy("wrap_pi over ±16 turns", wrapError, "rad");
+        accuracy("wrap_pi, share of its bound", wrapShare, "");
+    }
+
+    template<typename Input, typename Function>
+    double nanosecondsPerCall(const std::vector<Input>& inputs, Function function) {
+        volatile float sink = 0.0f;
+        float sum = 0.0f;
+        const auto start = std::chrono::steady_clock::now();
+        for (const Input& input : inputs) {
+            sum += function(input);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        sink = sum;
+        (void) sink;
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count())
+               / static_cast<double>(inputs.size());
+    }
+
+    void throughput(const char* name, const double libm, const double fast) {
+        printf("  %-22s %8.2f ns %8.2f ns\n", name, libm, fast);
+    }
+
+    void checkThroughput(const size_t calls) {
+        struct Pair {
+            float a;
+            float b;
+        };
+        struct IntegerPair {
+            int32_t a;
+            int32_t b;
+        };
+        std::vector<float> angles(calls);
+        std::vector<float> positives(calls);
+        std::vector<Pair> pairs(calls);
+        std::vector<IntegerPair> integerPairs(calls);
+        std::vector<uint32_t> rawAngles(calls);
+        std::uniform_real_distribution<float> angle(-4.0f, 4.0f);
+        std::uniform_real_distribution<float> coordinate(-3.0f, 3.0f);
+        for (size_t i = 0; i < calls; i++) {
+            angles[i] = angle(random);
+            positives[i] = logUniform(1.0e-3f, 1.0e3f);
+            pairs[i] = {coordinate(random), coordinate(random)};
+            integerPairs[i] = {static_cast<int32_t>(pairs[i].a * 65536.0f), static_cast<int32_t>(pairs[i].b * 65536.0f)};
+            rawAngles[i] = static_cast<uint32_t>(random());
+        }
+
+        printf("throughput                       libm     fast_math\n");
+        throughput("sin", nanosecondsPerCall(angles, [](float x) { return std::sin(x); }),
+                   nanosecondsPerCall(angles, [](float x) { return FAST_MATH::sin(x); }));
+        throughput("sin + cos", nanosecondsPerCall(angles, [](float x) { return std::sin(x) + std::cos(x); }),
+                   nanosecondsPerCall(angles, [](float x) {
+                       float s;
+                       float c;
+                       sincos(x, s, c);
+                       return s + c;
+                   }));
+        throughput("atan", nanosecondsPerCall(angles, [](float x) { return std::atan(x); }),
+                   nanosecondsPerCall(angles, [](float x) { return FAST_MATH::atan(x); }));
+        throughput("atan2", nanosecondsPerCall(pairs, [](Pair p) { return std::atan2(p.a, p.b); }),
+                   nanosecondsPerCall(pairs, [](Pair p) { return FAST_MATH::atan2(p.a, p.b); }));
+        throughput("1/sqrt", nanosecondsPerCall(positives, [](float x) { return 1.0f / std::sqrt(x); }),
+                   nanosecondsPerCall(positives, [](float x) { return rsqrt(x); }));
+        throughput("hypot", nanosecondsPerCall(pairs, [](Pair p) { return std::sqrt(p.a * p.a + p.b * p.b); }),
+                   nanosecondsPerCall(pairs, [](Pair p) { return FAST_MATH::hypot(p.a, p.b); }));
+        throughput("sinQ16 (vs sin)", nanosecondsPerCall(angles, [](float x) { return std::sin(x); }),
+                   nanosecondsPerCall(rawAngles, [](uint32_t raw) {
+                       return static_cast<float>(sinQ16(BinaryAngle::fromRaw(raw)));
+                   }));
+        throughput("atan2Q16 (vs atan2)", nanosecondsPerCall(pairs, [](Pair p) { return std::atan2(p.a, p.b); }),
+                   nanosecondsPerCall(integerPairs, [](IntegerPair p) {
+                       return static_cast<float>(atan2Q16(p.a, p.b).signedRaw());
+                   }));
+        throughput("hypotQ16 (vs hypot)", nanosecondsPerCall(pairs, [](Pair p) { return std::sqrt(p.a * p.a + p.b * p.b); }),
+                   nanosecondsPerCall(integerPairs, [](IntegerPair p) {
+                       return static_cast<float>(hypotQ16(p.a, p.b));
+                   }));
+        throughput("wrap_pi (vs remainder)", nanosecondsPerCall(angles, [](float x) { return std::remainder(x, static_cast<float>(TWO_PI)); }),
+                   nanosecondsPerCall(angles, [](float x) { return wrap_pi(x); }));
+    }
+}
+
+int main(int argc, char** argv) {
+    const long calls = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 4000000;
+    if (calls <= 0) {
+        fprintf(stderr, "usage: %s [CALLS]\n", argv[0]);
+        return 1;
+    }
+    checkAccuracy();
+    checkThroughput(static_cast<size_t>(calls));
+    return 0;
+}
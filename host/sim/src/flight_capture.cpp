@@ -0,0 +1,37 @@
+#include "flight_capture.h"
+#include <cstring>
+#include <map>
+#include "telemetry.h"
+#include "telemetry_decoder.h"
+
+namespace SIM {
+
+    std::vector<FLIGHT_RECORDER::TickRecord> loadTicks(FILE* input) {
+        using FLIGHT_RECORDER::TickRecord;
+        TELEMETRY::FrameDecoder decoder;
+        TELEMETRY::Frame frame{};
+        std::map<uint32_t, TickRecord> byTick;
+        int byte;
+        while ((byte = std::fgetc(input)) != EOF) {
+            decoder.push(static_cast<uint8_t>(byte));
+            while (decoder.next(frame)) {
+                if (frame.type != TELEMETRY::RECORD::FLIGHT_RECORD || frame.length != sizeof(TickRecord)) {
+                    continue;
+                }
+                TickRecord tick{};
+                std::memcpy(&tick, frame.payload, sizeof(tick));
+                byTick[tick.tick] = tick;
+            }
+        }
+
+        std::vector<TickRecord> ticks;
+        for (const auto& entry : byTick) {
+            if (!ticks.empty() && entry.first != ticks.back().tick + 1) {
+                ticks.clear();
+            }
+            ticks.push_back(entry.second);
+        }
+        return ticks;
+    }
+
+} // SIM
@@ -0,0 +1,139 @@
+// Queueing benchmark for the I2C engine on the simulated bus.
+//
+// Three traffic classes share one bus: a high priority 16-byte read every 5 ms (an IMU packet), the
+// normal priority trigger-and-read of four rangefinders every 10 ms, and a low priority 32-byte read
+// every 50 ms (housekeeping). Each class is submitted from its own timer interrupt, the way firmware
+// drivers would, and the benchmark reports how long each class waited for the bus and how much CPU
+// time the same traffic would have cost through the SDK's blocking calls.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "i2c_engine.h"
+
+namespace {
+    using namespace I2C_ENGINE;
+
+    // Answers every write and every read of any length.
+    class FillerDevice : public HOST_HAL::I2CDevice {
+    public:
+        int write(const uint8_t* src, size_t len) override {
+            (void) src;
+            return static_cast<int>(len);
+        }
+
+        int read(uint8_t* dst, size_t len) override {
+            std::memset(dst, 0x5a, len);
+            return static_cast<int>(len);
+        }
+    };
+
+    struct TrafficClass {
+        const char* name;
+        int64_t periodUs;
+        Transfer transfers[8];
+        size_t transferCount;
+        uint32_t rounds;
+        uint32_t skipped;   // transfers not resubmitted because the previous one was still queued
+        repeating_timer_t timer;
+    };
+
+    I2CEngine* engine;
+    uint8_t readBuffer[64];
+    const uint8_t command[5] = {0x5A, 0x05, 0x00, 0x01, 0x60};
+
+    bool submitRound(repeating_timer_t* timer) {
+        auto* traffic = static_cast<TrafficClass*>(timer->user_data);
+        for (size_t i = 0; i < traffic->transferCount; i++) {
+            if (!engine->submit(traffic->transfers[i])) {
+                traffic->skipped++;
+            }
+        }
+        traffic->rounds++;
+        return true;
+    }
+
+    Transfer makeRead(uint8_t address, size_t length, Priority priority, uint32_t deadlineUs) {
+        Transfer transfer;
+        transfer.address = address;
+        transfer.readData = readBuffer;
+        transfer.readLength = length;
+        transfer.priority = priority;
+        transfer.deadlineUs = deadlineUs;
+        return transfer;
+    }
+
+    Transfer makeWrite(uint8_t address, Priority priority, uint32_t deadlineUs) {
+        Transfer transfer;
+        transfer.address = address;
+        transfer.writeData = command;
+        transfer.writeLength = sizeof(command);
+        transfer.priority = priority;
+        transfer.deadlineUs = deadlineUs;
+        return transfer;
+    }
+}
+
+int main(int argc, char** argv) {
+    double seconds = 10.0;
+    uint baudrate = 100 * 1000;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+            baudrate = static_cast<uint>(std::atoi(argv[++i]));
+        } else {
+            fprintf(stderr, "usage: %s [--seconds N] [--baud HZ]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FillerDevice device;
+    for (uint8_t address = 0x10; address <= 0x4a; address++) {
+        HOST_HAL::attachI2CDevice(i2c0, address, &device);
+    }
+    i2c_init(i2c0, baudrate);
+    engine = new I2CEngine(i2c0);
+
+    TrafficClass imu{"high", -5000, {makeRead(0x4a, 16, Priority::HIGH, 0)}, 1, 0, 0, {}};
+    TrafficClass tof{"normal", -10000, {}, 8, 0, 0, {}};
+    for (size_t i = 0; i < 4; i++) {
+        const auto address = static_cast<uint8_t>(0x11 + i);
+        tof.transfers[2 * i] = makeWrite(address, Priority::NORMAL, 10000);
+        tof.transfers[2 * i + 1] = makeRead(address, 9, Priority::NORMAL, 10000);
+    }
+    TrafficClass housekeeping{"low", -50000, {makeRead(0x48, 32, Priority::LOW, 0)}, 1, 0, 0, {}};
+
+    TrafficClass* classes[] = {&imu, &tof, &housekeeping};
+    for (auto* traffic : classes) {
+        add_repeating_timer_us(traffic->periodUs, submitRound, traffic, &traffic->timer);
+    }
+
+    const uint64_t startUs = HOST_HAL::nowUs();
+    const auto durationUs = static_cast<uint64_t>(seconds * 1e6);
+    while (HOST_HAL::nowUs() - startUs < durationUs) {
+        HOST_HAL::advanceUs(100);
+        engine->service();
+    }
+
+    const I2CEngineStats stats = engine->stats();
+    const HOST_HAL::I2CStats bus = HOST_HAL::i2cStats(i2c0);
+    const double elapsedUs = static_cast<double>(HOST_HAL::nowUs() - startUs);
+    printf("%.1f s at %u Hz: %u submitted, %u completed, %u failed, %u expired, max queue depth %u\n",
+           elapsedUs * 1e-6, baudrate, stats.submitted, stats.completed, stats.failed, stats.expired,
+           stats.maxQueueDepth);
+    for (size_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+        const TrafficClass* traffic = classes[priority];
+        printf("  %-6s every %5lld us: queue latency %6.0f us mean, %6u us max, %u submissions skipped "
+               "(previous still in flight)\n",
+               traffic->name, static_cast<long long>(-traffic->periodUs), stats.meanQueueLatencyUs[priority],
+               stats.maxQueueLatencyUs[priority], traffic->skipped);
+    }
+    printf("bus busy %.1f%%; CPU time spent waiting on the bus: 0 us with the engine, %llu us (%.1f%%) "
+           "with blocking calls\n",
+           100.0 * static_cast<double>(stats.busyUs) / elapsedUs, static_cast<unsigned long long>(bus.busyUs),
+           100.0 * static_cast<double>(bus.busyUs) / elapsedUs);
+    return 0;
+}
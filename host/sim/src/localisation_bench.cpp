@@ -0,0 +1,258 @@
+// Cost and accuracy benchmark for the arena localisation kernel.
+//
+// Random poses are drawn inside a 2.2 m arena. For each one, the four ToF ranges the robot would see are
+// computed with 1 cm of noise. Each input goes through two implementations:
+// - the permutation search the state estimator used before the kernel, copied here unchanged
+// - ARENA_LOCALISATION::ArenaLocaliser
+// The run is repeated with one ray in eight replaced by a return off the robot's own chassis, or by an
+// out-of-range reading. The benchmark reports the cost per fix in host nanoseconds and (on x86) TSC cycles,
+// the RMS position error, and how many fixes were more than 10 cm out. Build the host tree with
+// -DCMAKE_BUILD_TYPE=Release for meaningful numbers. On the target the same call runs under the profiler's
+// localisation stage.
+//
+//   localisation_bench [FIXES]
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <tuple>
+#include <vector>
+#include "arena_localisation.h"
+#include "drivetrain_config.h"
+#include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+namespace {
+    using COMMON::FourToFDistances;
+    using COMMON::NUM_TOF_SENSORS;
+    using COMMON::Pose;
+
+    constexpr float ARENA_SIZE = 2.2f;
+    constexpr float MOUNT_OFFSETS[NUM_TOF_SENSORS] = {CONFIG::TOF_FRONT_OFFSET, CONFIG::TOF_RIGHT_OFFSET,
+                                                      CONFIG::TOF_REAR_OFFSET, CONFIG::TOF_LEFT_OFFSET};
+
+    // The state estimator's localisation before the kernel replaced it, unchanged apart from being free
+    // functions with the arena size and drive direction passed in.
+    namespace PERMUTATIONS {
+        struct PermutationResult {
+            std::array<float, NUM_TOF_SENSORS> xList;
+            std::array<float, NUM_TOF_SENSORS> yList;
+            size_t xSize;
+            size_t ySize;
+        };
+
+        std::pair<float, float> calculatePossiblePositions(float angle, float distance) {
+            angle = wrap_pi(angle);
+
+            float x_pos = 0.0f, y_pos = 0.0f;
+
+            if (angle < 0) {
+                x_pos = ARENA_SIZE - distance * cos(angle + M_PI / 2);
+            } else {
+                x_pos = distance * cos(angle + 1.5f * M_PI);
+            }
+
+            if ((angle < (0.5f * M_PI)) && (angle > (-0.5f * M_PI))) {
+                y_pos = ARENA_SIZE - distance * cos(angle);
+            } else {
+                y_pos = distance * cos(angle + M_PI);
+            }
+
+            return {x_pos, y_pos};
+        }
+
+        PermutationResult createPermutation(int permutation, const std::array<float, NUM_TOF_SENSORS>& xPositions,
+                                            const std::array<float, NUM_TOF_SENSORS>& yPositions) {
+            std::array<float, NUM_TOF_SENSORS> xList = {0.0f};
+            std::array<float, NUM_TOF_SENSORS> yList = {0.0f};
+            size_t xSize = 0, ySize = 0;
+            std::bitset<4> binary(permutation);
+            for (size_t sensor = 0; sensor < NUM_TOF_SENSORS; ++sensor) {
+                if (binary[sensor]) {
+                    yList[ySize++] = yPositions[sensor];
+                } else {
+                    xList[xSize++] = xPositions[sensor];
+                }
+            }
+            return {xList, yList, xSize, ySize};
+        }
+
+        std::tuple<float, float, float> calculateCoordinateVariance(const PermutationResult& result) {
+            float xMean = std::accumulate(result.xList.begin(), result.xList.begin() + result.xSize, 0.0f) / result.xSize;
+            float yMean = std::accumulate(result.yList.begin(), result.yList.begin() + result.ySize, 0.0f) / result.ySize;
+
+            auto xVariance = std::accumulate(result.xList.begin(), result.xList.begin() + result.xSize, 0.0f,
+                                             [xMean](float acc, float x) { return acc + std::pow(x - xMean, 2); }) / result.xSize;
+            auto yVariance = std::accumulate(result.yList.begin(), result.yList.begin() + result.ySize, 0.0f,
+                                             [yMean](float acc, float y) { return acc + std::pow(y - yMean, 2); }) / result.ySize;
+
+            float totalVariance = xVariance + yVariance;
+
+            return {totalVariance, xMean, yMean};
+        }
+
+        Pose localisation(float heading, FourToFDistances tof_distances, float driveDirection) {
+            auto [Fx, Fy] = calculatePossiblePositions(heading, tof_distances.front);
+            auto [Rx, Ry] = calculatePossiblePositions(heading - M_PI_2, tof_distances.right);
+            auto [Bx, By] = calculatePossiblePositions(heading - M_PI, tof_distances.rear);
+            auto [Lx, Ly] = calculatePossiblePositions(heading - 3 * M_PI_2, tof_distances.left);
+
+            std::array<float, NUM_TOF_SENSORS> xPositions = {Fx, Rx, Bx, Lx};
+            std::array<float, NUM_TOF_SENSORS> yPositions = {Fy, Ry, By, Ly};
+
+            float lowestVariance = std::numeric_limits<float>::max();
+            Pose bestEstimate = {0.0f, 0.0f, 0.0f};
+            for (int permutationNo = 1; permutationNo < (1 << NUM_TOF_SENSORS); ++permutationNo) {
+                PermutationResult permutation = createPermutation(permutationNo, xPositions, yPositions);
+                auto [totalVariance, xMean, yMean] = calculateCoordinateVariance(permutation);
+                if (totalVariance < lowestVariance) {
+                    lowestVariance = totalVariance;
+                    bestEstimate.x = driveDirection * (xMean - ARENA_SIZE / 2);
+                    bestEstimate.y = driveDirection * (yMean - ARENA_SIZE / 2);
+                    bestEstimate.heading = heading;
+                }
+            }
+            return bestEstimate;
+        }
+    }
+
+    struct Sample {
+        Pose truth;
+        FourToFDistances ranges;
+    };
+
+    float rangeToWall(const Pose& pose, const float angle) {
+        const float half = ARENA_SIZE / 2;
+        const float ux = -std::sin(angle);
+        const float uy = std::cos(angle);
+        float range = INFINITY;
+        if (ux > 1e-6f) range = std::fmin(range, (half - pose.x) / ux);
+        if (ux < -1e-6f) range = std::fmin(range, (-half - pose.x) / ux);
+        if (uy > 1e-6f) range = std::fmin(range, (half - pose.y) / uy);
+        if (uy < -1e-6f) range = std::fmin(range, (-half - pose.y) / uy);
+        return range;
+    }
+
+    std::vector<Sample> makeSamples(const long count, const bool withBadRays) {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> position(-ARENA_SIZE / 2 + 0.2f, ARENA_SIZE / 2 - 0.2f);
+        std::uniform_real_distribution<float> heading(-static_cast<float>(M_PI), static_cast<float>(M_PI));
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::normal_distribution<float> noise(0.0f, 0.01f);
+        std::vector<Sample> samples(static_cast<size_t>(count));
+        for (Sample& sample : samples) {
+            sample.truth = {position(random), position(random), heading(random)};
+            float ranges[NUM_TOF_SENSORS];
+            for (size_t sensor = 0; sensor < NUM_TOF_SENSORS; sensor++) {
+                ranges[sensor] = rangeToWall(sample.truth, sample.truth.heading - static_cast<float>(sensor) *
+                                                                                   static_cast<float>(M_PI_2));
+                ranges[sensor] += noise(random);
+                if (withBadRays && uniform(random) < 0.125f) {
+                    // a zero reading off the chassis comes back as just the mount offset; a lost return as the
+                    // sensor's maximum
+                    ranges[sensor] = uniform(random) < 0.5f ? MOUNT_OFFSETS[sensor] : CONFIG::TOF_MAX_RANGE + 1.0f;
+                }
+            }
+            sample.ranges = {ranges[0], ranges[1], ranges[2], ranges[3]};
+        }
+        return samples;
+    }
+
+    struct Result {
+        double nanoseconds = 0.0;
+        double cycles = 0.0;
+        double squaredError = 0.0;
+        long grossErrors = 0;
+        long noFix = 0;
+    };
+
+    template<typename Locate>
+    Result run(const std::vector<Sample>& samples, Locate locate) {
+        std::vector<Pose> fixes(samples.size());
+        std::vector<bool> valid(samples.size());
+        Result result;
+#if HAVE_TSC
+        const uint64_t startCycles = __rdtsc();
+#endif
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < samples.size(); i++) {
+            bool ok = true;
+            fixes[i] = locate(samples[i], ok);
+            valid[i] = ok;
+        }
+        const auto end = std::chrono::steady_clock::now();
+#if HAVE_TSC
+        result.cycles = static_cast<double>(__rdtsc() - startCycles) / static_cast<double>(samples.size());
+#endif
+        result.nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count())
+                             / static_cast<double>(samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            if (!valid[i]) {
+                result.noFix++;
+                continue;
+            }
+            const float error = std::hypot(fixes[i].x - samples[i].truth.x, fixes[i].y - samples[i].truth.y);
+            result.squaredError += error * error;
+            if (error > 0.1f) {
+                result.grossErrors++;
+            }
+        }
+        const long fixed = static_cast<long>(samples.size()) - result.noFix;
+        result.squaredError = fixed > 0 ? result.squaredError / static_cast<double>(fixed) : 0.0;
+        return result;
+    }
+
+    void print(const char* name, const Result& result, const long count) {
+        printf("  %-13s %7.0f ns", name, result.nanoseconds);
+#if HAVE_TSC
+        printf(" %7.0f cycles", result.cycles);
+#endif
+        printf("  rms %.4f m, %ld over 10 cm, %ld without a fix (of %ld)\n", std::sqrt(result.squaredError),
+               result.grossErrors, result.noFix, count);
+    }
+}
+
+int main(int argc, char** argv) {
+    const long count = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 200000;
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [FIXES]\n", argv[0]);
+        return 1;
+    }
+
+    const ARENA_LOCALISATION::RayLimits limits = {
+            {MOUNT_OFFSETS[0] + CONFIG::TOF_SELF_CLEARANCE, MOUNT_OFFSETS[1] + CONFIG::TOF_SELF_CLEARANCE,
+             MOUNT_OFFSETS[2] + CONFIG::TOF_SELF_CLEARANCE, MOUNT_OFFSETS[3] + CONFIG::TOF_SELF_CLEARANCE},
+            CONFIG::TOF_MAX_RANGE};
+    const ARENA_LOCALISATION::ArenaLocaliser localiser(ARENA_SIZE, limits);
+
+    const auto permutations = [](const Sample& sample, bool& ok) {
+        ok = true;
+        return PERMUTATIONS::localisation(sample.truth.heading, sample.ranges, 1.0f);
+    };
+    const auto kernel = [&localiser](const Sample& sample, bool& ok) {
+        const ARENA_LOCALISATION::Fix fix = localiser.locate(sample.truth.heading, sample.ranges);
+        ok = fix.valid;
+        return fix.pose;
+    };
+
+    for (const bool withBadRays : {false, true}) {
+        const std::vector<Sample> samples = makeSamples(count, withBadRays);
+        printf("%ld fixes, %s\n", count, withBadRays ? "one ray in eight off the chassis or out of range"
+                                                     : "all rays good");
+        print("permutations", run(samples, permutations), count);
+        print("kernel", run(samples, kernel), count);
+    }
+    return 0;
+}
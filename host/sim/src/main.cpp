@@ -0,0 +1,303 @@
+// Closed-loop host simulation of the control stack.
+//
+// Wires the firmware objects together exactly as src/main.cpp does, attaches simulated
+// peripherals to the host HAL and steps a plant model in virtual time. At the end it reports
+// how far the estimate drifted from the truth and how many control cycles per wall-clock
+// second the host managed, which makes it a convenient harness for profiling the real code.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "navigator.h"
+#include "receiver.h"
+#include "statemanager.h"
+#include "state_estimator.h"
+#include "ackermann_strategy.h"
+#include "drivetrain_config.h"
+#include "utils.h"
+#include "bno080.h"
+#include "i2c_engine.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "flight_recorder.h"
+#include "plant.h"
+#include "sim_devices.h"
+
+namespace {
+    constexpr uint64_t PHYSICS_STEP_US = 1000;
+    constexpr uint64_t RECEIVER_FRAME_US = 22500;   // CPPM frame period
+    const uint8_t TOF_ADDRESSES[COMMON::NUM_TOF_SENSORS] = {0x12, 0x13, 0x11, 0x14};   // front, right, rear, left
+
+    struct Options {
+        double seconds = 30.0;
+        bool waypoint = false;
+        bool quiet = false;
+        bool dualCore = false;
+        const char* telemetryPath = nullptr;
+        double dumpAt = -1.0;
+        double wheelSpin = 0.0;
+        double tofGlitches = 0.0;
+    };
+
+    void usage(const char* name) {
+        fprintf(stderr, "usage: %s [--seconds N] [--waypoint] [--quiet] [--dual-core] [--telemetry FILE] [--dump-at S] [--wheel-spin F] [--tof-glitches F]\n", name);
+        fprintf(stderr, "  --seconds N  simulated time to run (default 30)\n");
+        fprintf(stderr, "  --waypoint   fly the configured waypoint route instead of the scripted RC pilot\n");
+        fprintf(stderr, "  --quiet      discard the firmware's own printf output\n");
+        fprintf(stderr, "  --dual-core  hand actuation over as the DUAL_CORE firmware build does\n");
+        fprintf(stderr, "  --telemetry FILE  capture the binary telemetry stream (decode with telemetry_decode)\n");
+        fprintf(stderr, "  --dump-at S  send the flight recorder dump command on the console S seconds in\n");
+        fprintf(stderr, "  --wheel-spin F  make the rear left wheel turn a fraction F further than it rolls\n");
+        fprintf(stderr, "  --tof-glitches F  spoil a fraction F of the ToF frames with weak returns and short spikes\n");
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; i++) {
+            if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+                options.seconds = std::atof(argv[++i]);
+            } else if (std::strcmp(argv[i], "--waypoint") == 0) {
+                options.waypoint = true;
+            } else if (std::strcmp(argv[i], "--quiet") == 0) {
+                options.quiet = true;
+            } else if (std::strcmp(argv[i], "--dual-core") == 0) {
+                options.dualCore = true;
+            } else if (std::strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+                options.telemetryPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--dump-at") == 0 && i + 1 < argc) {
+                options.dumpAt = std::atof(argv[++i]);
+            } else if (std::strcmp(argv[i], "--wheel-spin") == 0 && i + 1 < argc) {
+                options.wheelSpin = std::atof(argv[++i]);
+            } else if (std::strcmp(argv[i], "--tof-glitches") == 0 && i + 1 < argc) {
+                options.tofGlitches = std::atof(argv[++i]);
+            } else {
+                usage(argv[0]);
+                return false;
+            }
+        }
+        return options.seconds > 0.0;
+    }
+
+    // Scripted transmitter: gentle weave in RC mode, or the waypoint switch held on.
+    void updatePilot(const Options& options, double t) {
+        float channels[6] = {};
+        channels[static_cast<int>(RX_CHANNELS::AUX)] = options.waypoint ? 1.0f : -1.0f;
+        if (!options.waypoint) {
+            channels[static_cast<int>(RX_CHANNELS::ELE)] = 0.3f;
+            channels[static_cast<int>(RX_CHANNELS::AIL)] = 0.3f * static_cast<float>(std::sin(2.0 * M_PI * t / 6.0));
+        }
+        HOST_HAL::setReceiverChannels(channels, 6);
+    }
+
+    // telemetry goes to the capture file if there is one, and is otherwise drained and discarded
+    FILE* telemetryFile = nullptr;
+
+    void telemetrySink(const uint8_t* data, size_t length) {
+        if (telemetryFile != nullptr) {
+            fwrite(data, 1, length, telemetryFile);
+        }
+    }
+
+    // as src/main.cpp's console handling
+    void handleConsoleCommands() {
+        int command = getchar_timeout_us(0);
+        if (command == 'd') {
+            FLIGHT_RECORDER::requestDump();
+        } else if (command == 'r') {
+            FLIGHT_RECORDER::resume();
+        }
+    }
+
+    struct TimerCallbackData {
+        bool shouldNavigate;
+    };
+
+    TimerCallbackData timerCallbackData = {false};
+
+    extern "C" bool timer_callback(repeating_timer_t *t) {
+        auto *user_data = reinterpret_cast<TimerCallbackData *>(t->user_data);
+        user_data->shouldNavigate = true;
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    if (options.quiet && std::freopen("/dev/null", "w", stdout) == nullptr) {
+        return 1;
+    }
+
+    if (options.telemetryPath != nullptr) {
+        telemetryFile = std::fopen(options.telemetryPath, "wb");
+        if (telemetryFile == nullptr) {
+            fprintf(stderr, "could not open %s\n", options.telemetryPath);
+            return 1;
+        }
+    }
+    TELEMETRY::setSink(telemetrySink);
+
+    // ---- the world ----
+    SIM::PlantConfig plantConfig;
+    plantConfig.wheelSpin[COMMON::MOTOR_POSITION::REAR_LEFT] = options.wheelSpin;
+    SIM::Plant plant(CONFIG::DRIVING_STYLE, plantConfig);
+    SIM::TfLunaDevice* tofDevices[COMMON::NUM_TOF_SENSORS];
+    for (int i = 0; i < static_cast<int>(COMMON::NUM_TOF_SENSORS); i++) {
+        tofDevices[i] = new SIM::TfLunaDevice([&plant, i] { return plant.tofRange(i); });
+        tofDevices[i]->setGlitches(options.tofGlitches, static_cast<uint32_t>(i + 1));
+        HOST_HAL::attachI2CDevice(i2c0, TOF_ADDRESSES[i], tofDevices[i]);
+    }
+    SIM::Bno08xDevice imuDevice([&plant] { return SIM::ImuTruth{plant.heading(), plant.yawRate()}; });
+    HOST_HAL::attachI2CDevice(i2c0, CONFIG::BNO08X_ADDR, &imuDevice);
+    imuDevice.setInterruptPin(CONFIG::IMU_INT_PIN);
+    HOST_HAL::gpioDrive(CONFIG::motorStatusPin, false);
+
+    // ---- the firmware, wired as in src/main.cpp ----
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    stdio_init_all();
+    PROFILER::init();
+    initMotorMonitorPins();
+
+    i2c_inst_t* i2c_port0;
+    initI2C(i2c_port0, false);
+    auto *i2cEngine = new I2C_ENGINE::I2CEngine(i2c_port0);
+
+    BNO08x IMU;
+    if (!IMU.begin(CONFIG::BNO08X_ADDR, i2c_port0, i2cEngine)) {
+        fprintf(stderr, "simulated BNO08x did not start\n");
+        return 1;
+    }
+    auto *pStateEstimator = new STATE_ESTIMATOR::StateEstimator(&IMU, i2c_port0, i2cEngine, CONFIG::DRIVING_STYLE);
+    auto *pAckermannSteerStrategy = new MIXER::AckermannMixer(CONFIG::WHEEL_TRACK, CONFIG::WHEEL_BASE);
+    auto *pStateManager = new STATEMANAGER::StateManager(pAckermannSteerStrategy, pStateEstimator);
+    updatePilot(options, 0.0);
+    Receiver *pReceiver = getReceiver(motor::motor2040::SHARED_ADC);
+    auto *navigator = new Navigator(pReceiver, pStateManager, pStateEstimator, CONFIG::DRIVING_STYLE);
+    pStateManager->setDeferredActuation(options.dualCore);
+
+    // only the pose is pulled from each estimate, to compare with the plant
+    Subscription<COMMON::VehicleState> estimate(pStateEstimator->estimate());
+    COMMON::Pose estimatedPose{};
+
+    repeating_timer_t navigationTimer;
+    add_repeating_timer_ms(20, timer_callback, &timerCallbackData, &navigationTimer);
+
+    // ---- run ----
+    const uint64_t startUs = HOST_HAL::nowUs();
+    const uint64_t endUs = startUs + static_cast<uint64_t>(options.seconds * 1e6);
+    uint64_t simUs = startUs;
+    uint64_t nextPilotUs = startUs;
+    bool dumpSent = options.dumpAt < 0.0;
+    uint32_t navigationCycles = 0;
+    double maxPositionError = 0.0;
+
+    while (simUs < endUs) {
+        if (simUs >= nextPilotUs) {
+            updatePilot(options, static_cast<double>(simUs - startUs) * 1e-6);
+            nextPilotUs += RECEIVER_FRAME_US;
+        }
+        if (!dumpSent && static_cast<double>(simUs - startUs) * 1e-6 >= options.dumpAt) {
+            HOST_HAL::consoleInject("d", 1);
+            dumpSent = true;
+        }
+
+        simUs += PHYSICS_STEP_US;
+        plant.step(static_cast<double>(PHYSICS_STEP_US) * 1e-6);
+        for (auto* tof : tofDevices) {
+            tof->service(simUs);
+        }
+        HOST_HAL::runUntil(simUs);
+        // the hub asserts INT, and the firmware timestamps its reports, at the time it samples the plant
+        imuDevice.service(simUs);
+        simUs = std::max(simUs, HOST_HAL::nowUs());
+
+        // main loop context; with --dual-core the estimator and actuation stand in for core1's loop,
+        // and only see the navigator's requests through the state manager's handoff
+        pStateEstimator->serviceEstimation();
+        if (options.dualCore) {
+            pStateManager->applyRequestedState();
+        }
+        i2cEngine->service();
+        if (timerCallbackData.shouldNavigate) {
+            navigator->navigate();
+            timerCallbackData.shouldNavigate = false;
+            navigationCycles++;
+        }
+        handleConsoleCommands();
+        FLIGHT_RECORDER::serviceDump();
+        TELEMETRY::drain();
+
+        estimatedPose = estimate.take([](const COMMON::VehicleState& state) { return state.odometry; });
+        const double error = std::hypot(estimatedPose.x - plant.x(), estimatedPose.y - plant.y());
+        maxPositionError = std::max(maxPositionError, error);
+    }
+
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    const double simSeconds = static_cast<double>(HOST_HAL::nowUs() - startUs) * 1e-6;
+    const HOST_HAL::I2CStats bus = HOST_HAL::i2cStats(i2c0);
+
+    fprintf(stderr, "simulated %.2f s in %.3f s wall (%.1fx real time)\n",
+            simSeconds, wallSeconds, simSeconds / wallSeconds);
+    const uint32_t estimates = estimate.stamp().sequence;
+    fprintf(stderr, "estimator updates: %u (%.1f Hz, %u not seen by the sim), navigation cycles: %u (%.1f Hz)\n",
+            estimates, estimates / simSeconds, estimate.missed(), navigationCycles, navigationCycles / simSeconds);
+    const TaskTimingStats estimation = pStateEstimator->estimationTiming();
+    fprintf(stderr, "estimation latency %u/%.0f/%u us (min/mean/max), jitter %u us, execution %u us, "
+                    "%u deadline misses, %u skipped triggers\n",
+            estimation.minLatencyUs, estimation.meanLatencyUs, estimation.maxLatencyUs, estimation.maxJitterUs,
+            estimation.maxExecutionUs, estimation.deadlineMisses, estimation.skippedTriggers);
+    const SampleIntervalStats estimationDt = pStateEstimator->estimationInterval();
+    fprintf(stderr, "estimation dt %u/%.0f/%u us (min/mean/max), jitter %u us\n", estimationDt.minIntervalUs,
+            estimationDt.meanIntervalUs, estimationDt.maxIntervalUs, estimationDt.maxJitterUs);
+    const HeadingAlignmentStats alignment = pStateEstimator->imuAlignment();
+    fprintf(stderr, "imu heading at capture: %u interpolated, %u extrapolated, %u unaligned, newest sample "
+                    "%.0f/%d us old (mean/max); residual skew %.0f us as read, %.0f us aligned over %u checks, "
+                    "max error %.4f/%.4f rad\n",
+            alignment.interpolated, alignment.extrapolated, alignment.unaligned, alignment.meanSampleAgeUs,
+            alignment.maxSampleAgeUs, alignment.rawSkewUs, alignment.alignedSkewUs, alignment.checked,
+            alignment.maxRawError, alignment.maxAlignedError);
+    fprintf(stderr, "host throughput: %.0f control cycles per wall-clock second\n", navigationCycles / wallSeconds);
+    fprintf(stderr, "i2c0: %u transactions, %u errors, %.1f%% bus utilisation\n",
+            bus.transactions, bus.errors, 100.0 * static_cast<double>(bus.busyUs) / (simSeconds * 1e6));
+    const I2C_ENGINE::I2CEngineStats queue = i2cEngine->stats();
+    fprintf(stderr, "i2c engine: %u transfers, %u failed, %u expired, max queue depth %u, "
+                    "queue latency high %.0f/%u normal %.0f/%u us (mean/max)\n",
+            queue.completed, queue.failed, queue.expired, queue.maxQueueDepth,
+            queue.meanQueueLatencyUs[0], queue.maxQueueLatencyUs[0],
+            queue.meanQueueLatencyUs[1], queue.maxQueueLatencyUs[1]);
+    // let a dump still in progress finish, so the capture holds all of it
+    while (FLIGHT_RECORDER::serviceDump()) {
+        TELEMETRY::drain(SIZE_MAX);
+    }
+    TELEMETRY::drain(SIZE_MAX);
+    const TELEMETRY::TelemetryStats telemetry = TELEMETRY::stats();
+    fprintf(stderr, "telemetry: %u frames, %u dropped, max ring usage %u of %zu bytes, %u bytes drained (%.0f B/s)\n",
+            telemetry.frames[0], telemetry.dropped[0], telemetry.maxRingUsage[0], TELEMETRY::RING_CAPACITY,
+            telemetry.bytesDrained, telemetry.bytesDrained / simSeconds);
+    if (telemetryFile != nullptr) {
+        std::fclose(telemetryFile);
+    }
+#ifdef OSOD_PROFILING
+    fprintf(stderr, "host cpu per stage (us)  samples      min     mean      p99      max\n");
+    for (int stage = 0; stage < PROFILER::STAGE::STAGE_COUNT; stage++) {
+        const auto stageStats = PROFILER::stats(static_cast<PROFILER::STAGE::Stage>(stage), 0);
+        if (stageStats.samples > 0) {
+            fprintf(stderr, "  %-22s %8u %8.2f %8.2f %8.2f %8.2f\n", PROFILER::stageName(static_cast<PROFILER::STAGE::Stage>(stage)),
+                    stageStats.samples, stageStats.minUs, stageStats.meanUs, stageStats.p99Us, stageStats.maxUs);
+        }
+    }
+#endif
+    fprintf(stderr, "truth   x %.3f y %.3f heading %.3f\n", plant.x(), plant.y(), plant.heading());
+    fprintf(stderr, "estimate x %.3f y %.3f heading %.3f (max position error %.3f m)\n",
+            estimatedPose.x, estimatedPose.y, estimatedPose.heading,
+            maxPositionError);
+    return 0;
+}
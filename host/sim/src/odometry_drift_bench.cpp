@@ -0,0 +1,264 @@
+// Drift of the odometry integration models on synthetic and recorded trajectories.
+//
+// Each synthetic trajectory is driven at up to MAX_VELOCITY through tight turns and integrated finely in
+// double precision for the truth. Every 10 ms tick the models are given the exact arc length the rear axle
+// centre travelled, the exact heading at the end of the tick, and the steering angles the mixer would set
+// for the curvature, so the drift they show is the integration's alone. Each model is run with a new IMU
+// heading every tick, and ARC again with one only every fourth tick, with the turn in between coming from
+// the bicycle model or, as the original odometry did, held at the last heading.
+//
+// Given a telemetry capture holding a flight recorder dump, the same models dead-reckon the recorded ticks
+// from the rear encoders, the IMU yaw and the commanded steering angles. The reference is then the pose the
+// robot estimated, which the ToF ranges kept in check, so the figures include the odometry's own errors.
+//
+//   odometry_drift_bench [CAPTURE]
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "drivetrain_config.h"
+#include "flight_recorder.h"
+#include "pose_integration.h"
+#include "utils.h"
+#include "flight_capture.h"
+
+namespace {
+    using FLIGHT_RECORDER::TickRecord;
+
+    constexpr double DT = 0.01;
+    constexpr int SUBSTEPS = 100;
+    constexpr int IMU_EVERY = 4;
+
+    struct Truth {
+        double x = 0.0;
+        double y = 0.0;
+        double heading = 0.0;
+        double travelled = 0.0;
+    };
+
+    // speed in m/s and turn rate in rad/s at time t
+    struct Trajectory {
+        const char* name;
+        double seconds;
+        void (*command)(double t, double& speed, double& turnRate);
+    };
+
+    const Trajectory TRAJECTORIES[] = {
+            {"tight circle, r 0.3 m", 10.0, [](double, double& speed, double& turnRate) {
+                speed = CONFIG::MAX_VELOCITY;
+                turnRate = speed / 0.3;
+            }},
+            {"slalom", 10.0, [](double t, double& speed, double& turnRate) {
+                speed = CONFIG::MAX_VELOCITY;
+                turnRate = 4.5 * std::sin(2.0 * M_PI * t / 1.5);
+            }},
+            {"figure eight, accelerating", 12.0, [](double t, double& speed, double& turnRate) {
+                speed = CONFIG::MAX_VELOCITY * std::fmin(1.0, 0.2 + t / 6.0);
+                turnRate = (std::fmod(t, 6.0) < 3.0 ? 1.0 : -1.0) * speed / 0.45;
+            }},
+    };
+
+    enum class Turn {
+        IMU_EVERY_TICK,
+        BICYCLE_BETWEEN,
+        HELD_BETWEEN,
+    };
+
+    struct Model {
+        const char* name;
+        CONFIG::PoseIntegration integration;
+        Turn turn;
+    };
+
+    const Model MODELS[] = {
+            {"euler", CONFIG::EULER, Turn::IMU_EVERY_TICK},
+            {"midpoint", CONFIG::MIDPOINT, Turn::IMU_EVERY_TICK},
+            {"arc", CONFIG::ARC, Turn::IMU_EVERY_TICK},
+            {"arc, imu 1/4, bicycle", CONFIG::ARC, Turn::BICYCLE_BETWEEN},
+            {"arc, imu 1/4, held", CONFIG::ARC, Turn::HELD_BETWEEN},
+    };
+
+    struct Drift {
+        double sumOfSquares = 0.0;
+        double max = 0.0;
+        double final = 0.0;
+        double finalHeading = 0.0;
+        uint32_t samples = 0;
+
+        void add(const double error, const double headingError) {
+            sumOfSquares += error * error;
+            max = std::fmax(max, error);
+            final = error;
+            finalHeading = headingError;
+            samples++;
+        }
+
+        double rms() const {
+            return samples > 0 ? std::sqrt(sumOfSquares / samples) : 0.0;
+        }
+    };
+
+    // Dead reckoning with one model: the turn is the IMU's when a heading has arrived, as in
+    // StateEstimator::calculateNewPosition.
+    struct Track {
+        COMMON::Pose pose;
+        Model model;
+        float driveDirection;
+
+        void step(const float distance, const bool imuUpdated, const float imuHeading,
+                  const COMMON::SteeringAngles steering) {
+            float turn = 0.0f;
+            if (imuUpdated) {
+                turn = wrap_pi(imuHeading - pose.heading);
+            } else if (model.turn == Turn::BICYCLE_BETWEEN) {
+                turn = WHEEL_ODOMETRY::bicycleTurn(distance, steering);
+            }
+            const WHEEL_ODOMETRY::Displacement displacement = WHEEL_ODOMETRY::integrate(
+                    pose.heading, distance, turn, model.integration, driveDirection);
+            pose.x += displacement.dx;
+            pose.y += displacement.dy;
+            pose.heading = wrap_pi(pose.heading + turn);
+        }
+    };
+
+    void printHeader(const char* name, const double travelled) {
+        printf("%s (%.1f m)\n", name, travelled);
+        printf("  %-24s %10s %10s %10s %10s %12s\n", "model", "rms m", "max m", "final m", "final %", "heading rad");
+    }
+
+    void printDrift(const Model& model, const Drift& drift, const double travelled) {
+        printf("  %-24s %10.5f %10.5f %10.5f %10.3f %12.5f\n", model.name, drift.rms(), drift.max, drift.final,
+               travelled > 0.0 ? 100.0 * drift.final / travelled : 0.0, drift.finalHeading);
+    }
+
+    // The angles AckermannMixer sets for a path of this curvature, in its sign convention.
+    COMMON::SteeringAngles steeringFor(const double curvature) {
+        if (curvature == 0.0) {
+            return {0.0f, 0.0f};
+        }
+        const double radius = 1.0 / curvature;
+        const double maxAngle = CONFIG::MAX_STEERING_ANGLE;
+        const double left = -std::atan(CONFIG::WHEEL_BASE / (radius - CONFIG::HALF_WHEEL_TRACK));
+        const double right = std::atan(CONFIG::WHEEL_BASE / (radius + CONFIG::HALF_WHEEL_TRACK));
+        return {static_cast<float>(std::fmax(-maxAngle, std::fmin(maxAngle, left))),
+                static_cast<float>(std::fmax(-maxAngle, std::fmin(maxAngle, right)))};
+    }
+
+    void runSynthetic(const Trajectory& trajectory) {
+        const size_t modelCount = sizeof(MODELS) / sizeof(MODELS[0]);
+        std::vector<Track> tracks;
+        std::vector<Drift> drifts(modelCount);
+        for (const Model& model : MODELS) {
+            tracks.push_back({{0.0f, 0.0f, 0.0f}, model, 1.0f});
+        }
+
+        Truth truth;
+        const auto ticks = static_cast<long>(trajectory.seconds / DT);
+        for (long tick = 0; tick < ticks; tick++) {
+            const double start = truth.travelled;
+            double curvature = 0.0;
+            for (int i = 0; i < SUBSTEPS; i++) {
+                const double h = DT / SUBSTEPS;
+                const double t = tick * DT + (i + 0.5) * h;
+                double speed;
+                double turnRate;
+                trajectory.command(t, speed, turnRate);
+                const double mid = truth.heading + turnRate * h / 2;
+                truth.x -= speed * h * std::sin(mid);
+                truth.y += speed * h * std::cos(mid);
+                truth.heading += turnRate * h;
+                truth.travelled += speed * h;
+                curvature = turnRate / speed;
+            }
+            const auto distance = static_cast<float>(truth.travelled - start);
+            const auto heading = static_cast<float>(std::remainder(truth.heading, 2.0 * M_PI));
+            const COMMON::SteeringAngles steering = steeringFor(curvature);
+            for (size_t m = 0; m < modelCount; m++) {
+                const bool imuUpdated = MODELS[m].turn == Turn::IMU_EVERY_TICK || (tick + 1) % IMU_EVERY == 0;
+                tracks[m].step(distance, imuUpdated, heading, steering);
+                const COMMON::Pose& pose = tracks[m].pose;
+                drifts[m].add(std::hypot(pose.x - truth.x, pose.y - truth.y),
+                              std::fabs(wrap_pi(pose.heading - heading)));
+            }
+        }
+
+        printHeader(trajectory.name, truth.travelled);
+        for (size_t m = 0; m < modelCount; m++) {
+            printDrift(MODELS[m], drifts[m], truth.travelled);
+        }
+    }
+
+    bool runRecorded(const char* path) {
+        FILE* input = std::fopen(path, "rb");
+        if (input == nullptr) {
+            fprintf(stderr, "could not open %s\n", path);
+            return false;
+        }
+        const std::vector<TickRecord> ticks = SIM::loadTicks(input);
+        std::fclose(input);
+        if (ticks.size() < 2) {
+            fprintf(stderr, "%s holds no flight recorder dump\n", path);
+            return false;
+        }
+
+        // the yaw is recorded raw; its offset from the recorded heading is their mean difference over the dump
+        double sinSum = 0.0;
+        double cosSum = 0.0;
+        for (const TickRecord& tick : ticks) {
+            sinSum += std::sin(tick.imuYaw - tick.pose.heading);
+            cosSum += std::cos(tick.imuYaw - tick.pose.heading);
+        }
+        const auto headingOffset = static_cast<float>(std::atan2(sinSum, cosSum));
+
+        const size_t modelCount = sizeof(MODELS) / sizeof(MODELS[0]);
+        std::vector<Track> tracks;
+        std::vector<Drift> drifts(modelCount);
+        for (const Model& model : MODELS) {
+            tracks.push_back({ticks.front().pose, model, static_cast<float>(CONFIG::DRIVING_STYLE)});
+        }
+
+        // rear axle travel as StateEstimator::getPositionDelta finds it: the right wheel counts backwards
+        const double metresPerCount = M_PI * CONFIG::WHEEL_DIAMETER / CONFIG::COUNTS_PER_REV;
+        double travelled = 0.0;
+        for (size_t i = 1; i < ticks.size(); i++) {
+            const TickRecord& tick = ticks[i];
+            using namespace COMMON::MOTOR_POSITION;
+            const auto distance = static_cast<float>(
+                    (tick.encoderDelta[REAR_LEFT] - tick.encoderDelta[REAR_RIGHT]) / 2.0 * metresPerCount);
+            travelled += std::fabs(distance);
+            const bool imuUpdated = tick.imuReadUs != ticks[i - 1].imuReadUs;
+            const float imuHeading = wrap_pi(tick.imuYaw - headingOffset);
+            for (size_t m = 0; m < modelCount; m++) {
+                const bool thisTick = imuUpdated && (MODELS[m].turn == Turn::IMU_EVERY_TICK || i % IMU_EVERY == 0);
+                tracks[m].step(distance, thisTick, imuHeading, ticks[i - 1].driveTrainState.angles);
+                const COMMON::Pose& pose = tracks[m].pose;
+                drifts[m].add(std::hypot(pose.x - tick.pose.x, pose.y - tick.pose.y),
+                              std::fabs(wrap_pi(pose.heading - tick.pose.heading)));
+            }
+        }
+
+        char name[160];
+        std::snprintf(name, sizeof(name), "recorded: %s, ticks %u-%u", path, ticks.front().tick, ticks.back().tick);
+        printHeader(name, travelled);
+        for (size_t m = 0; m < modelCount; m++) {
+            printDrift(MODELS[m], drifts[m], travelled);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        fprintf(stderr, "usage: %s [CAPTURE]\n", argv[0]);
+        fprintf(stderr, "  CAPTURE  telemetry capture holding a flight recorder dump to score as well\n");
+        return 1;
+    }
+
+    for (const Trajectory& trajectory : TRAJECTORIES) {
+        runSynthetic(trajectory);
+    }
+    if (argc == 2 && !runRecorded(argv[1])) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Cost and accuracy benchmark for the particle localiser.
+//
+// A robot weaves around a 2.4 m by 1.6 m arena, which the square-arena localisers can't model, with twelve
+// barrels standing in it that the map leaves out. Each 10 ms tick the filter is given the wheel distance with
+// slip noise, an IMU yaw with noise, and two of the four ToF ranges as the staggered reads deliver them. The
+// ranges are ray-cast against the walls and the barrels, so a beam that hits a barrel comes back short of the
+// map. The run is repeated for each particle count. For each count the benchmark reports the cost of predict,
+// correct and estimate in host nanoseconds and (on x86) TSC cycles, the particles processed per millisecond by
+// a predict and a correct, and the error against the true pose. Build the host tree with
+// -DCMAKE_BUILD_TYPE=Release for meaningful numbers. On the target the same calls run under the profiler's
+// particleFilter stage; size CONFIG::PARTICLE_COUNT from the ratio of the two.
+//
+//   particle_localisation_bench [TICKS]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "drivetrain_config.h"
+#include "particle_localisation.h"
+#include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+namespace {
+    constexpr float HALF_WIDTH = 1.2f;
+    constexpr float HALF_DEPTH = 0.8f;
+    constexpr float DT = 0.01f;
+    constexpr float BARREL_RADIUS = 0.035f;
+    constexpr size_t BARRELS = 12;
+    constexpr size_t PARTICLE_COUNTS[] = {64, 128, 256, 512};
+
+    COMMON::MapSegment arena[] = {
+            {-1200, -800, 1200, -800},
+            {1200, -800, 1200, 800},
+            {1200, 800, -1200, 800},
+            {-1200, 800, -1200, -800}
+    };
+
+    // indexed like FourToFDistances
+    const float MIN_RANGE[COMMON::NUM_TOF_SENSORS] = {
+            CONFIG::TOF_FRONT_OFFSET + CONFIG::TOF_SELF_CLEARANCE, CONFIG::TOF_RIGHT_OFFSET + CONFIG::TOF_SELF_CLEARANCE,
+            CONFIG::TOF_REAR_OFFSET + CONFIG::TOF_SELF_CLEARANCE, CONFIG::TOF_LEFT_OFFSET + CONFIG::TOF_SELF_CLEARANCE};
+
+    struct Truth {
+        float x = 0.0f;
+        float y = -0.4f;
+        float heading = 0.0f;
+    };
+
+    struct Barrel {
+        float x;
+        float y;
+    };
+
+    // distance from the robot centre along angle to the first wall or barrel, as TfLunaArray reports it
+    float rangeToObstacle(const Truth& truth, const Barrel* barrels, const size_t barrelCount, const float angle) {
+        const float ux = -std::sin(angle);
+        const float uy = std::cos(angle);
+        float range = CONFIG::TOF_MAX_RANGE;
+        if (ux > 1e-6f) range = std::fmin(range, (HALF_WIDTH - truth.x) / ux);
+        if (ux < -1e-6f) range = std::fmin(range, (-HALF_WIDTH - truth.x) / ux);
+        if (uy > 1e-6f) range = std::fmin(range, (HALF_DEPTH - truth.y) / uy);
+        if (uy < -1e-6f) range = std::fmin(range, (-HALF_DEPTH - truth.y) / uy);
+        for (size_t i = 0; i < barrelCount; i++) {
+            const float cx = barrels[i].x - truth.x;
+            const float cy = barrels[i].y - truth.y;
+            const float along = cx * ux + cy * uy;
+            const float across = cx * uy - cy * ux;
+            if (along > 0.0f && std::fabs(across) < BARREL_RADIUS) {
+                range = std::fmin(range, along - std::sqrt(BARREL_RADIUS * BARREL_RADIUS - across * across));
+            }
+        }
+        return range;
+    }
+
+    struct Clock {
+        uint64_t nanoseconds = 0;
+        uint64_t cycles = 0;
+        uint64_t calls = 0;
+
+        template<typename Work>
+        void time(Work work) {
+#if HAVE_TSC
+            const uint64_t startCycles = __rdtsc();
+#endif
+            const auto start = std::chrono::steady_clock::now();
+            work();
+            const auto end = std::chrono::steady_clock::now();
+#if HAVE_TSC
+            cycles += __rdtsc() - startCycles;
+#endif
+            nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            calls++;
+        }
+
+        [[nodiscard]] double perCall() const {
+            return calls == 0 ? 0.0 : static_cast<double>(nanoseconds) / static_cast<double>(calls);
+        }
+
+        void print(const char* name, const size_t particles) const {
+            if (calls == 0) {
+                return;
+            }
+            printf("  %-10s %9.0f ns %6.1f ns/particle", name, perCall(), perCall() / static_cast<double>(particles));
+#if HAVE_TSC
+            printf(" %9.0f cycles", static_cast<double>(cycles) / static_cast<double>(calls));
+#endif
+            printf("\n");
+        }
+    };
+
+    void run(const size_t count, const long ticks) {
+        std::mt19937 random(42);
+        std::normal_distribution<float> unit(0.0f, 1.0f);
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+        Barrel barrels[BARRELS];
+        for (Barrel& barrel : barrels) {
+            barrel = {uniform(random) * (HALF_WIDTH - 0.2f), uniform(random) * (HALF_DEPTH - 0.2f)};
+        }
+
+        PARTICLE_LOCALISATION::StaticParticleLocaliser<PARTICLE_LOCALISATION::MAX_PARTICLES> filter(
+                arena, sizeof(arena) / sizeof(arena[0]), count, CONFIG::Car);
+        Truth truth;
+        filter.reset({truth.x, truth.y, truth.heading}, 0.1f, 0.1f);
+
+        Clock predict;
+        Clock correct;
+        Clock estimate;
+        double squaredError = 0.0;
+        float maxError = 0.0f;
+        uint32_t shortReturns = 0;
+
+        for (long tick = 0; tick < ticks; tick++) {
+            // a slow weave around the arena: 0.6 m/s, turning back and forth
+            const float t = static_cast<float>(tick) * DT;
+            const float speed = 0.6f;
+            float turnRate = 1.6f * std::sin(0.5f * t) + 0.6f * std::sin(1.7f * t);
+            // keep the course inside the arena by steering back towards the centre near the walls
+            if (std::fabs(truth.x) > HALF_WIDTH - 0.4f || std::fabs(truth.y) > HALF_DEPTH - 0.3f) {
+                const float towardsCentre = wrap_pi(std::atan2(truth.x, -truth.y) - truth.heading);
+                turnRate = std::fmax(-3.0f, std::fmin(3.0f, 4.0f * towardsCentre));
+            }
+            const float previousHeading = truth.heading;
+            truth.heading = wrap_pi(truth.heading + turnRate * DT);
+            truth.x -= speed * DT * std::sin(truth.heading);
+            truth.y += speed * DT * std::cos(truth.heading);
+
+            const float distance = speed * DT * (1.0f + 0.03f * unit(random));
+            const float turn = wrap_pi(truth.heading - previousHeading) + 0.002f * unit(random);
+            const float yaw = truth.heading + 0.005f * unit(random);
+
+            // the staggered reads deliver the four sensors over two ticks
+            float ranges[COMMON::NUM_TOF_SENSORS] = {NAN, NAN, NAN, NAN};
+            for (size_t sensor = tick % 2; sensor < COMMON::NUM_TOF_SENSORS; sensor += 2) {
+                const float angle = truth.heading - static_cast<float>(sensor) * static_cast<float>(M_PI_2);
+                const float obstacle = rangeToObstacle(truth, barrels, BARRELS, angle);
+                const float measured = obstacle + 0.02f * unit(random);
+                if (measured >= MIN_RANGE[sensor] && measured <= CONFIG::TOF_MAX_RANGE) {
+                    ranges[sensor] = measured;
+                    shortReturns += obstacle < rangeToObstacle(truth, barrels, 0, angle);
+                }
+            }
+
+            predict.time([&] { filter.predict(distance, turn); });
+            correct.time([&] { filter.correct(yaw, ranges); });
+            PARTICLE_LOCALISATION::Estimate result{};
+            estimate.time([&] { result = filter.estimate(); });
+
+            const float error = std::hypot(result.pose.x - truth.x, result.pose.y - truth.y);
+            squaredError += error * error;
+            maxError = std::fmax(maxError, error);
+        }
+
+        const PARTICLE_LOCALISATION::Stats stats = filter.stats();
+        printf("%zu particles\n", count);
+        predict.print("predict", count);
+        correct.print("correct", count);
+        estimate.print("estimate", count);
+        const double perParticle = (predict.perCall() + correct.perCall()) / static_cast<double>(count);
+        printf("  %.0f particles/ms (predict + correct), %.0f rays/ms, %u resamples in %ld ticks\n",
+               1e6 / perParticle, static_cast<double>(stats.raysCast) * 1e6 / static_cast<double>(correct.nanoseconds),
+               stats.resamples, ticks);
+        printf("  position error rms %.4f max %.4f m, %u of the ranges were off a barrel\n",
+               std::sqrt(squaredError / static_cast<double>(ticks)), maxError, shortReturns);
+    }
+}
+
+int main(int argc, char** argv) {
+    const long ticks = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 20000;
+    if (ticks <= 0) {
+        fprintf(stderr, "usage: %s [TICKS]\n", argv[0]);
+        return 1;
+    }
+    printf("particle localiser, %ld ticks (%.0f s) per count\n", ticks, static_cast<double>(ticks) * DT);
+    for (const size_t count : PARTICLE_COUNTS) {
+        run(count, ticks);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <cmath>
+#include <limits>
+#include "plant.h"
+#include "host_hal.h"
+#include "motor2040.hpp"
+
+namespace SIM {
+    using namespace COMMON;
+
+    namespace {
+        const pin_pair MOTOR_PINS[MOTOR_POSITION::MOTOR_POSITION_COUNT] = {
+                motor::motor2040::MOTOR_A, motor::motor2040::MOTOR_B,
+                motor::motor2040::MOTOR_C, motor::motor2040::MOTOR_D
+        };
+        const pin_pair ENCODER_PINS[MOTOR_POSITION::MOTOR_POSITION_COUNT] = {
+                motor::motor2040::ENCODER_A, motor::motor2040::ENCODER_B,
+                motor::motor2040::ENCODER_C, motor::motor2040::ENCODER_D
+        };
+        // left, right, as the state manager sets them up
+        const uint STEERING_PINS[2] = {motor::motor2040::RX_ECHO, motor::motor2040::TX_TRIG};
+        // Mounting offsets from the robot centre, indexed like FourToFDistances (front, right, rear, left)
+        const double TOF_OFFSETS[NUM_TOF_SENSORS] = {
+                CONFIG::TOF_FRONT_OFFSET, CONFIG::TOF_RIGHT_OFFSET, CONFIG::TOF_REAR_OFFSET, CONFIG::TOF_LEFT_OFFSET
+        };
+        // the TF-Luna cannot see further than this
+        constexpr double TOF_MAX_RANGE = 8.0;
+    }
+
+    Plant::Plant(CONFIG::SteeringStyle style, const PlantConfig& config) : driveDirection(style), config(config) {
+        for (int i = 0; i < MOTOR_POSITION::MOTOR_POSITION_COUNT; i++) {
+            HOST_HAL::setEncoderCount(ENCODER_PINS[i].first, 0);
+        }
+    }
+
+    void Plant::setPose(double x, double y, double heading) {
+        poseX = x;
+        poseY = y;
+        poseHeading = heading;
+    }
+
+    void Plant::step(double dtS) {
+        // rear wheels: each follows its duty towards the no-load speed. The encoder is wired so that it reads in
+        // the same sense the stoker commands (left wheels positive forwards, right wheels negative forwards).
+        const double alpha = 1.0 - std::exp(-dtS / config.wheelTimeConstantS);
+        for (const MotorPosition wheel : {MOTOR_POSITION::REAR_LEFT, MOTOR_POSITION::REAR_RIGHT}) {
+            const double target = HOST_HAL::motorDuty(MOTOR_PINS[wheel].first) * CONFIG::SPEED_SCALE_RADIANS_PER_SEC;
+            wheelRates[wheel] += (target - wheelRates[wheel]) * alpha;
+        }
+
+        // front wheels: they roll where the body takes them. A wheel moves along the chassis as fast as the rear
+        // wheel on its side, and a steered wheel rolls further to cover that
+        const double maxAngle = CONFIG::MAX_STEERING_ANGLE;
+        const double leftAngle = std::fmin(std::fabs(HOST_HAL::servoValue(STEERING_PINS[0])), maxAngle);
+        const double rightAngle = std::fmin(std::fabs(HOST_HAL::servoValue(STEERING_PINS[1])), maxAngle);
+        wheelRates[MOTOR_POSITION::FRONT_LEFT] = wheelRates[MOTOR_POSITION::REAR_LEFT] / std::cos(leftAngle);
+        wheelRates[MOTOR_POSITION::FRONT_RIGHT] = wheelRates[MOTOR_POSITION::REAR_RIGHT] / std::cos(rightAngle);
+
+        // a spinning wheel turns further than it rolls; only its encoder sees the difference
+        const double countsPerRadian = CONFIG::COUNTS_PER_REV / (2.0 * M_PI);
+        for (int i = 0; i < MOTOR_POSITION::MOTOR_POSITION_COUNT; i++) {
+            wheelCounts[i] += wheelRates[i] * (1.0 + config.wheelSpin[i]) * dtS * countsPerRadian;
+            HOST_HAL::setEncoderCount(ENCODER_PINS[i].first, static_cast<int32_t>(std::floor(wheelCounts[i])));
+        }
+
+        // body: rear axle kinematics, matching StateEstimator::getPositionDelta
+        const double wheelRadius = CONFIG::WHEEL_DIAMETER / 2.0;
+        const double leftSpeed = wheelRates[MOTOR_POSITION::REAR_LEFT] * wheelRadius;
+        const double rightSpeed = -wheelRates[MOTOR_POSITION::REAR_RIGHT] * wheelRadius;
+        bodySpeed = driveDirection * (leftSpeed + rightSpeed) / 2.0;
+        bodyYawRate = (rightSpeed - leftSpeed) / CONFIG::WHEEL_TRACK;
+
+        // integrate about the midpoint heading
+        const double midHeading = poseHeading + bodyYawRate * dtS / 2.0;
+        poseX -= bodySpeed * dtS * std::sin(midHeading);
+        poseY += bodySpeed * dtS * std::cos(midHeading);
+        poseHeading = std::remainder(poseHeading + bodyYawRate * dtS, 2.0 * M_PI);
+    }
+
+    double Plant::rayToWall(double angle) const {
+        if (!std::isfinite(config.arenaSize)) {
+            return TOF_MAX_RANGE;
+        }
+        const double half = config.arenaSize / 2.0;
+        const double dx = -std::sin(angle);
+        const double dy = std::cos(angle);
+        double range = std::numeric_limits<double>::infinity();
+        if (dx > 1e-9) range = std::min(range, (half - poseX) / dx);
+        if (dx < -1e-9) range = std::min(range, (-half - poseX) / dx);
+        if (dy > 1e-9) range = std::min(range, (half - poseY) / dy);
+        if (dy < -1e-9) range = std::min(range, (-half - poseY) / dy);
+        return std::min(range, TOF_MAX_RANGE);
+    }
+
+    double Plant::tofRange(int sensor) const {
+        // the sensors are fixed to the chassis, whose mechanical front faces backwards when driving as a forklift
+        const double chassisHeading = poseHeading + (driveDirection == CONFIG::Forklift ? M_PI : 0.0);
+        const double sensorHeading = chassisHeading - sensor * M_PI_2;
+        return std::max(0.0, rayToWall(sensorHeading) - TOF_OFFSETS[sensor]);
+    }
+}
@@ -0,0 +1,170 @@
+// Cost and accuracy benchmark for the pose EKF.
+//
+// A robot drives a looping course around a square arena. Each 10 ms tick the filter is given the wheel
+// distance with slip noise, an IMU yaw with noise, and one or two ToF ranges per tick as the staggered
+// reads deliver them, a few of them bogus. The benchmark times predict, the heading correction and the
+// range corrections separately, in host nanoseconds and (on x86) TSC cycles. Build the host tree with
+// -DCMAKE_BUILD_TYPE=Release for meaningful numbers. The same stages run on the target under the profiler's
+// poseEkf stage. It also reports the filter's error against the true pose, next to the error of dead
+// reckoning on the same inputs.
+//
+//   pose_ekf_bench [TICKS]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "pose_ekf.h"
+#include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+namespace {
+    constexpr float ARENA_SIZE = 2.2f;
+    constexpr float DT = 0.01f;
+    constexpr float TOF_OFFSET = 0.0f; // ranges are from the robot centre, as TfLunaArray reports them
+
+    struct Truth {
+        float x = 0.0f;
+        float y = -0.5f;
+        float heading = 0.0f;
+    };
+
+    float rangeToWall(const Truth& truth, const float angle) {
+        const float half = ARENA_SIZE / 2;
+        const float ux = -std::sin(angle);
+        const float uy = std::cos(angle);
+        float range = INFINITY;
+        if (ux > 1e-6f) range = std::fmin(range, (half - truth.x) / ux);
+        if (ux < -1e-6f) range = std::fmin(range, (-half - truth.x) / ux);
+        if (uy > 1e-6f) range = std::fmin(range, (half - truth.y) / uy);
+        if (uy < -1e-6f) range = std::fmin(range, (-half - truth.y) / uy);
+        return range + TOF_OFFSET;
+    }
+
+    struct Clock {
+        uint64_t nanoseconds = 0;
+        uint64_t cycles = 0;
+        uint64_t calls = 0;
+
+        template<typename Work>
+        void time(Work work) {
+#if HAVE_TSC
+            const uint64_t startCycles = __rdtsc();
+#endif
+            const auto start = std::chrono::steady_clock::now();
+            work();
+            const auto end = std::chrono::steady_clock::now();
+#if HAVE_TSC
+            cycles += __rdtsc() - startCycles;
+#endif
+            nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            calls++;
+        }
+
+        void print(const char* name) const {
+            if (calls == 0) {
+                return;
+            }
+            printf("  %-18s %9llu calls %9.0f ns", name, (unsigned long long) calls,
+                   static_cast<double>(nanoseconds) / static_cast<double>(calls));
+#if HAVE_TSC
+            printf(" %9.0f cycles", static_cast<double>(cycles) / static_cast<double>(calls));
+#endif
+            printf("\n");
+        }
+    };
+}
+
+int main(int argc, char** argv) {
+    const long ticks = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 200000;
+    if (ticks <= 0) {
+        fprintf(stderr, "usage: %s [TICKS]\n", argv[0]);
+        return 1;
+    }
+
+    std::mt19937 random(42);
+    std::normal_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    POSE_EKF::PoseEkf filter(CONFIG::Car, ARENA_SIZE);
+    Truth truth;
+    filter.reset({truth.x, truth.y, truth.heading});
+    Truth deadReckoning = truth;
+
+    Clock predict;
+    Clock heading;
+    Clock range;
+    double squaredError = 0.0;
+    double deadReckoningSquaredError = 0.0;
+    float maxError = 0.0f;
+
+    for (long tick = 0; tick < ticks; tick++) {
+        // a slow weave around the arena: 0.8 m/s, turning back and forth
+        const float t = static_cast<float>(tick) * DT;
+        const float speed = 0.8f;
+        float turnRate = 1.6f * std::sin(0.5f * t) + 0.6f * std::sin(1.7f * t);
+        // keep the course inside the arena by steering back towards the centre near the walls
+        if (std::fabs(truth.x) > 0.7f || std::fabs(truth.y) > 0.7f) {
+            const float towardsCentre = wrap_pi(std::atan2(truth.x, -truth.y) - truth.heading);
+            turnRate = std::fmax(-3.0f, std::fmin(3.0f, 4.0f * towardsCentre));
+        }
+        truth.heading = wrap_pi(truth.heading + turnRate * DT);
+        truth.x -= speed * DT * std::sin(truth.heading);
+        truth.y += speed * DT * std::cos(truth.heading);
+
+        const float distance = speed * DT * (1.0f + 0.03f * unit(random));
+        const float yaw = truth.heading + 0.005f * unit(random);
+
+        predict.time([&] { filter.predict(distance, DT); });
+        heading.time([&] { filter.correctHeading(yaw); });
+        deadReckoning.heading = yaw;
+        deadReckoning.x -= distance * std::sin(yaw);
+        deadReckoning.y += distance * std::cos(yaw);
+
+        // the staggered reads deliver the four sensors over two ticks; one in twenty ranges is bogus
+        for (size_t sensor = tick % 2; sensor < COMMON::NUM_TOF_SENSORS; sensor += 2) {
+            float measured = rangeToWall(truth, truth.heading - static_cast<float>(sensor) * static_cast<float>(M_PI_2));
+            measured += 0.02f * unit(random);
+            if (uniform(random) < 0.05f) {
+                measured *= uniform(random);
+            }
+            range.time([&] { filter.correctRange(sensor, measured); });
+        }
+
+        const COMMON::Pose estimate = filter.pose();
+        const float error = std::hypot(estimate.x - truth.x, estimate.y - truth.y);
+        squaredError += error * error;
+        maxError = std::fmax(maxError, error);
+        const float deadReckoningError = std::hypot(deadReckoning.x - truth.x, deadReckoning.y - truth.y);
+        deadReckoningSquaredError += deadReckoningError * deadReckoningError;
+    }
+
+    printf("pose EKF, %ld ticks (%.0f s)\n", ticks, static_cast<double>(ticks) * DT);
+    predict.print("predict");
+    heading.print("correctHeading");
+    range.print("correctRange");
+    const double perTick = (static_cast<double>(predict.nanoseconds + heading.nanoseconds + range.nanoseconds))
+                           / static_cast<double>(ticks);
+    printf("  %-18s %25.0f ns", "per tick", perTick);
+#if HAVE_TSC
+    printf(" %9.0f cycles", static_cast<double>(predict.cycles + heading.cycles + range.cycles) / static_cast<double>(ticks));
+#endif
+    printf("\n");
+
+    const POSE_EKF::RangeStats stats = filter.rangeStats();
+    printf("ranges: %u fused, %u rejected by the gate, %u skipped, %u recoveries\n", stats.accepted, stats.rejected,
+           stats.skipped, stats.recoveries);
+    printf("position error: ekf rms %.4f max %.4f m, dead reckoning rms %.4f m\n",
+           std::sqrt(squaredError / static_cast<double>(ticks)), maxError,
+           std::sqrt(deadReckoningSquaredError / static_cast<double>(ticks)));
+    printf("final sigma x %.4f y %.4f m heading %.4f rad\n", std::sqrt(filter.variance(POSE_EKF::STATE::X)),
+           std::sqrt(filter.variance(POSE_EKF::STATE::Y)), std::sqrt(filter.variance(POSE_EKF::STATE::HEADING)));
+    return 0;
+}
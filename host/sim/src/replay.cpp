@@ -0,0 +1,268 @@
+// Replays a flight recorder dump through the unmodified control stack.
+//
+// The dump (a telemetry capture holding FLIGHT_RECORD frames, see libs/flight_recorder) supplies, for
+// every estimator tick, the encoder counts, the IMU yaw, the ToF ranges and the receiver channels. They
+// are fed in through the host HAL and the simulated I2C devices, so the StateEstimator, Navigator and
+// WaypointNavigation code run exactly as they do in osod_sim, in virtual time and as fast as the host
+// allows. After each replayed tick the replayed pose and requested state are compared with the ones
+// recorded on the robot.
+//
+// The replay starts from the first recorded tick's pose. State the dump doesn't hold, such as the
+// waypoint index and the PID integrators, starts from scratch, so expect the setpoints to take a
+// moment to settle unless the dump starts at the beginning of a run.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "pico/stdlib.h"
+#include "host_hal.h"
+#include "navigator.h"
+#include "receiver.h"
+#include "statemanager.h"
+#include "state_estimator.h"
+#include "ackermann_strategy.h"
+#include "drivetrain_config.h"
+#include "utils.h"
+#include "bno080.h"
+#include "i2c_engine.h"
+#include "telemetry.h"
+#include "flight_recorder.h"
+#include "sim_devices.h"
+#include "flight_capture.h"
+
+namespace {
+    using FLIGHT_RECORDER::TickRecord;
+
+    constexpr uint64_t STEP_US = 1000;
+    constexpr uint64_t WARM_UP_US = 500000;     // long enough for the IMU and every ToF sensor to report
+    constexpr uint64_t TICK_TIMEOUT_US = 100000;
+    const uint8_t TOF_ADDRESSES[COMMON::NUM_TOF_SENSORS] = {0x12, 0x13, 0x11, 0x14};   // front, right, rear, left
+    const float TOF_OFFSETS[COMMON::NUM_TOF_SENSORS] = {
+            CONFIG::TOF_FRONT_OFFSET, CONFIG::TOF_RIGHT_OFFSET, CONFIG::TOF_REAR_OFFSET, CONFIG::TOF_LEFT_OFFSET
+    };
+    const pin_pair ENCODER_PINS[COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT] = {
+            motor::motor2040::ENCODER_A, motor::motor2040::ENCODER_B,
+            motor::motor2040::ENCODER_C, motor::motor2040::ENCODER_D
+    };
+
+    void usage(const char* name) {
+        fprintf(stderr, "usage: %s CAPTURE [--csv FILE]\n", name);
+        fprintf(stderr, "  CAPTURE     telemetry capture holding a flight recorder dump\n");
+        fprintf(stderr, "  --csv FILE  write the recorded and replayed pose and setpoints for every tick\n");
+    }
+
+    const TickRecord* current = nullptr;
+
+    void applyInputs(const TickRecord& tick) {
+        current = &tick;
+        for (int i = 0; i < COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT; i++) {
+            HOST_HAL::setEncoderCount(ENCODER_PINS[i].first, tick.encoderCount[i]);
+        }
+        HOST_HAL::setReceiverChannels(tick.receiverChannels, FLIGHT_RECORDER::RECEIVER_CHANNEL_COUNT);
+    }
+
+    struct ErrorStats {
+        double sumOfSquares = 0.0;
+        double max = 0.0;
+        uint32_t samples = 0;
+
+        void add(double error) {
+            sumOfSquares += error * error;
+            max = std::max(max, std::fabs(error));
+            samples++;
+        }
+
+        double rms() const {
+            return samples > 0 ? std::sqrt(sumOfSquares / samples) : 0.0;
+        }
+    };
+
+    void discardTelemetry(const uint8_t* data, size_t length) {
+        (void) data;
+        (void) length;
+    }
+
+    struct TimerCallbackData {
+        bool shouldNavigate;
+    };
+
+    TimerCallbackData timerCallbackData = {false};
+
+    extern "C" bool timer_callback(repeating_timer_t *t) {
+        auto *user_data = reinterpret_cast<TimerCallbackData *>(t->user_data);
+        user_data->shouldNavigate = true;
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* capturePath = nullptr;
+    const char* csvPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (capturePath == nullptr && argv[i][0] != '-') {
+            capturePath = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (capturePath == nullptr) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE* input = std::fopen(capturePath, "rb");
+    if (input == nullptr) {
+        fprintf(stderr, "could not open %s\n", capturePath);
+        return 1;
+    }
+    const std::vector<TickRecord> ticks = SIM::loadTicks(input);
+    std::fclose(input);
+    if (ticks.size() < 2) {
+        fprintf(stderr, "%s holds no flight recorder dump to replay\n", capturePath);
+        return 1;
+    }
+    FILE* csv = nullptr;
+    if (csvPath != nullptr) {
+        csv = std::fopen(csvPath, "w");
+        if (csv == nullptr) {
+            fprintf(stderr, "could not create %s\n", csvPath);
+            return 1;
+        }
+        fprintf(csv, "tick,time_us,recorded_x,recorded_y,recorded_heading,replayed_x,replayed_y,replayed_heading,"
+                     "recorded_velocity,replayed_velocity,recorded_angular_velocity,replayed_angular_velocity\n");
+    }
+    if (std::freopen("/dev/null", "w", stdout) == nullptr) {
+        return 1;
+    }
+
+    // ---- the recorded world: the devices report whatever the current tick recorded ----
+    applyInputs(ticks.front());
+    SIM::TfLunaDevice* tofDevices[COMMON::NUM_TOF_SENSORS];
+    for (int i = 0; i < static_cast<int>(COMMON::NUM_TOF_SENSORS); i++) {
+        tofDevices[i] = new SIM::TfLunaDevice([i] {
+            return std::max(0.0, static_cast<double>(current->tofDistance[i] - TOF_OFFSETS[i]));
+        });
+        HOST_HAL::attachI2CDevice(i2c0, TOF_ADDRESSES[i], tofDevices[i]);
+    }
+    SIM::Bno08xDevice imuDevice([] { return SIM::ImuTruth{current->imuYaw, current->imuYawRate}; });
+    HOST_HAL::attachI2CDevice(i2c0, CONFIG::BNO08X_ADDR, &imuDevice);
+    imuDevice.setInterruptPin(CONFIG::IMU_INT_PIN);
+    HOST_HAL::gpioDrive(CONFIG::motorStatusPin, false);
+
+    // ---- the firmware, wired as in src/main.cpp ----
+    const auto wallStart = std::chrono::steady_clock::now();
+
+    stdio_init_all();
+    initMotorMonitorPins();
+    TELEMETRY::setSink(discardTelemetry);
+
+    i2c_inst_t* i2c_port0;
+    initI2C(i2c_port0, false);
+    auto *i2cEngine = new I2C_ENGINE::I2CEngine(i2c_port0);
+
+    BNO08x IMU;
+    if (!IMU.begin(CONFIG::BNO08X_ADDR, i2c_port0, i2cEngine)) {
+        fprintf(stderr, "simulated BNO08x did not start\n");
+        return 1;
+    }
+    auto *pStateEstimator = new STATE_ESTIMATOR::StateEstimator(&IMU, i2c_port0, i2cEngine, CONFIG::DRIVING_STYLE);
+    auto *pAckermannSteerStrategy = new MIXER::AckermannMixer(CONFIG::WHEEL_TRACK, CONFIG::WHEEL_BASE);
+    auto *pStateManager = new STATEMANAGER::StateManager(pAckermannSteerStrategy, pStateEstimator);
+    Receiver *pReceiver = getReceiver(motor::motor2040::SHARED_ADC);
+    auto *navigator = new Navigator(pReceiver, pStateManager, pStateEstimator, CONFIG::DRIVING_STYLE);
+
+    // start from the recorded pose: the estimator starts at the origin with its heading offset at zero. The
+    // filtered heading can lead or lag the IMU yaw by a few hundredths of a radian in a fast turn, so the
+    // recorded heading offset is taken as the mean difference over the whole dump, not the first tick's
+    const TickRecord& first = ticks.front();
+    double offsetSin = 0.0;
+    double offsetCos = 0.0;
+    for (const TickRecord& tick : ticks) {
+        offsetSin += std::sin(tick.imuYaw - tick.pose.heading);
+        offsetCos += std::cos(tick.imuYaw - tick.pose.heading);
+    }
+    const auto headingOffset = static_cast<float>(std::atan2(offsetSin, offsetCos));
+    pStateEstimator->requestOdometryOffset(-first.pose.x, -first.pose.y, headingOffset);
+
+    repeating_timer_t navigationTimer;
+    add_repeating_timer_ms(20, timer_callback, &timerCallbackData, &navigationTimer);
+
+    // ---- replay ----
+    uint64_t simUs = HOST_HAL::nowUs();
+    auto step = [&]() {
+        simUs += STEP_US;
+        for (auto* tof : tofDevices) {
+            tof->service(simUs);
+        }
+        HOST_HAL::runUntil(simUs);
+        // the hub asserts INT, and the firmware timestamps its reports, at the time it samples the plant
+        imuDevice.service(simUs);
+        simUs = std::max(simUs, HOST_HAL::nowUs());
+
+        const bool estimated = pStateEstimator->serviceEstimation();
+        i2cEngine->service();
+        if (timerCallbackData.shouldNavigate) {
+            navigator->navigate();
+            timerCallbackData.shouldNavigate = false;
+        }
+        TELEMETRY::drain();
+        return estimated;
+    };
+
+    const uint64_t warmUpEndUs = simUs + WARM_UP_US;
+    while (simUs < warmUpEndUs) {
+        step();
+    }
+
+    const uint64_t replayStartUs = simUs;
+    ErrorStats positionError;
+    ErrorStats headingError;
+    ErrorStats velocityError;
+    ErrorStats angularVelocityError;
+    for (size_t k = 1; k < ticks.size(); k++) {
+        const TickRecord& recorded = ticks[k];
+        applyInputs(recorded);
+        const uint64_t deadlineUs = simUs + TICK_TIMEOUT_US;
+        while (!step()) {
+            if (simUs > deadlineUs) {
+                fprintf(stderr, "the estimator stopped running at tick %u\n", recorded.tick);
+                return 1;
+            }
+        }
+
+        TickRecord replayed{};
+        FLIGHT_RECORDER::latest(replayed);
+        positionError.add(std::hypot(replayed.pose.x - recorded.pose.x, replayed.pose.y - recorded.pose.y));
+        headingError.add(wrap_pi(replayed.pose.heading - recorded.pose.heading));
+        velocityError.add(replayed.requestedVelocity - recorded.requestedVelocity);
+        angularVelocityError.add(replayed.requestedAngularVelocity - recorded.requestedAngularVelocity);
+        if (csv != nullptr) {
+            fprintf(csv, "%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", recorded.tick, recorded.timeUs,
+                    recorded.pose.x, recorded.pose.y, recorded.pose.heading,
+                    replayed.pose.x, replayed.pose.y, replayed.pose.heading,
+                    recorded.requestedVelocity, replayed.requestedVelocity,
+                    recorded.requestedAngularVelocity, replayed.requestedAngularVelocity);
+        }
+    }
+    if (csv != nullptr) {
+        std::fclose(csv);
+    }
+
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    const double replayedSeconds = static_cast<double>(simUs - replayStartUs) * 1e-6;
+    const double recordedSeconds = static_cast<double>(ticks.back().timeUs - ticks.front().timeUs) * 1e-6;
+    fprintf(stderr, "replayed ticks %u-%u (%.2f s recorded, %.2f s simulated) in %.3f s wall (%.1fx real time)\n",
+            ticks.front().tick, ticks.back().tick, recordedSeconds, replayedSeconds, wallSeconds,
+            replayedSeconds / wallSeconds);
+    fprintf(stderr, "position error          rms %.4f max %.4f m\n", positionError.rms(), positionError.max);
+    fprintf(stderr, "heading error           rms %.4f max %.4f rad\n", headingError.rms(), headingError.max);
+    fprintf(stderr, "requested velocity      rms %.4f max %.4f m/s\n", velocityError.rms(), velocityError.max);
+    fprintf(stderr, "requested angular vel.  rms %.4f max %.4f rad/s\n", angularVelocityError.rms(),
+            angularVelocityError.max);
+    return 0;
+}
@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "sim_devices.h"
+
+namespace SIM {
+
+    // ---- TF-Luna ----
+
+    namespace {
+        const uint8_t TF_LUNA_TRIGGER[] = {0x5A, 0x05, 0x00, 0x01, 0x60};
+        constexpr double TF_LUNA_TEMPERATURE_C = 25.0;
+        constexpr uint16_t TF_LUNA_STRENGTH = 1200;
+    }
+
+    TfLunaDevice::TfLunaDevice(std::function<double()> rangeM, uint64_t framePeriodUs)
+        : rangeM(std::move(rangeM)), framePeriodUs(framePeriodUs) {
+        service(0);
+    }
+
+    void TfLunaDevice::service(uint64_t nowUs) {
+        if (nowUs < nextFrameUs) {
+            return;
+        }
+        nextFrameUs = nowUs + framePeriodUs;
+
+        auto distanceCm = static_cast<uint16_t>(std::lround(rangeM() * 100.0));
+        uint16_t strength = TF_LUNA_STRENGTH;
+        if (glitchFraction > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random) < glitchFraction) {
+            if (nextGlitchWeak) {
+                distanceCm = 0;
+                strength = 0;
+            } else {
+                distanceCm = static_cast<uint16_t>(distanceCm * std::uniform_real_distribution<double>(0.0, 1.0)(random));
+            }
+            nextGlitchWeak = !nextGlitchWeak;
+        }
+        const auto temperature = static_cast<uint16_t>((TF_LUNA_TEMPERATURE_C + 256.0) * 8.0);
+        frame[0] = 0x59;
+        frame[1] = 0x59;
+        frame[2] = distanceCm & 0xFF;
+        frame[3] = distanceCm >> 8;
+        frame[4] = strength & 0xFF;
+        frame[5] = strength >> 8;
+        frame[6] = temperature & 0xFF;
+        frame[7] = temperature >> 8;
+        uint8_t checksum = 0;
+        for (int i = 0; i < 8; i++) {
+            checksum += frame[i];
+        }
+        frame[8] = checksum;
+    }
+
+    void TfLunaDevice::setGlitches(const double fraction, const uint32_t seed) {
+        glitchFraction = fraction;
+        random.seed(seed);
+    }
+
+    int TfLunaDevice::write(const uint8_t* src, size_t len) {
+        if (len == sizeof(TF_LUNA_TRIGGER) && std::memcmp(src, TF_LUNA_TRIGGER, len) == 0) {
+            // the trigger returns the latest completed frame, not a fresh measurement
+            std::memcpy(latched, frame, sizeof(frame));
+        }
+        return static_cast<int>(len);
+    }
+
+    int TfLunaDevice::read(uint8_t* dst, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            dst[i] = i < sizeof(latched) ? latched[i] : 0;
+        }
+        return static_cast<int>(len);
+    }
+
+    // ---- BNO08x ----
+
+    namespace {
+        constexpr size_t SHTP_HEADER_LEN = 4;
+        constexpr size_t MAX_INPUT_CARGO = 252;
+        constexpr size_t MAX_PENDING_REPORTS = 64;
+
+        constexpr uint8_t CHANNEL_COMMAND = 0;
+        constexpr uint8_t CHANNEL_EXECUTABLE = 1;
+        constexpr uint8_t CHANNEL_CONTROL = 2;
+        constexpr uint8_t CHANNEL_INPUT_NORMAL = 3;
+        constexpr uint8_t CHANNEL_GYRO_RV = 5;
+
+        constexpr uint8_t REPORT_GYROSCOPE = 0x02;
+        constexpr uint8_t REPORT_ROTATION_VECTOR = 0x05;
+        constexpr uint8_t REPORT_GAME_ROTATION_VECTOR = 0x08;
+        constexpr uint8_t REPORT_GYRO_INTEGRATED_RV = 0x2A;
+        constexpr uint8_t REPORT_PROD_ID_RESP = 0xF8;
+        constexpr uint8_t REPORT_PROD_ID_REQ = 0xF9;
+        constexpr uint8_t REPORT_BASE_TIMESTAMP = 0xFB;
+        constexpr uint8_t REPORT_SET_FEATURE = 0xFD;
+
+        // report id / length pairs advertised to the host (SH-2 reference manual, section 6)
+        const uint8_t REPORT_LENGTHS[] = {
+                0xF1, 16, 0xF3, 16, 0xF5, 4, 0xF8, 16, 0xFC, 17, 0xFB, 5, 0xFA, 5, 0xEF, 2,
+                0x01, 10, 0x02, 10, 0x03, 10, 0x04, 10, 0x05, 14, 0x06, 10, 0x07, 16, 0x08, 12,
+                0x09, 14, 0x2A, 14,
+        };
+
+        uint32_t minimumIntervalUs(uint8_t sensorId) {
+            return sensorId == REPORT_GYRO_INTEGRATED_RV ? 1000 : 2500;
+        }
+
+        void putU16(std::vector<uint8_t>& out, uint16_t value) {
+            out.push_back(value & 0xFF);
+            out.push_back(value >> 8);
+        }
+
+        void putU32(std::vector<uint8_t>& out, uint32_t value) {
+            for (int i = 0; i < 4; i++) {
+                out.push_back((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        void putQ(std::vector<uint8_t>& out, double value, int qPoint) {
+            const double scaled = std::clamp(value * (1 << qPoint), -32768.0, 32767.0);
+            putU16(out, static_cast<uint16_t>(static_cast<int16_t>(std::lround(scaled))));
+        }
+
+        void putTlv(std::vector<uint8_t>& out, uint8_t tag, const std::vector<uint8_t>& value) {
+            out.push_back(tag);
+            out.push_back(static_cast<uint8_t>(value.size()));
+            out.insert(out.end(), value.begin(), value.end());
+        }
+
+        std::vector<uint8_t> u32Value(uint32_t value) {
+            std::vector<uint8_t> out;
+            putU32(out, value);
+            return out;
+        }
+
+        std::vector<uint8_t> u16Value(uint16_t value) {
+            std::vector<uint8_t> out;
+            putU16(out, value);
+            return out;
+        }
+
+        std::vector<uint8_t> stringValue(const char* text) {
+            return {text, text + std::strlen(text) + 1};
+        }
+    }
+
+    Bno08xDevice::Bno08xDevice(std::function<ImuTruth()> truth) : truth(std::move(truth)) {
+    }
+
+    void Bno08xDevice::reset() {
+        sensors.clear();
+        pendingInputs.clear();
+        pendingGyroRv.clear();
+        outgoing.clear();
+        current.bytes.clear();
+        currentOffset = 0;
+        std::fill(std::begin(sequenceNumbers), std::end(sequenceNumbers), 0);
+        queueAdvertisement();
+        queuePacket(CHANNEL_EXECUTABLE, {1});   // reset complete
+    }
+
+    void Bno08xDevice::queuePacket(uint8_t channel, const std::vector<uint8_t>& payload) {
+        queuePacket(channel, payload, HOST_HAL::nowUs());
+    }
+
+    void Bno08xDevice::queuePacket(uint8_t channel, const std::vector<uint8_t>& payload, uint64_t readyUs) {
+        // the sequence number is filled in as the packet is read
+        const auto length = static_cast<uint16_t>(payload.size() + SHTP_HEADER_LEN);
+        std::vector<uint8_t> packet = {
+                static_cast<uint8_t>(length & 0xFF), static_cast<uint8_t>(length >> 8), channel, 0
+        };
+        packet.insert(packet.end(), payload.begin(), payload.end());
+        outgoing.push_back({readyUs, std::move(packet)});
+    }
+
+    void Bno08xDevice::queueAdvertisement() {
+        std::vector<uint8_t> advert = {0x00};
+
+        putTlv(advert, 1, u32Value(0));                 // GUID: SHTP
+        putTlv(advert, 2, u16Value(256));               // max cargo + header, write
+        putTlv(advert, 3, u16Value(384));               // max cargo + header, read
+        putTlv(advert, 4, u16Value(256));               // max transfer, write
+        putTlv(advert, 5, u16Value(256));               // max transfer, read
+        putTlv(advert, 8, stringValue("SHTP"));
+        putTlv(advert, 0x80, stringValue("1.0.1"));
+        putTlv(advert, 6, {CHANNEL_COMMAND});
+        putTlv(advert, 9, stringValue("command"));
+
+        putTlv(advert, 1, u32Value(1));                 // GUID: executable
+        putTlv(advert, 8, stringValue("executable"));
+        putTlv(advert, 6, {CHANNEL_EXECUTABLE});
+        putTlv(advert, 9, stringValue("device"));
+
+        putTlv(advert, 1, u32Value(2));                 // GUID: sensor hub
+        putTlv(advert, 8, stringValue("sensorhub"));
+        putTlv(advert, 0x80, stringValue("1.0.0"));
+        putTlv(advert, 0x81, {std::begin(REPORT_LENGTHS), std::end(REPORT_LENGTHS)});
+        putTlv(advert, 6, {CHANNEL_CONTROL});
+        putTlv(advert, 9, stringValue("control"));
+        putTlv(advert, 6, {CHANNEL_INPUT_NORMAL});
+        putTlv(advert, 9, stringValue("inputNormal"));
+        putTlv(advert, 7, {4});
+        putTlv(advert, 9, stringValue("inputWake"));
+        putTlv(advert, 6, {CHANNEL_GYRO_RV});
+        putTlv(advert, 9, stringValue("inputGyroRv"));
+
+        queuePacket(CHANNEL_COMMAND, advert);
+    }
+
+    void Bno08xDevice::queueProductIds() {
+        const uint32_t partNumbers[] = {10003608, 10003606, 10003171, 10003251};
+        std::vector<uint8_t> payload;
+        for (uint32_t partNumber : partNumbers) {
+            payload.push_back(REPORT_PROD_ID_RESP);
+            payload.push_back(0x01);                    // reset cause: power on
+            payload.push_back(3);                       // sw version major
+            payload.push_back(2);                       // sw version minor
+            putU32(payload, partNumber);
+            putU32(payload, 7);                         // build
+            putU16(payload, 0);                         // patch
+            putU16(payload, 0);                         // reserved
+        }
+        queuePacket(CHANNEL_CONTROL, payload);
+    }
+
+    void Bno08xDevice::handleControl(const uint8_t* payload, size_t len) {
+        if (len == 0) {
+            return;
+        }
+        switch (payload[0]) {
+            case REPORT_PROD_ID_REQ:
+                queueProductIds();
+                break;
+            case REPORT_SET_FEATURE: {
+                if (len < 17) {
+                    return;
+                }
+                const uint8_t sensorId = payload[1];
+                uint32_t interval = payload[5] | payload[6] << 8 | payload[7] << 16 | uint32_t(payload[8]) << 24;
+                if (interval == 0) {
+                    sensors.erase(sensorId);
+                    return;
+                }
+                Sensor& sensor = sensors[sensorId];
+                sensor.intervalUs = std::max(interval, minimumIntervalUs(sensorId));
+                sensor.nextDueUs = HOST_HAL::nowUs() + sensor.intervalUs;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    std::vector<uint8_t> Bno08xDevice::makeReport(uint8_t sensorId, Sensor& sensor, const ImuTruth& imu) const {
+        const double halfYaw = imu.yaw / 2.0;
+        std::vector<uint8_t> report;
+        if (sensorId == REPORT_GYRO_INTEGRATED_RV) {
+            // no report header on the gyro RV channel: quaternion Q14 then angular velocity Q10
+            putQ(report, 0.0, 14);
+            putQ(report, 0.0, 14);
+            putQ(report, std::sin(halfYaw), 14);
+            putQ(report, std::cos(halfYaw), 14);
+            putQ(report, 0.0, 10);
+            putQ(report, 0.0, 10);
+            putQ(report, imu.yawRate, 10);
+            return report;
+        }
+
+        report = {sensorId, sensor.sequence++, 0x03, 0x00};   // status: high accuracy, delay filled in later
+        switch (sensorId) {
+            case REPORT_ROTATION_VECTOR:
+            case REPORT_GAME_ROTATION_VECTOR:
+                putQ(report, 0.0, 14);
+                putQ(report, 0.0, 14);
+                putQ(report, std::sin(halfYaw), 14);
+                putQ(report, std::cos(halfYaw), 14);
+                if (sensorId == REPORT_ROTATION_VECTOR) {
+                    putQ(report, 0.05, 12);     // estimated heading accuracy, radians
+                }
+                break;
+            case REPORT_GYROSCOPE:
+                putQ(report, 0.0, 9);
+                putQ(report, 0.0, 9);
+                putQ(report, imu.yawRate, 9);
+                break;
+            default:
+                return {};
+        }
+        return report;
+    }
+
+    void Bno08xDevice::service(uint64_t nowUs) {
+        bool sampled = false;
+        ImuTruth imu{};
+        for (auto& [sensorId, sensor] : sensors) {
+            if (sensor.nextDueUs > nowUs) {
+                continue;
+            }
+            if (!sampled) {
+                imu = truth();
+                sampled = true;
+            }
+            auto& queue = sensorId == REPORT_GYRO_INTEGRATED_RV ? pendingGyroRv : pendingInputs;
+            std::vector<uint8_t> report = makeReport(sensorId, sensor, imu);
+            if (!report.empty()) {
+                queue.push_back({nowUs, std::move(report)});
+            }
+            while (queue.size() > MAX_PENDING_REPORTS) {
+                queue.pop_front();
+                droppedReports++;
+            }
+            sensor.nextDueUs += sensor.intervalUs;
+            if (sensor.nextDueUs <= nowUs) {
+                sensor.nextDueUs = nowUs + sensor.intervalUs;
+            }
+        }
+
+        while (!scripted.empty() && scripted.front().sampleUs <= nowUs) {
+            outgoing.push_back(std::move(scripted.front()));
+            scripted.pop_front();
+        }
+
+        if (interruptPin >= 0 && !interruptAsserted && hasData()) {
+            interruptAsserted = true;
+            interruptAssertedUs = nowUs;
+            HOST_HAL::gpioDrive(interruptPin, false);
+        }
+    }
+
+    void Bno08xDevice::setInterruptPin(uint pin) {
+        interruptPin = static_cast<int>(pin);
+        interruptAsserted = false;
+        HOST_HAL::gpioDrive(pin, true);
+    }
+
+    void Bno08xDevice::script(uint64_t atUs, std::vector<uint8_t> packet) {
+        const auto later = std::upper_bound(scripted.begin(), scripted.end(), atUs,
+                                            [](uint64_t us, const PendingReport& entry) { return us < entry.sampleUs; });
+        scripted.insert(later, {atUs, std::move(packet)});
+    }
+
+    bool Bno08xDevice::hasData() const {
+        return !current.bytes.empty() || !outgoing.empty() || !pendingGyroRv.empty() || !pendingInputs.empty();
+    }
+
+    bool Bno08xDevice::buildInputPacket(uint64_t interruptUs) {
+        if (!pendingGyroRv.empty()) {
+            queuePacket(CHANNEL_GYRO_RV, pendingGyroRv.front().bytes, pendingGyroRv.front().sampleUs);
+            pendingGyroRv.pop_front();
+            return true;
+        }
+        if (pendingInputs.empty()) {
+            return false;
+        }
+
+        // one base timestamp reference, counted back from INT, then as many reports as fit, each carrying its
+        // delay from the base
+        const uint64_t baseUs = pendingInputs.front().sampleUs;
+        std::vector<uint8_t> payload = {REPORT_BASE_TIMESTAMP};
+        putU32(payload, static_cast<uint32_t>((interruptUs - std::min(baseUs, interruptUs)) / 100));
+        while (!pendingInputs.empty() && payload.size() + pendingInputs.front().bytes.size() <= MAX_INPUT_CARGO) {
+            PendingReport& report = pendingInputs.front();
+            const auto delay = static_cast<uint16_t>(std::min<uint64_t>((report.sampleUs - baseUs) / 100, 0x3FFF));
+            report.bytes[2] = static_cast<uint8_t>((report.bytes[2] & 0x03) | ((delay >> 8) << 2));
+            report.bytes[3] = delay & 0xFF;
+            payload.insert(payload.end(), report.bytes.begin(), report.bytes.end());
+            pendingInputs.pop_front();
+        }
+        queuePacket(CHANNEL_INPUT_NORMAL, payload, baseUs);
+        return true;
+    }
+
+    int Bno08xDevice::write(const uint8_t* src, size_t len) {
+        if (len < SHTP_HEADER_LEN) {
+            return static_cast<int>(len);
+        }
+        const size_t packetLen = std::min<size_t>((src[0] | src[1] << 8) & 0x7FFF, len);
+        const uint8_t channel = src[2];
+        const uint8_t* payload = src + SHTP_HEADER_LEN;
+        const size_t payloadLen = packetLen > SHTP_HEADER_LEN ? packetLen - SHTP_HEADER_LEN : 0;
+
+        if (channel == CHANNEL_EXECUTABLE && payloadLen >= 1 && payload[0] == 1) {
+            reset();
+        } else if (channel == CHANNEL_COMMAND && payloadLen >= 1 && payload[0] == 0) {
+            queueAdvertisement();
+        } else if (channel == CHANNEL_CONTROL) {
+            handleControl(payload, payloadLen);
+        }
+        return static_cast<int>(len);
+    }
+
+    int Bno08xDevice::read(uint8_t* dst, size_t len) {
+        statistics.reads++;
+        statistics.bytesRead += len;
+        // the hub times its reports from when it asserted INT; with no INT wired, from the read
+        const uint64_t interruptUs = interruptAsserted ? interruptAssertedUs : HOST_HAL::nowUs();
+        if (interruptAsserted) {
+            interruptAsserted = false;
+            HOST_HAL::gpioDrive(interruptPin, true);
+        }
+        if (current.bytes.empty()) {
+            if (outgoing.empty()) {
+                buildInputPacket(interruptUs);
+            }
+            if (!outgoing.empty()) {
+                current = std::move(outgoing.front());
+                outgoing.pop_front();
+                currentOffset = 0;
+            }
+        }
+
+        std::memset(dst, 0, len);
+        if (current.bytes.empty()) {
+            // nothing to send: a zero-length header
+            statistics.emptyReads++;
+            return static_cast<int>(len);
+        }
+
+        // every read transaction starts with a header describing the cargo that is still to come. Each
+        // transfer that carries cargo, continuations included, takes the channel's next sequence number
+        const std::vector<uint8_t>& packet = current.bytes;
+        const uint8_t channel = packet[2] < std::size(sequenceNumbers) ? packet[2] : 0;
+        const size_t remaining = packet.size() - SHTP_HEADER_LEN - currentOffset;
+        uint8_t header[SHTP_HEADER_LEN] = {packet[0], packet[1], packet[2], sequenceNumbers[channel]};
+        if (currentOffset > 0) {
+            const auto continuationLen = static_cast<uint16_t>(remaining + SHTP_HEADER_LEN);
+            header[0] = continuationLen & 0xFF;
+            header[1] = static_cast<uint8_t>((continuationLen >> 8) | 0x80);
+        }
+        std::memcpy(dst, header, std::min(len, SHTP_HEADER_LEN));
+
+        const size_t cargo = len > SHTP_HEADER_LEN ? std::min(len - SHTP_HEADER_LEN, remaining) : 0;
+        if (cargo > 0) {
+            sequenceNumbers[channel]++;
+        }
+        std::memcpy(dst + SHTP_HEADER_LEN, packet.data() + SHTP_HEADER_LEN + currentOffset, cargo);
+        currentOffset += cargo;
+        if (currentOffset == packet.size() - SHTP_HEADER_LEN) {
+            const uint64_t deliveryUs = HOST_HAL::nowUs() - std::min(current.sampleUs, HOST_HAL::nowUs());
+            statistics.packetsDelivered++;
+            statistics.deliverySumUs += deliveryUs;
+            statistics.maxDeliveryUs = std::max(statistics.maxDeliveryUs, deliveryUs);
+            current.bytes.clear();
+        }
+        return static_cast<int>(len);
+    }
+}
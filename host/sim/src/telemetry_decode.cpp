@@ -0,0 +1,227 @@
+// Decodes a captured telemetry stream into CSV, one file per record type.
+//
+// The input is the raw byte stream from the firmware's USB serial port (or osod_sim --telemetry), so it
+// may have printf text mixed in; anything that isn't a valid frame is skipped. For an output prefix P
+// the records are written to P_vehicle_state.csv, P_motor.csv, P_pid.csv, P_waypoint.csv and
+// P_estimator_health.csv, and a flight recorder dump to P_flight_record.csv, each with the core the record came from and its frame
+// sequence number ahead of the record's own fields.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "telemetry_decoder.h"
+#include "flight_recorder.h"
+
+namespace {
+    using namespace TELEMETRY;
+
+    struct Output {
+        RECORD::Type type;
+        const char* suffix;
+        const char* header;
+        FILE* file;
+        uint32_t records;
+    };
+
+    Output outputs[] = {
+            {RECORD::VEHICLE_STATE, "vehicle_state",
+             "time_us,x,y,heading,velocity,angular_velocity,x_dot,y_dot,"
+             "speed_front_left,speed_front_right,speed_rear_left,speed_rear_right,"
+             "steering_left,steering_right,tof_front,tof_right,tof_rear,tof_left,"
+             "slip_front_left,slip_front_right,slip_rear_left,slip_rear_right", nullptr, 0},
+            {RECORD::MOTOR, "motor",
+             "time_us,motor,measured_speed,setpoint,command,limited_command,duty,current_limited", nullptr, 0},
+            {RECORD::PID, "pid",
+             "time_us,loop,setpoint,measurement,p_term,i_term,d_term,output,dt", nullptr, 0},
+            {RECORD::WAYPOINT, "waypoint",
+             "time_us,target_index,nearest_index,distance_to_go,bearing,desired_v,desired_w,x,y,heading", nullptr, 0},
+            {RECORD::ESTIMATOR_HEALTH, "estimator_health",
+             "time_us,covariance_xx,covariance_xy,covariance_yy,heading_variance,"
+             "imu_nis,tof_nis_front,tof_nis_right,tof_nis_rear,tof_nis_left,since_range_fix_us,imu_accepted,"
+             "accepted_front,accepted_right,accepted_rear,accepted_left,"
+             "rejected_front,rejected_right,rejected_rear,rejected_left", nullptr, 0},
+            {RECORD::FLIGHT_RECORD, "flight_record",
+             "time_us,tick,"
+             "count_front_left,count_front_right,count_rear_left,count_rear_right,"
+             "delta_front_left,delta_front_right,delta_rear_left,delta_rear_right,"
+             "frequency_front_left,frequency_front_right,frequency_rear_left,frequency_rear_right,"
+             "imu_yaw,imu_yaw_rate,imu_read_us,"
+             "tof_front,tof_right,tof_rear,tof_left,"
+             "strength_front,strength_right,strength_rear,strength_left,"
+             "captured_us_front,captured_us_right,captured_us_rear,captured_us_left,"
+             "rx_ail,rx_ele,rx_thr,rx_rud,rx_aux,rx_nc,"
+             "requested_velocity,requested_angular_velocity,"
+             "speed_front_left,speed_front_right,speed_rear_left,speed_rear_right,steering_left,steering_right,"
+             "pose_x,pose_y,pose_heading",
+             nullptr, 0},
+    };
+
+    template<typename Record>
+    bool unpack(const Frame& frame, Record& record) {
+        if (frame.length != sizeof(Record)) {
+            return false;
+        }
+        std::memcpy(&record, frame.payload, sizeof(Record));
+        return true;
+    }
+
+    // returns false for an unknown type, or a known type with the wrong length
+    bool writeRecord(const Frame& frame, FILE* file) {
+        switch (frame.type) {
+            case RECORD::VEHICLE_STATE: {
+                VehicleStateRecord r;
+                if (!unpack(frame, r)) return false;
+                fprintf(file, "%u,%u,", frame.source, frame.sequence);
+                fprintf(file, "%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f,%.3f,%.3f,%.4f,%.4f,%.3f,%.3f,%.3f,%.3f,"
+                              "%.3f,%.3f,%.3f,%.3f\n",
+                        r.timeUs, r.x, r.y, r.heading, r.velocity, r.angularVelocity, r.xDot, r.yDot,
+                        r.wheelSpeeds[0], r.wheelSpeeds[1], r.wheelSpeeds[2], r.wheelSpeeds[3],
+                        r.steeringLeft, r.steeringRight,
+                        r.tofDistances[0], r.tofDistances[1], r.tofDistances[2], r.tofDistances[3],
+                        r.wheelSlip[0], r.wheelSlip[1], r.wheelSlip[2], r.wheelSlip[3]);
+                return true;
+            }
+            case RECORD::MOTOR: {
+                MotorRecord r;
+                if (!unpack(frame, r)) return false;
+                fprintf(file, "%u,%u,", frame.source, frame.sequence);
+                fprintf(file, "%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%u\n", r.timeUs, r.motor, r.measuredSpeed, r.setpoint,
+                        r.command, r.limitedCommand, r.duty, r.currentLimited);
+                return true;
+            }
+            case RECORD::PID: {
+                PidRecord r;
+                if (!unpack(frame, r)) return false;
+                fprintf(file, "%u,%u,", frame.source, frame.sequence);
+                fprintf(file, "%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.6f\n", r.timeUs, r.loop, r.setpoint, r.measurement,
+                        r.pTerm, r.iTerm, r.dTerm, r.output, r.dt);
+                return true;
+            }
+            case RECORD::WAYPOINT: {
+                WaypointRecord r;
+                if (!unpack(frame, r)) return false;
+                fprintf(file, "%u,%u,", frame.source, frame.sequence);
+                fprintf(file, "%u,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", r.timeUs, r.targetIndex,
+                        r.nearestIndex, r.distanceToGo, r.bearing, r.desiredV, r.desiredW, r.x, r.y, r.heading);
+                return true;
+            }
+            case RECORD::ESTIMATOR_HEALTH: {
+                EstimatorHealthRecord r;
+                if (!unpack(frame, r)) return false;
+                fprintf(file, "%u,%u,", frame.source, frame.sequence);
+                fprintf(file, "%u,%.6g,%.6g,%.6g,%.6g,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+                        r.timeUs, r.covarianceXX, r.covarianceXY, r.covarianceYY, r.headingVariance,
+                        r.imuNormalisedInnovation, r.tofNormalisedInnovation[0], r.tofNormalisedInnovation[1],
+                        r.tofNormalisedInnovation[2], r.tofNormalisedInnovation[3], r.sinceRangeFixUs,
+                        r.imuAccepted, r.tofAccepted[0], r.tofAccepted[1], r.tofAccepted[2], r.tofAccepted[3],
+                        r.tofRejected[0], r.tofRejected[1], r.tofRejected[2], r.tofRejected[3]);
+                return true;
+            }
+            case RECORD::FLIGHT_RECORD: {
+                FLIGHT_RECORDER::TickRecord r;
+                if (!unpack(frame, r)) return false;
+                const COMMON::DriveTrainState& d = r.driveTrainState;
+                fprintf(file, "%u,%u,", frame.source, frame.sequence);
+                fprintf(file, "%u,%u,%d,%d,%d,%d,%d,%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%.4f,%.4f,%u,"
+                              "%.3f,%.3f,%.3f,%.3f,%u,%u,%u,%u,%u,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,"
+                              "%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                        r.timeUs, r.tick,
+                        r.encoderCount[0], r.encoderCount[1], r.encoderCount[2], r.encoderCount[3],
+                        r.encoderDelta[0], r.encoderDelta[1], r.encoderDelta[2], r.encoderDelta[3],
+                        r.encoderFrequency[0], r.encoderFrequency[1], r.encoderFrequency[2], r.encoderFrequency[3],
+                        r.imuYaw, r.imuYawRate, r.imuReadUs,
+                        r.tofDistance[0], r.tofDistance[1], r.tofDistance[2], r.tofDistance[3],
+                        r.tofStrength[0], r.tofStrength[1], r.tofStrength[2], r.tofStrength[3],
+                        r.tofCapturedUs[0], r.tofCapturedUs[1], r.tofCapturedUs[2], r.tofCapturedUs[3],
+                        r.receiverChannels[0], r.receiverChannels[1], r.receiverChannels[2],
+                        r.receiverChannels[3], r.receiverChannels[4], r.receiverChannels[5],
+                        r.requestedVelocity, r.requestedAngularVelocity,
+                        d.speeds.speeds[0], d.speeds.speeds[1], d.speeds.speeds[2], d.speeds.speeds[3],
+                        d.angles.left, d.angles.right, r.pose.x, r.pose.y, r.pose.heading);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    Output* outputFor(uint8_t type) {
+        for (auto& output : outputs) {
+            if (output.type == type) {
+                return &output;
+            }
+        }
+        return nullptr;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s CAPTURE [OUTPUT_PREFIX]\n", argv[0]);
+        fprintf(stderr, "  CAPTURE        raw telemetry stream, or - for stdin\n");
+        fprintf(stderr, "  OUTPUT_PREFIX  prefix for the CSV files (default: CAPTURE without its extension)\n");
+        return 1;
+    }
+    const bool fromStdin = std::strcmp(argv[1], "-") == 0;
+    FILE* input = fromStdin ? stdin : std::fopen(argv[1], "rb");
+    if (input == nullptr) {
+        fprintf(stderr, "could not open %s\n", argv[1]);
+        return 1;
+    }
+    std::string prefix;
+    if (argc == 3) {
+        prefix = argv[2];
+    } else if (fromStdin) {
+        prefix = "telemetry";
+    } else {
+        prefix = argv[1];
+        const size_t dot = prefix.find_last_of('.');
+        const size_t slash = prefix.find_last_of('/');
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+            prefix.erase(dot);
+        }
+    }
+
+    FrameDecoder decoder;
+    Frame frame;
+    uint32_t malformed = 0;
+    int byte;
+    while ((byte = std::fgetc(input)) != EOF) {
+        decoder.push(static_cast<uint8_t>(byte));
+        while (decoder.next(frame)) {
+            Output* output = outputFor(frame.type);
+            if (output == nullptr) {
+                malformed++;
+                continue;
+            }
+            if (output->file == nullptr) {
+                const std::string path = prefix + "_" + output->suffix + ".csv";
+                output->file = std::fopen(path.c_str(), "w");
+                if (output->file == nullptr) {
+                    fprintf(stderr, "could not create %s\n", path.c_str());
+                    return 1;
+                }
+                fprintf(output->file, "core,sequence,%s\n", output->header);
+            }
+            if (writeRecord(frame, output->file)) {
+                output->records++;
+            } else {
+                malformed++;
+            }
+        }
+    }
+    if (!fromStdin) {
+        std::fclose(input);
+    }
+
+    const DecoderStats stats = decoder.stats();
+    fprintf(stderr, "%u frames, %u lost, %u checksum errors, %u bytes skipped, %u malformed records\n",
+            stats.frames, stats.lostFrames, stats.checksumErrors, stats.skippedBytes, malformed);
+    for (auto& output : outputs) {
+        if (output.file != nullptr) {
+            std::fclose(output.file);
+            fprintf(stderr, "  %s_%s.csv: %u records\n", prefix.c_str(), output.suffix, output.records);
+        }
+    }
+    return 0;
+}
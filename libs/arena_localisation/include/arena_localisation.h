@@ -0,0 +1,64 @@
+#ifndef OSOD_MOTOR_2040_ARENA_LOCALISATION_H
+#define OSOD_MOTOR_2040_ARENA_LOCALISATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include "types.h"
+
+/*
+ * Locates the robot in a square arena from the four ToF ranges and its heading.
+ *
+ * Each ray hits either an x wall or a y wall, so each one suggests a candidate x and a candidate y
+ * position. There are 16 ways to choose the walls. The kernel picks the choice whose x candidates and y
+ * candidates agree best, meaning the lowest total variance. The fix is the mean of each set.
+ *
+ * The kernel is built for a core without an FPU:
+ * - There is one sin/cos pair per call.
+ * - There are eight float multiplies to place the candidates. The candidates are then converted to whole
+ *   millimetres.
+ * - Everything after that is 32-bit integer arithmetic.
+ * - The assignments are visited in Gray code order, which is fixed at compile time. Successive
+ *   assignments differ by one ray, so the sums and sums of squares are updated by moving one candidate
+ *   from one axis to the other.
+ * - The best assignment is tracked with selects rather than branches.
+ *
+ * A ray is left out when it is shorter than its sensor's clearance, or longer than the sensor can
+ * measure or the arena allows. A short ray means the beam hit the robot itself. A ray left out that way
+ * plays no part in any assignment. A fix needs at least three usable rays, including at least one on
+ * each axis.
+ */
+
+namespace ARENA_LOCALISATION {
+    struct RayLimits {
+        float minRange[COMMON::NUM_TOF_SENSORS]; // metres from the robot centre, indexed like FourToFDistances
+        float maxRange;                          // metres from the robot centre
+    };
+
+    struct Fix {
+        COMMON::Pose pose;  // arena-centred position; heading is the heading the fix was made with
+        float variance;     // m², total spread of the chosen assignment's x and y candidates
+        uint8_t rays;       // bitmask of the sensors used
+        uint8_t yWalls;     // bitmask of the sensors taken to be ranging a y wall
+        bool valid;         // false if too few rays were usable; pose is then all zero
+    };
+
+    class ArenaLocaliser {
+    public:
+        // driveDirection flips the fix to match the odometry frame when driving as a forklift.
+        ArenaLocaliser(float arenaSize, const RayLimits& limits, float driveDirection = 1.0f);
+
+        [[nodiscard]] Fix locate(float heading, const COMMON::FourToFDistances& distances) const;
+
+        // True if range can be used from this sensor: past the robot's own geometry and within reach.
+        [[nodiscard]] bool rayUsable(size_t sensor, float range) const;
+
+    private:
+        float halfArena;
+        float candidateLimit; // candidates are clamped to ±this, which keeps the integer sums in range
+        int32_t candidateLimitMm;
+        RayLimits limits;
+        float driveDirection;
+    };
+}
+
+#endif //OSOD_MOTOR_2040_ARENA_LOCALISATION_H
@@ -0,0 +1,142 @@
+#include "arena_localisation.h"
+
+#include <cmath>
+#include "fast_math.h"
+
+namespace ARENA_LOCALISATION {
+    using COMMON::NUM_TOF_SENSORS;
+
+    namespace {
+        constexpr size_t NUM_ASSIGNMENTS = 1 << NUM_TOF_SENSORS;
+
+        // The wall assignments in Gray code order: bit n set means sensor n is ranging a y wall. Each
+        // entry after the first moves one sensor to the other axis.
+        struct Assignment {
+            uint8_t yWalls;
+            uint8_t movedSensor;
+            int8_t toY; // +1 if the moved sensor goes to the y walls, -1 if it comes back to the x walls
+        };
+
+        constexpr struct Assignments {
+            Assignment entries[NUM_ASSIGNMENTS];
+
+            constexpr Assignments() : entries() {
+                for (size_t i = 0; i < NUM_ASSIGNMENTS; i++) {
+                    const auto gray = static_cast<uint8_t>(i ^ (i >> 1));
+                    uint8_t moved = 0;
+                    while (i > 0 && ((i >> moved) & 1u) == 0) {
+                        moved++;
+                    }
+                    entries[i] = {gray, moved, static_cast<int8_t>((gray >> moved) & 1u ? 1 : -1)};
+                }
+            }
+        } ASSIGNMENTS;
+
+        static_assert(ASSIGNMENTS.entries[1].yWalls == 0b0001 && ASSIGNMENTS.entries[2].yWalls == 0b0011 &&
+                      ASSIGNMENTS.entries[3].yWalls == 0b0010 && ASSIGNMENTS.entries[3].toY == -1,
+                      "assignments must be in Gray code order");
+
+        // n²·variance = n·Σc² - (Σc)², so multiplying by 144/n² scales every set size's variance by the same
+        // 144 without a division. A set of none scores zero here and is ruled out by the count check.
+        constexpr uint32_t VARIANCE_SCALE = 144;
+        constexpr uint32_t SCALE_BY_COUNT[NUM_TOF_SENSORS + 1] = {0, 144, 36, 16, 9};
+
+        // 144·(3.8 m)² in mm² per axis still fits twice in 32 bits
+        constexpr float MAX_CANDIDATE_LIMIT = 3.8f;
+        constexpr uint32_t MIN_RAYS = 3;
+    }
+
+    ArenaLocaliser::ArenaLocaliser(const float arenaSize, const RayLimits& limits, const float driveDirection)
+            : halfArena(arenaSize / 2), candidateLimit(std::fmin(arenaSize, MAX_CANDIDATE_LIMIT)),
+              candidateLimitMm(static_cast<int32_t>(candidateLimit * 1000.0f)), limits(limits),
+              driveDirection(driveDirection) {
+        // the longest a ray can be inside the arena is the diagonal
+        const float diagonal = arenaSize * static_cast<float>(M_SQRT2);
+        if (diagonal < this->limits.maxRange) {
+            this->limits.maxRange = diagonal;
+        }
+    }
+
+    bool ArenaLocaliser::rayUsable(const size_t sensor, const float range) const {
+        // false for NaN too
+        return range >= limits.minRange[sensor] && range <= limits.maxRange;
+    }
+
+    Fix ArenaLocaliser::locate(const float heading, const COMMON::FourToFDistances& distances) const {
+        const float ranges[NUM_TOF_SENSORS] = {distances.front, distances.right, distances.rear, distances.left};
+        float sinHeading;
+        float cosHeading;
+        FAST_MATH::sincos(heading, sinHeading, cosHeading);
+        // the beam direction (-sin a, cos a) for a = heading - sensor·π/2, indexed like FourToFDistances
+        const float ux[NUM_TOF_SENSORS] = {-sinHeading, cosHeading, sinHeading, -cosHeading};
+        const float uy[NUM_TOF_SENSORS] = {cosHeading, sinHeading, -cosHeading, -sinHeading};
+
+        // candidate positions in mm from the arena centre, and whether each ray counts (1) or not (0)
+        int32_t xCandidate[NUM_TOF_SENSORS];
+        int32_t yCandidate[NUM_TOF_SENSORS];
+        int32_t weight[NUM_TOF_SENSORS];
+        uint8_t rays = 0;
+        int32_t xSum = 0;
+        int32_t xSquares = 0;
+        int32_t xCount = 0;
+        for (size_t sensor = 0; sensor < NUM_TOF_SENSORS; sensor++) {
+            const bool usable = rayUsable(sensor, ranges[sensor]);
+            const float range = usable ? ranges[sensor] : 0.0f;
+            const float xWall = ux[sensor] > 0.0f ? halfArena : -halfArena;
+            const float yWall = uy[sensor] > 0.0f ? halfArena : -halfArena;
+            const float x = std::fmin(std::fmax(xWall - range * ux[sensor], -candidateLimit), candidateLimit);
+            const float y = std::fmin(std::fmax(yWall - range * uy[sensor], -candidateLimit), candidateLimit);
+            // rounded to the nearest mm: the shift keeps the value positive, so truncating rounds
+            xCandidate[sensor] = static_cast<int32_t>((x + candidateLimit) * 1000.0f + 0.5f) - candidateLimitMm;
+            yCandidate[sensor] = static_cast<int32_t>((y + candidateLimit) * 1000.0f + 0.5f) - candidateLimitMm;
+            weight[sensor] = usable;
+            rays |= static_cast<uint8_t>(usable << sensor);
+            // the first assignment has every ray on the x walls
+            xSum += weight[sensor] * xCandidate[sensor];
+            xSquares += weight[sensor] * xCandidate[sensor] * xCandidate[sensor];
+            xCount += weight[sensor];
+        }
+
+        int32_t ySum = 0;
+        int32_t ySquares = 0;
+        int32_t yCount = 0;
+        uint32_t bestScore = UINT32_MAX;
+        uint8_t bestYWalls = 0;
+        int32_t bestXSum = 0;
+        int32_t bestXCount = 1;
+        int32_t bestYSum = 0;
+        int32_t bestYCount = 1;
+        for (size_t i = 1; i < NUM_ASSIGNMENTS; i++) {
+            const Assignment& assignment = ASSIGNMENTS.entries[i];
+            const size_t sensor = assignment.movedSensor;
+            const int32_t move = assignment.toY * weight[sensor];
+            xSum -= move * xCandidate[sensor];
+            xSquares -= move * xCandidate[sensor] * xCandidate[sensor];
+            xCount -= move;
+            ySum += move * yCandidate[sensor];
+            ySquares += move * yCandidate[sensor] * yCandidate[sensor];
+            yCount += move;
+
+            const auto xSpread = static_cast<uint32_t>(xCount * xSquares - xSum * xSum);
+            const auto ySpread = static_cast<uint32_t>(yCount * ySquares - ySum * ySum);
+            const uint32_t score = xSpread * SCALE_BY_COUNT[xCount] + ySpread * SCALE_BY_COUNT[yCount];
+            const bool better = (xCount > 0) & (yCount > 0) & (score < bestScore);
+            bestScore = better ? score : bestScore;
+            bestYWalls = better ? assignment.yWalls : bestYWalls;
+            bestXSum = better ? xSum : bestXSum;
+            bestXCount = better ? xCount : bestXCount;
+            bestYSum = better ? ySum : bestYSum;
+            bestYCount = better ? yCount : bestYCount;
+        }
+
+        const uint32_t rayCount = static_cast<uint32_t>(weight[0] + weight[1] + weight[2] + weight[3]);
+        if (rayCount < MIN_RAYS || bestScore == UINT32_MAX) {
+            return {{0.0f, 0.0f, 0.0f}, 0.0f, rays, 0, false};
+        }
+        const float x = static_cast<float>(bestXSum) / static_cast<float>(bestXCount) / 1000.0f;
+        const float y = static_cast<float>(bestYSum) / static_cast<float>(bestYCount) / 1000.0f;
+        const float variance = static_cast<float>(bestScore) / static_cast<float>(VARIANCE_SCALE) / 1.0e6f;
+        return {{driveDirection * x, driveDirection * y, heading}, variance, rays,
+                static_cast<uint8_t>(bestYWalls & rays), true};
+    }
+}
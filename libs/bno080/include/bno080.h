@@ -44,6 +44,7 @@
 #include "sh2_SensorValue.h"
 #include "sh2_err.h"
 #include "hardware/i2c.h"
+#include "i2c_engine.h"
 
 #pragma once
 
@@ -134,10 +135,26 @@
 #define TARE_AR_VR_STABILIZED_ROTATION_VECTOR 4
 #define TARE_AR_VR_STABILIZED_GAME_ROTATION_VECTOR 5
 
+// SHTP traffic since the last resetBusStats(). Every transaction also puts the address byte on the wire, so
+// wireBytes / cargoBytes is the bus cost of each byte of report.
+struct BNO08xBusStats {
+	uint32_t reads;
+	uint32_t emptyReads;	// found the hub with nothing to send
+	uint32_t wireBytes;		// reads and writes, address byte included
+	uint32_t cargoBytes;	// SHTP payload handed to the SH2 layer, headers excluded
+};
+
+// A decoded report as queued for drainSensorEvents(). Both times are in time_us_32()'s time base.
+struct BNO08xEvent {
+	sh2_SensorValue_t value;
+	uint32_t sampleUs;	// when the hub took the sample: the SH2 timestamp, counted back from INT
+	uint32_t hostUs;	// when it was decoded
+};
+
 class BNO08x
 {
 public:
-	bool begin(uint8_t deviceAddress = BNO08x_DEFAULT_ADDRESS, i2c_inst_t* i2c_port = i2c_default); //By default use the default I2C addres, and use Wire port
+	bool begin(uint8_t deviceAddress = BNO08x_DEFAULT_ADDRESS, i2c_inst_t* i2c_port = i2c_default, I2C_ENGINE::I2CEngine* i2c_engine = nullptr); //By default use the default I2C addres, and use Wire port. With an engine, SHTP traffic is queued on it at high priority
 	bool isConnected();
 
     sh2_ProductIds_t prodIds; ///< The product IDs returned by the sensor
@@ -152,6 +169,23 @@ public:
     bool getSensorEvent();
 	uint8_t getSensorEventID();
 
+	// Every report enabled with enableReport() also gets a queue of its own, so the reports decoded from one
+	// service, or from several, all survive until they are drained; sensorValue still holds only the last.
+	// Copies out and removes up to maxEvents of the sensor's pending events, oldest first, and returns how many.
+	size_t drainSensorEvents(sh2_SensorId_t sensorId, BNO08xEvent *events, size_t maxEvents);
+	uint32_t droppedSensorEvents(sh2_SensorId_t sensorId); // overwritten before they were drained
+	static float eventYaw(const sh2_SensorValue_t &value); // of a rotation vector or gyro-integrated RV event
+
+	// Read the hub when it pulls its INT line low rather than on every getSensorEvent(): each falling edge queues
+	// one read on the I2C engine, and getSensorEvent() then only decodes what has already arrived. Needs the
+	// engine passed to begin(). Falls back to polling if INT stays quiet for CONFIG::IMU_INT_SILENCE_US.
+	// The GPIO interrupt is taken by the core that calls this, so call it from the core that decodes the reports.
+	bool serviceOnInterrupt(uint intPin);
+	bool interruptDriven();
+
+	BNO08xBusStats busStats();
+	void resetBusStats();
+
 	bool softReset();	  //Try to reset the IMU via software
 	bool serviceBus(void);	
 	uint8_t resetReason(); //Query the IMU for the reason it last reset
@@ -227,6 +261,7 @@ public:
 	float getGyroIntegratedRVangVelX();
 	float getGyroIntegratedRVangVelY();
 	float getGyroIntegratedRVangVelZ();
+	float getGyroIntegratedRVYaw();
 
 	void getMag(float &x, float &y, float &z, uint8_t &accuracy);
 	float getMagX();
@@ -295,6 +330,8 @@ private:
 
 	bool _printDebug = false; //Flag to print debugging variables
 
+	static float yawFromQuaternion(float dqw, float dqx, float dqy, float dqz);
+
 	//These are the raw sensor values (without Q applied) pulled from the user requested Input Report
 	uint16_t rawAccelX, rawAccelY, rawAccelZ, accelAccuracy;
 	uint16_t rawLinAccelX, rawLinAccelY, rawLinAccelZ, accelLinAccuracy;
@@ -45,16 +45,58 @@
 
 #include "drivetrain_config.h"
 #include "utils.h"
+#include "fast_math.h"
 #include "hardware/gpio.h"
 
 int8_t _int_pin = -1, _reset_pin = -1;
 static i2c_inst_t  *_i2cPort = NULL;		//The generic connection to user's chosen I2C hardware
 static uint8_t _deviceAddress = BNO08x_DEFAULT_ADDRESS; //Keeps track of I2C address. setI2CAddress changes this.
+static I2C_ENGINE::I2CEngine *_i2cEngine = NULL;	//Shared bus engine, if the bus has one
 
 
 static sh2_SensorValue_t *_sensor_value = NULL;
+static bool _sensor_event_decoded = false; // set by sensorHandler, cleared before each sh2_service()
 static bool _reset_occurred = false;
 
+// decoded events of each enabled report, queued by sensorHandler until drainSensorEvents()
+#define SENSOR_EVENT_QUEUES 4
+#define SENSOR_EVENT_DEPTH 8 // a power of two
+struct SensorEventQueue {
+    BNO08xEvent events[SENSOR_EVENT_DEPTH];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+};
+static SensorEventQueue _eventQueues[SENSOR_EVENT_QUEUES];
+static uint8_t _eventQueueFor[SH2_MAX_SENSOR_ID + 1]; // one more than each sensor ID's queue index, 0 for none
+static size_t _eventQueuesUsed = 0;
+static SensorEventQueue *eventQueue(sh2_SensorId_t sensorId);
+
+// INT-driven servicing (serviceOnInterrupt): each falling edge on INT reads one fragment of up to
+// CONFIG::IMU_INT_READ_BYTES on the engine, and completed fragments wait here for sh2_service()
+#define SHTP_FRAGMENT_MAX 64 // the first fragment and any continuation read straight after it
+#define SHTP_FRAGMENT_SLOTS 8 // a power of two
+static_assert(CONFIG::IMU_INT_READ_BYTES >= 4 && CONFIG::IMU_INT_READ_BYTES <= SHTP_FRAGMENT_MAX,
+              "an INT read must hold the SHTP header and fit a fragment slot");
+
+struct ShtpFragment {
+    uint8_t data[SHTP_FRAGMENT_MAX];
+    uint16_t length;
+    uint32_t intUs; // when INT was seen low
+};
+
+static ShtpFragment _fragments[SHTP_FRAGMENT_SLOTS];
+static volatile uint32_t _fragmentHead = 0; // advanced by the read's completion
+static volatile uint32_t _fragmentTail = 0; // advanced by i2chal_read
+static I2C_ENGINE::Transfer _intTransfer;
+static critical_section_t _intLock;
+static volatile bool _interruptDriven = false;
+static uint32_t _lastFragmentUs = 0;
+
+static void startInterruptRead(uint32_t intUs, size_t length = CONFIG::IMU_INT_READ_BYTES);
+static void interruptReadComplete(I2C_ENGINE::Transfer &transfer);
+static void hal_intHandler(uint gpio, uint32_t events);
+
 static int i2chal_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len);
 static int i2chal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len,
                        uint32_t *t_us);
@@ -69,19 +111,33 @@ static bool i2c_write(const uint8_t *buffer, size_t len, bool stop = true,
         const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0);
 
 static bool i2c_read(uint8_t *buffer, size_t len, bool stop = true);
-static bool _i2c_read(uint8_t *buffer, size_t len, bool stop);
 
 
 
-size_t _maxBufferSize = 32;
+// The Arduino original was held to Wire's 32-byte buffer, which split every SHTP packet into chunks that
+// each re-read a header. Neither the RP2040's controller nor the I2C engine has that limit, so a whole
+// packet goes in one transaction, up to the largest the SH2 layer handles
+size_t _maxBufferSize = SH2_HAL_MAX_TRANSFER_IN;
 size_t maxBufferSize();		
 
+static uint8_t _txBuffer[SH2_HAL_MAX_TRANSFER_OUT]; // i2c_write() gathers its prefix and data here
+static BNO08xBusStats _busStats = {};
+
+// CONFIG::I2C_TIMEOUT_US catches a hung bus, but a whole packet can take longer than that to clock out
+// (the advertisement, a couple of hundred bytes, takes around 20 ms at 100 kHz), so allow each transaction
+// twice its own bus time on top
+static uint32_t transferTimeoutUs(size_t len) {
+  const uint64_t busUs = (uint64_t)(len + 1) * 9 * 1000000 / CONFIG::I2C_BAUD_RATE;
+  return CONFIG::I2C_TIMEOUT_US + (uint32_t)(2 * busUs);
+}
+
 //Initializes the sensor with basic settings using I2C
 //Returns false if sensor is not detected
-bool BNO08x::begin(uint8_t deviceAddress, i2c_inst_t* i2c_port)
+bool BNO08x::begin(uint8_t deviceAddress, i2c_inst_t* i2c_port, I2C_ENGINE::I2CEngine* i2c_engine)
 {
   	_deviceAddress = deviceAddress;
   	_i2cPort = i2c_port;
+  	_i2cEngine = i2c_engine;
 
 
 
@@ -157,23 +213,31 @@ float BNO08x::getPitch()
 // Return the yaw / heading (rotation around the z-axis) in Radians
 float BNO08x::getYaw()
 {
-	float dqw = getQuatReal();
-	float dqx = getQuatI();
-	float dqy = getQuatJ();
-	float dqz = getQuatK();
+	return yawFromQuaternion(getQuatReal(), getQuatI(), getQuatJ(), getQuatK());
+}
 
-	float norm = std::sqrt(dqw*dqw + dqx*dqx + dqy*dqy + dqz*dqz);
-	dqw = dqw/norm;
-	dqx = dqx/norm;
-	dqy = dqy/norm;
-	dqz = dqz/norm;
+// Return the yaw of the gyro-integrated rotation vector in Radians
+float BNO08x::getGyroIntegratedRVYaw()
+{
+	return yawFromQuaternion(getGyroIntegratedRVReal(), getGyroIntegratedRVI(), getGyroIntegratedRVJ(),
+	                         getGyroIntegratedRVK());
+}
+
+float BNO08x::yawFromQuaternion(float dqw, float dqx, float dqy, float dqz)
+{
+	// called for every IMU report, so this stays in single precision and off libm
+	float inverseNorm = FAST_MATH::rsqrt(dqw*dqw + dqx*dqx + dqy*dqy + dqz*dqz);
+	dqw = dqw*inverseNorm;
+	dqx = dqx*inverseNorm;
+	dqy = dqy*inverseNorm;
+	dqz = dqz*inverseNorm;
 
 	float ysqr = dqy * dqy;
 
 	// yaw (z-axis rotation)
-	float t3 = +2.0 * (dqw * dqz + dqx * dqy);
-	float t4 = +1.0 - 2.0 * (ysqr + dqz * dqz);
-	float yaw = std::atan2(t3, t4);
+	float t3 = +2.0f * (dqw * dqz + dqx * dqy);
+	float t4 = +1.0f - 2.0f * (ysqr + dqz * dqz);
+	float yaw = FAST_MATH::atan2(t3, t4);
 
 	return (yaw);
 }
@@ -1038,18 +1102,70 @@ bool BNO08x::wasReset(void) {
 bool BNO08x::getSensorEvent() {
   _sensor_value = &sensorValue;
 
-  _sensor_value->timestamp = 0;
+  // gyro-integrated RV reports carry no timestamp of their own, and the last report's sensorId stays
+  // behind in sensorValue, so neither says whether this service decoded anything
+  _sensor_event_decoded = false;
 
-  sh2_service();
+  if (!_interruptDriven) {
+    sh2_service();
+    return _sensor_event_decoded;
+  }
 
-  if (_sensor_value->timestamp == 0 && _sensor_value->sensorId != SH2_GYRO_INTEGRATED_RV) {
-    // no new events
-    return false;
+  // each service hands one fragment to the SHTP layer, and a fragment may hold a control response or
+  // only part of a packet, so keep going until an event is decoded or nothing more has arrived
+  do {
+    sh2_service();
+  } while (!_sensor_event_decoded && _fragmentTail != _fragmentHead);
+
+  if (!_sensor_event_decoded && time_us_32() - _lastFragmentUs > CONFIG::IMU_INT_SILENCE_US) {
+    // INT not wired, or stuck high
+    printf("BNO08x INT quiet for %lu us, polling instead\n", (unsigned long)CONFIG::IMU_INT_SILENCE_US);
+    gpio_set_irq_enabled(_int_pin, GPIO_IRQ_EDGE_FALL, false);
+    _interruptDriven = false;
   }
+  return _sensor_event_decoded;
+}
 
+bool BNO08x::serviceOnInterrupt(uint intPin) {
+  if (_i2cEngine == NULL) {
+    return false;
+  }
+  _int_pin = intPin;
+  critical_section_init(&_intLock);
+  _intTransfer.address = _deviceAddress;
+  _intTransfer.readLength = CONFIG::IMU_INT_READ_BYTES;
+  _intTransfer.priority = I2C_ENGINE::Priority::HIGH;
+  _intTransfer.callback = interruptReadComplete;
+  _fragmentHead = 0;
+  _fragmentTail = 0;
+  _lastFragmentUs = time_us_32();
+
+  // INT is active low and open drain on the hub
+  gpio_init(intPin);
+  gpio_set_dir(intPin, GPIO_IN);
+  gpio_pull_up(intPin);
+  _interruptDriven = true;
+  gpio_set_irq_enabled_with_callback(intPin, GPIO_IRQ_EDGE_FALL, true, hal_intHandler);
+
+  // a report may already be waiting, and its edge has gone
+  if (!gpio_get(intPin)) {
+    startInterruptRead(time_us_32());
+  }
   return true;
 }
 
+bool BNO08x::interruptDriven() {
+  return _interruptDriven;
+}
+
+BNO08xBusStats BNO08x::busStats() {
+  return _busStats;
+}
+
+void BNO08x::resetBusStats() {
+  _busStats = {};
+}
+
 /**
  * @brief Enable the given report type
  *
@@ -1081,9 +1197,51 @@ bool BNO08x::enableReport(sh2_SensorId_t sensorId, uint32_t interval_us,
     return false;
   }
 
+  if (sensorId <= SH2_MAX_SENSOR_ID && eventQueue(sensorId) == NULL) {
+    if (_eventQueuesUsed == SENSOR_EVENT_QUEUES) {
+      printf("BNO08x: no event queue left for report 0x%02x, only its last event is kept\n", sensorId);
+    } else {
+      _eventQueues[_eventQueuesUsed] = {};
+      _eventQueueFor[sensorId] = (uint8_t)++_eventQueuesUsed;
+    }
+  }
   return true;
 }
 
+static SensorEventQueue *eventQueue(sh2_SensorId_t sensorId) {
+  if (sensorId > SH2_MAX_SENSOR_ID || _eventQueueFor[sensorId] == 0) {
+    return NULL;
+  }
+  return &_eventQueues[_eventQueueFor[sensorId] - 1];
+}
+
+size_t BNO08x::drainSensorEvents(sh2_SensorId_t sensorId, BNO08xEvent *events, size_t maxEvents) {
+  SensorEventQueue *queue = eventQueue(sensorId);
+  if (queue == NULL) {
+    return 0;
+  }
+  size_t count = 0;
+  while (count < maxEvents && queue->tail != queue->head) {
+    events[count++] = queue->events[queue->tail % SENSOR_EVENT_DEPTH];
+    queue->tail++;
+  }
+  return count;
+}
+
+uint32_t BNO08x::droppedSensorEvents(sh2_SensorId_t sensorId) {
+  const SensorEventQueue *queue = eventQueue(sensorId);
+  return queue == NULL ? 0 : queue->dropped;
+}
+
+float BNO08x::eventYaw(const sh2_SensorValue_t &value) {
+  if (value.sensorId == SENSOR_REPORTID_GYRO_INTEGRATED_ROTATION_VECTOR) {
+    const auto &rv = value.un.gyroIntegratedRV;
+    return yawFromQuaternion(rv.real, rv.i, rv.j, rv.k);
+  }
+  const auto &rv = value.un.rotationVector;
+  return yawFromQuaternion(rv.real, rv.i, rv.j, rv.k);
+}
+
 /****************************************
 ***************************************** I2C interface
 *****************************************
@@ -1116,87 +1274,49 @@ static int i2chal_read(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len,
                        uint32_t *t_us) {
   // Serial.println("I2C HAL read");
 
-  // uint8_t *pBufferOrig = pBuffer;
-
-  uint8_t header[4];
-  if (!i2c_read(header, 4)) {
-    return 0;
+  if (_interruptDriven) {
+    // an edge can be missed while the previous read is on the bus or every slot is full, so pick up a
+    // hub that is still asking
+    if (!gpio_get(_int_pin)) {
+      startInterruptRead(time_us_32());
+    }
+    if (_fragmentTail == _fragmentHead) {
+      return 0;
+    }
+    const ShtpFragment &fragment = _fragments[_fragmentTail % SHTP_FRAGMENT_SLOTS];
+    const unsigned fragment_len = std::min<unsigned>(fragment.length, len);
+    memcpy(pBuffer, fragment.data, fragment_len);
+    *t_us = fragment.intUs;
+    _fragmentTail = _fragmentTail + 1;
+    return fragment_len;
   }
 
-  // Determine amount to read
-  uint16_t packet_size = (uint16_t)header[0] | (uint16_t)header[1] << 8;
-  // Unset the "continue" bit
-  packet_size &= ~0x8000;
-
-  /*
-  Serial.print("Read SHTP header. ");
-  Serial.print("Packet size: ");
-  Serial.print(packet_size);
-  Serial.print(" & buffer size: ");
-  Serial.println(len);
-  */
-
-  size_t i2c_buffer_max = maxBufferSize();
+  // the SH2 layer counts each report's timestamp back from when INT was asserted; polled, the nearest
+  // there is to that is the start of the read
+  *t_us = time_us_32();
 
-  if (packet_size > len) {
-    // packet wouldn't fit in our buffer
+  // the header says how long the packet is; then read all of it, header again included, in one
+  // transaction straight into the SHTP layer's buffer
+  if (!i2c_read(pBuffer, 4)) {
     return 0;
   }
-  // the number of non-header bytes to read
-  uint16_t cargo_remaining = packet_size;
-  uint8_t i2c_buffer[i2c_buffer_max];
-  uint16_t read_size;
-  uint16_t cargo_read_amount = 0;
-  bool first_read = true;
-
-  while (cargo_remaining > 0) {
-    if (first_read) {
-      read_size = std::min(i2c_buffer_max, (size_t)cargo_remaining);
-    } else {
-      read_size = std::min(i2c_buffer_max, (size_t)cargo_remaining + 4);
-    }
-
-    // Serial.print("Reading from I2C: "); Serial.println(read_size);
-    // Serial.print("Remaining to read: "); Serial.println(cargo_remaining);
-
-
-    if (!i2c_read(i2c_buffer, read_size)) {
-      return 0;
-    }
-
-    if (first_read) {
-      // The first time we're saving the "original" header, so include it in the
-      // cargo count
-      cargo_read_amount = read_size;
-      memcpy(pBuffer, i2c_buffer, cargo_read_amount);
-      first_read = false;
-    } else {
-      // this is not the first read, so copy from 4 bytes after the beginning of
-      // the i2c buffer to skip the header included with every new i2c read and
-      // don't include the header in the amount of cargo read
-      cargo_read_amount = read_size - 4;
-      memcpy(pBuffer, i2c_buffer + 4, cargo_read_amount);
-    }
-    // advance our pointer by the amount of cargo read
-    pBuffer += cargo_read_amount;
-    // mark the cargo as received
-    cargo_remaining -= cargo_read_amount;
+  // Unset the "continue" bit
+  uint16_t packet_size = ((uint16_t)pBuffer[0] | (uint16_t)pBuffer[1] << 8) & ~0x8000;
+  if (packet_size == 0) {
+    _busStats.emptyReads++;
+    return 0;
   }
-
-  /*
-  for (int i=0; i<packet_size; i++) {
-    Serial.print(pBufferOrig[i], HEX);
-    Serial.print(", ");
-    if (i % 16 == 15) Serial.println();
+  // anything longer than we can take arrives as continuations, which the SHTP layer reassembles
+  packet_size = std::min<size_t>(packet_size, std::min<size_t>(len, maxBufferSize()));
+  if (!i2c_read(pBuffer, packet_size)) {
+    return 0;
   }
-  Serial.println();
-  */
-
+  _busStats.cargoBytes += packet_size - 4;
   return packet_size;
 }
 
 static int i2chal_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
-  size_t i2c_buffer_max = maxBufferSize();
+  size_t i2c_buffer_max = sizeof(_txBuffer);
 
   /*
   Serial.print("I2C HAL write packet size: ");
@@ -1205,7 +1325,7 @@ static int i2chal_write(sh2_Hal_t *self, uint8_t *pBuffer, unsigned len) {
   Serial.println(i2c_buffer_max);
   */
 
-  uint16_t write_size = std::min(i2c_buffer_max, len);
+  uint16_t write_size = std::min<size_t>(i2c_buffer_max, len);
 
   if (!i2c_write(pBuffer, write_size)) {
     return 0;
@@ -1260,6 +1380,69 @@ static void sensorHandler(void *cookie, sh2_SensorEvent_t *event) {
     _sensor_value->timestamp = 0;
     return;
   }
+  _sensor_event_decoded = true;
+
+  // one service can decode several events, a whole batch or one of each enabled report, and each one
+  // overwrites _sensor_value, so keep a copy in its report's queue; when full, the oldest goes
+  SensorEventQueue *queue = eventQueue(_sensor_value->sensorId);
+  if (queue != NULL) {
+    if (queue->head - queue->tail == SENSOR_EVENT_DEPTH) {
+      queue->tail++;
+      queue->dropped++;
+    }
+    queue->events[queue->head % SENSOR_EVENT_DEPTH] = {*_sensor_value, (uint32_t)event->timestamp_uS, time_us_32()};
+    queue->head++;
+  }
+}
+
+// Queue a read of the next fragment, unless one is already on the bus or there is nowhere to put it.
+// Called from the INT edge, from a completed read and from task context.
+static void startInterruptRead(uint32_t intUs, size_t length) {
+  critical_section_enter_blocking(&_intLock);
+  if (!_intTransfer.inProgress() && _fragmentHead - _fragmentTail < SHTP_FRAGMENT_SLOTS) {
+    ShtpFragment &fragment = _fragments[_fragmentHead % SHTP_FRAGMENT_SLOTS];
+    fragment.intUs = intUs;
+    _intTransfer.readData = fragment.data;
+    _intTransfer.readLength = length;
+    _intTransfer.timeoutUs = transferTimeoutUs(length);
+    _i2cEngine->submit(_intTransfer);
+  }
+  critical_section_exit(&_intLock);
+}
+
+static void interruptReadComplete(I2C_ENGINE::Transfer &transfer) {
+  _busStats.reads++;
+  _busStats.wireBytes += transfer.readLength + 1;
+  if (transfer.succeeded()) {
+    // a zero length means the hub had nothing to send after all
+    const uint16_t packet_size = ((uint16_t)transfer.readData[0] | (uint16_t)transfer.readData[1] << 8) & ~0x8000;
+    if (packet_size == 0) {
+      _busStats.emptyReads++;
+    } else {
+      ShtpFragment &fragment = _fragments[_fragmentHead % SHTP_FRAGMENT_SLOTS];
+      fragment.length = std::min<size_t>(packet_size, transfer.readLength);
+      _busStats.cargoBytes += fragment.length - 4;
+      _fragmentHead = _fragmentHead + 1;
+      _lastFragmentUs = transfer.completedUs;
+      if (packet_size > transfer.readLength) {
+        // the rest follows as a continuation with its own header: read it now, in one go, rather than
+        // wait for the next edge
+        const size_t remaining = packet_size - transfer.readLength + 4;
+        startInterruptRead(fragment.intUs, std::min<size_t>(remaining, SHTP_FRAGMENT_MAX));
+        return;
+      }
+    }
+  }
+  // the hub raises INT again as soon as it has more, which may have been while this read was on the bus
+  if (!gpio_get(_int_pin)) {
+    startInterruptRead(time_us_32());
+  }
+}
+
+static void hal_intHandler(uint gpio, uint32_t events) {
+  if (_interruptDriven && gpio == (uint)_int_pin && (events & GPIO_IRQ_EDGE_FALL)) {
+    startInterruptRead(time_us_32());
+  }
 }
 
 /**
@@ -1299,12 +1482,12 @@ bool BNO08x::isConnected()
 
 /*!
  *    @brief  Write a buffer or two to the I2C device. Cannot be more than
- * maxBufferSize() bytes.
+ * SH2_HAL_MAX_TRANSFER_OUT bytes.
  *    @param  buffer Pointer to buffer of data to write. This is const to
  *            ensure the content of this buffer doesn't change.
  *    @param  len Number of bytes from buffer to write
  *    @param  prefix_buffer Pointer to optional array of data to write before
- * buffer. Cannot be more than maxBufferSize() bytes. This is const to
+ * buffer. Counts towards the same limit. This is const to
  *            ensure the content of this buffer doesn't change.
  *    @param  prefix_len Number of bytes from prefix buffer to write
  *    @param  stop Whether to send an I2C STOP signal on write
@@ -1314,12 +1497,12 @@ bool i2c_write(const uint8_t *buffer, size_t len, bool stop,
                                const uint8_t *prefix_buffer,
                                size_t prefix_len) {
     // Check buffer size - Adjust as per your platform's capabilities
-    if ((len + prefix_len) > maxBufferSize()) {
+    if ((len + prefix_len) > sizeof(_txBuffer)) {
         return false;
     }
 
     // Buffer to hold prefix and data combined
-    uint8_t combined_buffer[maxBufferSize()];
+    uint8_t *combined_buffer = _txBuffer;
     size_t total_len = 0;
 
     // Add prefix data if present
@@ -1331,9 +1514,21 @@ bool i2c_write(const uint8_t *buffer, size_t len, bool stop,
     // Add main data
     memcpy(combined_buffer + total_len, buffer, len);
     total_len += len;
+    _busStats.wireBytes += total_len + 1;
+
+    if (_i2cEngine != NULL) {
+        // the engine recovers the bus itself after a failed transfer
+        I2C_ENGINE::Transfer transfer;
+        transfer.address = _deviceAddress;
+        transfer.writeData = combined_buffer;
+        transfer.writeLength = total_len;
+        transfer.priority = I2C_ENGINE::Priority::HIGH;
+        transfer.timeoutUs = transferTimeoutUs(total_len);
+        return _i2cEngine->transferBlocking(transfer);
+    }
 
     // Perform the I2C write
-    int bytes_written = i2c_write_timeout_us(_i2cPort, _deviceAddress, combined_buffer, total_len, !stop, CONFIG::I2C_TIMEOUT_US);
+    int bytes_written = i2c_write_timeout_us(_i2cPort, _deviceAddress, combined_buffer, total_len, !stop, transferTimeoutUs(total_len));
     
     if (bytes_written == PICO_ERROR_GENERIC || bytes_written == PICO_ERROR_TIMEOUT) {
 		    // re-init the i2c port
@@ -1345,7 +1540,7 @@ bool i2c_write(const uint8_t *buffer, size_t len, bool stop,
 }
 
 /*!
- *    @brief  Read from I2C into a buffer from the I2C device.
+ *    @brief  Read from I2C into a buffer from the I2C device, in one transaction.
  *    Cannot be more than maxBufferSize() bytes.
  *    @param  buffer Pointer to buffer of data to read into
  *    @param  len Number of bytes from buffer to read.
@@ -1353,21 +1548,24 @@ bool i2c_write(const uint8_t *buffer, size_t len, bool stop,
  *    @return True if read was successful, otherwise false.
  */
 bool i2c_read(uint8_t *buffer, size_t len, bool stop) {
-  size_t pos = 0;
-  while (pos < len) {
-    size_t read_len =
-        ((len - pos) > maxBufferSize()) ? maxBufferSize() : (len - pos);
-    bool read_stop = (pos < (len - read_len)) ? false : stop;
-    if (!_i2c_read(buffer + pos, read_len, read_stop))
-      return false;
-    pos += read_len;
-  }
-  return true;
-}
+    if (len > maxBufferSize()) {
+        return false;
+    }
+    _busStats.reads++;
+    _busStats.wireBytes += len + 1;
+
+    if (_i2cEngine != NULL) {
+        I2C_ENGINE::Transfer transfer;
+        transfer.address = _deviceAddress;
+        transfer.readData = buffer;
+        transfer.readLength = len;
+        transfer.priority = I2C_ENGINE::Priority::HIGH;
+        transfer.timeoutUs = transferTimeoutUs(len);
+        return _i2cEngine->transferBlocking(transfer);
+    }
 
-bool _i2c_read(uint8_t *buffer, size_t len, bool stop) {
     // Perform the I2C read
-    int bytes_read = i2c_read_timeout_us(_i2cPort, _deviceAddress, buffer, len, !stop, CONFIG::I2C_TIMEOUT_US);
+    int bytes_read = i2c_read_timeout_us(_i2cPort, _deviceAddress, buffer, len, !stop, transferTimeoutUs(len));
 
 	  if (bytes_read == PICO_ERROR_GENERIC || bytes_read == PICO_ERROR_TIMEOUT) {
 		  // re-init the i2c port
@@ -0,0 +1,113 @@
+#ifndef OSOD_MOTOR_2040_FAST_MATH_H
+#define OSOD_MOTOR_2040_FAST_MATH_H
+
+#include <cstdint>
+
+/*
+ * Trigonometry and square roots for the control loops, without libm.
+ *
+ * The RP2040 has no FPU, so every libm sinf, atan2f or sqrtf is a long soft-float routine. Here most
+ * of the work is 32-bit integer arithmetic:
+ * - sin and cos interpolate a 257-entry quarter-wave table.
+ * - atan and atan2 fold into the first octant and interpolate a 257-entry arctangent table. The one
+ *   division goes to the RP2040's hardware divider in the fixed-point variant.
+ * - rsqrt uses a bit-level estimate refined by two Newton steps, and hypot is built on it.
+ * - The fixed-point roots seed from a small table and take one Newton step through the divider.
+ * The float variants cost a handful of float operations each. The Q16 variants take and return Q16.16
+ * fixed point (65536 = 1.0) and use no float at all.
+ *
+ * Angles are carried as BinaryAngle, a 32-bit fraction of a turn. Adding and subtracting wrap around
+ * for free, so an angle of any number of turns comes back in [-π, π] in one step. wrap_pi is
+ * built on it.
+ *
+ * Error bounds, measured by fast_math_bench against double-precision libm:
+ *   sin, cos                  < 6e-6 absolute (Q16: < 2e-5, which includes the Q16 rounding)
+ *   atan, atan2               < 3e-6 rad (Q16: < 5e-5 rad, set by the 15 bits kept from each input)
+ *   rsqrt                     < 5e-6 relative
+ *   hypot                     < 5e-6 relative
+ *   sqrtQ16, rsqrtQ16         < 4e-5 relative or 1 LSB, whichever is larger
+ *   hypotQ16                  < 7e-5 relative or 1 LSB, from the 15 bits kept from each input
+ *   wrap_pi                   < 1.5e-9 rad + 1.8e-7 |x|: the 2^-32-turn step of a BinaryAngle, plus float
+ *                             rounding in scaling x to turns and back. Inputs under 1.5e-9 rad come back as 0,
+ *                             and so do inputs of 1e9 rad or more, where a float's spacing is already tens of
+ *                             radians
+ * Non-finite float inputs give unspecified but finite results.
+ */
+
+namespace FAST_MATH {
+    class BinaryAngle {
+    public:
+        constexpr BinaryAngle() : turns(0) {}
+
+        static constexpr BinaryAngle fromRaw(const uint32_t raw) { return BinaryAngle(raw); }
+
+        // Any number of turns up to 1e9 rad is accepted. Larger and non-finite angles become zero.
+        static BinaryAngle fromRadians(float radians);
+
+        // In [-π, π]; float rounding can turn just under half a turn into π.
+        [[nodiscard]] float radians() const;
+
+        // 2³² is a full turn.
+        [[nodiscard]] constexpr uint32_t raw() const { return turns; }
+
+        // Half a turn is the most negative value, so the range is [-2³¹, 2³¹).
+        [[nodiscard]] constexpr int32_t signedRaw() const { return static_cast<int32_t>(turns); }
+
+        constexpr BinaryAngle operator+(const BinaryAngle other) const { return BinaryAngle(turns + other.turns); }
+
+        constexpr BinaryAngle operator-(const BinaryAngle other) const { return BinaryAngle(turns - other.turns); }
+
+        constexpr BinaryAngle operator-() const { return BinaryAngle(0u - turns); }
+
+        BinaryAngle& operator+=(const BinaryAngle other) {
+            turns += other.turns;
+            return *this;
+        }
+
+        BinaryAngle& operator-=(const BinaryAngle other) {
+            turns -= other.turns;
+            return *this;
+        }
+
+        constexpr bool operator==(const BinaryAngle other) const { return turns == other.turns; }
+
+        constexpr bool operator!=(const BinaryAngle other) const { return turns != other.turns; }
+
+        static constexpr uint32_t QUARTER_TURN = 1u << 30;
+        static constexpr uint32_t HALF_TURN = 1u << 31;
+
+    private:
+        constexpr explicit BinaryAngle(const uint32_t raw) : turns(raw) {}
+
+        uint32_t turns;
+    };
+
+    constexpr int32_t Q16_ONE = 1 << 16;
+
+    float sin(float radians);
+    float cos(float radians);
+    void sincos(float radians, float& sine, float& cosine);
+    float sin(BinaryAngle angle);
+    float cos(BinaryAngle angle);
+
+    // Radians in [-π/2, π/2], also for infinite x.
+    float atan(float x);
+    // Radians in [-π, π]. Zero for (0, 0).
+    float atan2(float y, float x);
+
+    // x > 0.
+    float rsqrt(float x);
+    float hypot(float x, float y);
+
+    int32_t sinQ16(BinaryAngle angle);
+    int32_t cosQ16(BinaryAngle angle);
+    // y and x in any common scale. Zero for (0, 0).
+    BinaryAngle atan2Q16(int32_t y, int32_t x);
+
+    uint32_t sqrtQ16(uint32_t x);
+    // Zero for x = 0.
+    uint32_t rsqrtQ16(uint32_t x);
+    uint32_t hypotQ16(int32_t x, int32_t y);
+}
+
+#endif //OSOD_MOTOR_2040_FAST_MATH_H
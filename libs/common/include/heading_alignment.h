@@ -0,0 +1,93 @@
+#ifndef OSOD_MOTOR_2040_HEADING_ALIGNMENT_H
+#define OSOD_MOTOR_2040_HEADING_ALIGNMENT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Brings the IMU's heading to the instant the encoders were captured, so the rotation odometry uses
+ * belongs to the same moment as its translation.
+ *
+ * Each heading sample carries the time the IMU took it, in time_us_32()'s time base. The heading at a
+ * capture is interpolated between the samples either side of it. When the newest sample is older than
+ * the capture, the heading is carried forward from it instead, at the sample's measured turn rate or,
+ * without one, the rate between the last two samples.
+ *
+ * The alignment is checked against the samples that arrive afterwards. Once a later sample brackets a
+ * capture, the heading interpolated between the two is taken as the heading at the capture. That is
+ * compared with the aligned heading, and with the newest sample's heading, which is what was used before.
+ * Each error is also turned into a residual skew: the error divided by the turn rate, summed over the
+ * checks made while turning.
+ */
+
+struct HeadingAlignmentStats {
+    uint32_t interpolated;
+    uint32_t extrapolated;
+    uint32_t unaligned;         // too far from any sample, or no rate to carry it with
+    float meanSampleAgeUs;      // from the newest sample to the capture, the skew being removed
+    int32_t maxSampleAgeUs;
+    uint32_t checked;           // captures bracketed by later samples while turning
+    float rawSkewUs;            // the newest sample's heading error, as time at the turn rate
+    float alignedSkewUs;        // the aligned heading's
+    float maxRawError;          // radians
+    float maxAlignedError;
+};
+
+class HeadingAlignment {
+public:
+    // The furthest the heading is carried from a sample; beyond that the sample's heading is used as it is.
+    static constexpr uint32_t MAX_EXTRAPOLATION_US = 25000;
+    // Checks made below this turn rate, in rad/s, say nothing about skew.
+    static constexpr float MIN_CHECK_RATE = 0.2f;
+
+    void reset();
+
+    // A heading sample, oldest first. rate is the measured turn rate in rad/s, or NaN if there isn't one.
+    void add(uint32_t sampleUs, float yaw, float rate);
+
+    // The heading at captureUs from the samples added so far. The capture is remembered and checked
+    // once later samples bracket it. Returns the newest sample's heading if it can't be aligned.
+    float headingAt(uint32_t captureUs);
+
+    [[nodiscard]] HeadingAlignmentStats stats() const;
+
+    void resetStats();
+
+private:
+    struct Sample {
+        uint32_t us;
+        float yaw;
+        float rate;
+    };
+
+    struct Capture {
+        uint32_t us;
+        float raw;
+        float aligned;
+    };
+
+    static constexpr size_t PENDING_CAPTURES = 4;
+
+    // Compares a capture's headings with the one interpolated between the samples either side of it.
+    void check(const Capture& capture, const Sample& before, const Sample& after);
+
+    Sample previous{};
+    Sample newest{};
+    size_t samples = 0;
+    Capture pending[PENDING_CAPTURES] = {};
+    size_t pendingCount = 0;
+
+    uint32_t interpolated = 0;
+    uint32_t extrapolated = 0;
+    uint32_t unaligned = 0;
+    uint64_t sampleAgeSumUs = 0;
+    int32_t maxSampleAgeUs = 0;
+    uint32_t checked = 0;
+    float rateSum = 0.0f;
+    float rawErrorSum = 0.0f;
+    float alignedErrorSum = 0.0f;
+    float maxRawError = 0.0f;
+    float maxAlignedError = 0.0f;
+};
+
+#endif //OSOD_MOTOR_2040_HEADING_ALIGNMENT_H
@@ -0,0 +1,120 @@
+#ifndef OSOD_MOTOR_2040_MEASUREMENT_QUEUE_H
+#define OSOD_MOTOR_2040_MEASUREMENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/*
+ * Timestamped measurement queue: each sensor pushes samples at its own rate, and the consumer takes them
+ * in the order they were taken.
+ *
+ * Each producer owns one channel, a single-producer single-consumer ring, so a push never waits or locks
+ * and is safe from an interrupt or the other core. A sensor's samples arrive in time order, so each
+ * channel is too, and pop() only has to compare the oldest sample of each channel. A push to a full
+ * channel is dropped and counted; the consumer is expected to drain the queue every tick.
+ *
+ * Times are 32-bit microsecond counters (time_us_32) compared by difference, so ordering is correct across
+ * the wrap as long as the queued samples are within half a wrap of each other.
+ */
+
+template<typename T, size_t CAPACITY = 16>
+class MeasurementChannel {
+    static_assert(std::is_trivially_copyable<T>::value, "measurements are copied into the ring");
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // producer: returns false, and counts a drop, if the channel is full
+    bool push(const T& value, const uint32_t timeUs) {
+        const uint32_t head = written.load(std::memory_order_relaxed);
+        if (head - taken.load(std::memory_order_acquire) >= CAPACITY) {
+            drops.store(drops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        Slot& slot = slots[head % CAPACITY];
+        slot.timeUs = timeUs;
+        slot.value = value;
+        written.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: the time the oldest sample was taken, false if the channel is empty
+    bool oldest(uint32_t& timeUs) const {
+        const uint32_t tail = taken.load(std::memory_order_relaxed);
+        if (written.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+        timeUs = slots[tail % CAPACITY].timeUs;
+        return true;
+    }
+
+    // consumer: takes the oldest sample, false if the channel is empty
+    bool pop(T& value, uint32_t& timeUs) {
+        const uint32_t tail = taken.load(std::memory_order_relaxed);
+        if (written.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+        const Slot& slot = slots[tail % CAPACITY];
+        value = slot.value;
+        timeUs = slot.timeUs;
+        taken.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] uint32_t dropped() const { return drops.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        uint32_t timeUs;
+        T value;
+    };
+
+    Slot slots[CAPACITY] = {};
+    std::atomic<uint32_t> written{0};
+    std::atomic<uint32_t> taken{0};
+    std::atomic<uint32_t> drops{0};
+};
+
+template<typename T, size_t CHANNELS, size_t CAPACITY = 16>
+class MeasurementQueue {
+public:
+    using Channel = MeasurementChannel<T, CAPACITY>;
+
+    Channel& channel(const size_t index) { return channels[index]; }
+
+    // Takes the oldest sample queued on any channel, and which channel it came from. Returns false if
+    // every channel is empty.
+    bool pop(T& value, uint32_t& timeUs, size_t& source) {
+        bool found = false;
+        uint32_t oldestUs = 0;
+        for (size_t i = 0; i < CHANNELS; i++) {
+            uint32_t channelUs;
+            if (channels[i].oldest(channelUs) &&
+                (!found || static_cast<int32_t>(channelUs - oldestUs) < 0)) {
+                found = true;
+                oldestUs = channelUs;
+                source = i;
+            }
+        }
+        return found && channels[source].pop(value, timeUs);
+    }
+
+    bool pop(T& value, uint32_t& timeUs) {
+        size_t source;
+        return pop(value, timeUs, source);
+    }
+
+    [[nodiscard]] uint32_t dropped() const {
+        uint32_t total = 0;
+        for (const Channel& channel : channels) {
+            total += channel.dropped();
+        }
+        return total;
+    }
+
+private:
+    Channel channels[CHANNELS];
+};
+
+#endif //OSOD_MOTOR_2040_MEASUREMENT_QUEUE_H
@@ -0,0 +1,46 @@
+#ifndef OSOD_MOTOR_2040_POSE_HISTORY_H
+#define OSOD_MOTOR_2040_POSE_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "types.h"
+
+/*
+ * A short history of how the robot has moved, so a measurement taken a little while ago can be compared
+ * with where the robot was when it was taken rather than where it is now.
+ *
+ * The history holds the odometry's motion over each of the last CAPACITY estimator ticks, not the poses
+ * themselves. Corrections made since a measurement was taken are then already in the current pose, and
+ * subtracting the motion since the measurement gives the pose it was taken from, corrections included.
+ * Motion within a tick is taken to be uniform.
+ */
+
+class PoseHistory {
+public:
+    static constexpr size_t CAPACITY = 16;
+
+    void reset();
+
+    // The robot moved by motion (in the odometry frame, heading change in radians) between startUs and endUs.
+    void record(uint32_t startUs, uint32_t endUs, const COMMON::Pose& motion);
+
+    // The motion from timeUs to the end of the newest tick; zero for a time at or after it. Returns false if
+    // timeUs is older than the history reaches.
+    bool motionSince(uint32_t timeUs, COMMON::Pose& motion) const;
+
+    // How far back the history reaches from the end of the newest tick, in microseconds.
+    [[nodiscard]] uint32_t spanUs() const;
+
+private:
+    struct Step {
+        uint32_t startUs;
+        uint32_t endUs;
+        COMMON::Pose motion;
+    };
+
+    Step steps[CAPACITY] = {};
+    size_t newest = 0;
+    size_t count = 0;
+};
+
+#endif //OSOD_MOTOR_2040_POSE_HISTORY_H
@@ -0,0 +1,105 @@
+#ifndef OSOD_MOTOR_2040_PROFILER_H
+#define OSOD_MOTOR_2040_PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Per-stage execution time profiler for the estimation and control pipelines.
+ *
+ * PROFILE_STAGE(stage) times the rest of the enclosing scope against the core's cycle counter (SysTick
+ * on the RP2040, the host's steady clock in the host build) and adds it to that stage's histogram for
+ * the core it ran on. dump() prints min/mean/p99/max per stage and core. SysTick is 24 bits wide, so
+ * on target a single stage can be timed up to ~134 ms at 125 MHz.
+ *
+ * Profiling is only compiled in when OSOD_PROFILING is defined (the PROFILING CMake option); otherwise
+ * PROFILE_STAGE expands to nothing and the rest of the interface to empty inline functions.
+ */
+
+namespace PROFILER {
+    namespace STAGE {
+        enum Stage {
+            ESTIMATE_STATE,
+            CAPTURE_ENCODERS,
+            GET_HEADING,
+            WHEEL_ODOMETRY,
+            TOF_SENSORS,
+            LOCALISATION,
+            FILTER_POSITIONS,
+            POSE_EKF,
+            PARTICLE_FILTER,
+            PUBLISH_ESTIMATE,
+            NAVIGATE,
+            REQUEST_STATE,
+            MIX,
+            SET_SPEED,
+            STAGE_COUNT // always keep this last in the enum so that we can use it to get the number of elements
+        };
+    }
+
+    constexpr size_t CORE_COUNT = 2;
+
+    struct StageStats {
+        uint32_t samples;
+        float minUs;
+        float meanUs;
+        float p99Us;    // upper edge of the histogram bucket holding the 99th percentile (within 25%)
+        float maxUs;
+    };
+
+#ifdef OSOD_PROFILING
+    // Start the cycle counter on the calling core; call once on each core before profiling on it.
+    void init();
+
+    uint32_t cycles();
+
+    // Cycles since start, allowing for the counter's width.
+    uint32_t elapsedCycles(uint32_t start);
+
+    float cyclesPerUs();
+
+    void record(STAGE::Stage stage, uint32_t elapsedCycles);
+
+    StageStats stats(STAGE::Stage stage, size_t core);
+
+    const char* stageName(STAGE::Stage stage);
+
+    void dump(bool reset = true);
+
+    void reset();
+
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(STAGE::Stage stage) : stage(stage), start(cycles()) {}
+
+        ~ScopedTimer() {
+            record(stage, elapsedCycles(start));
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        const STAGE::Stage stage;
+        const uint32_t start;
+    };
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_STAGE(stage) PROFILER::ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(PROFILER::STAGE::stage)
+#else
+    inline void init() {}
+
+    inline StageStats stats(STAGE::Stage, size_t) { return {}; }
+
+    inline const char* stageName(STAGE::Stage) { return ""; }
+
+    inline void dump(bool = true) {}
+
+    inline void reset() {}
+
+#define PROFILE_STAGE(stage) do {} while (0)
+#endif
+}
+
+#endif //OSOD_MOTOR_2040_PROFILER_H
@@ -0,0 +1,79 @@
+#ifndef OSOD_MOTOR_2040_SEQLOCK_H
+#define OSOD_MOTOR_2040_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/*
+ * Single-writer sequence lock for handing a value from one core (or interrupt) to another.
+ *
+ * The writer never waits. Readers copy the value and retry only if a write overlapped the
+ * copy, so they never observe a torn value and never hold the writer up. The sequence number
+ * is odd while a write is in progress and advances by two per completed write, so readers can
+ * also tell whether anything new has been published since their last read.
+ */
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied bytewise");
+
+public:
+    SeqLock() : value() {}
+
+    explicit SeqLock(const T& initial) : value(initial) {}
+
+    void write(const T& newValue) {
+        const uint32_t start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&value, &newValue, sizeof(T));
+        sequence.store(start + 2, std::memory_order_release);
+    }
+
+    // Copies the latest complete value into out and returns the sequence number it was published under.
+    uint32_t read(T& out) const {
+        return readWith([&out](const T& in) { std::memcpy(&out, &in, sizeof(T)); });
+    }
+
+    // Runs copy over the value in place, again if a write overlapped it, and returns the sequence number
+    // of the value it last ran over. copy must only take copies: what it sees may be torn, and only its
+    // final run is guaranteed not to be.
+    template<typename Copy>
+    uint32_t readWith(Copy copy) const {
+        while (true) {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1u) {
+                continue;
+            }
+            copy(static_cast<const T&>(value));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                return before;
+            }
+        }
+    }
+
+    T read() const {
+        T out;
+        read(out);
+        return out;
+    }
+
+    // The value in place, without copying. Only consistent on the writer's core, where a write can't be
+    // in progress while it is being read.
+    [[nodiscard]] const T& current() const {
+        return value;
+    }
+
+    // Sequence number of the last completed write (zero if nothing has been written).
+    [[nodiscard]] uint32_t published() const {
+        return sequence.load(std::memory_order_acquire) & ~1u;
+    }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    T value;
+};
+
+#endif //OSOD_MOTOR_2040_SEQLOCK_H
@@ -0,0 +1,112 @@
+#ifndef OSOD_MOTOR_2040_TASK_TIMING_H
+#define OSOD_MOTOR_2040_TASK_TIMING_H
+
+#include <cstdint>
+#include "pico/sync.h"
+
+/*
+ * Timing bookkeeping for a periodic task that is triggered from an interrupt but executed
+ * from the main loop. The interrupt only calls trigger(), which timestamps the request and
+ * raises the pending flag; the main loop brackets the real work with begin() and end().
+ *
+ * All times are 32-bit microsecond counters (time_us_32), so reads and writes are atomic on
+ * the RP2040 and differences are correct across the ~71 minute wrap. The trigger is handed to
+ * begin() under a critical section, as the interrupt may be taken on the other core.
+ */
+
+struct TaskTimingStats {
+    uint32_t runs;
+    uint32_t deadlineMisses;    // finished later than one period after the trigger
+    uint32_t skippedTriggers;   // triggered again before the previous trigger was serviced
+    uint32_t minLatencyUs;      // trigger to start of execution
+    uint32_t maxLatencyUs;
+    float meanLatencyUs;
+    uint32_t maxJitterUs;       // worst deviation of the start-to-start interval from the period
+    uint32_t maxExecutionUs;
+};
+
+class TaskTiming {
+public:
+    explicit TaskTiming(uint32_t periodUs);
+
+    // interrupt context: record the trigger time and mark the task as due
+    void trigger(uint32_t nowUs);
+
+    [[nodiscard]] bool pending() const { return isPending; }
+
+    // main loop: start servicing the pending trigger
+    void begin(uint32_t nowUs);
+
+    // main loop: the work for the current trigger has finished
+    void end(uint32_t nowUs);
+
+    [[nodiscard]] TaskTimingStats stats() const;
+
+    void resetStats();
+
+    [[nodiscard]] uint32_t period() const { return periodUs; }
+
+private:
+    const uint32_t periodUs;
+    critical_section_t lock{};
+    volatile bool isPending = false;
+    volatile uint32_t triggerUs = 0;
+    volatile uint32_t skipped = 0;
+
+    uint32_t activeTriggerUs = 0;
+    uint32_t lastStartUs = 0;
+    bool hasStarted = false;
+
+    uint32_t runs = 0;
+    uint32_t deadlineMisses = 0;
+    uint32_t minLatencyUs = UINT32_MAX;
+    uint32_t maxLatencyUs = 0;
+    uint64_t totalLatencyUs = 0;
+    uint32_t maxJitterUs = 0;
+    uint32_t maxExecutionUs = 0;
+};
+
+/*
+ * Measures the real interval between successive samples of a stage from their capture timestamps, so
+ * the stage can use the actual dt rather than its nominal period, and records how far the interval
+ * strays from that period.
+ */
+
+struct SampleIntervalStats {
+    uint32_t samples;
+    uint32_t minIntervalUs;
+    uint32_t maxIntervalUs;
+    float meanIntervalUs;
+    uint32_t maxJitterUs;       // worst deviation of the interval from the nominal period
+};
+
+class SampleInterval {
+public:
+    explicit SampleInterval(uint32_t nominalUs);
+
+    // Takes the capture time of a new sample and returns the time since the previous one in seconds.
+    // The first sample has no predecessor, so it gets the nominal period. A sample captured at the same
+    // time as the previous one gets zero.
+    float update(uint32_t captureUs);
+
+    // dt returned by the last update(), in seconds
+    [[nodiscard]] float dt() const { return lastDt; }
+
+    [[nodiscard]] SampleIntervalStats stats() const;
+
+    void resetStats();
+
+private:
+    const uint32_t nominalUs;
+    uint32_t lastCaptureUs = 0;
+    bool hasSample = false;
+    float lastDt;
+
+    uint32_t samples = 0;
+    uint32_t minIntervalUs = UINT32_MAX;
+    uint32_t maxIntervalUs = 0;
+    uint64_t totalIntervalUs = 0;
+    uint32_t maxJitterUs = 0;
+};
+
+#endif //OSOD_MOTOR_2040_TASK_TIMING_H
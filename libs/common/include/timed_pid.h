@@ -0,0 +1,53 @@
+#ifndef OSOD_MOTOR_2040_TIMED_PID_H
+#define OSOD_MOTOR_2040_TIMED_PID_H
+
+/*
+ * PID controller that is handed the measured time since its previous sample on every calculation,
+ * instead of assuming a fixed update rate. It matches pimoroni::PID when dt equals that PID's
+ * sample_rate, except that the first sample only primes the derivative rather than kicking it.
+ *
+ * A dt of zero means the measurement hasn't moved on since the last calculation (the same sample
+ * seen twice), so the integral and derivative are left as they were and only the proportional term
+ * follows the setpoint. The terms of the last calculation are kept for telemetry.
+ *
+ * Where the measurement's rate of change is measured directly (a gyro's turn rate for a heading loop),
+ * it can be passed in for the derivative term instead of differencing successive samples.
+ */
+
+class TimedPID {
+public:
+    struct Terms {
+        float p;
+        float i;
+        float d;
+    };
+
+    TimedPID(float kp, float ki, float kd);
+
+    float calculate(float value, float dt);
+
+    // As above, with the derivative taken from rate rather than from the change in value.
+    float calculate(float value, float rate, float dt);
+
+    void reset();
+
+    [[nodiscard]] const Terms& terms() const { return lastTerms; }
+
+    // dt used by the last calculation, in seconds
+    [[nodiscard]] float dt() const { return lastDt; }
+
+    float kp;
+    float ki;
+    float kd;
+    float setpoint = 0.0f;
+
+private:
+    float errorSum = 0.0f;
+    float lastValue = 0.0f;
+    float rate = 0.0f;
+    bool primed = false;
+    float lastDt = 0.0f;
+    Terms lastTerms{};
+};
+
+#endif //OSOD_MOTOR_2040_TIMED_PID_H
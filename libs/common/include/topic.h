@@ -0,0 +1,155 @@
+#ifndef OSOD_MOTOR_2040_TOPIC_H
+#define OSOD_MOTOR_2040_TOPIC_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "seqlock.h"
+
+/*
+ * Typed publish/subscribe topic.
+ *
+ * A topic is a SeqLock holding the latest sample and the time it was taken, with one publisher. The
+ * publisher never waits, and readers retry only if a publish overlapped their copy, so they never see a
+ * torn sample. Each sample is numbered: 1 for the first, then counting up.
+ *
+ * Nothing is pushed to subscribers and nothing is copied unless they ask. A subscriber on the
+ * publisher's core can read the slot in place through value(); one on either core can copy the whole
+ * sample, or pull just the fields it needs with a selector, e.g.
+ *
+ *     const float speed = topic.read([](const VehicleState& s) { return s.velocity.velocity; });
+ *
+ * A Subscription remembers the last sample it took, so it can tell whether there is anything new,
+ * how many samples went by without being taken, and how old the one it has is.
+ */
+
+template<typename T>
+class Topic {
+    static_assert(std::is_trivially_copyable<T>::value, "topic samples are copied bytewise");
+
+public:
+    struct Stamp {
+        uint32_t sequence;    // zero if nothing has been published
+        uint32_t timestampUs;
+    };
+
+    void publish(const T& newSample, const uint32_t timestampUs) {
+        slot.write({newSample, timestampUs});
+    }
+
+    // The latest sample in place, without copying. Only consistent on the publisher's core, where a
+    // publish can't be in progress while it is being read.
+    [[nodiscard]] const T& value() const {
+        return slot.current().value;
+    }
+
+    // Copies the latest complete sample into out and returns its stamp.
+    Stamp read(T& out) const {
+        uint32_t timestampUs = 0;
+        const uint32_t sequence = slot.readWith([&](const Sample& sample) {
+            std::memcpy(&out, &sample.value, sizeof(T));
+            timestampUs = sample.timestampUs;
+        });
+        return {sequence / 2, timestampUs};
+    }
+
+    T read() const {
+        T out;
+        read(out);
+        return out;
+    }
+
+    // Copies only what select picks out of the latest complete sample, and its stamp.
+    template<typename Select>
+    auto read(Select select, Stamp& stamp) const -> std::decay_t<decltype(select(std::declval<const T&>()))> {
+        using Field = std::decay_t<decltype(select(std::declval<const T&>()))>;
+        static_assert(std::is_trivially_copyable<Field>::value, "topic fields are copied bytewise");
+        Field field{};
+        uint32_t timestampUs = 0;
+        const uint32_t sequence = slot.readWith([&](const Sample& sample) {
+            field = select(sample.value);
+            timestampUs = sample.timestampUs;
+        });
+        stamp = {sequence / 2, timestampUs};
+        return field;
+    }
+
+    template<typename Select>
+    auto read(Select select) const -> std::decay_t<decltype(select(std::declval<const T&>()))> {
+        Stamp stamp{};
+        return read(select, stamp);
+    }
+
+    // Sequence number of the latest complete sample (zero if nothing has been published).
+    [[nodiscard]] uint32_t sequence() const {
+        return slot.published() / 2;
+    }
+
+private:
+    struct Sample {
+        T value;
+        uint32_t timestampUs;
+    };
+
+    SeqLock<Sample> slot;
+};
+
+template<typename T>
+class Subscription {
+public:
+    explicit Subscription(const Topic<T>& topic) : topic(topic) {}
+
+    // True if a sample has been published since the last one taken.
+    [[nodiscard]] bool updated() const {
+        return topic.sequence() != last.sequence;
+    }
+
+    // Copies the latest sample. Returns true if it hadn't been taken before.
+    bool take(T& out) {
+        return advance(topic.read(out));
+    }
+
+    // Pulls only what select picks out of the latest sample.
+    template<typename Select>
+    auto take(Select select) -> std::decay_t<decltype(select(std::declval<const T&>()))> {
+        typename Topic<T>::Stamp stamp{};
+        const auto field = topic.read(select, stamp);
+        advance(stamp);
+        return field;
+    }
+
+    // Stamp of the last sample taken.
+    [[nodiscard]] typename Topic<T>::Stamp stamp() const {
+        return last;
+    }
+
+    // Samples published since subscribing that were overwritten before they could be taken.
+    [[nodiscard]] uint32_t missed() const {
+        return missedSamples;
+    }
+
+    // True if nothing has been taken yet, or the last sample taken is more than maxAgeUs old.
+    [[nodiscard]] bool stale(const uint32_t nowUs, const uint32_t maxAgeUs) const {
+        return last.sequence == 0 || nowUs - last.timestampUs > maxAgeUs;
+    }
+
+private:
+    const Topic<T>& topic;
+    typename Topic<T>::Stamp last{};
+    uint32_t missedSamples = 0;
+
+    bool advance(const typename Topic<T>::Stamp& stamp) {
+        if (stamp.sequence == last.sequence) {
+            return false;
+        }
+        if (last.sequence != 0 && stamp.sequence > last.sequence + 1) {
+            missedSamples += stamp.sequence - last.sequence - 1;
+        }
+        last = stamp;
+        return true;
+    }
+};
+
+#endif //OSOD_MOTOR_2040_TOPIC_H
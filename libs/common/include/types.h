@@ -5,6 +5,7 @@
 #ifndef OSOD_MOTOR_2040_TYPES_H
 #define OSOD_MOTOR_2040_TYPES_H
 #include <cstddef>
+#include <cstdint>
 
 #pragma once
 namespace COMMON {
@@ -29,6 +30,20 @@ namespace COMMON {
         }
     };
 
+    // Per wheel, (wheel speed - ground speed) / ground speed at that wheel: positive when the wheel spins
+    // faster than the ground moves, -1 when it is stalled.
+    struct WheelSlip {
+        float ratios[MOTOR_POSITION::MOTOR_POSITION_COUNT];
+
+        float& operator[](const MOTOR_POSITION::MotorPosition position) {
+            return ratios[position];
+        }
+
+        const float& operator[](const MOTOR_POSITION::MotorPosition position) const {
+            return ratios[position];
+        }
+    };
+
     struct SteeringAngles {
         float left;
         float right;
@@ -48,6 +63,18 @@ namespace COMMON {
 
     constexpr size_t NUM_TOF_SENSORS = sizeof(FourToFDistances) / sizeof(float);
 
+    // A sensor sample for the state estimator's measurement queue, which stamps it with when it was taken.
+    struct Measurement {
+        enum Kind : uint8_t {
+            IMU_YAW,
+            TOF_RANGE
+        };
+        Kind kind;
+        uint8_t sensor;     // for a ToF range, indexed like FourToFDistances
+        float value;        // the IMU's yaw before the heading offset in radians, or the ToF distance in metres
+        float rate;         // the IMU's yaw rate in rad/s if the report measures it, otherwise NaN
+    };
+
     struct Pose {
         float x;
         float y;
@@ -59,6 +86,14 @@ namespace COMMON {
         float y;
     };
 
+    // A straight wall in a map of the arena, in mm from the arena centre in the odometry frame.
+    struct MapSegment {
+        int16_t x0;
+        int16_t y0;
+        int16_t x1;
+        int16_t y1;
+    };
+
     struct Waypoint {
         Point position;
         float heading;
@@ -77,11 +112,39 @@ namespace COMMON {
         float velocity;
         float angular_velocity;
     };
+    // How far the pose can be trusted, from whichever pose filter is in use: the covariance of the position in
+    // m² and the variance of the heading in rad².
+    struct PoseCovariance {
+        float xx;
+        float xy;
+        float yy;
+        float heading;
+    };
+
+    // How well one sensor's measurements agree with what the pose filter expected of them. The normalised
+    // innovation is the squared difference over the variance the filter expected it to have, averaged over
+    // recent measurements. It sits near 1 while the filter's noise model fits the sensor, and grows when the
+    // sensor, or the filter, is wrong.
+    struct InnovationStats {
+        float normalisedInnovation;
+        uint32_t accepted;
+        uint32_t rejected;  // judged an outlier, like an obstacle in front of a ToF sensor
+    };
+
+    struct EstimatorHealth {
+        InnovationStats imu;
+        InnovationStats tof[NUM_TOF_SENSORS];   // indexed like FourToFDistances
+        uint32_t sinceRangeFixUs;               // since a ToF range last corrected the position
+    };
+
     struct VehicleState {
         Velocity velocity;
         Pose odometry;
         DriveTrainState driveTrainState;
         FourToFDistances tofDistances;
+        WheelSlip wheelSlip;
+        PoseCovariance covariance;
+        EstimatorHealth health;
     };
 }
 
@@ -15,6 +15,14 @@ void handleI2CError(i2c_inst_t* &i2c_port);
 
 void i2cBusRecovery(uint sda_pin, uint scl_pin);
 
+// The I2C bus is shared between the cores when estimation runs on core1; every transaction
+// sequence must be made while holding this lock. Core1 only ever tries it, so it never stalls.
+bool tryLockI2CBus();
+
+void lockI2CBus();
+
+void unlockI2CBus();
+
 float wrap_pi(const float heading);
 
 bool reserved_addr(uint8_t addr);
@@ -0,0 +1,297 @@
+#include "fast_math.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace FAST_MATH {
+    namespace {
+        constexpr float TWO_PI = 6.28318530717958647692f;
+        constexpr float RAW_PER_RADIAN = 4294967296.0f / TWO_PI;
+        constexpr float RADIANS_PER_RAW = TWO_PI / 4294967296.0f;
+        // beyond this many radians the conversion to a 64-bit count of 2^-32 turns could overflow
+        constexpr float MAX_RADIANS = 1.0e9f;
+
+        // sin(i·π/512) in Q8.24 for i = 0..257. The entry past the quarter turn lets the interpolation read
+        // one ahead at exactly π/2 without a special case.
+        constexpr int32_t SIN_TABLE[258] = {
+                0, 102943, 205882, 308814, 411733, 514638, 617523, 720384, 823219, 926023,
+                1028791, 1131521, 1234209, 1336849, 1439440, 1541976, 1644455, 1746871, 1849222, 1951503,
+                2053710, 2155841, 2257890, 2359854, 2461729, 2563511, 2665197, 2766783, 2868265, 2969638,
+                3070900, 3172046, 3273072, 3373976, 3474752, 3575398, 3675909, 3776281, 3876512, 3976596,
+                4076531, 4176312, 4275936, 4375399, 4474698, 4573827, 4672785, 4771567, 4870169, 4968587,
+                5066819, 5164860, 5262706, 5360355, 5457801, 5555042, 5652074, 5748893, 5845495, 5941878,
+                6038037, 6133968, 6229669, 6325135, 6420363, 6515349, 6610090, 6704582, 6798821, 6892805,
+                6986529, 7079990, 7173184, 7266109, 7358759, 7451133, 7543226, 7635036, 7726557, 7817788,
+                7908725, 7999364, 8089701, 8179734, 8269459, 8358873, 8447972, 8536753, 8625213, 8713348,
+                8801154, 8888630, 8975771, 9062573, 9149035, 9235152, 9320922, 9406340, 9491405, 9576112,
+                9660458, 9744441, 9828057, 9911303, 9994176, 10076672, 10158790, 10240524, 10321873, 10402834,
+                10483403, 10563577, 10643353, 10722729, 10801701, 10880266, 10958422, 11036165, 11113493, 11190402,
+                11266890, 11342953, 11418590, 11493797, 11568571, 11642909, 11716809, 11790268, 11863283, 11935852,
+                12007971, 12079638, 12150850, 12221604, 12291899, 12361731, 12431097, 12499995, 12568423, 12636378,
+                12703856, 12770857, 12837376, 12903413, 12968963, 13034026, 13098597, 13162675, 13226258, 13289343,
+                13351928, 13414009, 13475586, 13536656, 13597215, 13657263, 13716797, 13775814, 13834313, 13892291,
+                13949745, 14006675, 14063077, 14118950, 14174291, 14229098, 14283370, 14337104, 14390298, 14442951,
+                14495059, 14546622, 14597637, 14648103, 14698017, 14747378, 14796184, 14844432, 14892122, 14939251,
+                14985817, 15031819, 15077256, 15122124, 15166424, 15210152, 15253308, 15295889, 15337895, 15379323,
+                15420172, 15460440, 15500126, 15539229, 15577747, 15615678, 15653022, 15689776, 15725939, 15761510,
+                15796488, 15830871, 15864658, 15897848, 15930439, 15962431, 15993821, 16024610, 16054795, 16084375,
+                16113350, 16141719, 16169479, 16196631, 16223173, 16249104, 16274424, 16299131, 16323224, 16346702,
+                16369565, 16391812, 16413442, 16434454, 16454846, 16474620, 16493773, 16512305, 16530216, 16547504,
+                16564169, 16580211, 16595628, 16610420, 16624588, 16638129, 16651044, 16663331, 16674992, 16686025,
+                16696429, 16706205, 16715352, 16723869, 16731757, 16739015, 16745643, 16751640, 16757007, 16761743,
+                16765847, 16769321, 16772163, 16774374, 16775953, 16776900, 16777216, 16776900,
+        };
+        constexpr uint32_t SIN_INDEX_SHIFT = 22;   // 8 bits of table index below the 2 quadrant bits
+        constexpr uint32_t SIN_FRACTION_BITS = 14; // of the 22 remaining, the most the interpolation can keep
+        constexpr float SIN_SCALE = 1.0f / (1 << 24);
+
+        // atan(i/256) in 2^-28 turns for i = 0..257, extended past 1 for the same reason as SIN_TABLE.
+        constexpr int32_t ATAN_TABLE[258] = {
+                0, 166885, 333765, 500635, 667490, 834324, 1001133, 1167911, 1334654, 1501356,
+                1668012, 1834618, 2001168, 2167657, 2334080, 2500432, 2666708, 2832904, 2999013, 3165032,
+                3330955, 3496778, 3662495, 3828101, 3993593, 4158964, 4324210, 4489327, 4654309, 4819151,
+                4983850, 5148400, 5312797, 5477036, 5641112, 5805021, 5968758, 6132319, 6295699, 6458894,
+                6621899, 6784710, 6947323, 7109733, 7271935, 7433926, 7595702, 7757257, 7918589, 8079692,
+                8240564, 8401199, 8561593, 8721744, 8881646, 9041296, 9200690, 9359825, 9518696, 9677299,
+                9835632, 9993690, 10151470, 10308969, 10466182, 10623106, 10779738, 10936075, 11092112, 11247848,
+                11403278, 11558400, 11713209, 11867704, 12021881, 12175737, 12329269, 12482474, 12635349, 12787891,
+                12940099, 13091968, 13243496, 13394680, 13545519, 13696009, 13846147, 13995932, 14145361, 14294432,
+                14443141, 14591488, 14739469, 14887083, 15034327, 15181200, 15327698, 15473821, 15619566, 15764932,
+                15909915, 16054516, 16198731, 16342560, 16486000, 16629049, 16771707, 16913971, 17055841, 17197314,
+                17338389, 17479066, 17619341, 17759215, 17898685, 18037752, 18176412, 18314667, 18452513, 18589950,
+                18726978, 18863595, 18999800, 19135593, 19270972, 19405937, 19540487, 19674621, 19808338, 19941638,
+                20074520, 20206984, 20339029, 20470654, 20601860, 20732644, 20863008, 20992951, 21122472, 21251571,
+                21380248, 21508502, 21636333, 21763742, 21890728, 22017290, 22143429, 22269145, 22394437, 22519306,
+                22643751, 22767773, 22891372, 23014548, 23137301, 23259630, 23381537, 23503022, 23624084, 23744725,
+                23864943, 23984741, 24104117, 24223073, 24341608, 24459723, 24577419, 24694696, 24811555, 24927995,
+                25044018, 25159624, 25274814, 25389587, 25503946, 25617890, 25731420, 25844536, 25957240, 26069532,
+                26181413, 26292883, 26403944, 26514596, 26624839, 26734675, 26844104, 26953128, 27061746, 27169961,
+                27277772, 27385181, 27492188, 27598795, 27705003, 27810811, 27916222, 28021237, 28125855, 28230079,
+                28333909, 28437346, 28540391, 28643045, 28745310, 28847187, 28948675, 29049777, 29150494, 29250826,
+                29350775, 29450342, 29549528, 29648334, 29746761, 29844811, 29942484, 30039781, 30136704, 30233255,
+                30329433, 30425241, 30520679, 30615749, 30710452, 30804788, 30898760, 30992369, 31085615, 31178500,
+                31271025, 31363192, 31455001, 31546454, 31637551, 31728296, 31818687, 31908728, 31998418, 32087760,
+                32176754, 32265402, 32353705, 32441664, 32529281, 32616556, 32703492, 32790089, 32876349, 32962272,
+                33047861, 33133116, 33218039, 33302630, 33386892, 33470826, 33554432, 33637712,
+        };
+        constexpr uint32_t ATAN_RATIO_BITS = 20;    // ratios in [0, 1] as Q20
+        constexpr uint32_t ATAN_FRACTION_BITS = 12; // below the 8 bits of table index
+        constexpr uint32_t ATAN_TO_RAW_SHIFT = 4;   // 2^-28 turns to 2^-32 turns
+
+        // sin of a binary angle in Q8.24
+        int32_t sinCore(const uint32_t angle) {
+            const uint32_t quadrant = angle >> 30;
+            uint32_t position = angle & (BinaryAngle::QUARTER_TURN - 1);
+            if (quadrant & 1u) {
+                // the second and fourth quadrants run the table backwards
+                position = BinaryAngle::QUARTER_TURN - position;
+            }
+            const uint32_t index = position >> SIN_INDEX_SHIFT;
+            const auto fraction = static_cast<int32_t>((position >> (SIN_INDEX_SHIFT - SIN_FRACTION_BITS)) &
+                                                       ((1u << SIN_FRACTION_BITS) - 1));
+            const int32_t low = SIN_TABLE[index];
+            const int32_t value = low + (((SIN_TABLE[index + 1] - low) * fraction + (1 << (SIN_FRACTION_BITS - 1)))
+                    >> SIN_FRACTION_BITS);
+            return quadrant & 2u ? -value : value;
+        }
+
+        // atan of a ratio in [0, 1] as Q20, in 2^-32 turns
+        uint32_t atanCore(const uint32_t ratio) {
+            const uint32_t index = ratio >> ATAN_FRACTION_BITS;
+            const auto fraction = static_cast<int32_t>(ratio & ((1u << ATAN_FRACTION_BITS) - 1));
+            const int32_t low = ATAN_TABLE[index];
+            const int32_t value = low + (((ATAN_TABLE[index + 1] - low) * fraction + (1 << (ATAN_FRACTION_BITS - 1)))
+                    >> ATAN_FRACTION_BITS);
+            return static_cast<uint32_t>(value) << ATAN_TO_RAW_SHIFT;
+        }
+
+        // Unfolds a first-octant angle (ratio = smaller / larger magnitude) into its quadrant, as an
+        // unsigned angle in [0, half a turn] measured towards the side y is on.
+        uint32_t unfold(const uint32_t octantAngle, const bool swapped, const bool xNegative) {
+            uint32_t angle = swapped ? BinaryAngle::QUARTER_TURN - octantAngle : octantAngle;
+            return xNegative ? BinaryAngle::HALF_TURN - angle : angle;
+        }
+
+        uint32_t leadingZeros(const uint32_t x) {
+            return static_cast<uint32_t>(__builtin_clz(x));
+        }
+
+        // √((i + ½)·2^24) for i = 64..255, seeds for square roots of [2^30, 2^32) to about 8 bits
+        constexpr uint16_t SQRT_SEED[192] = {
+                32896, 33150, 33402, 33652, 33900, 34147, 34392, 34635, 34876, 35116, 35354, 35590,
+                35825, 36059, 36291, 36521, 36750, 36978, 37204, 37429, 37652, 37874, 38095, 38315,
+                38533, 38750, 38966, 39181, 39394, 39606, 39818, 40028, 40237, 40445, 40652, 40857,
+                41062, 41266, 41469, 41671, 41871, 42071, 42270, 42468, 42665, 42861, 43057, 43251,
+                43445, 43637, 43829, 44020, 44210, 44400, 44588, 44776, 44963, 45149, 45334, 45519,
+                45703, 45886, 46069, 46250, 46431, 46612, 46791, 46970, 47149, 47326, 47503, 47679,
+                47855, 48030, 48204, 48378, 48551, 48723, 48895, 49067, 49237, 49407, 49577, 49746,
+                49914, 50082, 50249, 50416, 50582, 50747, 50912, 51077, 51241, 51404, 51567, 51730,
+                51892, 52053, 52214, 52374, 52534, 52694, 52853, 53011, 53169, 53327, 53484, 53640,
+                53797, 53952, 54108, 54262, 54417, 54571, 54724, 54877, 55030, 55182, 55334, 55485,
+                55636, 55787, 55937, 56087, 56236, 56385, 56534, 56682, 56830, 56977, 57124, 57271,
+                57417, 57563, 57709, 57854, 57999, 58143, 58287, 58431, 58574, 58717, 58860, 59002,
+                59144, 59286, 59427, 59568, 59709, 59849, 59989, 60129, 60268, 60407, 60546, 60684,
+                60822, 60960, 61098, 61235, 61372, 61508, 61644, 61780, 61916, 62051, 62186, 62321,
+                62456, 62590, 62724, 62857, 62991, 63124, 63256, 63389, 63521, 63653, 63785, 63916,
+                64047, 64178, 64309, 64439, 64569, 64699, 64828, 64957, 65086, 65215, 65344, 65472,
+        };
+
+        // floor(√m) for m in [2^30, 2^32), a 16-bit result. One Newton step from the seed gives the root
+        // to within one; the divide is a few cycles on the RP2040's hardware divider.
+        uint32_t isqrtNormalised(const uint32_t m) {
+            uint32_t root = SQRT_SEED[(m >> 24) - 64];
+            root = (root + m / root) >> 1;
+            root = root > 0xffffu ? 0xffffu : root;
+            // integer Newton steps never undershoot the floor
+            return root * root > m ? root - 1 : root;
+        }
+
+        uint32_t shift(const uint32_t value, const int32_t left) {
+            return left >= 0 ? value << left : value >> -left;
+        }
+    }
+
+    BinaryAngle BinaryAngle::fromRadians(const float radians) {
+        if (!(std::fabs(radians) < MAX_RADIANS)) {
+            return {};
+        }
+        // whole turns fall off the top when the count is truncated to 32 bits
+        return BinaryAngle(static_cast<uint32_t>(static_cast<int64_t>(radians * RAW_PER_RADIAN)));
+    }
+
+    float BinaryAngle::radians() const {
+        return static_cast<float>(signedRaw()) * RADIANS_PER_RAW;
+    }
+
+    float sin(const BinaryAngle angle) {
+        return static_cast<float>(sinCore(angle.raw())) * SIN_SCALE;
+    }
+
+    float cos(const BinaryAngle angle) {
+        return static_cast<float>(sinCore(angle.raw() + BinaryAngle::QUARTER_TURN)) * SIN_SCALE;
+    }
+
+    float sin(const float radians) {
+        return sin(BinaryAngle::fromRadians(radians));
+    }
+
+    float cos(const float radians) {
+        return cos(BinaryAngle::fromRadians(radians));
+    }
+
+    void sincos(const float radians, float& sine, float& cosine) {
+        const BinaryAngle angle = BinaryAngle::fromRadians(radians);
+        sine = sin(angle);
+        cosine = cos(angle);
+    }
+
+    float atan2(const float y, const float x) {
+        const float ay = std::fabs(y);
+        const float ax = std::fabs(x);
+        if (ax == 0.0f && ay == 0.0f) {
+            return 0.0f;
+        }
+        const bool swapped = ay > ax;
+        // fmin also turns the NaN from ∞/∞ into a finite ratio
+        const float ratio = std::fmin(swapped ? ax / ay : ay / ax, 1.0f);
+        const auto fixedRatio = static_cast<uint32_t>(ratio * (1 << ATAN_RATIO_BITS) + 0.5f);
+        const uint32_t angle = unfold(atanCore(fixedRatio), swapped, x < 0.0f);
+        const float magnitude = static_cast<float>(angle) * RADIANS_PER_RAW;
+        return y < 0.0f ? -magnitude : magnitude;
+    }
+
+    float atan(const float x) {
+        return atan2(x, 1.0f);
+    }
+
+    float rsqrt(const float x) {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        bits = 0x5f375a86u - (bits >> 1);
+        float estimate;
+        std::memcpy(&estimate, &bits, sizeof(estimate));
+        const float half = 0.5f * x;
+        estimate = estimate * (1.5f - half * estimate * estimate);
+        estimate = estimate * (1.5f - half * estimate * estimate);
+        return estimate;
+    }
+
+    float hypot(const float x, const float y) {
+        const float squares = x * x + y * y;
+        return squares > 0.0f ? squares * rsqrt(squares) : 0.0f;
+    }
+
+    int32_t sinQ16(const BinaryAngle angle) {
+        return (sinCore(angle.raw()) + (1 << 7)) >> 8;
+    }
+
+    int32_t cosQ16(const BinaryAngle angle) {
+        return (sinCore(angle.raw() + BinaryAngle::QUARTER_TURN) + (1 << 7)) >> 8;
+    }
+
+    BinaryAngle atan2Q16(const int32_t y, const int32_t x) {
+        const uint32_t ay = y < 0 ? 0u - static_cast<uint32_t>(y) : static_cast<uint32_t>(y);
+        const uint32_t ax = x < 0 ? 0u - static_cast<uint32_t>(x) : static_cast<uint32_t>(x);
+        if (ax == 0 && ay == 0) {
+            return {};
+        }
+        const bool swapped = ay > ax;
+        uint32_t larger = swapped ? ay : ax;
+        uint32_t smaller = swapped ? ax : ay;
+        // bring the larger magnitude into [2^14, 2^15], rounding, so the ratio fits a 32-bit division
+        const int32_t left = static_cast<int32_t>(leadingZeros(larger)) - 17;
+        if (left >= 0) {
+            larger <<= left;
+            smaller <<= left;
+        } else {
+            const uint32_t half = 1u << (-left - 1);
+            larger = (larger >> -left) + ((larger & ((half << 1) - 1)) >= half);
+            smaller = (smaller >> -left) + ((smaller & ((half << 1) - 1)) >= half);
+        }
+        const uint32_t ratio = ((smaller << 16) + larger / 2) / larger;
+        const uint32_t fixedRatio = (ratio > (1u << 16) ? 1u << 16 : ratio) << (ATAN_RATIO_BITS - 16);
+        const uint32_t angle = unfold(atanCore(fixedRatio), swapped, x < 0);
+        return BinaryAngle::fromRaw(y < 0 ? 0u - angle : angle);
+    }
+
+    uint32_t sqrtQ16(const uint32_t x) {
+        if (x == 0) {
+            return 0;
+        }
+        // √x in Q16 is √(x·2^16); scaling x by an even power of two into [2^30, 2^32) keeps 16 bits of root
+        const uint32_t even = leadingZeros(x) & ~1u;
+        const uint32_t root = isqrtNormalised(x << even);
+        return shift(root, 8 - static_cast<int32_t>(even / 2));
+    }
+
+    uint32_t rsqrtQ16(const uint32_t x) {
+        if (x == 0) {
+            return 0;
+        }
+        // 1/√x in Q16 is 2^24/√x, and √x = root / 2^(even/2)
+        const uint32_t even = leadingZeros(x) & ~1u;
+        const uint32_t root = isqrtNormalised(x << even);
+        const uint32_t inverse = 0xffffffffu / root; // 2^32/root, 17 bits
+        return shift(inverse, static_cast<int32_t>(even / 2) - 8);
+    }
+
+    uint32_t hypotQ16(const int32_t x, const int32_t y) {
+        uint32_t ax = x < 0 ? 0u - static_cast<uint32_t>(x) : static_cast<uint32_t>(x);
+        uint32_t ay = y < 0 ? 0u - static_cast<uint32_t>(y) : static_cast<uint32_t>(y);
+        const uint32_t larger = ax > ay ? ax : ay;
+        if (larger == 0) {
+            return 0;
+        }
+        // keep the squares' sum within 32 bits: both magnitudes at most 2^15 after rounding
+        const int32_t right = larger >= (1u << 15) ? 17 - static_cast<int32_t>(leadingZeros(larger)) : 0;
+        if (right > 0) {
+            const uint32_t half = 1u << (right - 1);
+            ax = (ax >> right) + ((ax & ((half << 1) - 1)) >= half);
+            ay = (ay >> right) + ((ay & ((half << 1) - 1)) >= half);
+        }
+        const uint32_t squares = ax * ax + ay * ay;
+        const uint32_t even = leadingZeros(squares) & ~1u;
+        const uint32_t root = isqrtNormalised(squares << even);
+        return shift(root, right - static_cast<int32_t>(even / 2));
+    }
+}
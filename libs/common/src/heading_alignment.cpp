@@ -0,0 +1,123 @@
+#include "heading_alignment.h"
+#include <algorithm>
+#include <cmath>
+#include "utils.h"
+
+void HeadingAlignment::reset() {
+    samples = 0;
+    pendingCount = 0;
+}
+
+void HeadingAlignment::add(const uint32_t sampleUs, const float yaw, const float rate) {
+    const Sample sample{sampleUs, yaw, rate};
+    if (samples > 0 && static_cast<int32_t>(sampleUs - newest.us) > 0) {
+        // captures this sample and the one before it bracket can now be checked; older ones never will be
+        size_t kept = 0;
+        for (size_t i = 0; i < pendingCount; i++) {
+            const Capture& capture = pending[i];
+            if (static_cast<int32_t>(capture.us - sampleUs) > 0) {
+                pending[kept++] = capture;
+            } else if (static_cast<int32_t>(capture.us - newest.us) >= 0) {
+                check(capture, newest, sample);
+            }
+        }
+        pendingCount = kept;
+    }
+    previous = newest;
+    newest = sample;
+    samples++;
+}
+
+float HeadingAlignment::headingAt(const uint32_t captureUs) {
+    if (samples == 0) {
+        return NAN;
+    }
+    const auto ageUs = static_cast<int32_t>(captureUs - newest.us);
+    sampleAgeSumUs += static_cast<uint64_t>(std::abs(ageUs));
+    maxSampleAgeUs = std::max(maxSampleAgeUs, ageUs);
+
+    const auto spanUs = static_cast<int32_t>(newest.us - previous.us);
+    if (samples > 1 && spanUs > 0 && ageUs <= 0 && static_cast<int32_t>(captureUs - previous.us) >= 0) {
+        interpolated++;
+        const float share = static_cast<float>(captureUs - previous.us) / static_cast<float>(spanUs);
+        return wrap_pi(previous.yaw + share * wrap_pi(newest.yaw - previous.yaw));
+    }
+
+    float rate = newest.rate;
+    if (std::isnan(rate) && samples > 1 && spanUs > 0) {
+        rate = wrap_pi(newest.yaw - previous.yaw) / (static_cast<float>(spanUs) * 1e-6f);
+    }
+    if (std::isnan(rate) || static_cast<uint32_t>(std::abs(ageUs)) > MAX_EXTRAPOLATION_US) {
+        unaligned++;
+        return newest.yaw;
+    }
+    extrapolated++;
+    const float aligned = wrap_pi(newest.yaw + rate * static_cast<float>(ageUs) * 1e-6f);
+    if (ageUs > 0) {
+        if (pendingCount == PENDING_CAPTURES) {
+            std::move(pending + 1, pending + PENDING_CAPTURES, pending);
+            pendingCount--;
+        }
+        pending[pendingCount++] = {captureUs, newest.yaw, aligned};
+    }
+    return aligned;
+}
+
+void HeadingAlignment::check(const Capture& capture, const Sample& before, const Sample& after) {
+    const auto spanUs = static_cast<float>(after.us - before.us);
+    const float turn = wrap_pi(after.yaw - before.yaw);
+    const float rate = turn / (spanUs * 1e-6f);
+    if (std::abs(rate) < MIN_CHECK_RATE) {
+        return;
+    }
+    // with both samples' turn rates measured, a cubic through both headings and rates follows a change of rate
+    // between them; otherwise the heading is taken to turn steadily
+    const float share = static_cast<float>(capture.us - before.us) / spanUs;
+    float actual = before.yaw + turn * share;
+    if (!std::isnan(before.rate) && !std::isnan(after.rate)) {
+        const float span = spanUs * 1e-6f;
+        const float share2 = share * share;
+        const float share3 = share2 * share;
+        actual = before.yaw + (share3 - 2.0f * share2 + share) * span * before.rate +
+                 (3.0f * share2 - 2.0f * share3) * turn + (share3 - share2) * span * after.rate;
+    }
+    actual = wrap_pi(actual);
+    const float rawError = std::abs(wrap_pi(capture.raw - actual));
+    const float alignedError = std::abs(wrap_pi(capture.aligned - actual));
+    checked++;
+    rateSum += std::abs(rate);
+    rawErrorSum += rawError;
+    alignedErrorSum += alignedError;
+    maxRawError = std::max(maxRawError, rawError);
+    maxAlignedError = std::max(maxAlignedError, alignedError);
+}
+
+HeadingAlignmentStats HeadingAlignment::stats() const {
+    HeadingAlignmentStats result{};
+    result.interpolated = interpolated;
+    result.extrapolated = extrapolated;
+    result.unaligned = unaligned;
+    const uint32_t captures = interpolated + extrapolated + unaligned;
+    result.meanSampleAgeUs = captures > 0 ? static_cast<float>(sampleAgeSumUs) / static_cast<float>(captures) : 0.0f;
+    result.maxSampleAgeUs = maxSampleAgeUs;
+    result.checked = checked;
+    result.rawSkewUs = rateSum > 0.0f ? rawErrorSum / rateSum * 1e6f : 0.0f;
+    result.alignedSkewUs = rateSum > 0.0f ? alignedErrorSum / rateSum * 1e6f : 0.0f;
+    result.maxRawError = maxRawError;
+    result.maxAlignedError = maxAlignedError;
+    return result;
+}
+
+void HeadingAlignment::resetStats() {
+    interpolated = 0;
+    extrapolated = 0;
+    unaligned = 0;
+    sampleAgeSumUs = 0;
+    maxSampleAgeUs = 0;
+    checked = 0;
+    rateSum = 0.0f;
+    rawErrorSum = 0.0f;
+    alignedErrorSum = 0.0f;
+    maxRawError = 0.0f;
+    maxAlignedError = 0.0f;
+}
@@ -0,0 +1,52 @@
+#include "pose_history.h"
+
+void PoseHistory::reset() {
+    newest = 0;
+    count = 0;
+}
+
+void PoseHistory::record(const uint32_t startUs, const uint32_t endUs, const COMMON::Pose& motion) {
+    newest = (newest + 1) % CAPACITY;
+    steps[newest] = {startUs, endUs, motion};
+    if (count < CAPACITY) {
+        count++;
+    }
+}
+
+bool PoseHistory::motionSince(const uint32_t timeUs, COMMON::Pose& motion) const {
+    motion = {0.0f, 0.0f, 0.0f};
+    if (count == 0) {
+        return false;
+    }
+    size_t index = newest;
+    for (size_t i = 0; i < count; i++) {
+        const Step& step = steps[index];
+        if (static_cast<int32_t>(timeUs - step.endUs) >= 0) {
+            return true;
+        }
+        // the share of this tick's motion that came after timeUs
+        float share = 1.0f;
+        const uint32_t lengthUs = step.endUs - step.startUs;
+        if (static_cast<int32_t>(timeUs - step.startUs) > 0 && lengthUs > 0) {
+            share = static_cast<float>(step.endUs - timeUs) / static_cast<float>(lengthUs);
+        }
+        motion.x += share * step.motion.x;
+        motion.y += share * step.motion.y;
+        motion.heading += share * step.motion.heading;
+        if (share < 1.0f) {
+            return true;
+        }
+        index = (index + CAPACITY - 1) % CAPACITY;
+    }
+    // timeUs is at the very start of the oldest tick, or before it
+    const Step& oldest = steps[(newest + CAPACITY + 1 - count) % CAPACITY];
+    return timeUs == oldest.startUs;
+}
+
+uint32_t PoseHistory::spanUs() const {
+    if (count == 0) {
+        return 0;
+    }
+    const Step& oldest = steps[(newest + CAPACITY + 1 - count) % CAPACITY];
+    return steps[newest].endUs - oldest.startUs;
+}
@@ -0,0 +1,136 @@
+#include "profiler.h"
+
+#ifdef OSOD_PROFILING
+#include <cstdio>
+#include "pico.h"
+
+namespace PROFILER {
+    namespace {
+        // Log-linear histogram: each power-of-two range of cycle counts is split into SUB_BUCKETS equal
+        // buckets, so a bucket is never wider than a quarter of its lower edge.
+        constexpr uint32_t SUB_BUCKET_BITS = 2;
+        constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+        constexpr uint32_t MAX_OCTAVE = 27;
+        constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (MAX_OCTAVE - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        const char* const STAGE_NAMES[STAGE::STAGE_COUNT] = {
+                "estimateState",
+                "captureEncoders",
+                "getLatestHeading",
+                "wheelOdometry",
+                "tofSensors",
+                "localisation",
+                "filterPositions",
+                "poseEkf",
+                "particleFilter",
+                "publishEstimate",
+                "navigate",
+                "requestState",
+                "mix",
+                "set_speed",
+        };
+
+        struct Histogram {
+            uint32_t samples;
+            uint32_t minCycles;
+            uint32_t maxCycles;
+            uint64_t totalCycles;
+            uint16_t buckets[BUCKET_COUNT];
+        };
+
+        // each core only writes its own histograms, so recording needs no locking
+        Histogram histograms[CORE_COUNT][STAGE::STAGE_COUNT];
+
+        size_t bucketFor(uint32_t value) {
+            if (value < SUB_BUCKETS) {
+                return value;
+            }
+            uint32_t octave = 31 - __builtin_clz(value);
+            if (octave > MAX_OCTAVE) {
+                return BUCKET_COUNT - 1;
+            }
+            const uint32_t sub = (value >> (octave - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+            return SUB_BUCKETS + (octave - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+        }
+
+        uint32_t bucketUpperEdge(size_t bucket) {
+            if (bucket < SUB_BUCKETS) {
+                return bucket + 1;
+            }
+            const uint32_t octave = (bucket - SUB_BUCKETS) / SUB_BUCKETS + SUB_BUCKET_BITS;
+            const uint32_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+            const uint32_t width = 1u << (octave - SUB_BUCKET_BITS);
+            return (SUB_BUCKETS + sub) * width + width;
+        }
+    }
+
+    void record(STAGE::Stage stage, uint32_t elapsedCycles) {
+        Histogram& histogram = histograms[get_core_num() % CORE_COUNT][stage];
+        if (histogram.samples == 0 || elapsedCycles < histogram.minCycles) {
+            histogram.minCycles = elapsedCycles;
+        }
+        if (elapsedCycles > histogram.maxCycles) {
+            histogram.maxCycles = elapsedCycles;
+        }
+        histogram.samples++;
+        histogram.totalCycles += elapsedCycles;
+        uint16_t& bucket = histogram.buckets[bucketFor(elapsedCycles)];
+        if (bucket < UINT16_MAX) {
+            bucket++;
+        }
+    }
+
+    StageStats stats(STAGE::Stage stage, size_t core) {
+        const Histogram& histogram = histograms[core][stage];
+        if (histogram.samples == 0) {
+            return {};
+        }
+        const float perUs = cyclesPerUs();
+        const uint32_t p99Rank = histogram.samples - histogram.samples / 100;
+        uint32_t cumulative = 0;
+        uint32_t p99Cycles = histogram.maxCycles;
+        for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+            cumulative += histogram.buckets[bucket];
+            if (cumulative >= p99Rank) {
+                p99Cycles = bucketUpperEdge(bucket) < histogram.maxCycles ? bucketUpperEdge(bucket) : histogram.maxCycles;
+                break;
+            }
+        }
+        return {histogram.samples,
+                static_cast<float>(histogram.minCycles) / perUs,
+                static_cast<float>(histogram.totalCycles) / static_cast<float>(histogram.samples) / perUs,
+                static_cast<float>(p99Cycles) / perUs,
+                static_cast<float>(histogram.maxCycles) / perUs};
+    }
+
+    const char* stageName(STAGE::Stage stage) {
+        return STAGE_NAMES[stage];
+    }
+
+    void dump(bool resetAfter) {
+        printf("profile (us)          core  samples      min     mean      p99      max\n");
+        for (size_t core = 0; core < CORE_COUNT; core++) {
+            for (int stage = 0; stage < STAGE::STAGE_COUNT; stage++) {
+                const StageStats stageStats = stats(static_cast<STAGE::Stage>(stage), core);
+                if (stageStats.samples == 0) {
+                    continue;
+                }
+                printf("%-20s %5u %8lu %8.1f %8.1f %8.1f %8.1f\n", STAGE_NAMES[stage], (unsigned) core,
+                       (unsigned long) stageStats.samples, stageStats.minUs, stageStats.meanUs, stageStats.p99Us,
+                       stageStats.maxUs);
+            }
+        }
+        if (resetAfter) {
+            reset();
+        }
+    }
+
+    void reset() {
+        for (auto& core : histograms) {
+            for (auto& histogram : core) {
+                histogram = {};
+            }
+        }
+    }
+}
+#endif
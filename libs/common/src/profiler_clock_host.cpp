@@ -0,0 +1,25 @@
+// Profiler clock in the host build: the host's steady clock in nanoseconds, so the profile shows where
+// the host CPU goes (the simulated clock doesn't advance while code runs).
+
+#include <chrono>
+#include "profiler.h"
+
+#ifdef OSOD_PROFILING
+namespace PROFILER {
+    void init() {
+    }
+
+    uint32_t cycles() {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }
+
+    uint32_t elapsedCycles(uint32_t start) {
+        return cycles() - start;
+    }
+
+    float cyclesPerUs() {
+        return 1000.0f;
+    }
+}
+#endif
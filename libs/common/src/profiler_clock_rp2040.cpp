@@ -0,0 +1,34 @@
+// Profiler clock on the RP2040: each core's SysTick, free-running at the system clock.
+
+#include "profiler.h"
+
+#ifdef OSOD_PROFILING
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+
+namespace PROFILER {
+    namespace {
+        constexpr uint32_t SYSTICK_MASK = 0x00ffffff;
+    }
+
+    void init() {
+        systick_hw->csr = 0;
+        systick_hw->rvr = SYSTICK_MASK;
+        systick_hw->cvr = 0;
+        systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+    }
+
+    uint32_t cycles() {
+        // SysTick counts down; invert it so the profiler sees an up-counter
+        return ~systick_hw->cvr & SYSTICK_MASK;
+    }
+
+    uint32_t elapsedCycles(uint32_t start) {
+        return (cycles() - start) & SYSTICK_MASK;
+    }
+
+    float cyclesPerUs() {
+        return static_cast<float>(clock_get_hz(clk_sys)) / 1e6f;
+    }
+}
+#endif
@@ -0,0 +1,119 @@
+#include "task_timing.h"
+
+TaskTiming::TaskTiming(uint32_t periodUs) : periodUs(periodUs) {
+    critical_section_init(&lock);
+}
+
+void TaskTiming::trigger(uint32_t nowUs) {
+    critical_section_enter_blocking(&lock);
+    if (isPending) {
+        // the previous request has not been picked up yet: it is superseded by this one
+        skipped = skipped + 1;
+    }
+    triggerUs = nowUs;
+    isPending = true;
+    critical_section_exit(&lock);
+}
+
+void TaskTiming::begin(uint32_t nowUs) {
+    // taken together, so a trigger landing in between is either this one or left pending for the next
+    critical_section_enter_blocking(&lock);
+    activeTriggerUs = triggerUs;
+    isPending = false;
+    critical_section_exit(&lock);
+
+    const uint32_t latency = nowUs - activeTriggerUs;
+    if (latency < minLatencyUs) minLatencyUs = latency;
+    if (latency > maxLatencyUs) maxLatencyUs = latency;
+    totalLatencyUs += latency;
+
+    if (hasStarted) {
+        const auto interval = static_cast<int32_t>(nowUs - lastStartUs);
+        const auto deviation = static_cast<uint32_t>(interval > static_cast<int32_t>(periodUs)
+                                                     ? interval - static_cast<int32_t>(periodUs)
+                                                     : static_cast<int32_t>(periodUs) - interval);
+        if (deviation > maxJitterUs) maxJitterUs = deviation;
+    }
+    lastStartUs = nowUs;
+    hasStarted = true;
+}
+
+void TaskTiming::end(uint32_t nowUs) {
+    runs++;
+    const uint32_t execution = nowUs - lastStartUs;
+    if (execution > maxExecutionUs) maxExecutionUs = execution;
+    if (nowUs - activeTriggerUs > periodUs) {
+        deadlineMisses++;
+    }
+}
+
+TaskTimingStats TaskTiming::stats() const {
+    return {
+            .runs = runs,
+            .deadlineMisses = deadlineMisses,
+            .skippedTriggers = skipped,
+            .minLatencyUs = runs > 0 ? minLatencyUs : 0,
+            .maxLatencyUs = maxLatencyUs,
+            .meanLatencyUs = runs > 0 ? static_cast<float>(totalLatencyUs) / static_cast<float>(runs) : 0.0f,
+            .maxJitterUs = maxJitterUs,
+            .maxExecutionUs = maxExecutionUs,
+    };
+}
+
+void TaskTiming::resetStats() {
+    skipped = 0;
+    hasStarted = false;
+    runs = 0;
+    deadlineMisses = 0;
+    minLatencyUs = UINT32_MAX;
+    maxLatencyUs = 0;
+    totalLatencyUs = 0;
+    maxJitterUs = 0;
+    maxExecutionUs = 0;
+}
+
+SampleInterval::SampleInterval(uint32_t nominalUs) : nominalUs(nominalUs),
+                                                     lastDt(static_cast<float>(nominalUs) * 1e-6f) {
+}
+
+float SampleInterval::update(uint32_t captureUs) {
+    if (!hasSample) {
+        hasSample = true;
+        lastCaptureUs = captureUs;
+        lastDt = static_cast<float>(nominalUs) * 1e-6f;
+        return lastDt;
+    }
+    const uint32_t interval = captureUs - lastCaptureUs;
+    lastCaptureUs = captureUs;
+    lastDt = static_cast<float>(interval) * 1e-6f;
+    if (interval == 0) {
+        // the same sample again: nothing has elapsed, and it says nothing about the period
+        return lastDt;
+    }
+
+    samples++;
+    if (interval < minIntervalUs) minIntervalUs = interval;
+    if (interval > maxIntervalUs) maxIntervalUs = interval;
+    totalIntervalUs += interval;
+    const uint32_t deviation = interval > nominalUs ? interval - nominalUs : nominalUs - interval;
+    if (deviation > maxJitterUs) maxJitterUs = deviation;
+    return lastDt;
+}
+
+SampleIntervalStats SampleInterval::stats() const {
+    return {
+            .samples = samples,
+            .minIntervalUs = samples > 0 ? minIntervalUs : 0,
+            .maxIntervalUs = maxIntervalUs,
+            .meanIntervalUs = samples > 0 ? static_cast<float>(totalIntervalUs) / static_cast<float>(samples) : 0.0f,
+            .maxJitterUs = maxJitterUs,
+    };
+}
+
+void SampleInterval::resetStats() {
+    samples = 0;
+    minIntervalUs = UINT32_MAX;
+    maxIntervalUs = 0;
+    totalIntervalUs = 0;
+    maxJitterUs = 0;
+}
@@ -0,0 +1,39 @@
+#include "timed_pid.h"
+
+TimedPID::TimedPID(float kp, float ki, float kd) : kp(kp), ki(ki), kd(kd) {
+}
+
+float TimedPID::calculate(float value, float dt) {
+    const float error = setpoint - value;
+    if (dt > 0.0f) {
+        errorSum += error * dt;
+        rate = primed ? (value - lastValue) / dt : 0.0f;
+        lastValue = value;
+        primed = true;
+    }
+    lastDt = dt;
+    lastTerms = {error * kp, errorSum * ki, -rate * kd};
+    return lastTerms.p + lastTerms.i + lastTerms.d;
+}
+
+float TimedPID::calculate(float value, float rate, float dt) {
+    const float error = setpoint - value;
+    if (dt > 0.0f) {
+        errorSum += error * dt;
+        lastValue = value;
+        primed = true;
+    }
+    this->rate = rate;
+    lastDt = dt;
+    lastTerms = {error * kp, errorSum * ki, -rate * kd};
+    return lastTerms.p + lastTerms.i + lastTerms.d;
+}
+
+void TimedPID::reset() {
+    errorSum = 0.0f;
+    lastValue = 0.0f;
+    rate = 0.0f;
+    primed = false;
+    lastDt = 0.0f;
+    lastTerms = {};
+}
@@ -1,13 +1,17 @@
 #include "utils.h"
 #include "hardware/i2c.h"
 #include "hardware/gpio.h"
+#include "pico/sync.h"
 #include "drivetrain_config.h"
+#include "fast_math.h"
 
 volatile bool ESCdelayInProgress = false;
 volatile bool ESCirqTriggered = false;
 
 #define I2C_RECOVERY_CLOCKS 9
 
+auto_init_mutex(i2cBusMutex);
+
 static int i2c_reinit_attempts = 0; // Counter for reinitialization attempts
 const int max_i2c_reinit_attempts = 4;
 
@@ -21,6 +25,19 @@ void handleI2CError(i2c_inst_t* &i2c_port) {
     }
 }
 
+bool tryLockI2CBus() {
+    uint32_t owner;
+    return mutex_try_enter(&i2cBusMutex, &owner);
+}
+
+void lockI2CBus() {
+    mutex_enter_blocking(&i2cBusMutex);
+}
+
+void unlockI2CBus() {
+    mutex_exit(&i2cBusMutex);
+}
+
 void i2cBusRecovery(uint sda_pin, uint scl_pin) {
     gpio_init(sda_pin);
     gpio_init(scl_pin);
@@ -76,17 +93,12 @@ void initI2C(i2c_inst_t* &i2c_port, bool force_recovery) {
 }
 
 float wrap_pi(const float heading) {
-    // constrain heading to within +/-pi (+/-180 degrees) without changing the meaning of the angle
-    // if its more than pi (+180), subtract 2*pi (subtract 360degrees) so we have the "smaller" angle 
-    float wrapped = heading;
-
-    if (heading > M_PI) {
-        wrapped = heading - M_TWOPI;
-    } else if (heading < -M_PI) {
-        wrapped = heading + M_TWOPI;
+    // constrain heading to within +/-pi (+/-180 degrees) without changing the meaning of the angle.
+    // As a binary angle whole turns drop off on their own, however many there are
+    if (std::isnan(heading)) {
+        return heading;
     }
-
-    return static_cast<float>(wrapped);
+    return FAST_MATH::BinaryAngle::fromRadians(heading).radians();
 }
 
 bool reserved_addr(uint8_t addr) {
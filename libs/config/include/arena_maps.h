@@ -0,0 +1,8 @@
+#pragma once
+#include "types.h"
+
+// Wall maps for the particle localiser. Only fixed walls belong here: barrels, mines and other robots move,
+// and the localiser treats a return short of the map as an obstacle.
+extern COMMON::MapSegment ecoDisasterArena[4];
+extern COMMON::MapSegment minesweeperArena[4];
+extern COMMON::MapSegment piNoonArena[4];
@@ -7,6 +7,7 @@
 
 #include "motor2040.hpp"
 #include "waypoint_routes.h"
+#include "arena_maps.h"
 #include "types.h"
 
 namespace CONFIG {
@@ -50,6 +51,106 @@ namespace CONFIG {
     constexpr float TOF_RIGHT_OFFSET = 0.07f;
     constexpr float TOF_REAR_OFFSET = 0.09f;
     constexpr float TOF_LEFT_OFFSET = 0.07f;
+    // a range (from the centre) less than this beyond a sensor's mount is a return off the robot's own chassis
+    constexpr float TOF_SELF_CLEARANCE = 0.02f;
+    constexpr float TOF_MAX_RANGE = 8.0f; // metres, the TF-Luna's rated range indoors
+
+    // ToF sampling. A TF-Luna only produces a new frame at its output rate (100 Hz by default), so each sensor
+    // is read at most that often; the four reads are phase-staggered across the sample period
+    constexpr uint32_t TOF_FRAME_PERIOD_US = 10000;
+    constexpr uint32_t TOF_SAMPLE_PERIOD_US = 20000;
+    constexpr uint32_t TOF_STALE_AFTER_US = 2 * TOF_SAMPLE_PERIOD_US; // older readings aren't used for localisation
+    // a TF-Luna return weaker than this, or saturated at 65535, is unreliable; the sensor reports it as 0 cm
+    constexpr uint16_t TOF_MIN_STRENGTH = 100;
+    // a range further than this from both the median of the sensor's last three and their trend is held back as a spike
+    constexpr float TOF_SPIKE_TOLERANCE = 0.1f;
+
+    // pose estimation. EKF fuses wheel odometry, IMU yaw and each ToF wall range weighted by their uncertainty
+    // (libs/pose_ekf); COMPLEMENTARY dead-reckons on the IMU heading and blends in the ToF localisation fix at a
+    // fixed weight; PARTICLE ray-casts the ToF beams against the challenge's arenaMap (libs/particle_localisation),
+    // so it copes with arenas that aren't an empty square. COMPLEMENTARY stays the default until the others have
+    // been tuned on the robot
+    enum PoseFilter {
+        COMPLEMENTARY,
+        EKF,
+        PARTICLE
+    };
+    constexpr PoseFilter POSE_FILTER = COMPLEMENTARY;
+    // see particle_localisation_bench for the cost per particle. Each takes 36 bytes of RAM, only reserved when
+    // POSE_FILTER is PARTICLE
+    constexpr size_t PARTICLE_COUNT = 256;
+
+    // wheel odometry. REAR_WHEELS takes the distance travelled from the two rear encoders; FOUR_WHEEL uses all four
+    // through the Ackermann geometry and the IMU turn rate, and down-weights wheels that slip or stall
+    // (libs/wheel_odometry). REAR_WHEELS, the original odometry, stays the default until FOUR_WHEEL has run on
+    // the robot
+    enum Odometry {
+        REAR_WHEELS,
+        FOUR_WHEEL
+    };
+    constexpr Odometry ODOMETRY = REAR_WHEELS;
+
+    // how each tick's travel is laid down. EULER moves along the heading at the end of the tick; MIDPOINT along the
+    // heading halfway through the turn; ARC along the chord of the circular arc the rear axle follows, which is
+    // exact for a constant turn. The EKF turns by its turn rate estimate; the complementary filter by the IMU heading
+    // change, or on ticks without a new IMU heading by the steering angles through the bicycle model. EULER, the
+    // default, is the original odometry, and its complementary filter holds the heading between IMU reports
+    enum PoseIntegration {
+        EULER,
+        MIDPOINT,
+        ARC
+    };
+    constexpr PoseIntegration POSE_INTEGRATION = EULER;
+
+    // IMU heading source. ROTATION_VECTOR is the hub's fused yaw, and the turn rate is found by differencing it
+    // between ticks; GYRO_INTEGRATED_RV is the hub's gyro-integrated orientation on its own channel, each report
+    // carrying the measured turn rate too. Each tick the hub is read until it is empty, at most
+    // IMU_REPORTS_PER_TICK times when polled, and every heading report queued since the last tick is fused. The
+    // hub can send GYRO_INTEGRATED_RV every 1000 us, but each report costs about 2 ms of the 100 kHz bus, so
+    // faster than one per estimator tick starves the ToF reads. ROTATION_VECTOR, the report the robot has always
+    // used, stays the default until GYRO_INTEGRATED_RV has been checked on the hardware
+    enum ImuReport {
+        ROTATION_VECTOR,
+        GYRO_INTEGRATED_RV
+    };
+    constexpr ImuReport IMU_REPORT = ROTATION_VECTOR;
+    constexpr uint32_t IMU_REPORT_INTERVAL_US = 10000;
+    constexpr uint32_t IMU_REPORTS_PER_TICK = 4;
+
+    // When the IMU's heading is taken to be from. AT_ENCODER_CAPTURE timestamps each report with its SH2
+    // timestamp, counted back from INT, and brings the heading to the instant the encoders were captured.
+    // The EKF and particle filter fuse each report against the pose at its own timestamp, and the
+    // complementary filter locates from the ToF ranges with the heading from when they were read. AS_READ, the
+    // default, takes the newest report as the heading at the capture, and fuses reports as of when they were
+    // decoded. The newest report is nearly always older than the capture, so AT_ENCODER_CAPTURE in practice
+    // extrapolates it at its turn rate rather than interpolating
+    enum ImuHeadingTiming {
+        AS_READ,
+        AT_ENCODER_CAPTURE
+    };
+    constexpr ImuHeadingTiming IMU_HEADING_TIMING = AS_READ;
+
+    // IMU servicing. INTERRUPT reads the hub when it pulls its INT line low, one IMU_INT_READ_BYTES transfer per
+    // edge, so the estimator finds its reports already read and never polls an empty hub; POLLED reads an SHTP
+    // header every tick whether or not there is a report. If INT stays quiet for IMU_INT_SILENCE_US the driver
+    // falls back to polling for good. INTERRUPT needs the BNO08x's INT pin wired to the Motor 2040's INT
+    // (IMU_INT_PIN), so POLLED, which needs nothing extra, is the default
+    enum ImuService {
+        POLLED,
+        INTERRUPT
+    };
+    constexpr ImuService IMU_SERVICE = POLLED;
+    constexpr uint IMU_INT_PIN = motor::motor2040::INT; // pin 19
+    // one report's SHTP packet: a gyro-integrated RV (4 byte header + 14), or a rotation vector behind its base
+    // timestamp (4 + 5 + 14). The rest of a longer packet is read as one continuation straight after
+    constexpr size_t IMU_INT_READ_BYTES = IMU_REPORT == GYRO_INTEGRATED_RV ? 18 : 23;
+    constexpr uint32_t IMU_INT_SILENCE_US = 500000;
+
+    // flight recorder. 176 bytes a tick, so 128 ticks is 1.28 s at the estimator's 100 Hz in ~22 KB. The buffer is
+    // static, in the 256 KB of main SRAM; each core's stack has its own 4 KB scratch bank, so it doesn't compete
+    // with them. FLIGHT_RECORDER_RAM_BUDGET caps it to leave the rest for the heap and the other buffers
+    constexpr size_t FLIGHT_RECORDER_TICKS = 128;
+    constexpr size_t FLIGHT_RECORDER_RAM_BUDGET = 32 * 1024;
 
     //steering
     constexpr float MAX_STEERING_ANGLE = 3.14 / 4; // radians
@@ -84,11 +185,15 @@ namespace CONFIG {
         constexpr float ARENA_SIZE = 2.2; // metres square
         constexpr COMMON::Waypoint* waypointBuffer = ecodisasterRoute;
         constexpr size_t waypointCount = sizeof(ecodisasterRoute) / sizeof(ecodisasterRoute[0]);
+        constexpr COMMON::MapSegment* arenaMap = ecoDisasterArena;
+        constexpr size_t arenaMapSegments = sizeof(ecoDisasterArena) / sizeof(ecoDisasterArena[0]);
     #elif (CURRENT_CHALLENGE == ESCAPE_ROUTE)
         const float WHEEL_DIAMETER = SMALL_WHEEL_DIAMETER;
         const float EXTERNAL_GEAR_RATIO = 1;
         constexpr SteeringStyle DRIVING_STYLE = Car;
         constexpr float ARENA_SIZE = std::numeric_limits<float>::quiet_NaN();
+        constexpr COMMON::MapSegment* arenaMap = nullptr; // no map, so PARTICLE has nothing to localise against
+        constexpr size_t arenaMapSegments = 0;
         constexpr COMMON::Waypoint* waypointBuffer = escapeRouteRoute;
         constexpr size_t waypointCount = sizeof(escapeRouteRoute) / sizeof(escapeRouteRoute[0]);
     #elif (CURRENT_CHALLENGE == ZOMBIE_APOCALYPSE)
@@ -96,6 +201,8 @@ namespace CONFIG {
         const float EXTERNAL_GEAR_RATIO = 1;
         constexpr SteeringStyle DRIVING_STYLE = Car;
         constexpr float ARENA_SIZE = std::numeric_limits<float>::quiet_NaN();
+        constexpr COMMON::MapSegment* arenaMap = nullptr; // no map, so PARTICLE has nothing to localise against
+        constexpr size_t arenaMapSegments = 0;
     #elif (CURRENT_CHALLENGE == MINESWEEPER)
         const float WHEEL_DIAMETER = SMALL_WHEEL_DIAMETER;
         const float EXTERNAL_GEAR_RATIO = 1;
@@ -103,16 +210,22 @@ namespace CONFIG {
         constexpr float ARENA_SIZE = 1.6; //metres square
         constexpr COMMON::Waypoint* waypointBuffer = minesweeperRoute;
         constexpr size_t waypointCount = sizeof(minesweeperRoute) / sizeof(minesweeperRoute[0]);
+        constexpr COMMON::MapSegment* arenaMap = minesweeperArena;
+        constexpr size_t arenaMapSegments = sizeof(minesweeperArena) / sizeof(minesweeperArena[0]);
     #elif (CURRENT_CHALLENGE == PI_NOON)
         const float WHEEL_DIAMETER = MECANUM_DIAMETER;
         const float EXTERNAL_GEAR_RATIO = 1;
         constexpr SteeringStyle DRIVING_STYLE = Car;
         constexpr float ARENA_SIZE = 2.4; //metres square
+        constexpr COMMON::MapSegment* arenaMap = piNoonArena;
+        constexpr size_t arenaMapSegments = sizeof(piNoonArena) / sizeof(piNoonArena[0]);
     #elif  (CURRENT_CHALLENGE == LAVA_PALAVA)
         const float WHEEL_DIAMETER = LARGE_WHEEL_DIAMETER;
         const float EXTERNAL_GEAR_RATIO = 1;
         constexpr SteeringStyle DRIVING_STYLE = Car;
         constexpr float ARENA_SIZE = std::numeric_limits<float>::quiet_NaN();
+        constexpr COMMON::MapSegment* arenaMap = nullptr; // no map, so PARTICLE has nothing to localise against
+        constexpr size_t arenaMapSegments = 0;
         constexpr COMMON::Waypoint* waypointBuffer = lavaRoute;
         constexpr size_t waypointCount = sizeof(lavaRoute)/ sizeof(lavaRoute[0]);
     #elif  (CURRENT_CHALLENGE == TEMPLE_OF_DOOM)
@@ -120,12 +233,16 @@ namespace CONFIG {
         const float EXTERNAL_GEAR_RATIO = 1;
         constexpr SteeringStyle DRIVING_STYLE = Car;
         constexpr float ARENA_SIZE = std::numeric_limits<float>::quiet_NaN();
+        constexpr COMMON::MapSegment* arenaMap = nullptr; // no map, so PARTICLE has nothing to localise against
+        constexpr size_t arenaMapSegments = 0;
     #else
         // Default case
         const float WHEEL_DIAMETER = SMALL_WHEEL_DIAMETER;
         const float EXTERNAL_GEAR_RATIO = 1;
         constexpr SteeringStyle DRIVING_DIRECTION = CarSteering;
         constexpr float ARENA_SIZE = std::numeric_limits<float>::quiet_NaN();
+        constexpr COMMON::MapSegment* arenaMap = nullptr; // no map, so PARTICLE has nothing to localise against
+        constexpr size_t arenaMapSegments = 0;
     #endif
 
 
@@ -0,0 +1,22 @@
+#include "arena_maps.h"
+
+COMMON::MapSegment ecoDisasterArena[4] = {   // 2.2 m square
+        {-1100, -1100, 1100, -1100},
+        {1100, -1100, 1100, 1100},
+        {1100, 1100, -1100, 1100},
+        {-1100, 1100, -1100, -1100}
+};
+
+COMMON::MapSegment minesweeperArena[4] = {   // 1.6 m square
+        {-800, -800, 800, -800},
+        {800, -800, 800, 800},
+        {800, 800, -800, 800},
+        {-800, 800, -800, -800}
+};
+
+COMMON::MapSegment piNoonArena[4] = {   // 2.4 m square
+        {-1200, -1200, 1200, -1200},
+        {1200, -1200, 1200, 1200},
+        {1200, 1200, -1200, 1200},
+        {-1200, 1200, -1200, -1200}
+};
@@ -0,0 +1,83 @@
+#ifndef OSOD_MOTOR_2040_FLIGHT_RECORDER_H
+#define OSOD_MOTOR_2040_FLIGHT_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "drivetrain_config.h"
+#include "types.h"
+
+/*
+ * In-RAM flight recorder.
+ *
+ * Keeps the last CAPACITY (CONFIG::FLIGHT_RECORDER_TICKS) estimator ticks in a circular buffer: the raw encoder captures, the IMU yaw
+ * and when it was read, the four ToF ranges with their signal strength, the receiver channels and the
+ * state the navigator last requested, the drive train state last sent to the stokers and the resulting
+ * pose estimate. That is everything the host replay (host/sim/src/replay.cpp) needs to run a dump back
+ * through the estimator and navigator. The estimator fills in a TickRecord as it goes and hands it to
+ * record(), which adds the latest receiver, requested and applied states and copies it into the buffer.
+ *
+ * requestDump() freezes the recorder and queues the buffer, oldest tick first, for the telemetry
+ * stream as RECORD::FLIGHT_RECORD frames. serviceDump() feeds it out from the main loop as the
+ * telemetry ring makes room, so a dump never crowds out live telemetry or blocks the loop. The
+ * recorder stays frozen, and can be dumped again, until resume() is called.
+ *
+ * record(), noteDriveTrainState() and latest() belong to the core that runs the estimator and the
+ * stokers; noteReceiverChannels(), noteRequestedState(), the freeze and dump controls and serviceDump()
+ * may be called from the other.
+ */
+
+namespace FLIGHT_RECORDER {
+    constexpr size_t CAPACITY = CONFIG::FLIGHT_RECORDER_TICKS;
+    constexpr size_t RECEIVER_CHANNEL_COUNT = 6; // in RX_CHANNELS order
+
+    struct TickRecord {
+        uint32_t timeUs;
+        uint32_t tick;          // counts every recorded tick, so gaps in a dump are visible
+        int32_t encoderCount[COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT];
+        int32_t encoderDelta[COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT];
+        float encoderFrequency[COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT];
+        float imuYaw;           // raw, before the heading offset is applied
+        float imuYawRate;       // rad/s as the IMU measured it; zero unless CONFIG::IMU_REPORT measures it
+        uint32_t imuReadUs;     // when the yaw was read from the IMU
+        float tofDistance[COMMON::NUM_TOF_SENSORS];
+        uint32_t tofCapturedUs[COMMON::NUM_TOF_SENSORS];
+        uint16_t tofStrength[COMMON::NUM_TOF_SENSORS];
+        float receiverChannels[RECEIVER_CHANNEL_COUNT];
+        float requestedVelocity;
+        float requestedAngularVelocity;
+        COMMON::DriveTrainState driveTrainState;
+        COMMON::Pose pose;      // the estimate this tick produced
+    };
+
+    static_assert(sizeof(TickRecord) == 176, "flight records have a fixed layout");
+    static_assert(CAPACITY >= 2, "a dump needs at least one tick besides the one being recorded");
+    static_assert(CAPACITY * sizeof(TickRecord) <= CONFIG::FLIGHT_RECORDER_RAM_BUDGET,
+                  "the flight recorder is over its RAM budget");
+
+    // Copies a tick into the buffer, unless the recorder is frozen.
+    void record(TickRecord& tick);
+
+    void noteReceiverChannels(const float (&channels)[RECEIVER_CHANNEL_COUNT]);
+
+    void noteRequestedState(float velocity, float angularVelocity);
+
+    void noteDriveTrainState(const COMMON::DriveTrainState& driveTrainState);
+
+    void freeze();
+
+    void resume();
+
+    [[nodiscard]] bool frozen();
+
+    // Copies the most recently recorded tick. Returns false if nothing has been recorded yet.
+    bool latest(TickRecord& tick);
+
+    // Freezes the recorder and starts a dump, unless one is already under way.
+    void requestDump();
+
+    // Emits as much of a pending dump as the telemetry ring has room for. Returns true while a dump is
+    // still in progress.
+    bool serviceDump();
+}
+
+#endif //OSOD_MOTOR_2040_FLIGHT_RECORDER_H
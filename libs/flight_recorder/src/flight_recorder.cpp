@@ -0,0 +1,119 @@
+#include "flight_recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include "seqlock.h"
+#include "telemetry.h"
+
+namespace FLIGHT_RECORDER {
+    namespace {
+        // a dump only fills the telemetry ring to half way, leaving the rest for live records
+        constexpr size_t LIVE_TELEMETRY_HEADROOM = TELEMETRY::RING_CAPACITY / 2;
+
+        struct RequestedState {
+            float velocity;
+            float angularVelocity;
+        };
+
+        TickRecord buffer[CAPACITY];
+        std::atomic<uint32_t> recordedTicks{0};
+        std::atomic<bool> isFrozen{false};
+
+        struct ReceiverChannels {
+            float channels[RECEIVER_CHANNEL_COUNT];
+        };
+
+        SeqLock<ReceiverChannels> receiverChannels;
+        SeqLock<RequestedState> requestedState;
+        COMMON::DriveTrainState appliedDriveTrainState{};
+
+        // dump progress, only touched by the core running the main loop
+        bool dumping = false;
+        uint32_t dumpNext = 0;
+        uint32_t dumpEnd = 0;
+    }
+
+    void record(TickRecord& tick) {
+        if (isFrozen.load(std::memory_order_acquire)) {
+            return;
+        }
+        const uint32_t index = recordedTicks.load(std::memory_order_relaxed);
+        const RequestedState requested = requestedState.read();
+        const ReceiverChannels receiver = receiverChannels.read();
+        tick.tick = index;
+        std::memcpy(tick.receiverChannels, receiver.channels, sizeof(tick.receiverChannels));
+        tick.requestedVelocity = requested.velocity;
+        tick.requestedAngularVelocity = requested.angularVelocity;
+        tick.driveTrainState = appliedDriveTrainState;
+        std::memcpy(&buffer[index % CAPACITY], &tick, sizeof(TickRecord));
+        recordedTicks.store(index + 1, std::memory_order_release);
+    }
+
+    void noteReceiverChannels(const float (&channels)[RECEIVER_CHANNEL_COUNT]) {
+        ReceiverChannels receiver{};
+        std::memcpy(receiver.channels, channels, sizeof(receiver.channels));
+        receiverChannels.write(receiver);
+    }
+
+    void noteRequestedState(const float velocity, const float angularVelocity) {
+        requestedState.write({velocity, angularVelocity});
+    }
+
+    void noteDriveTrainState(const COMMON::DriveTrainState& driveTrainState) {
+        appliedDriveTrainState = driveTrainState;
+    }
+
+    void freeze() {
+        isFrozen.store(true, std::memory_order_release);
+    }
+
+    void resume() {
+        dumping = false;
+        isFrozen.store(false, std::memory_order_release);
+    }
+
+    bool frozen() {
+        return isFrozen.load(std::memory_order_acquire);
+    }
+
+    bool latest(TickRecord& tick) {
+        const uint32_t count = recordedTicks.load(std::memory_order_acquire);
+        if (count == 0) {
+            return false;
+        }
+        std::memcpy(&tick, &buffer[(count - 1) % CAPACITY], sizeof(TickRecord));
+        return true;
+    }
+
+    void requestDump() {
+        if (dumping) {
+            return;
+        }
+        freeze();
+        // a tick the estimator was already recording when the freeze landed may still be being copied into
+        // the slot after the newest, which is also the oldest in a full buffer, so that one is left out
+        const uint32_t end = recordedTicks.load(std::memory_order_acquire);
+        const uint32_t count = std::min<uint32_t>(end, CAPACITY - 1);
+        dumpNext = end - count;
+        dumpEnd = end;
+        dumping = true;
+        printf("flight recorder: frozen, dumping %lu ticks\n", (unsigned long) count);
+    }
+
+    bool serviceDump() {
+        if (!dumping) {
+            return false;
+        }
+        while (dumpNext != dumpEnd && TELEMETRY::canEmit(sizeof(TickRecord) + LIVE_TELEMETRY_HEADROOM)) {
+            TELEMETRY::emit(TELEMETRY::RECORD::FLIGHT_RECORD, &buffer[dumpNext % CAPACITY], sizeof(TickRecord));
+            dumpNext++;
+        }
+        if (dumpNext == dumpEnd) {
+            dumping = false;
+            printf("flight recorder: dump complete\n");
+        }
+        return dumping;
+    }
+}
@@ -0,0 +1,199 @@
+#ifndef OSOD_MOTOR_2040_I2C_ENGINE_H
+#define OSOD_MOTOR_2040_I2C_ENGINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+#include "hardware/i2c.h"
+#include "drivetrain_config.h"
+#include "seqlock.h"
+
+namespace I2C_ENGINE {
+
+    enum class Priority : uint8_t {
+        HIGH,
+        NORMAL,
+        LOW,
+    };
+
+    constexpr size_t PRIORITY_COUNT = 3;
+
+    enum class TransferStatus : uint8_t {
+        IDLE,       // never submitted
+        QUEUED,
+        ACTIVE,     // on the bus
+        OK,
+        NACK,       // address or data not acknowledged
+        TIMEOUT,    // still on the bus when its timeout ran out, and aborted
+        EXPIRED,    // not started before its deadline, so never put on the bus
+    };
+
+    struct Transfer;
+
+    // Called once per transfer when it finishes, in whichever context finished it (usually the I2C or
+    // timer interrupt). Keep it short; it may submit further transfers.
+    using CompletionCallback = void (*)(Transfer& transfer);
+
+    // One write-then-read transaction (either half may be empty; a read after a write uses a repeated
+    // start). The caller owns the transfer and its buffers and must keep them alive until it completes.
+    struct Transfer {
+        uint8_t address = 0;
+        const uint8_t* writeData = nullptr;
+        size_t writeLength = 0;
+        uint8_t* readData = nullptr;
+        size_t readLength = 0;
+        Priority priority = Priority::NORMAL;
+        uint32_t deadlineUs = 0;                        // must start within this long of submission, 0 for no limit
+        uint32_t timeoutUs = CONFIG::I2C_TIMEOUT_US;    // bus time allowed once started
+        CompletionCallback callback = nullptr;
+        void* context = nullptr;
+
+        // filled in by the engine
+        volatile TransferStatus status = TransferStatus::IDLE;
+        uint32_t submittedUs = 0;
+        uint32_t startedUs = 0;
+        uint32_t completedUs = 0;
+        Transfer* next = nullptr;
+
+        [[nodiscard]] bool inProgress() const {
+            return status == TransferStatus::QUEUED || status == TransferStatus::ACTIVE;
+        }
+
+        [[nodiscard]] bool succeeded() const {
+            return status == TransferStatus::OK;
+        }
+    };
+
+    struct I2CEngineStats {
+        uint32_t submitted;
+        uint32_t completed;
+        uint32_t failed;
+        uint32_t expired;
+        uint32_t maxQueueDepth;
+        uint32_t maxQueueLatencyUs[PRIORITY_COUNT];     // submission to start on the bus
+        float meanQueueLatencyUs[PRIORITY_COUNT];
+        uint64_t busyUs;
+    };
+
+    class I2CEngine;
+
+    // Puts one transfer at a time on the wire and reports back through I2CEngine::complete().
+    class I2CBackend {
+    public:
+        virtual ~I2CBackend() = default;
+
+        // Called with the engine's lock held, so it must only start the transfer and report completion later.
+        virtual void start(Transfer& transfer) = 0;
+
+        // Abandon the transfer in progress, with the engine's lock held; complete() must not be called for it
+        // afterwards.
+        virtual void abort() = 0;
+
+        // Put the controller back in its idle configuration after the bus has been reinitialised.
+        virtual void reset() = 0;
+
+        // Called from the controller's interrupt through I2CEngine::handleInterrupt(), with the engine's lock
+        // held. Returns ACTIVE while the transfer is still on the bus, otherwise how it finished.
+        virtual TransferStatus handleInterrupt() {
+            return TransferStatus::ACTIVE;
+        }
+    };
+
+    // Owns the backend for the platform being built for (interrupt-driven on the RP2040, simulated
+    // bus time on the host).
+    I2CBackend* createBackend(i2c_inst_t* port, I2CEngine& engine);
+
+    /*
+     * Queued, interrupt-driven I2C master shared by every device on a bus.
+     *
+     * Drivers submit transfers and pick the results up later (or from a completion callback), so the
+     * CPU never waits on the bus. Queued transfers are started highest priority first, in submission
+     * order within a priority. A transfer that has not started by its deadline is dropped rather than
+     * put on the bus late. After a NACK or timeout the queue is held until service() has reinitialised
+     * the bus from task context.
+     *
+     * Code that still needs the SDK's blocking calls (the balance port's ADC driver) must bracket them
+     * with suspend() and resume().
+     *
+     * Transfers can be submitted from either core. The controller's interrupt is only ever taken on the
+     * core that constructed the engine, and its handler runs under the engine's lock, as does the timeout.
+     */
+    class I2CEngine {
+    public:
+        explicit I2CEngine(i2c_inst_t* port);
+
+        // Returns false if the transfer is already queued or on the bus.
+        bool submit(Transfer& transfer);
+
+        // Submit and wait for completion, for drivers whose interface is synchronous.
+        // Returns true if the transfer succeeded.
+        bool transferBlocking(Transfer& transfer);
+
+        // Call regularly from task context: recovers the bus after a failed transfer, and answers showStats().
+        void service();
+
+        // Stop starting transfers and wait for the one on the bus to finish, so the SDK's blocking calls
+        // can use the bus; resume() restarts the queue.
+        void suspend();
+
+        void resume();
+
+        [[nodiscard]] bool idle() const;
+
+        [[nodiscard]] I2CEngineStats stats() const;
+
+        void resetStats();
+
+        // Prints the counters service() last reported and asks it for the next report, which also clears them.
+        // Safe to call from either core; the first call only asks.
+        void showStats();
+
+        // Called by the backend when the active transfer has finished.
+        void complete(TransferStatus status);
+
+        // Called from the controller's interrupt; completes the active transfer if the backend says it has finished.
+        void handleInterrupt();
+
+    private:
+        i2c_inst_t* port;
+        I2CBackend* backend;
+        mutable critical_section_t lock{};
+
+        Transfer* queueHead[PRIORITY_COUNT] = {};
+        Transfer* queueTail[PRIORITY_COUNT] = {};
+        uint32_t queueDepth = 0;
+        Transfer* volatile active = nullptr;
+        alarm_id_t timeoutAlarm = 0;
+        volatile bool recoveryPending = false;
+        volatile bool suspended = false;
+
+        I2CEngineStats statistics{};
+        uint64_t queueLatencySumUs[PRIORITY_COUNT] = {};
+        uint32_t startedCount[PRIORITY_COUNT] = {};
+        // showStats() counts requests up; service() answers each with a report
+        std::atomic<uint32_t> reportRequests{0};
+        uint32_t reportsServed = 0;
+        SeqLock<I2CEngineStats> report;
+
+        // The counters, with the means worked out. The lock must be held.
+        [[nodiscard]] I2CEngineStats snapshot() const;
+
+        // Clears the counters. The lock must be held.
+        void clearStats();
+
+        Transfer* dispatch();
+
+        Transfer* retire(TransferStatus status, Transfer*& expired);
+
+        static void notify(Transfer* transfer, TransferStatus status, Transfer* expired);
+
+        static void finish(Transfer* transfers);
+
+        static int64_t timeoutCallback(alarm_id_t id, void* userData);
+    };
+
+} // I2C_ENGINE
+
+#endif //OSOD_MOTOR_2040_I2C_ENGINE_H
@@ -0,0 +1,55 @@
+// Host backend: the transfer is exchanged with the simulated device as soon as it starts, and completes
+// from a timer interrupt once its bus time has elapsed. The CPU is not charged for the bus time, as with
+// the interrupt-driven controller on the RP2040, so queueing latency and bus occupancy can be measured
+// in the simulation.
+
+#include "i2c_engine.h"
+#include "host_hal.h"
+
+namespace I2C_ENGINE {
+    namespace {
+        class HostBackend : public I2CBackend {
+        public:
+            HostBackend(i2c_inst_t* port, I2CEngine& engine) : port(port), engine(engine) {}
+
+            void start(Transfer& transfer) override {
+                uint64_t busUs = 0;
+                const int result = HOST_HAL::i2cTransaction(port, transfer.address, transfer.writeData,
+                                                            transfer.writeLength, transfer.readData,
+                                                            transfer.readLength, busUs);
+                const size_t expected = transfer.readLength > 0 ? transfer.readLength : transfer.writeLength;
+                status = result == static_cast<int>(expected) ? TransferStatus::OK : TransferStatus::NACK;
+                completionAlarm = add_alarm_in_us(busUs, &HostBackend::completionCallback, this, true);
+            }
+
+            void abort() override {
+                if (completionAlarm != 0) {
+                    cancel_alarm(completionAlarm);
+                    completionAlarm = 0;
+                }
+            }
+
+            void reset() override {
+                abort();
+            }
+
+        private:
+            i2c_inst_t* port;
+            I2CEngine& engine;
+            TransferStatus status = TransferStatus::OK;
+            alarm_id_t completionAlarm = 0;
+
+            static int64_t completionCallback(alarm_id_t, void* userData) {
+                auto* backend = static_cast<HostBackend*>(userData);
+                backend->completionAlarm = 0;
+                backend->engine.complete(backend->status);
+                return 0;
+            }
+        };
+    }
+
+    I2CBackend* createBackend(i2c_inst_t* port, I2CEngine& engine) {
+        return new HostBackend(port, engine);
+    }
+
+} // I2C_ENGINE
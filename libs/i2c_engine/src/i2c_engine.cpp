@@ -0,0 +1,268 @@
+#include <cstdio>
+#include "i2c_engine.h"
+#include "hardware/timer.h"
+#include "utils.h"
+
+namespace I2C_ENGINE {
+
+    I2CEngine::I2CEngine(i2c_inst_t* port) : port(port) {
+        critical_section_init(&lock);
+        backend = createBackend(port, *this);
+    }
+
+    bool I2CEngine::submit(Transfer& transfer) {
+        critical_section_enter_blocking(&lock);
+        if (transfer.inProgress()) {
+            critical_section_exit(&lock);
+            return false;
+        }
+        const auto priority = static_cast<size_t>(transfer.priority);
+        transfer.status = TransferStatus::QUEUED;
+        transfer.submittedUs = time_us_32();
+        transfer.next = nullptr;
+        if (queueTail[priority] == nullptr) {
+            queueHead[priority] = &transfer;
+        } else {
+            queueTail[priority]->next = &transfer;
+        }
+        queueTail[priority] = &transfer;
+        queueDepth++;
+        statistics.submitted++;
+        if (queueDepth > statistics.maxQueueDepth) {
+            statistics.maxQueueDepth = queueDepth;
+        }
+        Transfer* expired = dispatch();
+        critical_section_exit(&lock);
+        finish(expired);
+        return true;
+    }
+
+    bool I2CEngine::transferBlocking(Transfer& transfer) {
+        if (!submit(transfer)) {
+            return false;
+        }
+        while (transfer.inProgress()) {
+            service();
+            busy_wait_us_32(1);
+        }
+        return transfer.succeeded();
+    }
+
+    Transfer* I2CEngine::dispatch() {
+        // called with the lock held; returns the transfers that expired while waiting so their callbacks can
+        // be run once the lock has been released
+        Transfer* expired = nullptr;
+        if (active != nullptr || suspended || recoveryPending) {
+            return expired;
+        }
+        const uint32_t now = time_us_32();
+        for (size_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+            while (queueHead[priority] != nullptr) {
+                Transfer* transfer = queueHead[priority];
+                queueHead[priority] = transfer->next;
+                if (queueHead[priority] == nullptr) {
+                    queueTail[priority] = nullptr;
+                }
+                queueDepth--;
+
+                const uint32_t waitedUs = now - transfer->submittedUs;
+                if (transfer->deadlineUs != 0 && waitedUs > transfer->deadlineUs) {
+                    transfer->completedUs = now;
+                    transfer->next = expired;
+                    expired = transfer;
+                    statistics.expired++;
+                    continue;
+                }
+
+                transfer->startedUs = now;
+                transfer->next = nullptr;
+                transfer->status = TransferStatus::ACTIVE;
+                queueLatencySumUs[priority] += waitedUs;
+                startedCount[priority]++;
+                if (waitedUs > statistics.maxQueueLatencyUs[priority]) {
+                    statistics.maxQueueLatencyUs[priority] = waitedUs;
+                }
+                active = transfer;
+                timeoutAlarm = add_alarm_in_us(transfer->timeoutUs, &I2CEngine::timeoutCallback, this, true);
+                backend->start(*transfer);
+                return expired;
+            }
+        }
+        return expired;
+    }
+
+    void I2CEngine::finish(Transfer* transfers) {
+        while (transfers != nullptr) {
+            Transfer* transfer = transfers;
+            transfers = transfer->next;
+            transfer->next = nullptr;
+            transfer->status = TransferStatus::EXPIRED;
+            if (transfer->callback != nullptr) {
+                transfer->callback(*transfer);
+            }
+        }
+    }
+
+    Transfer* I2CEngine::retire(const TransferStatus status, Transfer*& expired) {
+        // called with the lock held; takes the active transfer off the bus and starts the next, leaving the
+        // callbacks to notify() once the lock has been released
+        Transfer* transfer = active;
+        expired = nullptr;
+        if (transfer == nullptr) {
+            return nullptr;
+        }
+        active = nullptr;
+        if (timeoutAlarm != 0) {
+            cancel_alarm(timeoutAlarm);
+            timeoutAlarm = 0;
+        }
+        const uint32_t now = time_us_32();
+        transfer->completedUs = now;
+        statistics.busyUs += now - transfer->startedUs;
+        if (status == TransferStatus::OK) {
+            statistics.completed++;
+        } else {
+            // hold the queue until service() has reinitialised the bus
+            statistics.failed++;
+            recoveryPending = true;
+        }
+        expired = dispatch();
+        return transfer;
+    }
+
+    void I2CEngine::notify(Transfer* transfer, const TransferStatus status, Transfer* expired) {
+        if (transfer != nullptr) {
+            transfer->status = status;
+            if (transfer->callback != nullptr) {
+                transfer->callback(*transfer);
+            }
+        }
+        finish(expired);
+    }
+
+    void I2CEngine::complete(const TransferStatus status) {
+        critical_section_enter_blocking(&lock);
+        Transfer* expired;
+        Transfer* transfer = retire(status, expired);
+        critical_section_exit(&lock);
+        notify(transfer, status, expired);
+    }
+
+    void I2CEngine::handleInterrupt() {
+        critical_section_enter_blocking(&lock);
+        const TransferStatus status = backend->handleInterrupt();
+        Transfer* expired = nullptr;
+        Transfer* transfer = status == TransferStatus::ACTIVE ? nullptr : retire(status, expired);
+        critical_section_exit(&lock);
+        notify(transfer, status, expired);
+    }
+
+    int64_t I2CEngine::timeoutCallback(alarm_id_t id, void* userData) {
+        auto* engine = static_cast<I2CEngine*>(userData);
+        critical_section_enter_blocking(&engine->lock);
+        Transfer* expired = nullptr;
+        Transfer* transfer = nullptr;
+        if (engine->active != nullptr && engine->timeoutAlarm == id) {
+            // aborted and retired under one hold of the lock, so the controller's interrupt can't finish it too
+            engine->backend->abort();
+            engine->timeoutAlarm = 0;
+            transfer = engine->retire(TransferStatus::TIMEOUT, expired);
+        }
+        critical_section_exit(&engine->lock);
+        notify(transfer, TransferStatus::TIMEOUT, expired);
+        return 0;
+    }
+
+    void I2CEngine::service() {
+        const uint32_t requests = reportRequests.load(std::memory_order_acquire);
+        if (requests != reportsServed) {
+            reportsServed = requests;
+            critical_section_enter_blocking(&lock);
+            const I2CEngineStats counters = snapshot();
+            clearStats();
+            critical_section_exit(&lock);
+            report.write(counters);
+        }
+        if (!recoveryPending || suspended || active != nullptr) {
+            return;
+        }
+        handleI2CError(port);
+        backend->reset();
+
+        critical_section_enter_blocking(&lock);
+        recoveryPending = false;
+        Transfer* expired = dispatch();
+        critical_section_exit(&lock);
+        finish(expired);
+    }
+
+    void I2CEngine::suspend() {
+        critical_section_enter_blocking(&lock);
+        suspended = true;
+        critical_section_exit(&lock);
+        while (active != nullptr) {
+            busy_wait_us_32(1);
+        }
+    }
+
+    void I2CEngine::resume() {
+        critical_section_enter_blocking(&lock);
+        suspended = false;
+        Transfer* expired = dispatch();
+        critical_section_exit(&lock);
+        finish(expired);
+    }
+
+    bool I2CEngine::idle() const {
+        return active == nullptr && queueDepth == 0;
+    }
+
+    I2CEngineStats I2CEngine::snapshot() const {
+        I2CEngineStats counters = statistics;
+        for (size_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+            counters.meanQueueLatencyUs[priority] = startedCount[priority] == 0 ? 0.0f :
+                    static_cast<float>(queueLatencySumUs[priority]) / static_cast<float>(startedCount[priority]);
+        }
+        return counters;
+    }
+
+    void I2CEngine::clearStats() {
+        statistics = {};
+        for (size_t priority = 0; priority < PRIORITY_COUNT; priority++) {
+            queueLatencySumUs[priority] = 0;
+            startedCount[priority] = 0;
+        }
+    }
+
+    I2CEngineStats I2CEngine::stats() const {
+        critical_section_enter_blocking(&lock);
+        const I2CEngineStats counters = snapshot();
+        critical_section_exit(&lock);
+        return counters;
+    }
+
+    void I2CEngine::resetStats() {
+        critical_section_enter_blocking(&lock);
+        clearStats();
+        critical_section_exit(&lock);
+    }
+
+    void I2CEngine::showStats() {
+        I2CEngineStats counters;
+        const bool reported = report.read(counters) != 0;
+        reportRequests.store(reportRequests.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        if (!reported) {
+            return;
+        }
+        printf("i2c: %lu submitted, %lu completed, %lu failed, %lu expired, max depth %lu, "
+               "queue latency high %.0f/%lu normal %.0f/%lu low %.0f/%lu us (mean/max), busy %llu us\n",
+               (unsigned long) counters.submitted, (unsigned long) counters.completed,
+               (unsigned long) counters.failed, (unsigned long) counters.expired,
+               (unsigned long) counters.maxQueueDepth,
+               counters.meanQueueLatencyUs[0], (unsigned long) counters.maxQueueLatencyUs[0],
+               counters.meanQueueLatencyUs[1], (unsigned long) counters.maxQueueLatencyUs[1],
+               counters.meanQueueLatencyUs[2], (unsigned long) counters.maxQueueLatencyUs[2],
+               (unsigned long long) counters.busyUs);
+    }
+
+} // I2C_ENGINE
@@ -0,0 +1,169 @@
+// Interrupt-driven backend for the RP2040's I2C controller. The TX FIFO is kept topped up with write
+// and read commands from the I2C interrupt, and read data is drained from the RX FIFO as it arrives, so
+// the CPU only spends a few microseconds per FIFO's worth of bytes rather than waiting out the transfer.
+//
+// The IRQ is enabled once, in the NVIC of the core that constructs the engine, and transfers are started and
+// stopped only through the controller's interrupt mask. A transfer submitted from the other core then still
+// completes on the one core, and the handler runs under the engine's lock.
+
+#include "i2c_engine.h"
+#include "hardware/irq.h"
+#include "hardware/regs/i2c.h"
+#include "hardware/structs/i2c.h"
+
+namespace I2C_ENGINE {
+    namespace {
+        constexpr uint32_t FIFO_DEPTH = 16;
+
+        class Rp2040Backend : public I2CBackend {
+        public:
+            Rp2040Backend(i2c_inst_t* port, I2CEngine& engine);
+
+            void start(Transfer& transfer) override;
+
+            void abort() override;
+
+            void reset() override;
+
+            TransferStatus handleInterrupt() override;
+
+        private:
+            i2c_inst_t* port;
+            i2c_hw_t* hw;
+            uint irqNumber;
+            Transfer* transfer = nullptr;
+            size_t commandsIssued = 0;
+            size_t bytesRead = 0;
+
+            void fillTxFifo();
+
+            void drainRxFifo();
+
+            void stop();
+        };
+
+        I2CEngine* engines[2] = {};
+
+        void i2c0Handler() {
+            engines[0]->handleInterrupt();
+        }
+
+        void i2c1Handler() {
+            engines[1]->handleInterrupt();
+        }
+
+        Rp2040Backend::Rp2040Backend(i2c_inst_t* port, I2CEngine& engine)
+                : port(port), hw(i2c_get_hw(port)) {
+            const uint index = i2c_hw_index(port);
+            irqNumber = index == 0 ? I2C0_IRQ : I2C1_IRQ;
+            engines[index] = &engine;
+            reset();
+            irq_set_exclusive_handler(irqNumber, index == 0 ? i2c0Handler : i2c1Handler);
+            irq_set_enabled(irqNumber, true);
+        }
+
+        void Rp2040Backend::reset() {
+            // the controller comes out of reset with most interrupts unmasked; only take them during a transfer
+            hw->intr_mask = 0;
+            hw->rx_tl = 0;
+            hw->tx_tl = 0;
+        }
+
+        void Rp2040Backend::start(Transfer& newTransfer) {
+            transfer = &newTransfer;
+            commandsIssued = 0;
+            bytesRead = 0;
+
+            hw->enable = 0;
+            hw->tar = newTransfer.address;
+            hw->enable = 1;
+            (void) hw->clr_intr;
+
+            fillTxFifo();
+            hw->intr_mask = I2C_IC_INTR_MASK_M_TX_EMPTY_BITS | I2C_IC_INTR_MASK_M_RX_FULL_BITS |
+                            I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+        }
+
+        void Rp2040Backend::fillTxFifo() {
+            const size_t total = transfer->writeLength + transfer->readLength;
+            while (commandsIssued < total && hw->txflr < FIFO_DEPTH) {
+                const bool isRead = commandsIssued >= transfer->writeLength;
+                // don't ask for more bytes than the RX FIFO can hold before we drain it
+                if (isRead && (commandsIssued - transfer->writeLength) - bytesRead >= FIFO_DEPTH) {
+                    break;
+                }
+                uint32_t command = 0;
+                if (isRead) {
+                    command |= I2C_IC_DATA_CMD_CMD_BITS;
+                    if (commandsIssued == transfer->writeLength && transfer->writeLength > 0) {
+                        command |= I2C_IC_DATA_CMD_RESTART_BITS;
+                    }
+                } else {
+                    command |= transfer->writeData[commandsIssued];
+                }
+                if (commandsIssued == total - 1) {
+                    command |= I2C_IC_DATA_CMD_STOP_BITS;
+                }
+                hw->data_cmd = command;
+                commandsIssued++;
+            }
+            if (commandsIssued == total) {
+                hw_clear_bits(&hw->intr_mask, I2C_IC_INTR_MASK_M_TX_EMPTY_BITS);
+            }
+        }
+
+        void Rp2040Backend::drainRxFifo() {
+            while (hw->rxflr > 0 && bytesRead < transfer->readLength) {
+                transfer->readData[bytesRead++] = static_cast<uint8_t>(hw->data_cmd & I2C_IC_DATA_CMD_DAT_BITS);
+            }
+        }
+
+        void Rp2040Backend::stop() {
+            hw->intr_mask = 0;
+            transfer = nullptr;
+        }
+
+        void Rp2040Backend::abort() {
+            if (transfer == nullptr) {
+                return;
+            }
+            hw_set_bits(&hw->enable, I2C_IC_ENABLE_ABORT_BITS);
+            stop();
+        }
+
+        TransferStatus Rp2040Backend::handleInterrupt() {
+            const uint32_t status = hw->intr_stat;
+            if (transfer == nullptr) {
+                hw->intr_mask = 0;
+                return TransferStatus::ACTIVE;
+            }
+            if (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+                (void) hw->clr_tx_abrt;
+                (void) hw->clr_stop_det;
+                stop();
+                return TransferStatus::NACK;
+            }
+            if (status & I2C_IC_INTR_STAT_R_RX_FULL_BITS) {
+                drainRxFifo();
+            }
+            if (status & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+                (void) hw->clr_stop_det;
+                drainRxFifo();
+                const bool done = commandsIssued == transfer->writeLength + transfer->readLength
+                                  && bytesRead == transfer->readLength;
+                stop();
+                return done ? TransferStatus::OK : TransferStatus::NACK;
+            }
+            // refill on TX_EMPTY, and after draining in case reads were held back for RX FIFO space
+            if (commandsIssued < transfer->writeLength + transfer->readLength) {
+                fillTxFifo();
+            }
+            return TransferStatus::ACTIVE;
+        }
+    }
+
+    I2CBackend* createBackend(i2c_inst_t* port, I2CEngine& engine) {
+        return new Rp2040Backend(port, engine);
+    }
+
+} // I2C_ENGINE
@@ -10,6 +10,7 @@
 #include <cstdio>
 #include <functional>
 #include "types.h"
+#include "fast_math.h"
 
 /**
  * @brief Returns the sign of a value
@@ -111,14 +112,14 @@ namespace MIXER {
             // if we're stationary, the angle is calculated from the wheelbase and turn radius
             // we'll still constrain it to the maximum steering angle, but we won't apply any slip
             // TODO: is this correct?
-            result.raw = std::atan2(wheelBase, wheelTurnRadius);;
+            result.raw = FAST_MATH::atan2(wheelBase, wheelTurnRadius);
             result.constrained = result.raw;
             result.slip = 0;
             return result;
         }
         // if we're moving, the angle is calculated from the wheelbase and turn radius
 
-        result.raw = std::atan(wheelBase / wheelTurnRadius);
+        result.raw = FAST_MATH::atan(wheelBase / wheelTurnRadius);
         if (side == CONFIG::Handedness::LEFT) {
             result.raw = -result.raw;
         }
@@ -138,13 +139,13 @@ namespace MIXER {
 
     float AckermannMixer::getFrontWheelSpeed(float angularVelocity, const float wheelTurnRadius, const float slipAngle,
                                              CONFIG::Handedness side) const {
-        float tmpSpeed = angularVelocity * std::sqrt(wheelTurnRadius * wheelTurnRadius + wheelBase * wheelBase);
+        float tmpSpeed = angularVelocity * FAST_MATH::hypot(wheelTurnRadius, wheelBase);
         tmpSpeed = tmpSpeed * sign(wheelTurnRadius);
         if (side == CONFIG::Handedness::RIGHT) {
             tmpSpeed = -tmpSpeed;
         }
         // return modified speeds to correct for limited steering
-        return tmpSpeed * std::cos(slipAngle);
+        return tmpSpeed * FAST_MATH::cos(slipAngle);
     }
 
 } // namespace MIXER
\ No newline at end of file
@@ -1,15 +1,13 @@
 #include "receiver.h"
 #include "statemanager.h"
 #include "types.h"
-#include "interfaces.h"
 #include "drivetrain_config.h"
 #include "types.h"
-#include "interfaces.h"
 #include "drivetrain_config.h"
 #include "waypoint_navigation.h"
 
 using namespace COMMON;
-class Navigator: public Observer {
+class Navigator {
 public:
     explicit Navigator(const Receiver* receiver, 
                         STATEMANAGER::StateManager *stateManager,
@@ -21,8 +19,6 @@ public:
 
     NAVIGATION_MODE::Mode navigationMode;
 
-    void update(const VehicleState newState) override;
-
 
 private:
     const Receiver *receiver{};
@@ -32,16 +28,23 @@ private:
     STATE_ESTIMATOR::StateEstimator* pStateEstimator;
 
     VehicleState current_state;
+    uint32_t current_state_us = 0; // when current_state was estimated
     float waypointModeThreshold = 0; //if signal above this, we're move into waypoint mode
     float waypointIndexThreshold = 0.5; //if signal above this, reset the waypoint index
     float setHeadingThreshold = -0.5; //if signal below this, set the heading
     float setOriginThreshold = 0.5; //if signal above this, set the odometry origin
+    static constexpr int dumpGestureFlicks = 3; //flicks of AUX into waypoint mode that dump the flight recorder...
+    uint32_t dumpGestureWindowUs = 2000000; //...if they all happen within this time
+    uint32_t auxFlickTimesUs[dumpGestureFlicks] = {};
+    int auxFlickCount = 0;
+    bool lastAuxHigh = false;
     float expo(float signal, float expoValue); // apply an exponential response to the channel
     float velocityExpoValue = 0.7;
     float steeringExpoValue = 0.7;
     bool shouldResetWaypointIndex(float signal);
     bool shouldSetHeading(float signal);
     bool shouldSetOdometryOrigin(float signal);
+    bool isDumpGesture(float signal); //true when the AUX switch has just completed the flight recorder dump gesture
     void setHeading(); //local method that's linked to the stateEstimator set_Heading_Offset method
     void setOrigin(); //local method that's linked to the stateEstimator set_Odometry_Offset method
     NAVIGATION_MODE::Mode parseTxSignals(const ReceiverChannelValues& signals); //function to use "spare" transmitter channels as auxiliary inputs
@@ -3,6 +3,8 @@
 #include "statemanager.h"
 #include "state_estimator.h"
 #include "types.h"
+#include "profiler.h"
+#include "flight_recorder.h"
 #include "drivetrain_config.h"
 #include "waypoint_navigation.h"
 #include "types.h"
@@ -19,9 +21,16 @@ Navigator::Navigator(const Receiver* receiver,
 }
 
 void Navigator::navigate() {
+    PROFILE_STAGE(NAVIGATE);
+    // pull the latest estimate rather than being notified of it, so the estimator can run on the other core
+    current_state_us = pStateEstimator->estimate().read(current_state).timestampUs;
+
     if (receiver->get_receiver_data()) {
 
         ReceiverChannelValues values = receiver->get_channel_values();
+        const float channels[FLIGHT_RECORDER::RECEIVER_CHANNEL_COUNT] = {
+                values.AIL, values.ELE, values.THR, values.RUD, values.AUX, values.NC};
+        FLIGHT_RECORDER::noteReceiverChannels(channels);
 
         NAVIGATION_MODE::Mode newMode;
         //check if the extra Tx channels should trigger anything
@@ -33,7 +42,7 @@ void Navigator::navigate() {
         STATE_ESTIMATOR::VehicleState requestedState{};
         switch (navigationMode) {
         case NAVIGATION_MODE::WAYPOINT:
-            waypointNavigator.navigate(current_state);
+            waypointNavigator.navigate(current_state, current_state_us);
             requestedState.velocity.velocity = driveDirection * waypointNavigator.desiredV;
             requestedState.velocity.angular_velocity = waypointNavigator.desiredW;
             break;
@@ -70,10 +79,6 @@ bool Navigator::shouldResetWaypointIndex(float signal){
     return (signal > waypointIndexThreshold);
 }
 
-void Navigator::update(const VehicleState newState) {
-    current_state = newState;
-}
-
 bool Navigator::shouldSetHeading(float signal){
     return (signal < setHeadingThreshold);
 }
@@ -105,9 +110,35 @@ NAVIGATION_MODE::Mode Navigator::parseTxSignals(const ReceiverChannelValues& sig
             printf("setting current position as zero for odometry.\n");
             setOrigin();
         }
+        if (isDumpGesture(signals.AUX)){
+            printf("AUX gesture, dumping the flight recorder.\n");
+            FLIGHT_RECORDER::requestDump();
+        }
         return determineMode(signals.AUX);
 }
 
+bool Navigator::isDumpGesture(float signal){
+    // the gesture is dumpGestureFlicks flicks of the AUX switch up into waypoint mode within
+    // dumpGestureWindowUs, timed from the first flick
+    bool auxHigh = signal > waypointModeThreshold;
+    bool flicked = auxHigh && !lastAuxHigh;
+    lastAuxHigh = auxHigh;
+    if (!flicked) {
+        return false;
+    }
+    uint32_t now = time_us_32();
+    for (int i = 0; i < dumpGestureFlicks - 1; i++) {
+        auxFlickTimesUs[i] = auxFlickTimesUs[i + 1];
+    }
+    auxFlickTimesUs[dumpGestureFlicks - 1] = now;
+    auxFlickCount++;
+    if (auxFlickCount >= dumpGestureFlicks && now - auxFlickTimesUs[0] <= dumpGestureWindowUs) {
+        auxFlickCount = 0;
+        return true;
+    }
+    return false;
+}
+
 float Navigator::expo(float input, float expoValue) {
     return input * (abs(input) * expoValue + (1.0f - expoValue));
 }
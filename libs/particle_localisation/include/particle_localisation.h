@@ -0,0 +1,174 @@
+#ifndef OSOD_MOTOR_2040_PARTICLE_LOCALISATION_H
+#define OSOD_MOTOR_2040_PARTICLE_LOCALISATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include "drivetrain_config.h"
+#include "types.h"
+
+/*
+ * Particle filter for the robot's pose against a map of the arena's walls.
+ *
+ * The map is a list of line segments (CONFIG::arenaMap), so the arena can be any shape. Each particle is
+ * a guess at the pose. predict() moves every particle by the wheel distance and the turn over the tick,
+ * each with its own noise. correct() scores every particle by how well it explains the IMU heading and
+ * the ToF ranges. For the ranges, each of the four beams is ray-cast from where its sensor is mounted on
+ * that particle, and the nearest wall it hits gives the range the particle expects.
+ *
+ * Obstacles that are not in the map, like barrels, mines or another robot, make a return shorter than the
+ * map predicts. A short return is cheap, with its cost capped at shortCost. A return longer than the map
+ * allows means the beam went through a wall, so its cap, longCost, is higher.
+ *
+ * The filter is built for a core without an FPU:
+ * - Positions are held in 1/16 mm and headings as binary angles.
+ * - Each particle's score is a cost, its negative log likelihood in 1/256 nats. A cost is turned into a
+ *   weight through a table rather than an exp().
+ * - There is one table sin/cos pair per particle per predict, and one per particle per correct.
+ * - A ray cast is 32-bit integer arithmetic plus one hardware divide per wall hit.
+ * - Float is only used once per call, to set up the noise, and in estimate().
+ *
+ * The filter never allocates. Its particles live in a StaticParticleLocaliser<CAPACITY>, which holds room
+ * for CAPACITY of them (no more than MAX_PARTICLES), so an owner that doesn't use the filter can build it
+ * with room for one. The particle count is fixed when the filter is built, up to that capacity.
+ * Resampling is adaptive. It only happens when the effective number of particles falls below
+ * resampleFraction of the count, so a correction that says little doesn't throw away the spread.
+ * Map coordinates and particles are kept within MAP_LIMIT_MM of the arena centre, which keeps the ray
+ * cast's products within 32 bits.
+ */
+
+namespace PARTICLE_LOCALISATION {
+    constexpr size_t MAX_PARTICLES = 512;
+    constexpr int32_t MAP_LIMIT_MM = 3000;
+
+    // All standard deviations unless noted.
+    struct Config {
+        float motionSlip = 0.05f;       // wheel distance error, as a fraction of the distance travelled
+        float motionFloor = 0.001f;     // m per predict, on top of the slip
+        float turnSlip = 0.05f;         // turn error, as a fraction of the turn
+        float turnFloor = 0.002f;       // rad per predict, on top of the slip
+        float imuHeading = 0.02f;       // rad, no less than 0.003
+        float tofRange = 0.03f;         // m, no less than 0.005
+        float shortCost = 2.0f;         // nats; the most a return short of the map costs
+        float longCost = 6.0f;          // nats; the most a return past the map costs
+        float resampleFraction = 0.5f;  // resample when the effective count falls below this share of the count
+        float initialPosition = 0.1f;   // m
+        float initialHeading = 0.1f;    // rad
+    };
+
+    struct Estimate {
+        COMMON::Pose pose;          // weighted mean of the particles
+        float positionSpread;       // m, weighted standard deviation of the positions, x and y together
+        float headingSpread;        // rad, circular standard deviation of the headings
+        float effectiveParticles;   // from the last correction's weights, before any resampling
+        COMMON::PoseCovariance covariance;  // weighted, with the heading's from headingSpread
+    };
+
+    struct Stats {
+        uint32_t corrections;
+        uint32_t resamples;
+        uint32_t raysCast;
+        uint32_t raysMissed;    // cast rays that hit no wall within the sensor's range
+    };
+
+    class ParticleLocaliser {
+    public:
+        struct Particle {
+            int32_t x;          // 1/16 mm
+            int32_t y;          // 1/16 mm
+            uint32_t heading;   // binary angle, 2³² to the turn
+            uint32_t cost;      // 1/256 nats
+        };
+
+        ParticleLocaliser(const ParticleLocaliser&) = delete;
+        ParticleLocaliser& operator=(const ParticleLocaliser&) = delete;
+
+        // Scatters the particles around pose with the given spreads, all equally weighted.
+        void reset(const COMMON::Pose& pose, float positionSpread, float headingSpread);
+
+        // distance is the wheel odometry's travel since the last predict in metres, turn the heading change
+        // over it in radians. Each particle moves along its heading halfway through its turn.
+        void predict(float distance, float turn);
+
+        // heading is the IMU's yaw with the heading offset applied, or NaN if there is none this tick.
+        // ranges are ToF distances from the robot centre, indexed like FourToFDistances, with NaN for a sensor
+        // that has nothing new or usable. lag is how far the robot has moved since they were taken
+        // (PoseHistory::motionSince), so each particle is scored from where it was then. Resamples if the
+        // weights have collapsed.
+        void correct(float heading, const float (&ranges)[COMMON::NUM_TOF_SENSORS], const COMMON::Pose& lag = {});
+
+        // Moves every particle by the given amounts, as requested odometry offsets do.
+        void shift(float dx, float dy, float dHeading);
+
+        [[nodiscard]] Estimate estimate() const;
+
+        [[nodiscard]] Stats stats() const { return counters; }
+
+        // The cost, in nats, that the last correction added to the particles, averaged over their weights
+        // before it: how badly the filter as a whole explains the measurement. While the errors are inside the
+        // caps, twice it is the squared innovation over the measurement's variance, with the particles' own
+        // spread included. A range whose cost reaches shortCost looks like an obstacle to most particles.
+        [[nodiscard]] float surprise() const { return lastSurprise; }
+
+        [[nodiscard]] size_t count() const { return particleCount; }
+
+        [[nodiscard]] bool hasMap() const { return segmentCount > 0; }
+
+        Config config;
+
+    protected:
+        // sets are the live set and the one resampling fills, and weights holds one per particle, each with room
+        // for capacity particles. The rest is as for StaticParticleLocaliser.
+        ParticleLocaliser(Particle* liveSet, Particle* spareSet, uint32_t* weights, size_t capacity,
+                          const COMMON::MapSegment* map, size_t segments, size_t count,
+                          CONFIG::SteeringStyle driveDirection, const Config& config, uint32_t seed);
+
+    private:
+        const COMMON::MapSegment* map;
+        size_t segmentCount;
+        size_t particleCount;
+        int32_t driveDirection;
+        uint32_t chassisOffset;     // the sensors face backwards when driving as a forklift
+        uint32_t random;
+        Particle* const particles[2];   // the live set and the one resampling fills
+        uint32_t* const weights;        // Q16, from each particle's cost after the last correction
+        size_t live = 0;
+        float effective;
+        float lastSurprise = 0.0f;
+        Stats counters{};
+
+        uint32_t nextRandom();
+
+        // Triangular noise in [-1, 1) as Q16, with a standard deviation of 1/√6.
+        int32_t triangular();
+
+        // The distance in mm from (x, y) in mm along the Q14 direction (dx, dy) to the nearest wall, or limit
+        // if no wall is hit before it.
+        [[nodiscard]] int32_t castRay(int32_t x, int32_t y, int32_t dx, int32_t dy, int32_t limit) const;
+
+        void resample(uint32_t totalWeight);
+    };
+
+    template<size_t CAPACITY>
+    struct ParticleStorage {
+        static_assert(CAPACITY >= 1 && CAPACITY <= MAX_PARTICLES, "particle capacity is 1 to MAX_PARTICLES");
+
+        ParticleLocaliser::Particle particleSets[2][CAPACITY] = {};
+        uint32_t particleWeights[CAPACITY] = {};
+    };
+
+    // A particle filter with room for CAPACITY particles. The storage is a base listed first, so it is in place
+    // before the filter scatters its particles into it.
+    template<size_t CAPACITY>
+    class StaticParticleLocaliser : private ParticleStorage<CAPACITY>, public ParticleLocaliser {
+    public:
+        // map is in mm from the arena centre, and must outlive the filter. count is clamped to [1, CAPACITY].
+        // driveDirection turns the motion and the sensors round when driving as a forklift.
+        StaticParticleLocaliser(const COMMON::MapSegment* map, const size_t segments, const size_t count,
+                                const CONFIG::SteeringStyle driveDirection, const Config& config = Config(),
+                                const uint32_t seed = 1)
+                : ParticleLocaliser(this->particleSets[0], this->particleSets[1], this->particleWeights, CAPACITY,
+                                    map, segments, count, driveDirection, config, seed) {}
+    };
+}
+
+#endif //OSOD_MOTOR_2040_PARTICLE_LOCALISATION_H
@@ -0,0 +1,374 @@
+#include "particle_localisation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "fast_math.h"
+
+namespace PARTICLE_LOCALISATION {
+    using COMMON::NUM_TOF_SENSORS;
+    using FAST_MATH::BinaryAngle;
+
+    namespace {
+        constexpr float POSITION_SCALE = 16000.0f;     // 1/16 mm to the metre
+        constexpr int32_t POSITION_LIMIT = MAP_LIMIT_MM * 16;
+        constexpr float COST_SCALE = 256.0f;           // 1/256 nats to the nat
+        constexpr float RAW_PER_RADIAN = 4294967296.0f / (2.0f * static_cast<float>(M_PI));
+        constexpr float SQRT6 = 2.4494897f;            // triangular noise on [-1, 1) has a variance of 1/6
+        constexpr float MAX_STEP = 0.5f;               // m per predict, which keeps the step products within 32 bits
+        constexpr int32_t MAX_STEP_NOISE = 8000;       // 1/16 mm, likewise
+        constexpr int32_t MAX_NOISE = 32767;           // amplitudes the Q16 noise multiplies by
+        constexpr int32_t MAX_RANGE_ERROR = 8000;      // mm
+
+        // indexed like FourToFDistances
+        const int32_t SENSOR_OFFSET_MM[NUM_TOF_SENSORS] = {
+                static_cast<int32_t>(CONFIG::TOF_FRONT_OFFSET * 1000.0f),
+                static_cast<int32_t>(CONFIG::TOF_RIGHT_OFFSET * 1000.0f),
+                static_cast<int32_t>(CONFIG::TOF_REAR_OFFSET * 1000.0f),
+                static_cast<int32_t>(CONFIG::TOF_LEFT_OFFSET * 1000.0f)};
+
+        // Weights are exp(-cost) in Q16, looked up in steps of 1/16 nat. Costs are held at COST_LIMIT, where
+        // the weight has rounded to zero.
+        constexpr size_t EXP_STEPS = 256;
+        constexpr uint32_t COST_LIMIT = EXP_STEPS * 16 - 1;
+
+        constexpr struct ExpTable {
+            uint32_t entries[EXP_STEPS];
+
+            constexpr ExpTable() : entries() {
+                // exp(-1/16) from its series, then each entry is the last one times that
+                double step = 1.0;
+                double term = 1.0;
+                for (int n = 1; n < 12; n++) {
+                    term *= -1.0 / 16.0 / n;
+                    step += term;
+                }
+                double value = 65536.0;
+                for (size_t i = 0; i < EXP_STEPS; i++) {
+                    entries[i] = static_cast<uint32_t>(value + 0.5);
+                    value *= step;
+                }
+            }
+        } EXP;
+
+        static_assert(EXP.entries[0] == 65536 && EXP.entries[16] == 24109 && EXP.entries[EXP_STEPS - 1] == 0,
+                      "weights must be exp(-k/16) in Q16");
+
+        int32_t clampPosition(const int32_t position) {
+            return std::clamp(position, -POSITION_LIMIT, POSITION_LIMIT);
+        }
+
+        int32_t amplitude(const float sigma, const float scale, const int32_t limit) {
+            return static_cast<int32_t>(std::fmin(SQRT6 * sigma * scale, static_cast<float>(limit)));
+        }
+
+        // Quadratic cost (e/σ)²/2 in 1/256 nats, for an error already multiplied by 16·2¹⁶/σ, capped at cap.
+        uint32_t quadraticCost(const int32_t error, const int32_t inverseSigma, const uint32_t cap) {
+            const int32_t scaled = (error * inverseSigma) >> 16;
+            return std::min(static_cast<uint32_t>(scaled * scaled) >> 1, cap);
+        }
+
+        uint32_t costFromNats(const float nats) {
+            return static_cast<uint32_t>(std::fmin(nats * COST_SCALE, static_cast<float>(COST_LIMIT)));
+        }
+    }
+
+    ParticleLocaliser::ParticleLocaliser(Particle* liveSet, Particle* spareSet, uint32_t* weights,
+                                         const size_t capacity, const COMMON::MapSegment* map, const size_t segments,
+                                         const size_t count, const CONFIG::SteeringStyle driveDirection,
+                                         const Config& config, const uint32_t seed)
+            : config(config), map(map), segmentCount(map == nullptr ? 0 : segments),
+              particleCount(std::clamp<size_t>(count, 1, capacity)),
+              driveDirection(static_cast<int32_t>(driveDirection)),
+              chassisOffset(driveDirection == CONFIG::Forklift ? BinaryAngle::HALF_TURN : 0),
+              random(seed == 0 ? 1 : seed), particles{liveSet, spareSet}, weights(weights),
+              effective(static_cast<float>(particleCount)) {
+        for (size_t i = 0; i < segmentCount; i++) {
+            const COMMON::MapSegment& segment = map[i];
+            if (std::abs(segment.x0) > MAP_LIMIT_MM || std::abs(segment.y0) > MAP_LIMIT_MM ||
+                std::abs(segment.x1) > MAP_LIMIT_MM || std::abs(segment.y1) > MAP_LIMIT_MM) {
+                printf("Particle localiser: map segment %u is outside +/-%ld mm, ignoring the map\n", (unsigned) i,
+                       (long) MAP_LIMIT_MM);
+                segmentCount = 0;
+                break;
+            }
+        }
+        reset({0.0f, 0.0f, 0.0f}, config.initialPosition, config.initialHeading);
+    }
+
+    uint32_t ParticleLocaliser::nextRandom() {
+        // xorshift32
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+
+    int32_t ParticleLocaliser::triangular() {
+        // the sum of the two halves of one draw
+        const uint32_t draw = nextRandom();
+        return static_cast<int32_t>(draw >> 16) + static_cast<int32_t>(draw & 0xffffu) - 65536;
+    }
+
+    void ParticleLocaliser::reset(const COMMON::Pose& pose, const float positionSpread, const float headingSpread) {
+        const auto x = static_cast<int32_t>(pose.x * POSITION_SCALE);
+        const auto y = static_cast<int32_t>(pose.y * POSITION_SCALE);
+        const uint32_t heading = BinaryAngle::fromRadians(pose.heading).raw();
+        const int32_t positionNoise = amplitude(positionSpread, POSITION_SCALE, MAX_NOISE);
+        const int32_t headingNoise = amplitude(headingSpread, RAW_PER_RADIAN / 65536.0f, MAX_NOISE);
+        Particle* set = particles[live];
+        for (size_t i = 0; i < particleCount; i++) {
+            set[i].x = clampPosition(x + ((triangular() * positionNoise) >> 16));
+            set[i].y = clampPosition(y + ((triangular() * positionNoise) >> 16));
+            set[i].heading = heading + static_cast<uint32_t>(triangular() * headingNoise);
+            set[i].cost = 0;
+            weights[i] = FAST_MATH::Q16_ONE;
+        }
+        effective = static_cast<float>(particleCount);
+        counters = {};
+    }
+
+    void ParticleLocaliser::predict(const float distance, const float turn) {
+        const float clamped = std::clamp(distance, -MAX_STEP, MAX_STEP);
+        const auto step = static_cast<int32_t>(clamped * POSITION_SCALE);
+        const int32_t stepNoise = amplitude(config.motionSlip * std::fabs(clamped) + config.motionFloor,
+                                            POSITION_SCALE, MAX_STEP_NOISE);
+        const uint32_t turnRaw = BinaryAngle::fromRadians(turn).raw();
+        const int32_t turnNoise = amplitude(config.turnSlip * std::fabs(turn) + config.turnFloor,
+                                            RAW_PER_RADIAN / 65536.0f, MAX_NOISE);
+
+        Particle* set = particles[live];
+        for (size_t i = 0; i < particleCount; i++) {
+            Particle& particle = set[i];
+            const int32_t travelled = step + ((triangular() * stepNoise) >> 16);
+            const uint32_t turned = turnRaw + static_cast<uint32_t>(triangular() * turnNoise);
+            const BinaryAngle direction = BinaryAngle::fromRaw(
+                    particle.heading + static_cast<uint32_t>(static_cast<int32_t>(turned) / 2));
+            particle.heading += turned;
+            const int32_t sine = FAST_MATH::sinQ16(direction);
+            const int32_t cosine = FAST_MATH::cosQ16(direction);
+            particle.x = clampPosition(particle.x - driveDirection * ((travelled * sine) >> 16));
+            particle.y = clampPosition(particle.y + driveDirection * ((travelled * cosine) >> 16));
+        }
+    }
+
+    int32_t ParticleLocaliser::castRay(const int32_t x, const int32_t y, const int32_t dx, const int32_t dy,
+                                       const int32_t limit) const {
+        // the ray (x, y) + t·d meets the segment p0 + u·e where t = (a × e) / (d × e) and u = (a × d) / (d × e),
+        // for a = p0 - (x, y). It hits if t > 0 and 0 <= u <= 1
+        int32_t nearest = limit;
+        for (size_t i = 0; i < segmentCount; i++) {
+            const COMMON::MapSegment& segment = map[i];
+            const int32_t ax = segment.x0 - x;
+            const int32_t ay = segment.y0 - y;
+            const int32_t ex = segment.x1 - segment.x0;
+            const int32_t ey = segment.y1 - segment.y0;
+            int32_t denominator = dx * ey - dy * ex;
+            int32_t along = ax * ey - ay * ex;
+            int32_t across = ax * dy - ay * dx;
+            if (denominator < 0) {
+                denominator = -denominator;
+                along = -along;
+                across = -across;
+            }
+            if (along <= 0 || across < 0 || across > denominator) {
+                continue;
+            }
+            // t = along·2¹⁴ / denominator mm, split so the numerator stays within 32 bits. A beam close enough
+            // to parallel to round the divisor to zero doesn't give a usable range anyway
+            const int32_t divisor = denominator >> 10;
+            if (divisor == 0) {
+                continue;
+            }
+            nearest = std::min(nearest, (along << 4) / divisor);
+        }
+        return nearest;
+    }
+
+    void ParticleLocaliser::correct(const float heading, const float (&ranges)[NUM_TOF_SENSORS],
+                                    const COMMON::Pose& lag) {
+        const bool headingMeasured = !std::isnan(heading);
+        // each sensor's measured and longest range from the sensor itself, in mm
+        int32_t measured[NUM_TOF_SENSORS];
+        int32_t limit[NUM_TOF_SENSORS];
+        bool ranged[NUM_TOF_SENSORS];
+        bool anyRange = false;
+        for (size_t s = 0; s < NUM_TOF_SENSORS; s++) {
+            ranged[s] = hasMap() && std::isfinite(ranges[s]);
+            limit[s] = static_cast<int32_t>(CONFIG::TOF_MAX_RANGE * 1000.0f) - SENSOR_OFFSET_MM[s];
+            measured[s] = ranged[s] ? std::clamp(static_cast<int32_t>(ranges[s] * 1000.0f) - SENSOR_OFFSET_MM[s], 0,
+                                                 limit[s])
+                                    : 0;
+            anyRange = anyRange || ranged[s];
+        }
+        if (!headingMeasured && !anyRange) {
+            return;
+        }
+        counters.corrections++;
+
+        const uint32_t headingRaw = headingMeasured ? BinaryAngle::fromRadians(heading).raw() : 0;
+        // each particle is scored from where it was when the measurements were taken
+        const auto lagX = static_cast<int32_t>(lag.x * POSITION_SCALE);
+        const auto lagY = static_cast<int32_t>(lag.y * POSITION_SCALE);
+        const uint32_t lagHeading = BinaryAngle::fromRadians(lag.heading).raw();
+        const int32_t headingInverse = static_cast<int32_t>(
+                16.0f * 65536.0f / std::fmax(config.imuHeading * RAW_PER_RADIAN / 65536.0f, 32.0f));
+        const int32_t rangeInverse = static_cast<int32_t>(16.0f * 65536.0f / std::fmax(config.tofRange * 1000.0f, 5.0f));
+        const uint32_t shortCap = costFromNats(config.shortCost);
+        const uint32_t longCap = costFromNats(config.longCost);
+
+        Particle* set = particles[live];
+        uint32_t minCost = COST_LIMIT;
+        // the cost this correction adds, weighted by what each particle was worth before it
+        uint64_t weightedAdded = 0;
+        uint64_t priorWeight = 0;
+        for (size_t i = 0; i < particleCount; i++) {
+            Particle& particle = set[i];
+            uint32_t cost = particle.cost;
+            const uint32_t headingThen = particle.heading - lagHeading;
+            if (headingMeasured) {
+                const int32_t error = static_cast<int32_t>(headingThen - headingRaw) >> 16;
+                cost += quadraticCost(error, headingInverse, COST_LIMIT);
+            }
+            if (anyRange) {
+                const BinaryAngle facing = BinaryAngle::fromRaw(headingThen + chassisOffset);
+                const int32_t sine = FAST_MATH::sinQ16(facing) >> 2;
+                const int32_t cosine = FAST_MATH::cosQ16(facing) >> 2;
+                // the beam direction (-sin a, cos a) in Q14 for a = heading - sensor·π/2
+                const int32_t ux[NUM_TOF_SENSORS] = {-sine, cosine, sine, -cosine};
+                const int32_t uy[NUM_TOF_SENSORS] = {cosine, sine, -cosine, -sine};
+                const int32_t x = clampPosition(particle.x - lagX) >> 4;
+                const int32_t y = clampPosition(particle.y - lagY) >> 4;
+                for (size_t s = 0; s < NUM_TOF_SENSORS; s++) {
+                    if (!ranged[s]) {
+                        continue;
+                    }
+                    const int32_t originX = x + ((SENSOR_OFFSET_MM[s] * ux[s]) >> 14);
+                    const int32_t originY = y + ((SENSOR_OFFSET_MM[s] * uy[s]) >> 14);
+                    const int32_t expected = castRay(originX, originY, ux[s], uy[s], limit[s]);
+                    if (expected == limit[s]) {
+                        counters.raysMissed++;
+                    }
+                    const int32_t error = std::clamp(measured[s] - expected, -MAX_RANGE_ERROR, MAX_RANGE_ERROR);
+                    cost += quadraticCost(error, rangeInverse, error < 0 ? shortCap : longCap);
+                }
+            }
+            weightedAdded += static_cast<uint64_t>(weights[i]) * (cost - particle.cost);
+            priorWeight += weights[i];
+            cost = std::min(cost, COST_LIMIT);
+            particle.cost = cost;
+            minCost = std::min(minCost, cost);
+        }
+        lastSurprise = priorWeight > 0 ? static_cast<float>(static_cast<double>(weightedAdded) /
+                                                           static_cast<double>(priorWeight)) / COST_SCALE
+                                       : 0.0f;
+        if (anyRange) {
+            for (size_t s = 0; s < NUM_TOF_SENSORS; s++) {
+                counters.raysCast += ranged[s] ? particleCount : 0;
+            }
+        }
+
+        // costs are kept relative to the best particle, which has a weight of one
+        uint32_t totalWeight = 0;
+        uint64_t totalSquared = 0;
+        for (size_t i = 0; i < particleCount; i++) {
+            set[i].cost -= minCost;
+            const uint32_t weight = EXP.entries[set[i].cost >> 4];
+            weights[i] = weight;
+            totalWeight += weight;
+            totalSquared += static_cast<uint64_t>(weight) * weight;
+        }
+        effective = static_cast<float>(static_cast<double>(totalWeight) * static_cast<double>(totalWeight) /
+                                       static_cast<double>(totalSquared));
+        if (effective < config.resampleFraction * static_cast<float>(particleCount)) {
+            resample(totalWeight);
+        }
+    }
+
+    void ParticleLocaliser::resample(const uint32_t totalWeight) {
+        // systematic resampling: one random start, then evenly spaced picks along the cumulative weights
+        const Particle* from = particles[live];
+        Particle* to = particles[1 - live];
+        const uint32_t spacing = totalWeight / particleCount;
+        uint32_t position = spacing > 0 ? nextRandom() % spacing : 0;
+        uint32_t cumulative = weights[0];
+        size_t source = 0;
+        for (size_t i = 0; i < particleCount; i++) {
+            while (position >= cumulative && source + 1 < particleCount) {
+                source++;
+                cumulative += weights[source];
+            }
+            to[i] = from[source];
+            to[i].cost = 0;
+            position += spacing;
+        }
+        for (size_t i = 0; i < particleCount; i++) {
+            weights[i] = FAST_MATH::Q16_ONE;
+        }
+        live = 1 - live;
+        counters.resamples++;
+    }
+
+    void ParticleLocaliser::shift(const float dx, const float dy, const float dHeading) {
+        const auto x = static_cast<int32_t>(dx * POSITION_SCALE);
+        const auto y = static_cast<int32_t>(dy * POSITION_SCALE);
+        const uint32_t heading = BinaryAngle::fromRadians(dHeading).raw();
+        Particle* set = particles[live];
+        for (size_t i = 0; i < particleCount; i++) {
+            set[i].x = clampPosition(set[i].x + x);
+            set[i].y = clampPosition(set[i].y + y);
+            set[i].heading += heading;
+        }
+    }
+
+    Estimate ParticleLocaliser::estimate() const {
+        const Particle* set = particles[live];
+        uint64_t totalWeight = 0;
+        int64_t sumX = 0;
+        int64_t sumY = 0;
+        // second moments about the first particle, which keeps them small
+        uint64_t sumXX = 0;
+        int64_t sumXY = 0;
+        uint64_t sumYY = 0;
+        int64_t sumSine = 0;
+        int64_t sumCosine = 0;
+        const int32_t originX = set[0].x;
+        const int32_t originY = set[0].y;
+        for (size_t i = 0; i < particleCount; i++) {
+            const uint32_t weight = weights[i];
+            const int64_t x = set[i].x - originX;
+            const int64_t y = set[i].y - originY;
+            const BinaryAngle heading = BinaryAngle::fromRaw(set[i].heading);
+            totalWeight += weight;
+            sumX += weight * x;
+            sumY += weight * y;
+            sumXX += weight * static_cast<uint64_t>(x * x);
+            sumXY += weight * (x * y);
+            sumYY += weight * static_cast<uint64_t>(y * y);
+            sumSine += static_cast<int64_t>(weight) * FAST_MATH::sinQ16(heading);
+            sumCosine += static_cast<int64_t>(weight) * FAST_MATH::cosQ16(heading);
+        }
+        const auto total = static_cast<double>(totalWeight);
+        const double meanX = static_cast<double>(sumX) / total;
+        const double meanY = static_cast<double>(sumY) / total;
+        const double scale = POSITION_SCALE * POSITION_SCALE;
+        const double varianceX = std::fmax(static_cast<double>(sumXX) / total - meanX * meanX, 0.0) / scale;
+        const double varianceY = std::fmax(static_cast<double>(sumYY) / total - meanY * meanY, 0.0) / scale;
+        const double covarianceXY = (static_cast<double>(sumXY) / total - meanX * meanY) / scale;
+        const auto sine = static_cast<float>(static_cast<double>(sumSine) / total / FAST_MATH::Q16_ONE);
+        const auto cosine = static_cast<float>(static_cast<double>(sumCosine) / total / FAST_MATH::Q16_ONE);
+        // the length of the mean heading vector, which shrinks from one as the headings spread
+        const float resultant = std::fmin(FAST_MATH::hypot(sine, cosine), 1.0f);
+
+        Estimate result{};
+        result.pose.x = static_cast<float>((originX + meanX) / POSITION_SCALE);
+        result.pose.y = static_cast<float>((originY + meanY) / POSITION_SCALE);
+        result.pose.heading = FAST_MATH::atan2(sine, cosine);
+        result.positionSpread = static_cast<float>(std::sqrt(varianceX + varianceY));
+        result.headingSpread = resultant > 0.0f ? std::sqrt(-2.0f * std::log(resultant)) : static_cast<float>(M_PI);
+        result.effectiveParticles = effective;
+        result.covariance = {static_cast<float>(varianceX), static_cast<float>(covarianceXY),
+                             static_cast<float>(varianceY), result.headingSpread * result.headingSpread};
+        return result;
+    }
+}
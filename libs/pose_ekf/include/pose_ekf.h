@@ -0,0 +1,134 @@
+#ifndef OSOD_MOTOR_2040_POSE_EKF_H
+#define OSOD_MOTOR_2040_POSE_EKF_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "drivetrain_config.h"
+#include "types.h"
+
+/*
+ * Extended Kalman filter for the robot's pose.
+ *
+ * The state is (x, y, heading, v, ω) in the odometry frame, whose origin is the centre of the arena when
+ * ToF localisation is in use. Each tick predict() drives the state forward with the distance the wheels
+ * travelled and the current turn rate, laid along the arc that turn rate gives (CONFIG::POSE_INTEGRATION).
+ * The wheel distance is treated as a noisy control input, so a slip grows the position uncertainty along
+ * the direction of travel. correctHeading() then fuses the IMU yaw,
+ * correctTurnRate() the gyro's turn rate when the IMU report carries one, and correctRange() fuses each
+ * ToF range. A range is modelled as the distance from the robot centre to
+ * the wall of a square arena that the sensor's beam hits.
+ *
+ * Every measurement is scalar, so each correction is a rank-one update and needs no matrix inversion.
+ * The filter is fixed size and never allocates. A predict, a heading correction and four range
+ * corrections come to about 450 float multiplies and five sin/cos pairs. A range whose beam lands near a
+ * corner, where the wall it hits is ambiguous, is skipped. A range too far from the prediction (an
+ * obstacle, a robot or a bad return) is rejected by an innovation gate. If every range keeps being
+ * rejected, the filter is more likely lost than surrounded by obstacles. After tofRecoverAfter
+ * rejections in a row off the walls of one axis, that axis's uncertainty is widened so the walls can
+ * pull it back.
+ */
+
+namespace POSE_EKF {
+    namespace STATE {
+        enum Index {
+            X,
+            Y,
+            HEADING,
+            VELOCITY,
+            TURN_RATE,
+            STATE_SIZE // always keep this last in the enum so that we can use it to get the number of elements
+        };
+    }
+
+    constexpr size_t N = STATE::STATE_SIZE;
+
+    // All standard deviations unless noted.
+    struct NoiseConfig {
+        float odometrySlip = 0.05f;         // wheel distance error, as a fraction of the distance travelled
+        float odometryFloor = 0.0005f;      // m per tick, on top of the slip
+        float headingDrift = 0.0004f;       // rad²/s of heading random walk not explained by ω
+        float turnRateChange = 40.0f;       // rad²/s³ of turn rate random walk
+        float imuYaw = 0.01f;               // rad
+        float imuYawRate = 0.02f;           // rad/s
+        float tofRange = 0.03f;             // m
+        float tofGate = 3.0f;               // ranges further than this many standard deviations out are rejected
+        float tofCornerMargin = 0.06f;      // m; beams that land this close to a corner are skipped
+        uint32_t tofRecoverAfter = 8;       // consecutive rejected ranges off one axis's walls before reopening it
+        float tofReopenedPosition = 0.5f;   // m; the uncertainty a reopened axis is widened to
+        float initialPosition = 0.1f;       // m
+        float initialHeading = 0.1f;        // rad
+    };
+
+    struct RangeStats {
+        uint32_t accepted;
+        uint32_t rejected;  // failed the innovation gate
+        uint32_t recoveries; // times an axis was reopened after a run of rejections
+        uint32_t skipped;   // not modelled: no arena, near a corner, or the robot is outside the arena
+    };
+
+    class PoseEkf {
+    public:
+        PoseEkf(CONFIG::SteeringStyle driveDirection, float arenaSize, const NoiseConfig& noise = NoiseConfig(),
+                CONFIG::PoseIntegration integration = CONFIG::POSE_INTEGRATION);
+
+        // Restarts the filter at pose, stationary, with the initial uncertainty.
+        void reset(const COMMON::Pose& pose);
+
+        // distance is the wheel odometry's travel since the last predict, dt the time since then in seconds.
+        // spread is how far apart the wheels' own distances were, in metres, and adds to the distance error.
+        void predict(float distance, float dt, float spread = 0.0f);
+
+        // heading is the IMU's yaw with the heading offset applied.
+        void correctHeading(float heading);
+
+        // turnRate is the IMU's measured yaw rate, counter-clockwise positive like the heading.
+        void correctTurnRate(float turnRate);
+
+        // range is a ToF sensor's distance from the robot centre, indexed like FourToFDistances. lag is how far
+        // the robot has moved since the range was taken (PoseHistory::motionSince), so a late range is
+        // compared with the pose it was taken from. Returns true if it was fused.
+        bool correctRange(size_t sensor, float range, const COMMON::Pose& lag = {});
+
+        // Moves the estimate by the given amounts, as requested odometry offsets do, without changing its
+        // uncertainty.
+        void shift(float dx, float dy, float dHeading);
+
+        [[nodiscard]] COMMON::Pose pose() const;
+
+        [[nodiscard]] float velocity() const { return state[STATE::VELOCITY]; }
+
+        [[nodiscard]] float turnRate() const { return state[STATE::TURN_RATE]; }
+
+        [[nodiscard]] float variance(STATE::Index index) const { return covariance[index][index]; }
+
+        [[nodiscard]] float covarianceOf(STATE::Index a, STATE::Index b) const { return covariance[a][b]; }
+
+        // The last correction's squared innovation over the variance the filter expected it to have, whether or
+        // not it passed the gate. NaN if the last measurement wasn't modelled, like a range near a corner.
+        [[nodiscard]] float normalisedInnovation() const { return lastNormalisedInnovation; }
+
+        [[nodiscard]] RangeStats rangeStats() const { return stats; }
+
+        NoiseConfig noise;
+
+        // how predict() lays down each tick's travel (pose_integration.h)
+        CONFIG::PoseIntegration integration;
+
+    private:
+        float driveDirection;
+        float chassisOffset;    // the sensors face backwards when driving as a forklift
+        float halfArena;
+        float state[N] = {};
+        float covariance[N][N] = {};
+        RangeStats stats{};
+        float lastNormalisedInnovation = NAN;
+        uint32_t consecutiveRejections[2] = {}; // off the x walls and the y walls
+
+        // Rank-one update for a measurement with two non-zero Jacobian entries (h1 at i1, h2 at i2).
+        bool update(float innovation, size_t i1, float h1, size_t i2, float h2, float measurementVariance,
+                    float gate);
+    };
+}
+
+#endif //OSOD_MOTOR_2040_POSE_EKF_H
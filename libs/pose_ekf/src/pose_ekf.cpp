@@ -0,0 +1,203 @@
+#include "pose_ekf.h"
+
+#include <cmath>
+#include "utils.h"
+#include "fast_math.h"
+#include "pose_integration.h"
+
+namespace POSE_EKF {
+    using namespace STATE;
+
+    PoseEkf::PoseEkf(const CONFIG::SteeringStyle driveDirection, const float arenaSize, const NoiseConfig& noise,
+                     const CONFIG::PoseIntegration integration)
+            : noise(noise), integration(integration), driveDirection(static_cast<float>(driveDirection)),
+              chassisOffset(driveDirection == CONFIG::Forklift ? static_cast<float>(M_PI) : 0.0f),
+              halfArena(arenaSize / 2) {
+        reset({0.0f, 0.0f, 0.0f});
+    }
+
+    void PoseEkf::reset(const COMMON::Pose& pose) {
+        for (size_t i = 0; i < N; i++) {
+            state[i] = 0.0f;
+            for (size_t j = 0; j < N; j++) {
+                covariance[i][j] = 0.0f;
+            }
+        }
+        state[X] = pose.x;
+        state[Y] = pose.y;
+        state[HEADING] = pose.heading;
+        covariance[X][X] = noise.initialPosition * noise.initialPosition;
+        covariance[Y][Y] = noise.initialPosition * noise.initialPosition;
+        covariance[HEADING][HEADING] = noise.initialHeading * noise.initialHeading;
+        stats = {};
+        consecutiveRejections[0] = 0;
+        consecutiveRejections[1] = 0;
+    }
+
+    void PoseEkf::predict(const float distance, const float dt, const float spread) {
+        if (dt <= 0.0f) {
+            return;
+        }
+        const float turn = state[TURN_RATE] * dt;
+        const WHEEL_ODOMETRY::Displacement step = WHEEL_ODOMETRY::integrate(state[HEADING], distance, turn,
+                                                                            integration, driveDirection);
+        state[X] += step.dx;
+        state[Y] += step.dy;
+        state[HEADING] = wrap_pi(state[HEADING] + turn);
+        state[VELOCITY] = distance / dt;
+
+        // F is the identity apart from these entries; the velocity row is zero because the new velocity
+        // comes from the wheels alone. Turning the direction of travel swings the step about its start, and
+        // the turn rate turns it by its share of dt. The arc's chord factor also changes with the turn rate,
+        // but only at second order, so it is left out
+        const float dxdh = -step.dy;
+        const float dydh = step.dx;
+        float F[N][N] = {};
+        for (size_t i = 0; i < N; i++) {
+            F[i][i] = 1.0f;
+        }
+        F[X][HEADING] = dxdh;
+        F[X][TURN_RATE] = dxdh * step.turnShare * dt;
+        F[Y][HEADING] = dydh;
+        F[Y][TURN_RATE] = dydh * step.turnShare * dt;
+        F[HEADING][TURN_RATE] = dt;
+        F[VELOCITY][VELOCITY] = 0.0f;
+
+        float FP[N][N];
+        for (size_t i = 0; i < N; i++) {
+            for (size_t j = 0; j < N; j++) {
+                float sum = 0.0f;
+                for (size_t k = 0; k < N; k++) {
+                    sum += F[i][k] * covariance[k][j];
+                }
+                FP[i][j] = sum;
+            }
+        }
+        for (size_t i = 0; i < N; i++) {
+            for (size_t j = i; j < N; j++) {
+                float sum = 0.0f;
+                for (size_t k = 0; k < N; k++) {
+                    sum += FP[i][k] * F[j][k];
+                }
+                covariance[i][j] = sum;
+                covariance[j][i] = sum;
+            }
+        }
+
+        // the wheel distance error moves the robot along its direction of travel and shows up in the velocity
+        const float distanceSigma = noise.odometrySlip * std::fabs(distance) + noise.odometryFloor + spread;
+        const float distanceVariance = distanceSigma * distanceSigma;
+        const float G[N] = {step.perMetreX, step.perMetreY, 0.0f, 1.0f / dt, 0.0f};
+        for (size_t i = 0; i < N; i++) {
+            for (size_t j = 0; j < N; j++) {
+                covariance[i][j] += G[i] * G[j] * distanceVariance;
+            }
+        }
+        covariance[HEADING][HEADING] += noise.headingDrift * dt;
+        covariance[TURN_RATE][TURN_RATE] += noise.turnRateChange * dt;
+    }
+
+    void PoseEkf::correctHeading(const float heading) {
+        const float innovation = wrap_pi(heading - state[HEADING]);
+        update(innovation, HEADING, 1.0f, HEADING, 0.0f, noise.imuYaw * noise.imuYaw, 0.0f);
+    }
+
+    void PoseEkf::correctTurnRate(const float turnRate) {
+        update(turnRate - state[TURN_RATE], TURN_RATE, 1.0f, TURN_RATE, 0.0f, noise.imuYawRate * noise.imuYawRate,
+               0.0f);
+    }
+
+    bool PoseEkf::correctRange(const size_t sensor, const float range, const COMMON::Pose& lag) {
+        lastNormalisedInnovation = NAN;
+        if (!std::isfinite(halfArena)) {
+            stats.skipped++;
+            return false;
+        }
+        // where the robot was when the range was taken. The innovation is found there and applied to the
+        // state now, which differs from it by a known motion
+        const float x = state[X] - lag.x;
+        const float y = state[Y] - lag.y;
+        const float heading = state[HEADING] - lag.heading;
+        const float angle = heading + chassisOffset - static_cast<float>(sensor) * static_cast<float>(M_PI_2);
+        float sinAngle;
+        float cosAngle;
+        FAST_MATH::sincos(angle, sinAngle, cosAngle);
+        const float ux = -sinAngle;
+        const float uy = cosAngle;
+
+        // distance along the beam to the x = ±halfArena and y = ±halfArena walls it is heading for
+        constexpr float PARALLEL = 1e-3f;
+        const float xWall = ux > 0.0f ? halfArena : -halfArena;
+        const float yWall = uy > 0.0f ? halfArena : -halfArena;
+        const float toX = std::fabs(ux) > PARALLEL ? (xWall - x) / ux : INFINITY;
+        const float toY = std::fabs(uy) > PARALLEL ? (yWall - y) / uy : INFINITY;
+        if (toX <= 0.0f || toY <= 0.0f || std::fabs(toX - toY) < noise.tofCornerMargin) {
+            stats.skipped++;
+            return false;
+        }
+
+        const float gate = noise.tofGate;
+        const float variance = noise.tofRange * noise.tofRange;
+        const size_t axis = toX < toY ? X : Y;
+        bool fused;
+        if (axis == X) {
+            // r = (xWall - x) / ux
+            fused = update(range - toX, X, -1.0f / ux, HEADING, toX * cosAngle / ux, variance, gate);
+        } else {
+            // r = (yWall - y) / uy
+            fused = update(range - toY, Y, -1.0f / uy, HEADING, toY * sinAngle / uy, variance, gate);
+        }
+        if (fused) {
+            stats.accepted++;
+            consecutiveRejections[axis] = 0;
+        } else {
+            stats.rejected++;
+            if (++consecutiveRejections[axis] >= noise.tofRecoverAfter) {
+                const float reopened = noise.tofReopenedPosition * noise.tofReopenedPosition;
+                covariance[axis][axis] = std::fmax(covariance[axis][axis], reopened);
+                consecutiveRejections[axis] = 0;
+                stats.recoveries++;
+            }
+        }
+        return fused;
+    }
+
+    bool PoseEkf::update(const float innovation, const size_t i1, const float h1, const size_t i2, const float h2,
+                         const float measurementVariance, const float gate) {
+        // P Hᵀ, with H zero apart from h1 and h2
+        float PHt[N];
+        for (size_t i = 0; i < N; i++) {
+            PHt[i] = covariance[i][i1] * h1 + covariance[i][i2] * h2;
+        }
+        const float innovationVariance = h1 * PHt[i1] + h2 * PHt[i2] + measurementVariance;
+        lastNormalisedInnovation = innovation * innovation / innovationVariance;
+        if (gate > 0.0f && innovation * innovation > gate * gate * innovationVariance) {
+            return false;
+        }
+
+        const float inverse = 1.0f / innovationVariance;
+        for (size_t i = 0; i < N; i++) {
+            state[i] += PHt[i] * inverse * innovation;
+        }
+        state[HEADING] = wrap_pi(state[HEADING]);
+        // P -= K (H P) = P Hᵀ (P Hᵀ)ᵀ / S, which keeps P symmetric
+        for (size_t i = 0; i < N; i++) {
+            const float scaled = PHt[i] * inverse;
+            for (size_t j = i; j < N; j++) {
+                covariance[i][j] -= scaled * PHt[j];
+                covariance[j][i] = covariance[i][j];
+            }
+        }
+        return true;
+    }
+
+    void PoseEkf::shift(const float dx, const float dy, const float dHeading) {
+        state[X] += dx;
+        state[Y] += dy;
+        state[HEADING] = wrap_pi(state[HEADING] + dHeading);
+    }
+
+    COMMON::Pose PoseEkf::pose() const {
+        return {state[X], state[Y], state[HEADING]};
+    }
+}
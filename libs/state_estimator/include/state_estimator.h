@@ -4,18 +4,27 @@
 
 #ifndef OSOD_MOTOR_2040_STATE_ESTIMATOR_H
 #define OSOD_MOTOR_2040_STATE_ESTIMATOR_H
-#include <vector>
-#include <numeric>
+#include <atomic>
 #include <cmath>
-#include <tuple>
 #include "pico/stdlib.h"
 #include "hardware/timer.h"
 #include "motor2040.hpp"
 #include "drivetrain_config.h"
-#include "interfaces.h"
+#include "task_timing.h"
+#include "seqlock.h"
+#include "topic.h"
+#include "measurement_queue.h"
+#include "pose_history.h"
+#include "heading_alignment.h"
 #include "types.h"
 #include "bno080.h"
 #include "tf_luna.h"
+#include "flight_recorder.h"
+#include "pose_ekf.h"
+#include "arena_localisation.h"
+#include "particle_localisation.h"
+#include "wheel_odometry.h"
+#include "pose_integration.h"
 
 using namespace motor;
 using namespace encoder;
@@ -30,9 +39,45 @@ struct Encoders {
 namespace STATE_ESTIMATOR {
     using namespace COMMON;
     using namespace std;
-    class StateEstimator : public Subject {
+
+    // The sensors that push to the estimator's measurement queue, one channel each.
+    enum MeasurementSource {
+        IMU_MEASUREMENTS,
+        TOF_MEASUREMENTS,
+        MEASUREMENT_SOURCE_COUNT // always keep this last in the enum so that we can use it to get the number of elements
+    };
+
+    struct FusionStats {
+        uint32_t fused;
+        uint32_t late;      // taken before the pose history reaches, so not fused
+        uint32_t maxAgeUs;  // the oldest measurement fused, relative to the tick's encoder capture
+    };
+
+    // What showEstimationTiming() prints from the counters the estimator's core keeps, taken in one go at the
+    // start of a tick, over the period since the last report.
+    struct EstimationReport {
+        TaskTimingStats timing;
+        SampleIntervalStats interval;
+        float sigmaX;               // the EKF's, in m
+        float sigmaY;
+        float sigmaHeading;         // rad
+        POSE_EKF::RangeStats ranges;
+        PARTICLE_LOCALISATION::Estimate particles;
+        PARTICLE_LOCALISATION::Stats particleCounts;
+        uint32_t particleCount;
+        FusionStats fusion;
+        uint32_t queueDrops;
+        uint32_t historySpanUs;
+        ToFStats tof[NUM_TOF_SENSORS];
+        BNO08xBusStats imuBus;
+        uint32_t droppedHeadingReports;
+        HeadingAlignmentStats alignment;
+    };
+
+    class StateEstimator {
     public:
-        explicit StateEstimator(BNO08x* IMUinstance, i2c_inst_t* port, CONFIG::SteeringStyle direction);
+        explicit StateEstimator(BNO08x* IMUinstance, i2c_inst_t* port, I2C_ENGINE::I2CEngine* i2cEngine,
+                                CONFIG::SteeringStyle direction);
 
     protected:
         ~StateEstimator(); // Destructor to cancel the timer
@@ -42,11 +87,36 @@ namespace STATE_ESTIMATOR {
         
         void estimateState();
 
+        // Runs estimateState() from the main loop if the timer has requested it since the last call.
+        // Returns true if a new estimate was produced.
+        bool serviceEstimation();
+
+        [[nodiscard]] TaskTimingStats estimationTiming() const;
+
+        // Measured intervals between the encoder captures of successive estimates.
+        [[nodiscard]] SampleIntervalStats estimationInterval() const;
+
+        // How the IMU's heading was brought to each encoder capture, and how well (CONFIG::AT_ENCODER_CAPTURE).
+        [[nodiscard]] HeadingAlignmentStats imuAlignment() const;
+
+        // Prints the latest report and asks the estimator's core for the next one. Safe to call from either core;
+        // the first call only asks.
+        void showEstimationTiming();
+
+        // The pose filter used when CONFIG::POSE_FILTER is EKF.
+        [[nodiscard]] const POSE_EKF::PoseEkf& poseEkf() const;
+
+        // The pose filter used when CONFIG::POSE_FILTER is PARTICLE.
+        [[nodiscard]] const PARTICLE_LOCALISATION::ParticleLocaliser& particleLocaliser() const;
+
         void publishState() const;
 
-        void addObserver(Observer* observer) override;
+        // Most recent complete estimate. Safe to call from either core and never blocks the estimator.
+        [[nodiscard]] VehicleState latestState() const;
 
-        void notifyObservers(VehicleState newState) override;
+        // Each estimate is published here, stamped with the time it was produced. Consumers subscribe to
+        // it and pull the estimate, or just the fields they need, when they want it.
+        [[nodiscard]] const Topic<VehicleState>& estimate() const;
 
         void updateCurrentSteeringAngles(const SteeringAngles& newSteeringAngles);
 
@@ -57,81 +127,112 @@ namespace STATE_ESTIMATOR {
 
         CONFIG::SteeringStyle driveDirection; //factor to change odometry direction based on what we currently consider the front
 
-        Pose localisation(float heading, FourToFDistances tof_distances);
-
-        std::pair<float, float> possiblePositions(float heading, float distance, float arena_size);
-
-        std::tuple<float, float, float> coordinateVariance(const std::vector<float>& xList, const std::vector<float>& yList);
+        ARENA_LOCALISATION::Fix localisation(float heading, const FourToFDistances& tof_distances);
 
         bool arenaLocalisation;
-        struct PermutationResult {
-            std::array<float, NUM_TOF_SENSORS> xList;
-            std::array<float, NUM_TOF_SENSORS> yList;
-            size_t xSize;
-            size_t ySize;
-        };
+
         void zeroHeading(); 
 
         void requestOdometryOffset(float xOffset, float yOffset, float extraHeadingOffset);
 
-        Pose odometryOffsetRequest;
-
     private:
         Encoder* encoders[MOTOR_POSITION::MOTOR_POSITION_COUNT];
         static StateEstimator* instancePtr;
         repeating_timer_t* timer;
         BNO08x* IMU;
         i2c_inst_t* i2c_port;
+        TfLunaArray tofSensors;
         float IMUHeadingOffset = 0;
-        //TODO: (related to issue #42) actually use timer (defined above) instead of fixed interval
-        const uint32_t timerInterval = 10;  // Interval in milliseconds
+        bool imuInterruptAttached = false;
+        const uint32_t timerInterval = 10;  // Interval in milliseconds; the estimate itself uses the measured interval
+        TaskTiming estimationTask{timerInterval * 1000};
+        SampleInterval tickInterval{timerInterval * 1000};
         VehicleState estimatedState;
         VehicleState previousState;
         DriveTrainState currentDriveTrainState;
         SteeringAngles currentSteeringAngles;
         float localisation_weighting = 0.1;
         Pose localisationEstimate;
-
-        static void timerCallback(repeating_timer_t* timer);
+        ARENA_LOCALISATION::ArenaLocaliser arenaLocaliser;
+        WHEEL_ODOMETRY::FourWheelOdometry wheelOdometry{CONFIG::WHEEL_TRACK};
+        POSE_EKF::PoseEkf poseFilter;
+        // only has room for the particles when it is the pose filter in use
+        PARTICLE_LOCALISATION::StaticParticleLocaliser<
+                CONFIG::POSE_FILTER == CONFIG::PARTICLE ? CONFIG::PARTICLE_COUNT : 1> particleFilter;
+        MeasurementQueue<Measurement, MEASUREMENT_SOURCE_COUNT> measurements;
+        PoseHistory poseHistory;
+        HeadingAlignment imuHeading;
+        uint32_t previousTickUs;
+        FusionStats fusion{};
+        uint32_t reportedDrops = 0; // queue drops already in a report
+        // showEstimationTiming() counts requests up; the estimator's core answers each with a report
+        std::atomic<uint32_t> reportRequests{0};
+        uint32_t reportsServed = 0;
+        SeqLock<EstimationReport> report;
+        EstimatorHealth health{};
+        uint32_t lastRangeFixUs;
+        PoseCovariance deadReckoning{}; // the complementary filter's covariance, which it doesn't track itself
+        Topic<VehicleState> estimateTopic;
+        // the heading is requested on its own, so zeroHeading() leaves a pending position offset alone
+        SeqLock<Point> positionOffsetRequest;
+        SeqLock<float> headingOffsetRequest;
+        uint32_t appliedPositionSequence = 0;
+        uint32_t appliedHeadingSequence = 0;
+        FLIGHT_RECORDER::TickRecord flightRecord{}; // filled in over each tick, then handed to the flight recorder
+
+        static bool timerCallback(repeating_timer_t* timer);
 
         void setupTimer() const;
 
-        Observer* observers[10] = {};
-        int observerCount = 0;
+        // Publishes a report of the counters and clears them, on the estimator's core.
+        void publishReport();
 
-        void captureEncoders(Encoder::Capture* encoderCaptures) const;
+        void captureEncoders(Encoder::Capture* encoderCaptures);
         
-        void getLatestHeading(float& heading);
+        // Enables the IMU report CONFIG::IMU_REPORT selects, at CONFIG::IMU_REPORT_INTERVAL_US.
+        void enableImuReports();
+
+        // With CONFIG::INTERRUPT, has the IMU read from its INT line. Called from the first serviceEstimation(),
+        // so the INT edge is taken on the core that estimates (core1 in DUAL_CORE) rather than the one that
+        // constructed the estimator.
+        void attachImuInterrupt();
+
+        // Returns true if the IMU delivered a new yaw, otherwise heading is left at the current estimate. With
+        // CONFIG::AT_ENCODER_CAPTURE the heading is brought to captureUs. yawRate is only set by a report that
+        // measures it (CONFIG::GYRO_INTEGRATED_RV). Every report read is also queued for fusion.
+        bool getLatestHeading(float& heading, float& yawRate, uint32_t captureUs);
 
         bool initialiseHeadingOffset();
 
         void getPositionDelta(Encoder::Capture encoderCaptures[4], float& distance_travelled) const;
 
-        void calculateNewPosition(VehicleState& tmpState, float distance_travelled, float heading);
+        void calculateNewPosition(VehicleState& tmpState, float distance_travelled, float heading, bool heading_measured);
+
+        // Fuses everything the sensors have queued, oldest first, into the pose filter, each measurement against
+        // the pose the robot had when it was taken.
+        void fuseMeasurements(VehicleState& tmpState, uint32_t tickUs);
+
+        // Adds a correction's normalised innovation to a sensor's health. NaN, for one that wasn't modelled,
+        // is ignored.
+        static void noteInnovation(InnovationStats& stats, float normalisedInnovation, bool accepted);
 
-        Velocity calculateVelocities(float new_heading, float previous_heading, float left_speed, float right_speed);
+        // The pose covariance for the complementary filter, from the same noise model the EKF uses: the
+        // position uncertainty grows with the distance travelled and shrinks with each localisation fix.
+        void growDeadReckoning(float distance);
+        void applyFixToDeadReckoning(const ARENA_LOCALISATION::Fix& fix);
+
+        // speed is forwards for the chassis
+        Velocity calculateVelocities(float new_heading, float previous_heading, float speed, float dt);
+
+        // Distance, speed and slip from all four wheels, checked against the IMU's turn rate over the tick.
+        WHEEL_ODOMETRY::Estimate fourWheelOdometry(const Encoder::Capture* encoderCaptures, SteeringAngles steering_angles,
+                                                   float yaw_rate, float dt) const;
 
         static MotorSpeeds getWheelSpeeds(const Encoder::Capture* encoderCaptures);
 
         [[nodiscard]] SteeringAngles estimateSteeringAngles() const;
-        
-        pair<float, float> calculatePossiblePositions(float heading, float distance);
-
-        tuple<float, float, float> calculateCoordinateVariance(const PermutationResult& result);
 
         Pose filterPositions(Pose odometryEstimate, Pose localisationEstimate);
-        
-        const size_t NUM_PERMUTATIONS = 1 << NUM_TOF_SENSORS; //number of permations is 2^(num sensors)
-        
-        PermutationResult createPermutation(
-            int permutation,
-            const std::array<float, NUM_TOF_SENSORS>& xPositions,
-            const std::array<float, NUM_TOF_SENSORS>& yPositions);
-        
-        Pose evaluatePositionPermutations(
-            float heading,
-            const std::array<float, NUM_TOF_SENSORS>& xPositions,
-            const std::array<float, NUM_TOF_SENSORS>& yPositions);
 
         void processOdometryOffsets();
     };
@@ -1,24 +1,44 @@
 //
 // Created by robbe on 03/12/2023.
 //
+#include <algorithm>
 #include <cstdio>
-#include <bitset>
 #include "state_estimator.h"
 #include "drivetrain_config.h"
 #include "encoder.hpp"
 #include "bno080.h"
 #include "utils.h"
+#include "fast_math.h"
+#include "profiler.h"
+#include "telemetry.h"
 
 #include "tf_luna.h"
 namespace STATE_ESTIMATOR {
+    namespace {
+        // indexed like FourToFDistances
+        constexpr ARENA_LOCALISATION::RayLimits TOF_RAY_LIMITS = {
+                {CONFIG::TOF_FRONT_OFFSET + CONFIG::TOF_SELF_CLEARANCE, CONFIG::TOF_RIGHT_OFFSET + CONFIG::TOF_SELF_CLEARANCE,
+                 CONFIG::TOF_REAR_OFFSET + CONFIG::TOF_SELF_CLEARANCE, CONFIG::TOF_LEFT_OFFSET + CONFIG::TOF_SELF_CLEARANCE},
+                CONFIG::TOF_MAX_RANGE};
+
+        // the BNO08x report the heading comes from
+        constexpr sh2_SensorId_t IMU_HEADING_REPORT = CONFIG::IMU_REPORT == CONFIG::GYRO_INTEGRATED_RV
+                                                      ? SENSOR_REPORTID_GYRO_INTEGRATED_ROTATION_VECTOR
+                                                      : SENSOR_REPORTID_ROTATION_VECTOR;
+    }
+
     StateEstimator *StateEstimator::instancePtr = nullptr;
 
-    StateEstimator::StateEstimator(BNO08x* IMUinstance, i2c_inst_t* port, CONFIG::SteeringStyle direction) : encoders{
+    StateEstimator::StateEstimator(BNO08x* IMUinstance, i2c_inst_t* port, I2C_ENGINE::I2CEngine* i2cEngine,
+                                   CONFIG::SteeringStyle direction) : encoders{
             [MOTOR_POSITION::FRONT_LEFT] =new Encoder(pio0, 0, motor2040::ENCODER_A, PIN_UNUSED, Direction::NORMAL_DIR, CONFIG::COUNTS_PER_REV),
             [MOTOR_POSITION::FRONT_RIGHT] =new Encoder(pio0, 1, motor2040::ENCODER_B, PIN_UNUSED, Direction::NORMAL_DIR, CONFIG::COUNTS_PER_REV),
             [MOTOR_POSITION::REAR_LEFT] = new Encoder(pio0, 2, motor2040::ENCODER_C, PIN_UNUSED, Direction::NORMAL_DIR, CONFIG::COUNTS_PER_REV),
             [MOTOR_POSITION::REAR_RIGHT] = new Encoder(pio0, 3, motor2040::ENCODER_D, PIN_UNUSED, Direction::NORMAL_DIR, CONFIG::COUNTS_PER_REV)
-    }, timer(new repeating_timer_t), estimatedState(), previousState(), currentDriveTrainState() {
+    }, timer(new repeating_timer_t), tofSensors(i2cEngine), estimatedState(), previousState(), currentDriveTrainState(),
+      arenaLocaliser(CONFIG::ARENA_SIZE, TOF_RAY_LIMITS, static_cast<float>(direction)),
+      poseFilter(direction, CONFIG::ARENA_SIZE),
+      particleFilter(CONFIG::arenaMap, CONFIG::arenaMapSegments, CONFIG::PARTICLE_COUNT, direction) {
         encoders[MOTOR_POSITION::FRONT_LEFT]->init();
         encoders[MOTOR_POSITION::FRONT_RIGHT]->init();
         encoders[MOTOR_POSITION::REAR_LEFT]->init();
@@ -40,13 +60,21 @@ namespace STATE_ESTIMATOR {
         estimatedState.driveTrainState.angles.right = 0.0f;
         estimatedState.tofDistances = getAllLidarDistances(i2c_port);
         IMU = IMUinstance;
+        enableImuReports();
+        tofSensors.publishTo(&measurements.channel(TOF_MEASUREMENTS));
+        previousTickUs = time_us_32();
+        lastRangeFixUs = previousTickUs;
+        const float initialPosition = poseFilter.noise.initialPosition * poseFilter.noise.initialPosition;
+        deadReckoning = {initialPosition, 0.0f, initialPosition,
+                         poseFilter.noise.initialHeading * poseFilter.noise.initialHeading};
+        estimatedState.covariance = deadReckoning;
         
         instancePtr = this;
         // check if we're going to use the ToF sensors for arena localisation 
         // (a naN arena size means we're not going to use the arena for localisation):
         arenaLocalisation = !isnan(CONFIG::ARENA_SIZE);
         
-        odometryOffsetRequest.x = odometryOffsetRequest.y = odometryOffsetRequest.heading = 0;
+        estimateTopic.publish(estimatedState, time_us_32());
 
         driveDirection = direction;
         
@@ -86,34 +114,29 @@ namespace STATE_ESTIMATOR {
 
     void StateEstimator::publishState() const {
         // showValuesViaCSV();
+        const uint32_t now = time_us_32();
+        TELEMETRY::emit(TELEMETRY::vehicleStateRecord(now, estimatedState));
+        TELEMETRY::emit(TELEMETRY::estimatorHealthRecord(now, estimatedState));
     }
 
-    void StateEstimator::addObserver(Observer* observer) {
-        if (observerCount < 10) {
-            observers[observerCount++] = observer;
-        }
-    }
-
-    void StateEstimator::notifyObservers(const VehicleState newState) {
-        for (int i = 0; i < observerCount; i++) {
-            observers[i]->update(newState);
-        }
-    }
-
-    void StateEstimator::captureEncoders(Encoder::Capture* encoderCaptures) const {
+    void StateEstimator::captureEncoders(Encoder::Capture* encoderCaptures) {
+        PROFILE_STAGE(CAPTURE_ENCODERS);
         for(int i = 0; i < MOTOR_POSITION::MOTOR_POSITION_COUNT; i++) {
             encoderCaptures[i] = encoders[i]->capture();
+            flightRecord.encoderCount[i] = encoderCaptures[i].count();
+            flightRecord.encoderDelta[i] = encoderCaptures[i].delta();
+            flightRecord.encoderFrequency[i] = encoderCaptures[i].frequency();
         }
     }
 
     void StateEstimator::calculateBilateralSpeeds(const MotorSpeeds& motor_speeds, const SteeringAngles steering_angles, float& left_speed, float& right_speed) {
-        left_speed = (motor_speeds[MOTOR_POSITION::FRONT_LEFT] * cos(steering_angles.left)
+        left_speed = (motor_speeds[MOTOR_POSITION::FRONT_LEFT] * FAST_MATH::cos(steering_angles.left)
                       + motor_speeds[MOTOR_POSITION::REAR_LEFT]) / 2;
 
         // convert average wheel rotation speed to linear speed
         left_speed = left_speed * CONFIG::WHEEL_DIAMETER / 2;
 
-        right_speed = (motor_speeds[MOTOR_POSITION::FRONT_RIGHT] * cos(steering_angles.right)
+        right_speed = (motor_speeds[MOTOR_POSITION::FRONT_RIGHT] * FAST_MATH::cos(steering_angles.right)
                        + motor_speeds[MOTOR_POSITION::REAR_RIGHT]) / 2;
         right_speed = right_speed * CONFIG::WHEEL_DIAMETER / 2;
     }
@@ -129,29 +152,59 @@ namespace STATE_ESTIMATOR {
         distance_travelled = ((left_travel - right_travel) / 2) * CONFIG::WHEEL_DIAMETER / 2;
     }
 
-    void StateEstimator::calculateNewPosition(VehicleState& tmpState, const float distance_travelled, const float heading) {
-        //use the latest heading and distance travleled to update the estiamted position
-        tmpState.odometry.x -= driveDirection * distance_travelled * sin(heading);
-        tmpState.odometry.y += driveDirection * distance_travelled * cos(heading);
-
-        //now actually update odometry's heading
-        tmpState.odometry.heading = heading;
-
-        //constrain heading to +/-pi
-        tmpState.odometry.heading = wrap_pi(tmpState.odometry.heading);
+    void StateEstimator::calculateNewPosition(VehicleState& tmpState, const float distance_travelled, const float heading,
+                                              const bool heading_measured) {
+        // the turn over the tick is the IMU's when it has reported, otherwise the steering's through the bicycle model;
+        // EULER holds the heading instead, as the original odometry did
+        const float previous_heading = tmpState.odometry.heading;
+        const bool steered = !heading_measured && CONFIG::POSE_INTEGRATION != CONFIG::EULER;
+        const float turn = steered ? WHEEL_ODOMETRY::bicycleTurn(distance_travelled, tmpState.driveTrainState.angles)
+                           : wrap_pi(heading - previous_heading);
+        const WHEEL_ODOMETRY::Displacement step = WHEEL_ODOMETRY::integrate(previous_heading, distance_travelled, turn,
+                                                                            CONFIG::POSE_INTEGRATION,
+                                                                            static_cast<float>(driveDirection));
+        tmpState.odometry.x += step.dx;
+        tmpState.odometry.y += step.dy;
+
+        //now actually update odometry's heading, constrained to +/-pi
+        tmpState.odometry.heading = wrap_pi(previous_heading + turn);
     }
 
-    Velocity StateEstimator::calculateVelocities(const float new_heading, const float previous_heading, const float left_speed, const float right_speed) {
+    Velocity StateEstimator::calculateVelocities(const float new_heading, const float previous_heading, const float speed, const float dt) {
         // TODO return a velocities struct instead of setting individual values
         Velocity tmpVelocity{};
-        tmpVelocity.velocity = (left_speed - right_speed) / 2;
-        tmpVelocity.x_dot = -driveDirection * tmpVelocity.velocity * sin(new_heading);
-        tmpVelocity.y_dot = driveDirection * tmpVelocity.velocity * cos(new_heading);
+        tmpVelocity.velocity = speed;
+        float sinHeading;
+        float cosHeading;
+        FAST_MATH::sincos(new_heading, sinHeading, cosHeading);
+        tmpVelocity.x_dot = -driveDirection * tmpVelocity.velocity * sinHeading;
+        tmpVelocity.y_dot = driveDirection * tmpVelocity.velocity * cosHeading;
        
-        tmpVelocity.angular_velocity = 1000 * (wrap_pi(new_heading - previous_heading)) / timerInterval;
+        // previous_heading is the last estimate's, dt the measured time since it; should no time have
+        // passed, the last turn rate stands
+        tmpVelocity.angular_velocity = dt > 0.0f ? wrap_pi(new_heading - previous_heading) / dt
+                                                 : estimatedState.velocity.angular_velocity;
         return tmpVelocity;
     }
 
+    WHEEL_ODOMETRY::Estimate StateEstimator::fourWheelOdometry(const Encoder::Capture* encoderCaptures,
+                                                              const SteeringAngles steering_angles,
+                                                              const float yaw_rate, const float dt) const {
+        PROFILE_STAGE(WHEEL_ODOMETRY);
+        // the right-hand wheels count backwards when the chassis moves forwards
+        WHEEL_ODOMETRY::Input input{};
+        for (int i = 0; i < MOTOR_POSITION::MOTOR_POSITION_COUNT; i++) {
+            const bool right = i == MOTOR_POSITION::FRONT_RIGHT || i == MOTOR_POSITION::REAR_RIGHT;
+            const float wheelRadius = right ? -CONFIG::WHEEL_DIAMETER / 2 : CONFIG::WHEEL_DIAMETER / 2;
+            input.travel[i] = encoderCaptures[i].radians_delta() * wheelRadius;
+            input.speed[i] = encoderCaptures[i].radians_per_second() * wheelRadius;
+        }
+        input.steering = steering_angles;
+        input.yawRate = yaw_rate;
+        input.dt = dt;
+        return wheelOdometry.update(input);
+    }
+
     MotorSpeeds StateEstimator::getWheelSpeeds(const Encoder::Capture* encoderCaptures) {
         MotorSpeeds wheelSpeeds{};
         for(int i = 0; i < MOTOR_POSITION::MOTOR_POSITION_COUNT; i++) {
@@ -165,10 +218,16 @@ namespace STATE_ESTIMATOR {
     }
 
     void StateEstimator::estimateState() {
+        PROFILE_STAGE(ESTIMATE_STATE);
 
         //update odometry offsets based on external requests
         processOdometryOffsets();
 
+        // the estimate is stamped with the time its encoder captures were taken
+        const uint32_t tickUs = time_us_32();
+        const float dt = tickInterval.update(tickUs);
+        flightRecord.timeUs = tickUs;
+
         // instantiate a copy of the current state
         VehicleState tmpState = estimatedState;
         
@@ -176,19 +235,10 @@ namespace STATE_ESTIMATOR {
         Encoder::Capture encoderCaptures[MOTOR_POSITION::MOTOR_POSITION_COUNT];
         captureEncoders(encoderCaptures);
 
-        // calculate position deltas
-
-        float distance_travelled = 0.0f;
-        getPositionDelta(encoderCaptures, distance_travelled);
-
-
         float heading = 0.0f;
-        getLatestHeading(heading);
-
-        //calculate new position and orientation
-        calculateNewPosition(tmpState, distance_travelled, heading);
-
-        //calculate speeds
+        float yawRate = 0.0f;
+        const bool headingUpdated = getLatestHeading(heading, yawRate, tickUs);
+        const bool yawRateMeasured = headingUpdated && CONFIG::IMU_REPORT == CONFIG::GYRO_INTEGRATED_RV;
 
         //get wheel speeds
         tmpState.driveTrainState.speeds = getWheelSpeeds(encoderCaptures);
@@ -196,193 +246,519 @@ namespace STATE_ESTIMATOR {
         // estimate steering angles
         tmpState.driveTrainState.angles = estimateSteeringAngles();
 
-        // calculate left and right speeds
-        float left_speed;
-        float right_speed;
-        calculateBilateralSpeeds(tmpState.driveTrainState.speeds, tmpState.driveTrainState.angles, left_speed, right_speed);
+        // check every wheel against the kinematics and the turn the IMU saw over this tick. The slip ratios are
+        // published whichever odometry is in use
+        const float imuTurnRate = yawRateMeasured ? yawRate
+                                  : headingUpdated && dt > 0.0f ? wrap_pi(heading - estimatedState.odometry.heading) / dt
+                                  : estimatedState.velocity.angular_velocity;
+        const WHEEL_ODOMETRY::Estimate wheels = fourWheelOdometry(encoderCaptures, tmpState.driveTrainState.angles,
+                                                                  imuTurnRate, dt);
+        tmpState.wheelSlip = wheels.slip;
+
+        // calculate position deltas
+        float distance_travelled = wheels.distance;
+        float distanceSpread = wheels.spread;
+        if (CONFIG::ODOMETRY == CONFIG::REAR_WHEELS) {
+            getPositionDelta(encoderCaptures, distance_travelled);
+            distanceSpread = 0.0f;
+        }
+
+        //calculate new position and orientation
+        if (CONFIG::POSE_FILTER == CONFIG::EKF) {
+            PROFILE_STAGE(POSE_EKF);
+            poseFilter.predict(distance_travelled, dt, distanceSpread);
+            tmpState.odometry = poseFilter.pose();
+        } else if (CONFIG::POSE_FILTER == CONFIG::PARTICLE) {
+            PROFILE_STAGE(PARTICLE_FILTER);
+            particleFilter.predict(distance_travelled, imuTurnRate * dt);
+            const PARTICLE_LOCALISATION::Estimate particles = particleFilter.estimate();
+            tmpState.odometry = particles.pose;
+            tmpState.covariance = particles.covariance;
+        } else {
+            calculateNewPosition(tmpState, distance_travelled, heading, headingUpdated);
+            growDeadReckoning(distance_travelled);
+        }
+        poseHistory.record(previousTickUs, tickUs,
+                           {tmpState.odometry.x - estimatedState.odometry.x, tmpState.odometry.y - estimatedState.odometry.y,
+                            wrap_pi(tmpState.odometry.heading - estimatedState.odometry.heading)});
+        previousTickUs = tickUs;
+        fuseMeasurements(tmpState, tickUs);
+
+        //calculate speeds
+        float speed = wheels.velocity;
+        if (CONFIG::ODOMETRY == CONFIG::REAR_WHEELS) {
+            // calculate left and right speeds
+            float left_speed;
+            float right_speed;
+            calculateBilateralSpeeds(tmpState.driveTrainState.speeds, tmpState.driveTrainState.angles, left_speed, right_speed);
+            speed = (left_speed - right_speed) / 2;
+        }
 
         //calc all velocities
-        tmpState.velocity = calculateVelocities(tmpState.odometry.heading, previousState.odometry.heading, left_speed, right_speed);
+        tmpState.velocity = calculateVelocities(tmpState.odometry.heading, estimatedState.odometry.heading, speed, dt);
+        if (CONFIG::IMU_REPORT == CONFIG::GYRO_INTEGRATED_RV) {
+            // the gyro's own rate from the newest report, rather than the heading change over the last tick
+            tmpState.velocity.angular_velocity = yawRateMeasured ? yawRate : estimatedState.velocity.angular_velocity;
+        }
 
-        // get ToF data
-        tmpState.tofDistances = getAllLidarDistances(i2c_port);
-        
-        if (arenaLocalisation) {
-            localisationEstimate = localisation(tmpState.odometry.heading, tmpState.tofDistances);
-            tmpState.odometry = filterPositions(tmpState.odometry, localisationEstimate);
+        // pick up the ToF frames read since the last tick and queue reads for the sensors now due. Sensors
+        // that haven't delivered keep their last reading; localisation runs when something new has arrived,
+        // as long as none of the four readings has gone stale
+        const uint32_t nowUs = time_us_32();
+        bool tofUpdated;
+        {
+            PROFILE_STAGE(TOF_SENSORS);
+            tofUpdated = tofSensors.collectDistances(tmpState.tofDistances) > 0;
+            tofSensors.scheduleReads(nowUs);
+        }
+        int64_t rangeAgeSumUs = 0;
+        for (size_t i = 0; i < NUM_TOF_SENSORS; i++) {
+            const ToFReading tof = tofSensors.reading(i, nowUs);
+            rangeAgeSumUs += static_cast<int32_t>(tickUs - tof.capturedUs);
+            flightRecord.tofDistance[i] = tof.distance;
+            flightRecord.tofStrength[i] = tof.strength;
+            flightRecord.tofCapturedUs[i] = tof.capturedUs;
+        }
+
+        if (CONFIG::POSE_FILTER == CONFIG::EKF) {
+            tmpState.velocity.angular_velocity = poseFilter.turnRate();
+        } else if (CONFIG::POSE_FILTER == CONFIG::COMPLEMENTARY && arenaLocalisation && tofUpdated &&
+                   tofSensors.allCurrent(nowUs)) {
+            // with the heading aligned to the encoders, the ranges are older than it, each read at its own time:
+            // locate with the heading the robot had at their mean read time, and carry the fix forward by the
+            // motion since
+            Pose lag{};
+            if (CONFIG::IMU_HEADING_TIMING == CONFIG::AT_ENCODER_CAPTURE) {
+                const auto meanAgeUs = static_cast<int32_t>(rangeAgeSumUs / static_cast<int64_t>(NUM_TOF_SENSORS));
+                poseHistory.motionSince(tickUs - static_cast<uint32_t>(meanAgeUs), lag);
+            }
+            const ARENA_LOCALISATION::Fix fix = localisation(wrap_pi(tmpState.odometry.heading - lag.heading),
+                                                             tmpState.tofDistances);
+            if (fix.valid) {
+                localisationEstimate = {fix.pose.x + lag.x, fix.pose.y + lag.y, tmpState.odometry.heading};
+                tmpState.odometry = filterPositions(tmpState.odometry, localisationEstimate);
+                applyFixToDeadReckoning(fix);
+                lastRangeFixUs = tickUs;
+            }
         }
 
+        // publish how far the pose can be trusted alongside it; the particle filter's comes with its estimate
+        if (CONFIG::POSE_FILTER == CONFIG::EKF) {
+            using POSE_EKF::STATE::X;
+            using POSE_EKF::STATE::Y;
+            using POSE_EKF::STATE::HEADING;
+            tmpState.covariance = {poseFilter.covarianceOf(X, X), poseFilter.covarianceOf(X, Y),
+                                   poseFilter.covarianceOf(Y, Y), poseFilter.covarianceOf(HEADING, HEADING)};
+        } else if (CONFIG::POSE_FILTER == CONFIG::COMPLEMENTARY) {
+            tmpState.covariance = deadReckoning;
+        }
+        tmpState.health = health;
+        tmpState.health.sinceRangeFixUs = tickUs - lastRangeFixUs;
+
         // update the estimated states
         previousState = estimatedState;
         estimatedState = tmpState;
+        flightRecord.pose = estimatedState.odometry;
+        FLIGHT_RECORDER::record(flightRecord);
+
+        {
+            PROFILE_STAGE(PUBLISH_ESTIMATE);
+            estimateTopic.publish(estimatedState, tickUs);
+        }
+    }
+
+    void StateEstimator::fuseMeasurements(VehicleState& tmpState, const uint32_t tickUs) {
+        // the complementary filter reads the newest heading and ranges directly, so it only drains the queue
+        const float noRanges[NUM_TOF_SENSORS] = {NAN, NAN, NAN, NAN};
+        bool fused = false;
+        Measurement measurement{};
+        uint32_t takenUs;
+        while (measurements.pop(measurement, takenUs)) {
+            if (CONFIG::POSE_FILTER == CONFIG::COMPLEMENTARY) {
+                continue;
+            }
+            // rays off the robot itself or out of range are never fused
+            if (measurement.kind == Measurement::TOF_RANGE &&
+                (!arenaLocalisation || !arenaLocaliser.rayUsable(measurement.sensor, measurement.value))) {
+                continue;
+            }
+            // how far the robot has moved since the measurement was taken
+            Pose lag{};
+            if (!poseHistory.motionSince(takenUs, lag)) {
+                fusion.late++;
+                continue;
+            }
+            const auto ageUs = static_cast<int32_t>(tickUs - takenUs);
+            fusion.maxAgeUs = std::max(fusion.maxAgeUs, static_cast<uint32_t>(std::max(ageUs, 0)));
+            fusion.fused++;
+            fused = true;
+
+            if (measurement.kind == Measurement::IMU_YAW) {
+                const float yaw = measurement.value - IMUHeadingOffset;
+                if (CONFIG::POSE_FILTER == CONFIG::EKF) {
+                    PROFILE_STAGE(POSE_EKF);
+                    poseFilter.correctHeading(wrap_pi(yaw + lag.heading));
+                    noteInnovation(health.imu, poseFilter.normalisedInnovation(), true);
+                    if (!std::isnan(measurement.rate)) {
+                        poseFilter.correctTurnRate(measurement.rate);
+                    }
+                } else {
+                    PROFILE_STAGE(PARTICLE_FILTER);
+                    particleFilter.correct(yaw, noRanges, lag);
+                    noteInnovation(health.imu, 2.0f * particleFilter.surprise(), true);
+                }
+            } else {
+                InnovationStats& sensorHealth = health.tof[measurement.sensor];
+                bool accepted;
+                if (CONFIG::POSE_FILTER == CONFIG::EKF) {
+                    PROFILE_STAGE(POSE_EKF);
+                    accepted = poseFilter.correctRange(measurement.sensor, measurement.value, lag);
+                    noteInnovation(sensorHealth, poseFilter.normalisedInnovation(), accepted);
+                } else {
+                    PROFILE_STAGE(PARTICLE_FILTER);
+                    float ranges[NUM_TOF_SENSORS] = {NAN, NAN, NAN, NAN};
+                    ranges[measurement.sensor] = measurement.value;
+                    particleFilter.correct(NAN, ranges, lag);
+                    // a range no particle can explain better than an obstacle would is one
+                    accepted = particleFilter.surprise() < particleFilter.config.shortCost;
+                    noteInnovation(sensorHealth, 2.0f * particleFilter.surprise(), accepted);
+                }
+                if (accepted) {
+                    lastRangeFixUs = tickUs;
+                }
+            }
+        }
+
+        if (!fused) {
+            return;
+        }
+        if (CONFIG::POSE_FILTER == CONFIG::EKF) {
+            tmpState.odometry = poseFilter.pose();
+        } else {
+            PROFILE_STAGE(PARTICLE_FILTER);
+            const PARTICLE_LOCALISATION::Estimate particles = particleFilter.estimate();
+            tmpState.odometry = particles.pose;
+            tmpState.covariance = particles.covariance;
+        }
+    }
+
+    void StateEstimator::noteInnovation(InnovationStats& stats, const float normalisedInnovation, const bool accepted) {
+        // averaged over roughly the last twenty measurements
+        constexpr float AVERAGING = 0.05f;
+        if (std::isnan(normalisedInnovation)) {
+            return;
+        }
+        stats.normalisedInnovation += AVERAGING * (normalisedInnovation - stats.normalisedInnovation);
+        if (accepted) {
+            stats.accepted++;
+        } else {
+            stats.rejected++;
+        }
+    }
+
+    void StateEstimator::growDeadReckoning(const float distance) {
+        // the wheels' own error, plus the sideways error a heading as uncertain as the IMU's yaw makes
+        const POSE_EKF::NoiseConfig& noise = poseFilter.noise;
+        const float travelled = std::fabs(distance) * noise.odometrySlip + noise.odometryFloor;
+        const float headingVariance = noise.imuYaw * noise.imuYaw;
+        const float growth = travelled * travelled + distance * distance * headingVariance;
+        deadReckoning.xx += growth;
+        deadReckoning.yy += growth;
+        deadReckoning.heading = headingVariance;
+    }
+
+    void StateEstimator::applyFixToDeadReckoning(const ARENA_LOCALISATION::Fix& fix) {
+        // filterPositions() blends in the fix with localisation_weighting, so the variances blend with its square
+        const float kept = (1.0f - localisation_weighting) * (1.0f - localisation_weighting);
+        const float taken = localisation_weighting * localisation_weighting;
+        deadReckoning.xx = kept * deadReckoning.xx + taken * fix.variance / 2.0f;
+        deadReckoning.yy = kept * deadReckoning.yy + taken * fix.variance / 2.0f;
+        deadReckoning.xy *= kept;
+    }
+
+    void StateEstimator::enableImuReports() {
+        IMU->enableReport(IMU_HEADING_REPORT, CONFIG::IMU_REPORT_INTERVAL_US);
+    }
 
-        // notify observers of the new state
-        notifyObservers(estimatedState);
+    void StateEstimator::attachImuInterrupt() {
+        imuInterruptAttached = true;
+        if (CONFIG::IMU_SERVICE == CONFIG::INTERRUPT && !IMU->serviceOnInterrupt(CONFIG::IMU_INT_PIN)) {
+            printf("IMU has no I2C engine to read it from INT, polling instead\n");
+        }
     }
 
-    void StateEstimator::getLatestHeading(float& heading) {
+    bool StateEstimator::getLatestHeading(float& heading, float& yawRate, const uint32_t captureUs) {
+      PROFILE_STAGE(GET_HEADING);
       //default latest heading is the current heading
       heading = estimatedState.odometry.heading;
       
-      //if possible, update the heading with the latest from the IMU
-        if (IMU->getSensorEvent() == true) {
-            if (IMU->getSensorEventID() == SENSOR_REPORTID_ROTATION_VECTOR) {
-                heading = IMU->getYaw() - IMUHeadingOffset;
+      //if possible, update the heading with the latest from the IMU. Read from INT, the reports are already
+      // off the bus and decoding them doesn't touch it
+        const bool polled = !IMU->interruptDriven();
+        if (polled && !tryLockI2CBus()) {
+            return false;
+        }
+        // reports arrive faster than the estimator ticks, so decode everything that has queued up on the hub;
+        // when polling, the bound stops a backlog from holding the bus for the whole tick
+        const uint32_t reportLimit = polled ? CONFIG::IMU_REPORTS_PER_TICK : UINT32_MAX;
+        for (uint32_t i = 0; i < reportLimit && IMU->getSensorEvent(); i++) {
+        }
+        if (polled) {
+            unlockI2CBus();
+        }
+        // each heading report waits in its own queue, so a batch, or other reports decoded alongside, can't
+        // displace it; fuse them oldest first, each as of when the hub took it
+        const bool aligned = CONFIG::IMU_HEADING_TIMING == CONFIG::AT_ENCODER_CAPTURE;
+        bool updated = false;
+        float yaw = 0.0f;
+        BNO08xEvent event;
+        while (IMU->drainSensorEvents(IMU_HEADING_REPORT, &event, 1) == 1) {
+            yaw = BNO08x::eventYaw(event.value);
+            float rate = NAN;
+            if (IMU_HEADING_REPORT == SENSOR_REPORTID_GYRO_INTEGRATED_ROTATION_VECTOR) {
+                rate = event.value.un.gyroIntegratedRV.angVelZ;
+                yawRate = rate;
             }
+            updated = true;
+            imuHeading.add(event.sampleUs, yaw, rate);
+            measurements.channel(IMU_MEASUREMENTS).push({Measurement::IMU_YAW, 0, yaw, rate},
+                                                        aligned ? event.sampleUs : event.hostUs);
+        }
+        if (updated) {
+            // the rotation then belongs to the same instant as the wheels' travel
+            const float yawAtCapture = imuHeading.headingAt(captureUs);
+            heading = (aligned ? yawAtCapture : yaw) - IMUHeadingOffset;
+            flightRecord.imuYaw = yaw;
+            flightRecord.imuYawRate = yawRate;
+            flightRecord.imuReadUs = time_us_32();
         }
+        return updated;
     }
 
-    void StateEstimator::setupTimer() const {
-        // Example configuration (adjust as needed)
+    VehicleState StateEstimator::latestState() const {
+        return estimateTopic.read();
+    }
+
+    const Topic<VehicleState>& StateEstimator::estimate() const {
+        return estimateTopic;
+    }
 
-        // Set up the repeating timer with the callback
-        if (!add_repeating_timer_ms(timerInterval,
-                                    reinterpret_cast<repeating_timer_callback_t>(&StateEstimator::timerCallback),
+    void StateEstimator::setupTimer() const {
+        // The timer only requests an estimate; the work itself runs from the main loop via serviceEstimation()
+        // so the I2C traffic and maths don't hold off other interrupts. A negative delay keeps the requests
+        // on a fixed 10 ms grid rather than 10 ms after the previous callback returned.
+        if (!add_repeating_timer_ms(-static_cast<int32_t>(timerInterval), &StateEstimator::timerCallback,
                                     nullptr, timer)) {
-            // Handle error if timer creation fails
+            printf("State estimator timer could not be created\n");
         }
     }
 
-    void StateEstimator::timerCallback(repeating_timer_t *timer) {
+    bool StateEstimator::timerCallback(repeating_timer_t *timer) {
         if (instancePtr != nullptr) {
-            instancePtr->estimateState();
-            instancePtr->publishState();
+            instancePtr->estimationTask.trigger(time_us_32());
         }
+        return true;
     }
 
-    void StateEstimator::updateCurrentSteeringAngles(const SteeringAngles& newSteeringAngles) {
-        currentSteeringAngles = newSteeringAngles;
+    bool StateEstimator::serviceEstimation() {
+        if (!imuInterruptAttached) {
+            attachImuInterrupt();
+        }
+        if (!estimationTask.pending()) {
+            return false;
+        }
+        const uint32_t requests = reportRequests.load(std::memory_order_acquire);
+        if (requests != reportsServed) {
+            reportsServed = requests;
+            publishReport();
+        }
+        estimationTask.begin(time_us_32());
+        estimateState();
+        publishState();
+        estimationTask.end(time_us_32());
+        return true;
     }
 
-    void StateEstimator::zeroHeading() {
-        // function sets a heading_offset request such that the (new) heading will be zero
-        odometryOffsetRequest.heading = estimatedState.odometry.heading;
+    TaskTimingStats StateEstimator::estimationTiming() const {
+        return estimationTask.stats();
     }
 
-    void StateEstimator::requestOdometryOffset(float xOffset, float yOffset, float extraHeadingOffset){
-        odometryOffsetRequest.x = xOffset;
-        odometryOffsetRequest.y = yOffset;
-        odometryOffsetRequest.heading = extraHeadingOffset;
+    SampleIntervalStats StateEstimator::estimationInterval() const {
+        return tickInterval.stats();
     }
 
-    void StateEstimator::processOdometryOffsets(){
-        estimatedState.odometry.x = estimatedState.odometry.x - odometryOffsetRequest.x;
-        estimatedState.odometry.y = estimatedState.odometry.y - odometryOffsetRequest.y;
-        IMUHeadingOffset = IMUHeadingOffset + odometryOffsetRequest.heading;
-
-        // since we've applied the requested offsets, set them back to zero
-        odometryOffsetRequest.x = odometryOffsetRequest.y = odometryOffsetRequest.heading = 0;
+    HeadingAlignmentStats StateEstimator::imuAlignment() const {
+        return imuHeading.stats();
     }
 
-    pair<float, float> StateEstimator::calculatePossiblePositions(float angle, float distance) {
-        /**
-         * Calculates the potential X, Y positions of the robot based on a single distance measurement
-         * and the robot's heading. This method assumes the robot is facing a square arena and uses trigonometry
-         * to infer its position relative to the nearest wall.
-         *
-         * @param angle The current heading of the robot in radians.
-         * @param distance The distance measurement from a ToF sensor to the nearest wall.
-         * @return A pair of floats representing the estimated X or Y positions in the arena.
-         */
-        angle = wrap_pi(angle); //constrain(wrap) to our usual +/-pi range
+    const POSE_EKF::PoseEkf& StateEstimator::poseEkf() const {
+        return poseFilter;
+    }
 
-        float x_pos = 0.0f, y_pos = 0.0f;
+    const PARTICLE_LOCALISATION::ParticleLocaliser& StateEstimator::particleLocaliser() const {
+        return particleFilter;
+    }
 
-        if (angle < 0) {
-            x_pos = CONFIG::ARENA_SIZE - distance * cos(angle + M_PI / 2);
-        } else {
-            x_pos = distance * cos(angle + 1.5f * M_PI);
+    void StateEstimator::publishReport() {
+        EstimationReport current{};
+        current.timing = estimationTask.stats();
+        current.interval = tickInterval.stats();
+        if (CONFIG::POSE_FILTER == CONFIG::EKF) {
+            current.sigmaX = sqrtf(poseFilter.variance(POSE_EKF::STATE::X));
+            current.sigmaY = sqrtf(poseFilter.variance(POSE_EKF::STATE::Y));
+            current.sigmaHeading = sqrtf(poseFilter.variance(POSE_EKF::STATE::HEADING));
+            current.ranges = poseFilter.rangeStats();
+        } else if (CONFIG::POSE_FILTER == CONFIG::PARTICLE) {
+            current.particles = particleFilter.estimate();
+            current.particleCounts = particleFilter.stats();
+            current.particleCount = particleFilter.count();
         }
+        if (CONFIG::POSE_FILTER != CONFIG::COMPLEMENTARY) {
+            const uint32_t drops = measurements.dropped();
+            current.fusion = fusion;
+            current.queueDrops = drops - reportedDrops;
+            current.historySpanUs = poseHistory.spanUs();
+            reportedDrops = drops;
+            fusion = {};
+        }
+        for (size_t i = 0; i < NUM_TOF_SENSORS; i++) {
+            current.tof[i] = tofSensors.stats(i);
+        }
+        current.imuBus = IMU->busStats();
+        current.droppedHeadingReports = IMU->droppedSensorEvents(IMU_HEADING_REPORT);
+        current.alignment = imuHeading.stats();
+        report.write(current);
+        IMU->resetBusStats();
+        imuHeading.resetStats();
+        estimationTask.resetStats();
+        tickInterval.resetStats();
+    }
 
-        if ((angle < (0.5f * M_PI)) && (angle > (-0.5f * M_PI))) {
-            y_pos = CONFIG::ARENA_SIZE - distance * cos(angle);
-        } else {
-            y_pos = distance * cos(angle + M_PI);
+    void StateEstimator::showEstimationTiming() {
+        EstimationReport current;
+        const bool reported = report.read(current) != 0;
+        reportRequests.store(reportRequests.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        if (!reported) {
+            return;
         }
+        const TaskTimingStats& stats = current.timing;
+        printf("estimation: %lu runs, %lu deadline misses, %lu skipped, latency %lu/%.0f/%lu us (min/mean/max), "
+               "jitter %lu us, execution %lu us\n",
+               (unsigned long) stats.runs, (unsigned long) stats.deadlineMisses, (unsigned long) stats.skippedTriggers,
+               (unsigned long) stats.minLatencyUs, stats.meanLatencyUs, (unsigned long) stats.maxLatencyUs,
+               (unsigned long) stats.maxJitterUs, (unsigned long) stats.maxExecutionUs);
+        const SampleIntervalStats& interval = current.interval;
+        printf("estimation dt: %lu/%.0f/%lu us (min/mean/max), jitter %lu us\n",
+               (unsigned long) interval.minIntervalUs, interval.meanIntervalUs, (unsigned long) interval.maxIntervalUs,
+               (unsigned long) interval.maxJitterUs);
+        if (CONFIG::POSE_FILTER == CONFIG::EKF) {
+            printf("pose ekf: sigma x %.3f y %.3f m heading %.3f rad, ranges %lu fused, %lu rejected, %lu skipped\n",
+                   current.sigmaX, current.sigmaY, current.sigmaHeading, (unsigned long) current.ranges.accepted,
+                   (unsigned long) current.ranges.rejected, (unsigned long) current.ranges.skipped);
+        } else if (CONFIG::POSE_FILTER == CONFIG::PARTICLE) {
+            const PARTICLE_LOCALISATION::Estimate& particles = current.particles;
+            const PARTICLE_LOCALISATION::Stats& counts = current.particleCounts;
+            printf("particle filter: %u particles, %.0f effective, spread %.3f m heading %.3f rad, %lu resamples, "
+                   "%lu rays cast, %lu missed the map\n",
+                   (unsigned) current.particleCount, particles.effectiveParticles, particles.positionSpread,
+                   particles.headingSpread, (unsigned long) counts.resamples, (unsigned long) counts.raysCast,
+                   (unsigned long) counts.raysMissed);
+        }
+        if (CONFIG::POSE_FILTER != CONFIG::COMPLEMENTARY) {
+            printf("fusion: %lu measurements fused, oldest %lu us, %lu older than the %lu us pose history, "
+                   "%lu dropped by a full queue\n",
+                   (unsigned long) current.fusion.fused, (unsigned long) current.fusion.maxAgeUs,
+                   (unsigned long) current.fusion.late, (unsigned long) current.historySpanUs,
+                   (unsigned long) current.queueDrops);
+        }
+        const EstimatorHealth health = latestState().health;
+        printf("health: imu nis %.2f, tof nis %.2f/%.2f/%.2f/%.2f rejected %lu/%lu/%lu/%lu (front/right/rear/left), "
+               "last range fix %lu ms ago\n",
+               health.imu.normalisedInnovation, health.tof[0].normalisedInnovation,
+               health.tof[1].normalisedInnovation, health.tof[2].normalisedInnovation,
+               health.tof[3].normalisedInnovation, (unsigned long) health.tof[0].rejected,
+               (unsigned long) health.tof[1].rejected, (unsigned long) health.tof[2].rejected,
+               (unsigned long) health.tof[3].rejected, (unsigned long) (health.sinceRangeFixUs / 1000));
+        const char* const tofNames[NUM_TOF_SENSORS] = {"front", "right", "rear", "left"};
+        printf("tof frames:");
+        for (size_t i = 0; i < NUM_TOF_SENSORS; i++) {
+            const ToFStats& tof = current.tof[i];
+            printf(" %s %lu (%lu bad, %lu weak, %lu out of range, %lu held back)", tofNames[i],
+                   (unsigned long) tof.frames, (unsigned long) tof.badFrames, (unsigned long) tof.weak,
+                   (unsigned long) tof.outOfRange, (unsigned long) tof.heldBack);
+        }
+        printf("\n");
+        const BNO08xBusStats& bus = current.imuBus;
+        printf("imu bus: %lu reads (%lu empty), %.2f wire bytes per cargo byte, %lu heading reports overwritten\n",
+               (unsigned long) bus.reads, (unsigned long) bus.emptyReads,
+               bus.cargoBytes > 0 ? (double) bus.wireBytes / bus.cargoBytes : 0.0,
+               (unsigned long) current.droppedHeadingReports);
+        const HeadingAlignmentStats& alignment = current.alignment;
+        printf("imu heading at capture: %lu interpolated, %lu extrapolated, %lu unaligned, newest sample %.0f/%ld us "
+               "old (mean/max); residual skew %.0f us as read, %.0f us aligned over %lu checks\n",
+               (unsigned long) alignment.interpolated, (unsigned long) alignment.extrapolated,
+               (unsigned long) alignment.unaligned, alignment.meanSampleAgeUs, (long) alignment.maxSampleAgeUs,
+               alignment.rawSkewUs, alignment.alignedSkewUs, (unsigned long) alignment.checked);
+    }
 
-        return {x_pos, y_pos};
+    void StateEstimator::updateCurrentSteeringAngles(const SteeringAngles& newSteeringAngles) {
+        currentSteeringAngles = newSteeringAngles;
     }
 
-    Pose StateEstimator::localisation(float heading, FourToFDistances tof_distances) {
-        /**
-         * Estimates the robot's position within the arena by aggregating distance measurements from all ToF sensors.
-         * It calculates potential positions for each sensor based on the robot's current heading and the sensor readings,
-         * then combines these estimates to produce a more accurate localization within the arena.
-         *
-         * @param heading The current heading of the robot in radians.
-         * @param tof_distances A struct containing distance measurements from all ToF sensors.
-         * @return A Pose struct representing the estimated position (X, Y) of the robot.
-         */
+    void StateEstimator::zeroHeading() {
+        // function sets a heading_offset request such that the (new) heading will be zero
+        headingOffsetRequest.write(latestState().odometry.heading);
+    }
 
-        // Calculate possible positions for each sensor
-        // these are inferred possible positions, depending on which arena wall each sensor 
-        // is measuring, the sensor could be used to infer an x position or y position
-        auto [Fx, Fy] = calculatePossiblePositions(heading, tof_distances.front);
-        auto [Rx, Ry] = calculatePossiblePositions(heading - M_PI_2, tof_distances.right);
-        auto [Bx, By] = calculatePossiblePositions(heading - M_PI, tof_distances.rear);
-        auto [Lx, Ly] = calculatePossiblePositions(heading - 3 * M_PI_2, tof_distances.left);
-
-        // Combine the calculated positions into lists for easier manipulation
-        std::array<float, NUM_TOF_SENSORS> x_positions = {Fx, Rx, Bx, Lx};
-        std::array<float, NUM_TOF_SENSORS> y_positions = {Fy, Ry, By, Ly};
-
-        // evaluate all the possible purmutation of the positions and return the best-fitting position
-        return evaluatePositionPermutations(heading, x_positions, y_positions);
-    }
-
-    Pose StateEstimator::evaluatePositionPermutations(
-            float heading,
-            const std::array<float, NUM_TOF_SENSORS>& xPositions,
-            const std::array<float, NUM_TOF_SENSORS>& yPositions){
-     // evaluate all the possible purmutation of the positions and return the
-     // best-fitting position. The position is based on an arena-centre origin
-     
-        float lowestVariance = numeric_limits<float>::max();
-        Pose bestEstimate = {0.0f, 0.0f, 0.0f};
-        
-        for (int permutationNo = 1; permutationNo < NUM_PERMUTATIONS; ++permutationNo) {
-            // create 16 permutations (all the possible combinations of the two lists of possible
-            // positions), then iterate through them to check which is most self-consistent (lowest
-            // variance), assume that permutation is the most likely, best estimate of our position
-            PermutationResult permutation = createPermutation(permutationNo, xPositions, yPositions);
-            auto [totalVariance, xMean, yMean] = calculateCoordinateVariance(permutation);
-            
-            if (totalVariance < lowestVariance) {
-                lowestVariance = totalVariance;
-                bestEstimate.x = driveDirection * (xMean - CONFIG::ARENA_SIZE/2);
-                bestEstimate.y = driveDirection * (yMean - CONFIG::ARENA_SIZE/2);
-                bestEstimate.heading = heading;
-            }
+    void StateEstimator::requestOdometryOffset(float xOffset, float yOffset, float extraHeadingOffset){
+        // may be called from the other core; the request is picked up by the next estimate
+        positionOffsetRequest.write({xOffset, yOffset});
+        headingOffsetRequest.write(extraHeadingOffset);
+    }
+
+    void StateEstimator::processOdometryOffsets(){
+        Pose request{};
+        Point position{};
+        float heading = 0.0f;
+        const uint32_t positionSequence = positionOffsetRequest.read(position);
+        const uint32_t headingSequence = headingOffsetRequest.read(heading);
+        if (positionSequence == appliedPositionSequence && headingSequence == appliedHeadingSequence) {
+            return;
         }
-        
-        return bestEstimate;
+        if (positionSequence != appliedPositionSequence) {
+            request.x = position.x;
+            request.y = position.y;
+        }
+        if (headingSequence != appliedHeadingSequence) {
+            request.heading = heading;
         }
+        estimatedState.odometry.x = estimatedState.odometry.x - request.x;
+        estimatedState.odometry.y = estimatedState.odometry.y - request.y;
+        IMUHeadingOffset = IMUHeadingOffset + request.heading;
+        poseFilter.shift(-request.x, -request.y, -request.heading);
+        particleFilter.shift(-request.x, -request.y, -request.heading);
+
+        // remember which requests we've applied so they aren't applied again
+        appliedPositionSequence = positionSequence;
+        appliedHeadingSequence = headingSequence;
+    }
 
-    tuple<float, float, float> StateEstimator::calculateCoordinateVariance(const PermutationResult& result) {
+    ARENA_LOCALISATION::Fix StateEstimator::localisation(float heading, const FourToFDistances& tof_distances) {
+        PROFILE_STAGE(LOCALISATION);
         /**
-         * Computes the variance and mean of X and Y position estimates within the limits of valid data points as specified in the PermutationResult.
-         * The function calculates the mean for X and Y positions separately, then determines the variance for each set based on the deviation from their respective means.
-         * The total variance is the sum of the X and Y variances. This approach ensures only valid data points are considered, aligning with the static allocation strategy in embedded systems.
+         * Estimates the robot's position within the arena from the four ToF ranges and the current heading.
+         * Each range could be to an x wall or a y wall; the localiser picks the choice of walls that makes the
+         * ranges most self-consistent, leaving out rays that hit the robot itself or are out of range.
          *
-         * @param result The result structure from createPermutation containing X and Y positions with their valid counts.
-         * @return A tuple with the total variance, mean of X positions, and mean of Y positions.
+         * @param heading The current heading of the robot in radians.
+         * @param tof_distances A struct containing distance measurements from all ToF sensors.
+         * @return The arena-centred fix, which is only valid if enough of the rays could be used.
          */
-
-        float xMean = std::accumulate(result.xList.begin(), result.xList.begin() + result.xSize, 0.0f) / result.xSize;
-        float yMean = std::accumulate(result.yList.begin(), result.yList.begin() + result.ySize, 0.0f) / result.ySize;
-
-        // Calculate variances
-        auto xVariance = std::accumulate(result.xList.begin(), result.xList.begin() + result.xSize, 0.0f,
-                                        [xMean](float acc, float x) { return acc + std::pow(x - xMean, 2); }) / result.xSize;
-        auto yVariance = std::accumulate(result.yList.begin(), result.yList.begin() + result.ySize, 0.0f,
-                                        [yMean](float acc, float y) { return acc + std::pow(y - yMean, 2); }) / result.ySize;
-
-        float totalVariance = xVariance + yVariance;
-
-        return {totalVariance, xMean, yMean};
+        return arenaLocaliser.locate(heading, tof_distances);
     }
 
     Pose StateEstimator::filterPositions(Pose odometryEstimate, Pose localisationEstimate){
+        PROFILE_STAGE(FILTER_POSITIONS);
         /**
          * Combines the odometry and localization estimates to produce a filtered position estimate.
          * This method uses a weighted average approach to merge the estimates, potentially improving
@@ -401,36 +777,6 @@ namespace STATE_ESTIMATOR {
     }
 
 
-    StateEstimator::PermutationResult StateEstimator::createPermutation(
-            int permutation,
-            const std::array<float, NUM_TOF_SENSORS>& xPositions,
-            const std::array<float, NUM_TOF_SENSORS>& yPositions) {
-        /**
-         * Generates a specific permutation of valid X and Y position estimates based on the given permutation number.
-         * The permutation number is interpreted as a binary representation, where each bit indicates whether a position
-         * from the input X or Y positions list is selected. Positions corresponding to '1' bits are added to the Y list,
-         * and positions corresponding to '0' bits are added to the X list. The function returns arrays containing the
-         * selected positions along with the actual count of valid positions in each array.
-         *
-        * @param permutation The permutation number, interpreted as a binary pattern for selecting X or Y positions.
-        * @param xPositions The array of potential X positions.
-        * @param yPositions The array of potential Y positions.
-        * @return A structure containing the X and Y lists along with their counts of valid elements.
-        */
-        std::array<float, NUM_TOF_SENSORS> xList = {0.0f};
-        std::array<float, NUM_TOF_SENSORS> yList = {0.0f};
-        size_t xSize = 0, ySize = 0;
-        bitset<4> binary(permutation);
-        for (size_t sensor = 0; sensor < NUM_TOF_SENSORS; ++sensor) {
-            if (binary[sensor]) {
-                yList[ySize++] = yPositions[sensor];
-            } else {
-                xList[xSize++] = xPositions[sensor];
-            }
-        }
-        return {xList, yList, xSize, ySize};
-    }
-
     StateEstimator::~StateEstimator() {
         delete encoders[MOTOR_POSITION::FRONT_LEFT];
         delete encoders[MOTOR_POSITION::FRONT_RIGHT];
@@ -5,13 +5,13 @@
 #ifndef OSOD_MOTOR_2040_STATEMANAGER_H
 #define OSOD_MOTOR_2040_STATEMANAGER_H
 
-#include "interfaces.h"
 #include "types.h"
 #include "receiver.h"
 #include "state_estimator.h"
 #include "stoker.h"
 #include "mixer_strategy.h"
 #include "servo.hpp"
+#include "seqlock.h"
 
 namespace STATEMANAGER {
     using namespace COMMON;
@@ -28,6 +28,14 @@ namespace STATEMANAGER {
 
         void requestState(const COMMON::VehicleState& requestedState);
 
+        // When deferred, requestState() only publishes the mixed drive train state and the motors and
+        // servos are driven by applyRequestedState() on the core that runs the state estimator.
+        void setDeferredActuation(bool deferred);
+
+        // Applies the most recently requested drive train state, if it hasn't been applied yet.
+        // Returns true if the actuators were updated.
+        bool applyRequestedState();
+
         void setServoSteeringAngle(const DriveTrainState& driveTrainState, CONFIG::Handedness side) const;
 
     private:
@@ -36,9 +44,9 @@ namespace STATEMANAGER {
         DriveTrainState currentDriveTrainState{};
         STOKER::Stoker* stokers[MOTOR_POSITION::MOTOR_POSITION_COUNT] = {};
         SteeringServos steering_servos{};
-
-        Observer* observers[MOTOR_POSITION::MOTOR_POSITION_COUNT] = {};
-        int observerCount = 0;
+        bool deferredActuation = false;
+        SeqLock<DriveTrainState> requestedDriveTrainState;
+        uint32_t appliedRequestSequence = 0;
 
         void setDriveTrainState(const DriveTrainState& motorSpeeds);
 
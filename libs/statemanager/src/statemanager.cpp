@@ -5,6 +5,8 @@
 #include <cstdio>
 #include "state_estimator.h"
 #include "statemanager.h"
+#include "profiler.h"
+#include "flight_recorder.h"
 
 #include <libraries/pico_synth/pico_synth.hpp>
 #include <libraries/servo2040/servo2040.hpp>
@@ -23,15 +25,14 @@ namespace STATEMANAGER {
     StateManager::StateManager(MIXER::MixerStrategy *mixerStrategy, STATE_ESTIMATOR::StateEstimator *stateEstimator) : mixerStrategy(mixerStrategy), stateEstimator(stateEstimator) {
         printf("creating State manager\n");
         // set up the stokers
-        stokers[MOTOR_POSITION::FRONT_LEFT] = new STOKER::Stoker(motor::motor2040::MOTOR_A, MOTOR_POSITION::FRONT_LEFT, Direction::REVERSED_DIR);
-        stokers[MOTOR_POSITION::FRONT_RIGHT] = new STOKER::Stoker(motor::motor2040::MOTOR_B, MOTOR_POSITION::FRONT_RIGHT, Direction::REVERSED_DIR);
-        stokers[MOTOR_POSITION::REAR_LEFT] = new STOKER::Stoker(motor::motor2040::MOTOR_C, MOTOR_POSITION::REAR_LEFT, Direction::REVERSED_DIR);
-        stokers[MOTOR_POSITION::REAR_RIGHT] = new STOKER::Stoker(motor::motor2040::MOTOR_D, MOTOR_POSITION::REAR_RIGHT, Direction::REVERSED_DIR);
-
-        stateEstimator->addObserver(stokers[MOTOR_POSITION::FRONT_LEFT]);
-        stateEstimator->addObserver(stokers[MOTOR_POSITION::FRONT_RIGHT]);
-        stateEstimator->addObserver(stokers[MOTOR_POSITION::REAR_LEFT]);
-        stateEstimator->addObserver(stokers[MOTOR_POSITION::REAR_RIGHT]);
+        stokers[MOTOR_POSITION::FRONT_LEFT] = new STOKER::Stoker(motor::motor2040::MOTOR_A, MOTOR_POSITION::FRONT_LEFT, Direction::REVERSED_DIR,
+                                                                   stateEstimator->estimate());
+        stokers[MOTOR_POSITION::FRONT_RIGHT] = new STOKER::Stoker(motor::motor2040::MOTOR_B, MOTOR_POSITION::FRONT_RIGHT, Direction::REVERSED_DIR,
+                                                                   stateEstimator->estimate());
+        stokers[MOTOR_POSITION::REAR_LEFT] = new STOKER::Stoker(motor::motor2040::MOTOR_C, MOTOR_POSITION::REAR_LEFT, Direction::REVERSED_DIR,
+                                                                   stateEstimator->estimate());
+        stokers[MOTOR_POSITION::REAR_RIGHT] = new STOKER::Stoker(motor::motor2040::MOTOR_D, MOTOR_POSITION::REAR_RIGHT, Direction::REVERSED_DIR,
+                                                                   stateEstimator->estimate());
 
         // set up the servos
         // left - ADC2 / PWM 6 - Pin 28
@@ -46,8 +47,33 @@ namespace STATEMANAGER {
         //printf("Velocity: %f ", requestedState.velocity);
         //printf("Angular velocity: %f ", requestedState.angularVelocity);
         //printf("\n");
-        const DriveTrainState driveTrainState = mixerStrategy->mix(requestedState.velocity.velocity, requestedState.velocity.angular_velocity);
+        PROFILE_STAGE(REQUEST_STATE);
+        FLIGHT_RECORDER::noteRequestedState(requestedState.velocity.velocity, requestedState.velocity.angular_velocity);
+        DriveTrainState driveTrainState;
+        {
+            PROFILE_STAGE(MIX);
+            driveTrainState = mixerStrategy->mix(requestedState.velocity.velocity, requestedState.velocity.angular_velocity);
+        }
+        if (deferredActuation) {
+            requestedDriveTrainState.write(driveTrainState);
+        } else {
+            setDriveTrainState(driveTrainState);
+        }
+    }
+
+    void StateManager::setDeferredActuation(const bool deferred) {
+        deferredActuation = deferred;
+    }
+
+    bool StateManager::applyRequestedState() {
+        DriveTrainState driveTrainState{};
+        const uint32_t sequence = requestedDriveTrainState.read(driveTrainState);
+        if (sequence == appliedRequestSequence) {
+            return false;
+        }
+        appliedRequestSequence = sequence;
         setDriveTrainState(driveTrainState);
+        return true;
     }
 
     void StateManager::setServoSteeringAngle(const DriveTrainState& driveTrainState, const CONFIG::Handedness side) const {
@@ -86,6 +112,7 @@ namespace STATEMANAGER {
 
         // save the current state
         currentDriveTrainState = motorSpeeds;
+        FLIGHT_RECORDER::noteDriveTrainState(motorSpeeds);
 
         // update the state estimator with the current steering angles
         stateEstimator->updateCurrentSteeringAngles(motorSpeeds.angles);
@@ -5,37 +5,38 @@
 #ifndef OSOD_MOTOR_2040_STOKER_H
 #define OSOD_MOTOR_2040_STOKER_H
 
-#include "interfaces.h"
+#include "types.h"
+#include "topic.h"
 #include "drivers/motor/motor.hpp"
 #include "drivetrain_config.h"
-#include "pid.hpp"
+#include "timed_pid.h"
+#include "task_timing.h"
 
 namespace STOKER {
     using namespace COMMON;
-    class Stoker: public Observer {
+    class Stoker {
     protected:
         ~Stoker() = default;
 
     public:
-        Stoker(const pin_pair &pins, MOTOR_POSITION::MotorPosition position, Direction direction);
+        Stoker(const pin_pair &pins, MOTOR_POSITION::MotorPosition position, Direction direction,
+               const Topic<VehicleState>& estimate);
         void set_speed(float speed);
 
-        void update(VehicleState newState) override;
-
         float pseudo_current_limit(float current_speed, float command_speed);
 
     private:
         motor::Motor motor;
+        Subscription<VehicleState> estimate; // only this wheel's speed is pulled from each estimate
         float current_motor_speed = 0.0f;
         MOTOR_POSITION::MotorPosition motor_position_;
         float max_speed_change = CONFIG::MAX_CURRENT / CONFIG::STALL_CURRENT * CONFIG::SPEED_SCALE_RADIANS_PER_SEC;
 
-        /* UPDATE_RATE is a fixed number for now. 
-        note the parameter doesn't drive updates, it's just used for scaling PID parameters 
-        TODO: allow update rate to be settable on iniitalisation 
-         and independent of calls to set_speed(), see issue #42 */
-        float UPDATE_RATE = 0.02; //seconds
-        PID vel_pid = PID(CONFIG::VEL_KP, CONFIG::VEL_KI, CONFIG::VEL_KD, UPDATE_RATE);
+        // the velocity loop runs on the time between the estimates it is given, not on how often
+        // set_speed() is called; nominally every other estimate, as set_speed() follows the 50 Hz navigator
+        static constexpr uint32_t NOMINAL_UPDATE_US = 20000;
+        SampleInterval measurementInterval{NOMINAL_UPDATE_US};
+        TimedPID vel_pid = TimedPID(CONFIG::VEL_KP, CONFIG::VEL_KI, CONFIG::VEL_KD);
     };
 
 } // STOKER
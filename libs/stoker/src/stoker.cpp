@@ -3,32 +3,48 @@
 //
 
 #include "../include/stoker.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "pico/stdlib.h"
 
-#include <cstdio>
 #include <algorithm>
 
 namespace STOKER {
     Stoker::Stoker(const pin_pair& pins, const MOTOR_POSITION::MotorPosition position,
-                   Direction direction = Direction::NORMAL_DIR) : motor(pins, direction,
+                   Direction direction, const Topic<VehicleState>& estimate) : motor(pins, direction,
                                                                         CONFIG::SPEED_SCALE_RADIANS_PER_SEC),
+                                                                  estimate(estimate),
                                                                   motor_position_(position) {
         motor.init();
     }
 
     void Stoker::set_speed(const float speed) {
+        PROFILE_STAGE(SET_SPEED);
+        current_motor_speed = estimate.take([this](const VehicleState& state) {
+            return state.driveTrainState.speeds[motor_position_];
+        });
+        const float dt = measurementInterval.update(estimate.stamp().timestampUs);
         vel_pid.setpoint = speed;
-        float accel = vel_pid.calculate(current_motor_speed);
+        float accel = vel_pid.calculate(current_motor_speed, dt);
         float command_speed = speed + accel;
 
-        motor.speed(pseudo_current_limit(current_motor_speed, command_speed));
-        
-        // print the motor position, current motors peed, speed, accel, and (speed + accel)
-        printf("millis(): %u  : %d, current motor speed: %f, setpoint: %f, accel: %f, duty: %f\n",
-               millis(), motor_position_, current_motor_speed, speed, accel, motor.duty());
-    }
-
-    void Stoker::update(const VehicleState newState) {
-        current_motor_speed = newState.driveTrainState.speeds[motor_position_];
+        float limited_speed = pseudo_current_limit(current_motor_speed, command_speed);
+        motor.speed(limited_speed);
+
+        // report the loop through telemetry rather than printf, which would block on USB here
+        const uint32_t now = time_us_32();
+        TELEMETRY::MotorRecord record = {};
+        record.timeUs = now;
+        record.measuredSpeed = current_motor_speed;
+        record.setpoint = speed;
+        record.command = command_speed;
+        record.limitedCommand = limited_speed;
+        record.duty = motor.duty();
+        record.motor = static_cast<uint8_t>(motor_position_);
+        record.currentLimited = limited_speed != command_speed;
+        TELEMETRY::emit(record);
+        TELEMETRY::emit(TELEMETRY::pidRecord(now, static_cast<uint8_t>(motor_position_), vel_pid,
+                                             current_motor_speed, accel));
     }
 
 
@@ -38,13 +54,8 @@ namespace STOKER {
         // units, but must be the same units as CONFIG::SPEED_SCALE_RADIANS_PER_SEC (which is assumed
         // to be the no load speed). aims to limit the current to +/-CONFIG::CURRENT_LIMIT Amps.
 
-        float current_limited_speed = std::clamp(command_speed, current_speed - max_speed_change, current_speed + max_speed_change);
-
-        if (command_speed != current_limited_speed){
-            printf("motor: %d's command limited from %f to %f, to reduce current draw\n",
-                                         motor_position_, command_speed, current_limited_speed);
-        }
-        return current_limited_speed;
+        // when the limit is hit set_speed() flags it in the motor's telemetry record
+        return std::clamp(command_speed, current_speed - max_speed_change, current_speed + max_speed_change);
     }
 
 } // STOKER
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef OSOD_MOTOR_2040_SPSC_RING_H
+#define OSOD_MOTOR_2040_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Lock-free single-producer, single-consumer byte ring.
+ *
+ * The producer and consumer may run on different cores; neither ever waits for the other. Head and
+ * tail are free-running counters, each written by one side only, so only plain atomic loads and
+ * stores are needed (the RP2040's Cortex-M0+ has no read-modify-write atomics). Writes are all or
+ * nothing: a write that doesn't fit is refused rather than split, so the ring only ever holds whole
+ * records.
+ */
+template<size_t CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "ring capacity must be a power of two");
+
+public:
+    // producer side
+    bool write(const uint8_t* data, size_t length) {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        if (length > CAPACITY - (head - tail)) {
+            return false;
+        }
+        for (size_t i = 0; i < length; i++) {
+            buffer[(head + i) & MASK] = data[i];
+        }
+        head_.store(head + static_cast<uint32_t>(length), std::memory_order_release);
+        return true;
+    }
+
+    // consumer side: copies up to length bytes starting offset bytes past the tail without consuming them
+    size_t peek(uint8_t* data, size_t length, size_t offset = 0) const {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t available = head_.load(std::memory_order_acquire) - tail;
+        if (offset >= available) {
+            return 0;
+        }
+        if (length > available - offset) {
+            length = available - offset;
+        }
+        for (size_t i = 0; i < length; i++) {
+            data[i] = buffer[(tail + offset + i) & MASK];
+        }
+        return length;
+    }
+
+    void consume(size_t length) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + static_cast<uint32_t>(length), std::memory_order_release);
+    }
+
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() {
+        return CAPACITY;
+    }
+
+private:
+    static constexpr uint32_t MASK = CAPACITY - 1;
+
+    uint8_t buffer[CAPACITY] = {};
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+};
+
+#endif //OSOD_MOTOR_2040_SPSC_RING_H
@@ -0,0 +1,182 @@
+#ifndef OSOD_MOTOR_2040_TELEMETRY_H
+#define OSOD_MOTOR_2040_TELEMETRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "types.h"
+#include "timed_pid.h"
+
+/*
+ * Framed binary telemetry.
+ *
+ * The control path emits fixed-layout records instead of printing. emit() frames the record and copies
+ * it into a lock-free ring for the calling core, which takes a few microseconds and never blocks; if
+ * the ring is full the record is dropped and counted. drain(), called from the main loop when there is
+ * nothing more urgent to do, moves whole frames from the rings to the sink (USB CDC stdio on target,
+ * stdout or a capture file on the host).
+ *
+ * Each core's ring has a single producer, so records may be emitted from main-loop context on either
+ * core but not from interrupt handlers. drain() must only be called from one core.
+ *
+ * Frame layout, little-endian:
+ *
+ *   0xA5 0x5A | type | payload length | source core | sequence | payload | Fletcher-16 of type..payload
+ *
+ * The sequence counts frames per source core, so a decoder can tell how many were dropped. Frames can
+ * share the stream with printf text; the decoder skips anything that isn't a valid frame.
+ */
+
+namespace TELEMETRY {
+    constexpr uint8_t SYNC_0 = 0xA5;
+    constexpr uint8_t SYNC_1 = 0x5A;
+    constexpr size_t HEADER_SIZE = 6;
+    constexpr size_t CHECKSUM_SIZE = 2;
+    constexpr size_t FRAME_OVERHEAD = HEADER_SIZE + CHECKSUM_SIZE;
+    constexpr size_t MAX_PAYLOAD = 192;
+    constexpr size_t MAX_FRAME_SIZE = FRAME_OVERHEAD + MAX_PAYLOAD;
+
+    constexpr size_t CORE_COUNT = 2;
+    constexpr size_t RING_CAPACITY = 4096; // bytes per core, about 100 ms of the full record set
+    constexpr size_t DRAIN_BUDGET_BYTES = 512; // per drain() call, so a slow host can't stall the main loop
+
+    namespace RECORD {
+        enum Type : uint8_t {
+            VEHICLE_STATE = 1,
+            MOTOR = 2,
+            PID = 3,
+            WAYPOINT = 4,
+            FLIGHT_RECORD = 5, // FLIGHT_RECORDER::TickRecord, only sent in a flight recorder dump
+            ESTIMATOR_HEALTH = 6,
+        };
+    }
+
+    namespace PID_LOOP {
+        // the four motor velocity loops use their COMMON::MOTOR_POSITION index
+        enum Loop : uint8_t {
+            WAYPOINT_HEADING = COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT,
+        };
+    }
+
+    // published by the state estimator after every estimate
+    struct VehicleStateRecord {
+        uint32_t timeUs;
+        float x;
+        float y;
+        float heading;
+        float velocity;
+        float angularVelocity;
+        float xDot;
+        float yDot;
+        float wheelSpeeds[COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT];
+        float steeringLeft;
+        float steeringRight;
+        float tofDistances[COMMON::NUM_TOF_SENSORS];
+        float wheelSlip[COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT];
+    };
+
+    // published by the state estimator with each VehicleStateRecord: the pose's uncertainty and how well each
+    // sensor agrees with the pose filter (COMMON::EstimatorHealth)
+    struct EstimatorHealthRecord {
+        uint32_t timeUs;
+        float covarianceXX;     // m²
+        float covarianceXY;
+        float covarianceYY;
+        float headingVariance;  // rad²
+        float imuNormalisedInnovation;
+        float tofNormalisedInnovation[COMMON::NUM_TOF_SENSORS];
+        uint32_t sinceRangeFixUs;
+        uint32_t imuAccepted;
+        uint32_t tofAccepted[COMMON::NUM_TOF_SENSORS];
+        uint32_t tofRejected[COMMON::NUM_TOF_SENSORS];
+    };
+
+    // one per stoker per set_speed()
+    struct MotorRecord {
+        uint32_t timeUs;
+        float measuredSpeed;
+        float setpoint;
+        float command;          // setpoint plus the velocity loop's correction
+        float limitedCommand;   // command after the pseudo current limit
+        float duty;
+        uint8_t motor;          // COMMON::MOTOR_POSITION
+        uint8_t currentLimited; // 1 if the current limit changed the command
+        uint8_t reserved[2];
+    };
+
+    // the terms of one PID calculation; see pidRecord()
+    struct PidRecord {
+        uint32_t timeUs;
+        float setpoint;
+        float measurement;
+        float pTerm;
+        float iTerm;
+        float dTerm;
+        float output;
+        float dt;               // measured time since the loop's previous sample, in seconds
+        uint8_t loop;           // PID_LOOP, or a motor position
+        uint8_t reserved[3];
+    };
+
+    // one per WaypointNavigation::navigate()
+    struct WaypointRecord {
+        uint32_t timeUs;
+        float distanceToGo;
+        float bearing;
+        float desiredV;
+        float desiredW;
+        float x;
+        float y;
+        float heading;
+        uint8_t targetIndex;
+        uint8_t nearestIndex;
+        uint8_t reserved[2];
+    };
+
+    static_assert(sizeof(VehicleStateRecord) == 88, "telemetry records have a fixed layout");
+    static_assert(sizeof(MotorRecord) == 28, "telemetry records have a fixed layout");
+    static_assert(sizeof(PidRecord) == 36, "telemetry records have a fixed layout");
+    static_assert(sizeof(WaypointRecord) == 36, "telemetry records have a fixed layout");
+    static_assert(sizeof(EstimatorHealthRecord) == 80, "telemetry records have a fixed layout");
+    static_assert(sizeof(VehicleStateRecord) <= MAX_PAYLOAD, "record too large for a frame");
+
+    struct TelemetryStats {
+        uint32_t frames[CORE_COUNT];  // emitted and queued
+        uint32_t dropped[CORE_COUNT]; // refused because the ring was full
+        uint32_t maxRingUsage[CORE_COUNT];
+        uint32_t bytesDrained;
+    };
+
+    using Sink = void (*)(const uint8_t* data, size_t length);
+
+    void emit(RECORD::Type type, const void* payload, size_t length);
+
+    // true if the calling core's ring has room for a record of this size
+    bool canEmit(size_t length);
+
+    inline void emit(const VehicleStateRecord& record) { emit(RECORD::VEHICLE_STATE, &record, sizeof(record)); }
+    inline void emit(const MotorRecord& record) { emit(RECORD::MOTOR, &record, sizeof(record)); }
+    inline void emit(const PidRecord& record) { emit(RECORD::PID, &record, sizeof(record)); }
+    inline void emit(const WaypointRecord& record) { emit(RECORD::WAYPOINT, &record, sizeof(record)); }
+    inline void emit(const EstimatorHealthRecord& record) {
+        emit(RECORD::ESTIMATOR_HEALTH, &record, sizeof(record));
+    }
+
+    VehicleStateRecord vehicleStateRecord(uint32_t timeUs, const COMMON::VehicleState& state);
+
+    EstimatorHealthRecord estimatorHealthRecord(uint32_t timeUs, const COMMON::VehicleState& state);
+
+    PidRecord pidRecord(uint32_t timeUs, uint8_t loop, const TimedPID& pid, float measurement, float output);
+
+    // moves up to maxBytes of whole frames to the sink, returns the number of bytes written
+    size_t drain(size_t maxBytes = DRAIN_BUDGET_BYTES);
+
+    void setSink(Sink sink);
+
+    TelemetryStats stats();
+
+    void showStats();
+
+    uint16_t fletcher16(const uint8_t* data, size_t length);
+}
+
+#endif //OSOD_MOTOR_2040_TELEMETRY_H
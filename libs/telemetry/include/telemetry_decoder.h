@@ -0,0 +1,50 @@
+#ifndef OSOD_MOTOR_2040_TELEMETRY_DECODER_H
+#define OSOD_MOTOR_2040_TELEMETRY_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "telemetry.h"
+
+namespace TELEMETRY {
+    struct Frame {
+        uint8_t type;
+        uint8_t length;
+        uint8_t source;
+        uint8_t sequence;
+        uint8_t payload[MAX_PAYLOAD];
+    };
+
+    struct DecoderStats {
+        uint32_t frames;
+        uint32_t checksumErrors;
+        uint32_t skippedBytes; // printf text and anything else between frames
+        uint32_t lostFrames;   // inferred from gaps in each source's sequence
+    };
+
+    /*
+     * Recovers frames from a telemetry byte stream. Feed it bytes in order with push(), and after each
+     * one collect any completed frames with next(). A candidate frame that fails its checksum is
+     * rejected one byte at a time, so a real frame that started inside it is still found.
+     */
+    class FrameDecoder {
+    public:
+        void push(uint8_t byte);
+
+        bool next(Frame& frame);
+
+        DecoderStats stats() const {
+            return decoderStats;
+        }
+
+    private:
+        void discard(size_t length);
+
+        uint8_t buffer[MAX_FRAME_SIZE] = {};
+        size_t count = 0;
+        bool sequenceSeen[CORE_COUNT] = {};
+        uint8_t nextSequence[CORE_COUNT] = {};
+        DecoderStats decoderStats = {};
+    };
+}
+
+#endif //OSOD_MOTOR_2040_TELEMETRY_DECODER_H
@@ -0,0 +1,177 @@
+#include "telemetry.h"
+
+#include <cstdio>
+#include <cstring>
+#include "pico.h"
+#include "spsc_ring.h"
+
+namespace TELEMETRY {
+    Sink defaultSink();
+
+    namespace {
+        SpscRing<RING_CAPACITY> rings[CORE_COUNT];
+
+        // each core only writes its own counters, so emitting needs no locking
+        uint8_t sequence[CORE_COUNT];
+        uint32_t frames[CORE_COUNT];
+        uint32_t dropped[CORE_COUNT];
+        uint32_t maxRingUsage[CORE_COUNT];
+        uint32_t bytesDrained;
+
+        Sink sink = nullptr;
+    }
+
+    uint16_t fletcher16(const uint8_t* data, size_t length) {
+        uint16_t sum1 = 0;
+        uint16_t sum2 = 0;
+        for (size_t i = 0; i < length; i++) {
+            sum1 = (sum1 + data[i]) % 255;
+            sum2 = (sum2 + sum1) % 255;
+        }
+        return static_cast<uint16_t>((sum2 << 8) | sum1);
+    }
+
+    void emit(const RECORD::Type type, const void* payload, const size_t length) {
+        if (length > MAX_PAYLOAD) {
+            return;
+        }
+        const uint core = get_core_num();
+
+        uint8_t frame[MAX_FRAME_SIZE];
+        frame[0] = SYNC_0;
+        frame[1] = SYNC_1;
+        frame[2] = type;
+        frame[3] = static_cast<uint8_t>(length);
+        frame[4] = static_cast<uint8_t>(core);
+        frame[5] = sequence[core];
+        std::memcpy(&frame[HEADER_SIZE], payload, length);
+        const uint16_t checksum = fletcher16(&frame[2], HEADER_SIZE - 2 + length);
+        frame[HEADER_SIZE + length] = static_cast<uint8_t>(checksum & 0xff);
+        frame[HEADER_SIZE + length + 1] = static_cast<uint8_t>(checksum >> 8);
+
+        // the sequence advances for dropped frames too, so the gap shows up in the decoded stream
+        sequence[core]++;
+        if (!rings[core].write(frame, FRAME_OVERHEAD + length)) {
+            dropped[core]++;
+            return;
+        }
+        frames[core]++;
+        const uint32_t usage = rings[core].size();
+        if (usage > maxRingUsage[core]) {
+            maxRingUsage[core] = usage;
+        }
+    }
+
+    bool canEmit(const size_t length) {
+        return rings[get_core_num()].size() + FRAME_OVERHEAD + length <= RING_CAPACITY;
+    }
+
+    VehicleStateRecord vehicleStateRecord(const uint32_t timeUs, const COMMON::VehicleState& state) {
+        VehicleStateRecord record = {};
+        record.timeUs = timeUs;
+        record.x = state.odometry.x;
+        record.y = state.odometry.y;
+        record.heading = state.odometry.heading;
+        record.velocity = state.velocity.velocity;
+        record.angularVelocity = state.velocity.angular_velocity;
+        record.xDot = state.velocity.x_dot;
+        record.yDot = state.velocity.y_dot;
+        std::memcpy(record.wheelSpeeds, state.driveTrainState.speeds.speeds, sizeof(record.wheelSpeeds));
+        record.steeringLeft = state.driveTrainState.angles.left;
+        record.steeringRight = state.driveTrainState.angles.right;
+        record.tofDistances[0] = state.tofDistances.front;
+        record.tofDistances[1] = state.tofDistances.right;
+        record.tofDistances[2] = state.tofDistances.rear;
+        record.tofDistances[3] = state.tofDistances.left;
+        std::memcpy(record.wheelSlip, state.wheelSlip.ratios, sizeof(record.wheelSlip));
+        return record;
+    }
+
+    EstimatorHealthRecord estimatorHealthRecord(const uint32_t timeUs, const COMMON::VehicleState& state) {
+        EstimatorHealthRecord record = {};
+        record.timeUs = timeUs;
+        record.covarianceXX = state.covariance.xx;
+        record.covarianceXY = state.covariance.xy;
+        record.covarianceYY = state.covariance.yy;
+        record.headingVariance = state.covariance.heading;
+        record.imuNormalisedInnovation = state.health.imu.normalisedInnovation;
+        record.sinceRangeFixUs = state.health.sinceRangeFixUs;
+        record.imuAccepted = state.health.imu.accepted;
+        for (size_t i = 0; i < COMMON::NUM_TOF_SENSORS; i++) {
+            record.tofNormalisedInnovation[i] = state.health.tof[i].normalisedInnovation;
+            record.tofAccepted[i] = state.health.tof[i].accepted;
+            record.tofRejected[i] = state.health.tof[i].rejected;
+        }
+        return record;
+    }
+
+    PidRecord pidRecord(const uint32_t timeUs, const uint8_t loop, const TimedPID& pid, const float measurement,
+                        const float output) {
+        PidRecord record = {};
+        record.timeUs = timeUs;
+        record.loop = loop;
+        record.setpoint = pid.setpoint;
+        record.measurement = measurement;
+        record.pTerm = pid.terms().p;
+        record.iTerm = pid.terms().i;
+        record.dTerm = pid.terms().d;
+        record.output = output;
+        record.dt = pid.dt();
+        return record;
+    }
+
+    size_t drain(const size_t maxBytes) {
+        if (sink == nullptr) {
+            sink = defaultSink();
+        }
+        uint8_t frame[MAX_FRAME_SIZE];
+        size_t written = 0;
+        bool progress = true;
+        // alternate between the cores' rings a frame at a time so neither starves the other
+        while (progress) {
+            progress = false;
+            for (auto& ring : rings) {
+                uint8_t header[HEADER_SIZE];
+                if (ring.peek(header, HEADER_SIZE) < HEADER_SIZE) {
+                    continue;
+                }
+                const size_t frameLength = FRAME_OVERHEAD + header[3];
+                if (written + frameLength > maxBytes) {
+                    return written;
+                }
+                ring.peek(frame, frameLength);
+                sink(frame, frameLength);
+                ring.consume(frameLength);
+                written += frameLength;
+                bytesDrained += frameLength;
+                progress = true;
+            }
+        }
+        return written;
+    }
+
+    void setSink(const Sink newSink) {
+        sink = newSink;
+    }
+
+    TelemetryStats stats() {
+        TelemetryStats result = {};
+        for (size_t core = 0; core < CORE_COUNT; core++) {
+            result.frames[core] = frames[core];
+            result.dropped[core] = dropped[core];
+            result.maxRingUsage[core] = maxRingUsage[core];
+        }
+        result.bytesDrained = bytesDrained;
+        return result;
+    }
+
+    void showStats() {
+        const TelemetryStats current = stats();
+        printf("telemetry: %lu/%lu frames (core0/core1), %lu/%lu dropped, max ring usage %lu/%lu of %u bytes, "
+               "%lu bytes drained\n",
+               (unsigned long) current.frames[0], (unsigned long) current.frames[1],
+               (unsigned long) current.dropped[0], (unsigned long) current.dropped[1],
+               (unsigned long) current.maxRingUsage[0], (unsigned long) current.maxRingUsage[1],
+               (unsigned) RING_CAPACITY, (unsigned long) current.bytesDrained);
+    }
+}
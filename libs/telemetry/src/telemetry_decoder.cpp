@@ -0,0 +1,65 @@
+#include "telemetry_decoder.h"
+
+#include <cstring>
+
+namespace TELEMETRY {
+    void FrameDecoder::push(const uint8_t byte) {
+        if (count == sizeof(buffer)) {
+            // only reachable if next() isn't called between pushes
+            discard(1);
+            decoderStats.skippedBytes++;
+        }
+        buffer[count++] = byte;
+    }
+
+    bool FrameDecoder::next(Frame& frame) {
+        while (count > 0) {
+            if (buffer[0] != SYNC_0 || (count >= 2 && buffer[1] != SYNC_1)) {
+                discard(1);
+                decoderStats.skippedBytes++;
+                continue;
+            }
+            if (count < HEADER_SIZE) {
+                return false;
+            }
+            const size_t length = buffer[3];
+            const uint8_t source = buffer[4];
+            if (length > MAX_PAYLOAD || source >= CORE_COUNT) {
+                discard(1);
+                decoderStats.skippedBytes++;
+                continue;
+            }
+            if (count < FRAME_OVERHEAD + length) {
+                return false;
+            }
+            const uint16_t checksum = buffer[HEADER_SIZE + length] | (buffer[HEADER_SIZE + length + 1] << 8);
+            if (fletcher16(&buffer[2], HEADER_SIZE - 2 + length) != checksum) {
+                discard(1);
+                decoderStats.checksumErrors++;
+                decoderStats.skippedBytes++;
+                continue;
+            }
+
+            frame.type = buffer[2];
+            frame.length = static_cast<uint8_t>(length);
+            frame.source = source;
+            frame.sequence = buffer[5];
+            std::memcpy(frame.payload, &buffer[HEADER_SIZE], length);
+            discard(FRAME_OVERHEAD + length);
+
+            if (sequenceSeen[source]) {
+                decoderStats.lostFrames += static_cast<uint8_t>(frame.sequence - nextSequence[source]);
+            }
+            sequenceSeen[source] = true;
+            nextSequence[source] = frame.sequence + 1;
+            decoderStats.frames++;
+            return true;
+        }
+        return false;
+    }
+
+    void FrameDecoder::discard(const size_t length) {
+        std::memmove(buffer, &buffer[length], count - length);
+        count -= length;
+    }
+}
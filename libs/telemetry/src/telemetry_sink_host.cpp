@@ -0,0 +1,17 @@
+// Telemetry sink in the host build: stdout, alongside the firmware's printf output. The simulation
+// replaces it with a capture file when asked for one.
+
+#include <cstdio>
+#include "telemetry.h"
+
+namespace TELEMETRY {
+    namespace {
+        void stdoutSink(const uint8_t* data, const size_t length) {
+            fwrite(data, 1, length, stdout);
+        }
+    }
+
+    Sink defaultSink() {
+        return stdoutSink;
+    }
+}
@@ -0,0 +1,19 @@
+// Telemetry sink on the RP2040: the stdio stream (USB CDC), written raw so the frames aren't
+// subjected to the CR/LF translation printf output gets.
+
+#include "telemetry.h"
+#include "pico/stdio.h"
+
+namespace TELEMETRY {
+    namespace {
+        void stdioSink(const uint8_t* data, const size_t length) {
+            for (size_t i = 0; i < length; i++) {
+                putchar_raw(data[i]);
+            }
+        }
+    }
+
+    Sink defaultSink() {
+        return stdioSink;
+    }
+}
@@ -1,8 +1,12 @@
 
 #include <stdio.h>
+#include <array>
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "types.h"
+#include "i2c_engine.h"
+#include "measurement_queue.h"
+#include "seqlock.h"
 
 #pragma once
 
@@ -15,14 +19,116 @@ const uint8_t tf_luna_left = 0x14;
 
 // Data fetch instruction
 const uint8_t getLidarDataCmd[] = {0x5A, 0x05, 0x00, 0x01, 0x60};
+const size_t lidarFrameLength = 9;
 
 struct LidarData {
     int distance;
     int strength;
     int temperature;
+    bool valid;     // the frame had the right header and checksum
 };
 
 // Function to get Lidar data
 LidarData getSingleLidarData(uint8_t i2c_addr, i2c_inst_t* i2c_port);
+// Distances from the robot centre; NaN for a sensor whose frame isn't usable
 COMMON::FourToFDistances getAllLidarDistances(i2c_inst_t* i2c_port);
 float convertAndApplyOffset(int distance_cm, float offset);
+LidarData decodeLidarFrame(const uint8_t* frame);
+
+// Why a frame was, or wasn't, used
+enum class LidarFrameCheck : uint8_t {
+    USABLE,
+    BAD_FRAME,      // wrong header or checksum, or the read failed
+    WEAK,           // strength below CONFIG::TOF_MIN_STRENGTH, or saturated
+    OUT_OF_RANGE,   // no distance, or further than CONFIG::TOF_MAX_RANGE from the robot centre
+};
+LidarFrameCheck checkLidarData(const LidarData& data, float offset);
+
+struct ToFReading {
+    float distance;         // metres, mount offset applied, from the newest frame passed on
+    uint16_t strength;      // signal strength of that frame's return
+    uint32_t capturedUs;    // when that frame was read off the bus
+    bool stale;             // nothing passed on yet, or not within CONFIG::TOF_STALE_AFTER_US
+    LidarFrameCheck lastCheck;  // how the newest frame fared, usable or not
+};
+
+struct ToFStats {
+    uint32_t frames;        // read off the bus, whatever their content
+    uint32_t badFrames;
+    uint32_t weak;
+    uint32_t outOfRange;
+    uint32_t heldBack;      // usable frames taken for a spike
+};
+
+// Reads the four ToF sensors through the I2C engine without waiting on the bus. Each sensor is read once per
+// sample period, and the sensors are phase-staggered across the period so each estimator tick only reads
+// some of them. A sensor is never read again before it can have produced a new frame.
+//
+// Each frame is checked before it is used: a corrupt frame, a weak or saturated return, or a distance the
+// sensor can't measure is counted and dropped. A usable frame is then held back if it is more than
+// CONFIG::TOF_SPIKE_TOLERANCE both from the median of that sensor's last three and from the line through the
+// two before it, so one bad range is outvoted rather than passed on, while a range changing quickly but
+// steadily isn't. A frame that is passed on is passed on as it is, with no delay, so its capture time still
+// says when it was measured. A genuine step in range, like a beam moving onto a nearer wall, is held back
+// for one frame until the next one confirms it.
+class TfLunaArray {
+public:
+    explicit TfLunaArray(I2C_ENGINE::I2CEngine* engine, uint32_t samplePeriodUs = CONFIG::TOF_SAMPLE_PERIOD_US);
+
+    // Queue a trigger and frame read for each sensor that is due. A read that hasn't reached the bus by the
+    // time the sensor is next due is dropped in favour of the next one.
+    void scheduleReads(uint32_t nowUs);
+
+    // Updates the distances of the sensors that have delivered a frame since the last call, leaving the
+    // others untouched. Returns the number updated.
+    size_t collectDistances(COMMON::FourToFDistances& distances);
+
+    [[nodiscard]] ToFReading reading(size_t sensor, uint32_t nowUs) const;
+
+    // Pushes every range that is passed on to channel as it arrives, stamped with its capture time. The push is
+    // made from the I2C engine's completion callback, so ranges reach the channel at the sensors' own rate.
+    void publishTo(MeasurementChannel<COMMON::Measurement>* channel);
+
+    // True if no sensor's latest reading is stale.
+    [[nodiscard]] bool allCurrent(uint32_t nowUs) const;
+
+    [[nodiscard]] ToFStats stats(size_t sensor) const { return sensors[sensor].stats; }
+
+private:
+    static constexpr size_t MEDIAN_WINDOW = 3;
+
+    struct Sample {
+        float distance;
+        uint16_t strength;
+        uint32_t capturedUs;
+    };
+
+    struct Sensor {
+        uint8_t address;
+        uint8_t index;
+        float offset;
+        I2C_ENGINE::Transfer trigger;
+        I2C_ENGINE::Transfer frame;
+        uint8_t frameData[lidarFrameLength];
+        float window[MEDIAN_WINDOW];    // distances of the newest usable frames, oldest first
+        size_t windowCount;
+        SeqLock<Sample> filtered;       // the frame last passed on, written from the I2C completion callback
+        uint32_t collected;             // filtered's sequence number as of the last collectDistances()
+        bool hasReading;
+        Sample current;                 // filtered, as of the last collectDistances()
+        LidarFrameCheck lastCheck;
+        ToFStats stats;
+        uint32_t nextReadUs;
+        MeasurementChannel<COMMON::Measurement>* channel;
+    };
+
+    I2C_ENGINE::I2CEngine* engine;
+    uint32_t samplePeriodUs;
+    std::array<Sensor, COMMON::NUM_TOF_SENSORS> sensors{};
+
+    static void frameReceived(I2C_ENGINE::Transfer& transfer);
+
+    // Checks a frame and compares it with the sensor's recent ones. Returns true if it is passed on, and leaves
+    // it in passed.
+    static bool filterFrame(Sensor& sensor, const LidarData& data, uint32_t capturedUs, Sample& passed);
+};
@@ -1,5 +1,7 @@
 #include "pico/stdlib.h"
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include "hardware/i2c.h"
 #include "drivetrain_config.h"
 #include "tf_luna.h"
@@ -8,40 +10,63 @@
 
 // Function to get Lidar data
 LidarData getSingleLidarData(uint8_t i2c_addr, i2c_inst_t* i2c_port) {
-    uint8_t temp[9] = {0};
+    uint8_t temp[lidarFrameLength] = {0};
     const int retval = i2c_write_timeout_us(i2c_port, i2c_addr, getLidarDataCmd, 5, false, CONFIG::I2C_TIMEOUT_US); // Send command
     if (retval == PICO_ERROR_GENERIC || retval == PICO_ERROR_TIMEOUT) {
         handleI2CError(i2c_port);;
     }
-    i2c_read_timeout_us(i2c_port, i2c_addr, temp, 9, false, CONFIG::I2C_TIMEOUT_US); // Read response
+    i2c_read_timeout_us(i2c_port, i2c_addr, temp, lidarFrameLength, false, CONFIG::I2C_TIMEOUT_US); // Read response
     if (retval == PICO_ERROR_GENERIC || retval == PICO_ERROR_TIMEOUT) {
         handleI2CError(i2c_port);;
     }
 
-    LidarData data = {0, 0, 0}; // Initialize to zero
-    
-    if (temp[0] == 0x59 && temp[1] == 0x59) {
-        data.distance = temp[2] + temp[3] * 256; // Distance value
-        data.strength = temp[4] + temp[5] * 256; // Signal strength
-        data.temperature = (temp[6] + temp[7] * 256) / 8 - 256; // Chip temperature
+    return decodeLidarFrame(temp);
+}
+
+LidarData decodeLidarFrame(const uint8_t* frame) {
+    LidarData data = {0, 0, 0, false}; // Initialize to zero
+
+    // the last byte is the low byte of the sum of the others
+    uint8_t checksum = 0;
+    for (size_t i = 0; i < lidarFrameLength - 1; i++) {
+        checksum += frame[i];
+    }
+    if (frame[0] == 0x59 && frame[1] == 0x59 && checksum == frame[lidarFrameLength - 1]) {
+        data.distance = frame[2] + frame[3] * 256; // Distance value
+        data.strength = frame[4] + frame[5] * 256; // Signal strength
+        data.temperature = (frame[6] + frame[7] * 256) / 8 - 256; // Chip temperature
+        data.valid = true;
     }
 
     return data;
 }
 
+LidarFrameCheck checkLidarData(const LidarData& data, const float offset) {
+    if (!data.valid) {
+        return LidarFrameCheck::BAD_FRAME;
+    }
+    if (data.strength < CONFIG::TOF_MIN_STRENGTH || data.strength == UINT16_MAX) {
+        return LidarFrameCheck::WEAK;
+    }
+    if (data.distance <= 0 || convertAndApplyOffset(data.distance, offset) > CONFIG::TOF_MAX_RANGE) {
+        return LidarFrameCheck::OUT_OF_RANGE;
+    }
+    return LidarFrameCheck::USABLE;
+}
+
 COMMON::FourToFDistances getAllLidarDistances(i2c_inst_t* i2c_port) {
     // function to get the distances of four ToF sensors in meters
-    // Get distance from each sensor, convert from centimeters to meters, and apply the offset
-    int front_cm = getSingleLidarData(tf_luna_front, i2c_port).distance;
-    int right_cm = getSingleLidarData(tf_luna_right, i2c_port).distance;
-    int rear_cm = getSingleLidarData(tf_luna_rear, i2c_port).distance;
-    int left_cm = getSingleLidarData(tf_luna_left, i2c_port).distance;
-
-    // Convert from centimeters to meters and apply offsets
-    float front_m = convertAndApplyOffset(front_cm, CONFIG::TOF_FRONT_OFFSET);
-    float right_m = convertAndApplyOffset(right_cm, CONFIG::TOF_RIGHT_OFFSET);
-    float rear_m = convertAndApplyOffset(rear_cm, CONFIG::TOF_REAR_OFFSET);
-    float left_m = convertAndApplyOffset(left_cm, CONFIG::TOF_LEFT_OFFSET);
+    // Get distance from each sensor, convert from centimeters to meters, and apply the offset. A frame that
+    // fails its checks gives NaN rather than a range of just the offset
+    auto distance = [i2c_port](const uint8_t address, const float offset) {
+        const LidarData data = getSingleLidarData(address, i2c_port);
+        return checkLidarData(data, offset) == LidarFrameCheck::USABLE ? convertAndApplyOffset(data.distance, offset)
+                                                                       : NAN;
+    };
+    float front_m = distance(tf_luna_front, CONFIG::TOF_FRONT_OFFSET);
+    float right_m = distance(tf_luna_right, CONFIG::TOF_RIGHT_OFFSET);
+    float rear_m = distance(tf_luna_rear, CONFIG::TOF_REAR_OFFSET);
+    float left_m = distance(tf_luna_left, CONFIG::TOF_LEFT_OFFSET);
 
     // Return the struct populated with the distances
     return {front_m, right_m, rear_m, left_m};
@@ -50,4 +75,160 @@ COMMON::FourToFDistances getAllLidarDistances(i2c_inst_t* i2c_port) {
 float convertAndApplyOffset(int distance_cm, float offset) {
     // covnerts a sensor reading in cm to metres, and applies an offset. returns a float
     return static_cast<float>(distance_cm) / 100.0f + offset;
-}
\ No newline at end of file
+}
+
+namespace {
+    // sensor order matches FourToFDistances
+    constexpr float COMMON::FourToFDistances::* TOF_FIELDS[COMMON::NUM_TOF_SENSORS] = {
+            &COMMON::FourToFDistances::front,
+            &COMMON::FourToFDistances::right,
+            &COMMON::FourToFDistances::rear,
+            &COMMON::FourToFDistances::left,
+    };
+}
+
+TfLunaArray::TfLunaArray(I2C_ENGINE::I2CEngine* engine, const uint32_t samplePeriodUs)
+        : engine(engine), samplePeriodUs(std::max(samplePeriodUs, CONFIG::TOF_FRAME_PERIOD_US)) {
+    const uint8_t addresses[COMMON::NUM_TOF_SENSORS] = {tf_luna_front, tf_luna_right, tf_luna_rear, tf_luna_left};
+    const float offsets[COMMON::NUM_TOF_SENSORS] = {CONFIG::TOF_FRONT_OFFSET, CONFIG::TOF_RIGHT_OFFSET,
+                                                    CONFIG::TOF_REAR_OFFSET, CONFIG::TOF_LEFT_OFFSET};
+    const uint32_t now = time_us_32();
+    for (size_t i = 0; i < sensors.size(); i++) {
+        Sensor& sensor = sensors[i];
+        sensor.address = addresses[i];
+        sensor.index = static_cast<uint8_t>(i);
+        sensor.offset = offsets[i];
+        // stagger the sensors evenly across the sample period
+        sensor.nextReadUs = now + i * this->samplePeriodUs / sensors.size();
+
+        sensor.trigger.address = sensor.address;
+        sensor.trigger.writeData = getLidarDataCmd;
+        sensor.trigger.writeLength = sizeof(getLidarDataCmd);
+        sensor.trigger.deadlineUs = this->samplePeriodUs;
+
+        sensor.frame.address = sensor.address;
+        sensor.frame.readData = sensor.frameData;
+        sensor.frame.readLength = lidarFrameLength;
+        sensor.frame.deadlineUs = this->samplePeriodUs;
+        sensor.frame.callback = &TfLunaArray::frameReceived;
+        sensor.frame.context = &sensor;
+    }
+}
+
+void TfLunaArray::scheduleReads(const uint32_t nowUs) {
+    for (Sensor& sensor : sensors) {
+        if (static_cast<int32_t>(nowUs - sensor.nextReadUs) < 0) {
+            continue;
+        }
+        if (sensor.trigger.inProgress() || sensor.frame.inProgress()) {
+            continue;
+        }
+        engine->submit(sensor.trigger);
+        engine->submit(sensor.frame);
+        // keep to the sensor's phase slot; if we've fallen more than a period behind, skip the missed slots
+        // rather than read back-to-back
+        sensor.nextReadUs += samplePeriodUs;
+        if (static_cast<int32_t>(nowUs - sensor.nextReadUs) >= 0) {
+            sensor.nextReadUs += ((nowUs - sensor.nextReadUs) / samplePeriodUs + 1) * samplePeriodUs;
+        }
+    }
+}
+
+void TfLunaArray::frameReceived(I2C_ENGINE::Transfer& transfer) {
+    auto* sensor = static_cast<Sensor*>(transfer.context);
+    if (transfer.status == I2C_ENGINE::TransferStatus::EXPIRED) {
+        // never put on the bus, so there's nothing to judge the sensor by
+        return;
+    }
+    const LidarData data = transfer.succeeded() ? decodeLidarFrame(sensor->frameData) : LidarData{0, 0, 0, false};
+    Sample passed;
+    if (!filterFrame(*sensor, data, transfer.completedUs, passed)) {
+        return;
+    }
+    sensor->filtered.write(passed);
+    if (sensor->channel != nullptr) {
+        const COMMON::Measurement range = {COMMON::Measurement::TOF_RANGE, sensor->index, passed.distance, NAN};
+        sensor->channel->push(range, passed.capturedUs);
+    }
+}
+
+bool TfLunaArray::filterFrame(Sensor& sensor, const LidarData& data, const uint32_t capturedUs, Sample& passed) {
+    sensor.stats.frames++;
+    sensor.lastCheck = checkLidarData(data, sensor.offset);
+    switch (sensor.lastCheck) {
+        case LidarFrameCheck::BAD_FRAME:
+            sensor.stats.badFrames++;
+            return false;
+        case LidarFrameCheck::WEAK:
+            sensor.stats.weak++;
+            return false;
+        case LidarFrameCheck::OUT_OF_RANGE:
+            sensor.stats.outOfRange++;
+            return false;
+        case LidarFrameCheck::USABLE:
+            break;
+    }
+    const float distance = convertAndApplyOffset(data.distance, sensor.offset);
+    if (sensor.windowCount == MEDIAN_WINDOW) {
+        std::copy(sensor.window + 1, sensor.window + MEDIAN_WINDOW, sensor.window);
+        sensor.windowCount--;
+    }
+    sensor.window[sensor.windowCount++] = distance;
+
+    // a frame is judged against the median of the last three, itself included, so one spike is outvoted
+    // while a real step, once a second frame confirms it, moves the median along with it. A range that is
+    // changing fast, like a beam sweeping along a wall as the robot turns, runs away from the median, so a
+    // frame that carries on the line through the two before it is passed on too. Nothing is passed on
+    // until there are three to judge by
+    if (sensor.windowCount < MEDIAN_WINDOW) {
+        return false;
+    }
+    const float low = std::min(sensor.window[0], sensor.window[1]);
+    const float high = std::max(sensor.window[0], sensor.window[1]);
+    const float median = std::clamp(distance, low, high);
+    const float trend = 2.0f * sensor.window[1] - sensor.window[0];
+    if (std::fabs(distance - median) > CONFIG::TOF_SPIKE_TOLERANCE &&
+        std::fabs(distance - trend) > CONFIG::TOF_SPIKE_TOLERANCE) {
+        sensor.stats.heldBack++;
+        return false;
+    }
+    passed = {distance, static_cast<uint16_t>(data.strength), capturedUs};
+    return true;
+}
+
+void TfLunaArray::publishTo(MeasurementChannel<COMMON::Measurement>* channel) {
+    for (Sensor& sensor : sensors) {
+        sensor.channel = channel;
+    }
+}
+
+size_t TfLunaArray::collectDistances(COMMON::FourToFDistances& distances) {
+    size_t updated = 0;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        Sensor& sensor = sensors[i];
+        // the sequence number comes with the copy, so a frame landing during or after it is left for next time
+        if (sensor.filtered.published() == sensor.collected) {
+            continue;
+        }
+        sensor.collected = sensor.filtered.read(sensor.current);
+        sensor.hasReading = true;
+        distances.*TOF_FIELDS[i] = sensor.current.distance;
+        updated++;
+    }
+    return updated;
+}
+
+ToFReading TfLunaArray::reading(const size_t sensor, const uint32_t nowUs) const {
+    const Sensor& source = sensors[sensor];
+    const bool stale = !source.hasReading || nowUs - source.current.capturedUs > CONFIG::TOF_STALE_AFTER_US;
+    return {source.current.distance, source.current.strength, source.current.capturedUs, stale, source.lastCheck};
+}
+
+bool TfLunaArray::allCurrent(const uint32_t nowUs) const {
+    for (size_t i = 0; i < sensors.size(); i++) {
+        if (reading(i, nowUs).stale) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -5,16 +5,16 @@
 #include "types.h"
 #include "drivetrain_config.h"
 #include "utils.h"
-#include "pid.hpp"
+#include "timed_pid.h"
+#include "task_timing.h"
 
 namespace WAYPOINTS {
     using namespace COMMON;
-    using namespace pimoroni;
     class WaypointNavigation {
     public:
         WaypointNavigation();
         ~WaypointNavigation();
-        void navigate(const VehicleState& currentState); //update the desired movement to get to the next waypoint
+        void navigate(const VehicleState& currentState, uint32_t stateUs); //update the desired movement to get to the next waypoint; stateUs is when currentState was estimated
         float desiredV;  // desired velocity to get to next waypoint
         float desiredW;  // desired angular velocity to get to next waypoint
         uint8_t targetWaypointIndex = 0; // the index of the current waypoint we're navigating to
@@ -25,7 +25,14 @@ namespace WAYPOINTS {
         float headingToWaypoint(const Waypoint& target, const VehicleState& currentState); // heading to a waypoint. not currently used?
         float bearingToWaypoint(const Waypoint& target, const VehicleState& currentState); // Compass bearing to a waypoint
         float distanceToWaypoint(const Waypoint& target, const VehicleState& currentState); // distance to a waypoint
-        float lookAhead = 0.2; //lookahead distance in metres
+        float lookAhead = 0.2; //lookahead distance in metres, when the position is certain
+        float uncertainLookAhead = 2.0; // extra lookahead per metre of position standard deviation
+        float maxLookAhead; // the widest the lookahead gets: half the route's extent
+        float confidentSigma = 0.05; // position standard deviation in metres below which waypoint speeds are used as they are
+        float lostSigma = 0.3; // position standard deviation in metres at which speeds are cut to minSpeedScale
+        float minSpeedScale = 0.3; // the least share of a waypoint's speed driven however uncertain the position
+        float positionSigma(const VehicleState& currentState); // standard deviation of the estimated position, x and y together
+        float speedScale(float sigma); // share of the waypoint speed to drive with this much position uncertainty
         float maxTurnVelocity = 10; //max turn velocity in radians per second
         float unwrapHeading(const float targetHeading, float currentHeading); //find "nearest" description of current heading to target
 
@@ -33,9 +40,10 @@ namespace WAYPOINTS {
         float headingPGain = 20;
         float headingIGain = 0.5;
         float headingDGain = 5.0;
-        float UPDATE_RATE = 0.02; //seconds
+        SampleInterval stateInterval{20000}; // time between the estimates navigated on, nominally the 50 Hz navigation period
+        float maxStateGap = 0.1; // seconds; after a longer gap (e.g. out of waypoint mode) the heading loop starts afresh
 
-        PID headingPID = PID(headingPGain, headingIGain, headingDGain, UPDATE_RATE); // used for steering to waypoints
+        TimedPID headingPID = TimedPID(headingPGain, headingIGain, headingDGain); // used for steering to waypoints
     };
 }
 #endif // WAYPOINT_NAVIGATION_H
\ No newline at end of file
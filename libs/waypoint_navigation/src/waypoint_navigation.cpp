@@ -4,21 +4,36 @@
 #include "types.h"
 #include "drivetrain_config.h"
 #include "waypoint_navigation.h"
+#include "telemetry.h"
+#include "fast_math.h"
+#include "pico/stdlib.h"
 
 namespace WAYPOINTS {
 
-WaypointNavigation::WaypointNavigation(){}
+WaypointNavigation::WaypointNavigation(){
+    // the widest the lookahead can get: any point has a waypoint at least half the route's extent away,
+    // so a lookahead short of that always leaves one to steer for
+    float extent = 0.0f;
+    for (size_t i = 0; i < CONFIG::waypointCount; i++) {
+        for (size_t j = i + 1; j < CONFIG::waypointCount; j++) {
+            extent = std::max(extent, hypotf(CONFIG::waypointBuffer[i].position.x - CONFIG::waypointBuffer[j].position.x,
+                                             CONFIG::waypointBuffer[i].position.y - CONFIG::waypointBuffer[j].position.y));
+        }
+    }
+    maxLookAhead = 0.5f * extent;
+}
 
-void WaypointNavigation::navigate(const VehicleState& currentState) {
+void WaypointNavigation::navigate(const VehicleState& currentState, const uint32_t stateUs) {
     // updates desiredV and desiredW (speed and turn velocity)
     // based on the current position and the list of waypoints.
-    // the velocity comes from the speed associated with the closest waypoint
+    // the velocity comes from the speed associated with the closest waypoint, cut back when the estimator
+    // is unsure where the robot is
     // the turn velocity comes from PID feedback on the heading to the next waypoint
 
     // find nearest waypoint and use it to set the speed
     nearestWaypointIndex = nearestWaypoint(currentState); //TODO: check if UINT8_MAX?
     Waypoint nearestWaypoint = CONFIG::waypointBuffer[nearestWaypointIndex];
-    desiredV = nearestWaypoint.speed;
+    desiredV = nearestWaypoint.speed * speedScale(positionSigma(currentState));
 
     // find target waypoint and use it to set the angular velocity
     targetWaypointIndex = nextWaypoint(targetWaypointIndex, currentState);
@@ -31,16 +46,37 @@ void WaypointNavigation::navigate(const VehicleState& currentState) {
 
     headingPID.setpoint = bearingToNextWaypoint;
     //scale the response by the speed, so that the steering correction angle is consistent as run speeds varies
-    desiredW = std::clamp(-desiredV * headingPID.calculate(currentHeading),
+    float dt = stateInterval.update(stateUs);
+    if (dt > maxStateGap) {
+        // don't integrate or differentiate across a pause in navigation: this sample only primes the loop
+        headingPID.reset();
+        dt = 0.0f;
+    }
+    // with the gyro's turn rate in the estimate, the derivative uses it rather than differencing headings
+    // one navigation period apart. unwrapHeading mirrors the heading about the target, so the loop's
+    // measurement moves against the turn rate
+    float headingCorrection = CONFIG::IMU_REPORT == CONFIG::GYRO_INTEGRATED_RV
+                              ? headingPID.calculate(currentHeading, -currentState.velocity.angular_velocity, dt)
+                              : headingPID.calculate(currentHeading, dt);
+    desiredW = std::clamp(-desiredV * headingCorrection,
                                 -maxTurnVelocity, maxTurnVelocity);
-    float distanceToGo = distanceToWaypoint(targetWaypoint, currentState); 
-    printf("Target Waypoint: %d, Distance To Go: %f, Nearest Waypoint: %d, bearing To Waypoint: %f, desiredV: %f ", targetWaypointIndex, distanceToGo, nearestWaypointIndex, bearingToNextWaypoint, desiredV);
-    printf("X: %f, Y: %f, Velocity: %f, Heading: %f, turn rate: %f\n", 
-        currentState.odometry.x,
-        currentState.odometry.y,
-        currentState.velocity.velocity,
-        currentState.odometry.heading,
-        currentState.velocity.angular_velocity);
+    float distanceToGo = distanceToWaypoint(targetWaypoint, currentState);
+
+    const uint32_t now = time_us_32();
+    TELEMETRY::WaypointRecord record = {};
+    record.timeUs = now;
+    record.distanceToGo = distanceToGo;
+    record.bearing = bearingToNextWaypoint;
+    record.desiredV = desiredV;
+    record.desiredW = desiredW;
+    record.x = currentState.odometry.x;
+    record.y = currentState.odometry.y;
+    record.heading = currentState.odometry.heading;
+    record.targetIndex = targetWaypointIndex;
+    record.nearestIndex = nearestWaypointIndex;
+    TELEMETRY::emit(record);
+    TELEMETRY::emit(TELEMETRY::pidRecord(now, TELEMETRY::PID_LOOP::WAYPOINT_HEADING, headingPID, currentHeading,
+                                         headingCorrection));
 }
 
 
@@ -48,9 +84,17 @@ uint8_t WaypointNavigation::nextWaypoint(const uint8_t currentWaypointIndex, con
     // find the next waypoint to navigate to. starts from the current (target) waypoint
     // and looks forward to find the closest one thats outside of the lookahead distance.
     // returns a waypoint index. Only looks/progresses forwards.
+    // the lookahead widens with the position uncertainty, so an uncertain estimate steers for a further
+    // waypoint rather than chasing its own noise around the nearer ones.
     uint8_t nextWaypointIndex = currentWaypointIndex;
     Waypoint targetWaypoint = CONFIG::waypointBuffer[currentWaypointIndex];
-    while (distanceToWaypoint(targetWaypoint, currentState) < lookAhead ) { 
+    // the widening stops short of half the route's extent, and the search after one lap of the route, so a
+    // lost estimate with every waypoint inside the lookahead can't stall navigation
+    const float widenedLookAhead = std::min(lookAhead + uncertainLookAhead * positionSigma(currentState),
+                                            maxLookAhead);
+    size_t steps = 0;
+    while (distanceToWaypoint(targetWaypoint, currentState) < widenedLookAhead && steps < CONFIG::waypointCount) {
+        steps++;
 
         // we don't enter/increment if the current target waypoint is already outside the lookahead
         nextWaypointIndex += 1;
@@ -63,6 +107,16 @@ uint8_t WaypointNavigation::nextWaypoint(const uint8_t currentWaypointIndex, con
     return nextWaypointIndex;
 }
 
+float WaypointNavigation::positionSigma(const VehicleState& currentState){
+    return sqrtf(std::max(currentState.covariance.xx + currentState.covariance.yy, 0.0f));
+}
+
+float WaypointNavigation::speedScale(const float sigma){
+    // full speed up to confidentSigma, falling linearly to minSpeedScale at lostSigma
+    const float lost = std::clamp((sigma - confidentSigma) / (lostSigma - confidentSigma), 0.0f, 1.0f);
+    return 1.0f - lost * (1.0f - minSpeedScale);
+}
+
 uint8_t WaypointNavigation::nearestWaypoint(const VehicleState& currentState){
     // returns the index of the waypoint nearest to the current position
     // searches only through the waypoint buffer from the current(previous)
@@ -102,22 +156,12 @@ float WaypointNavigation::headingToWaypoint(const Waypoint& target, const Vehicl
 float WaypointNavigation::bearingToWaypoint(const Waypoint& target, const VehicleState& currentState){
  // bearing (heading) to a waypoint, relative to the "North" (Y axis) 
  // result is in radians
-    float dx, dy, bearingToWaypoint;
     // bearing to waypoint is the compass heading from current location to the target waypoint
-    dx = target.position.x - currentState.odometry.x;
-    dy = target.position.y - currentState.odometry.y;
-    if (dy != 0) {
-        //x and Y flipped around in atan2 as we want angle from Yaxis,
-        // not angle from X axis as the convention in maths
-        bearingToWaypoint = (float)atan2(-dx, dy);
-    } else {
-        if (dx > 0) {
-            bearingToWaypoint = M_PI / 2;
-        } else {
-            bearingToWaypoint = -M_PI / 2;
-        }
-    }
-    return bearingToWaypoint;
+    const float dx = target.position.x - currentState.odometry.x;
+    const float dy = target.position.y - currentState.odometry.y;
+    //x and Y flipped around in atan2 as we want angle from Yaxis,
+    // not angle from X axis as the convention in maths
+    return FAST_MATH::atan2(-dx, dy);
 }
 
 float WaypointNavigation::distanceToWaypoint(const Waypoint& target, const VehicleState& currentState){
@@ -125,8 +169,8 @@ float WaypointNavigation::distanceToWaypoint(const Waypoint& target, const Vehic
     // returns the as-the-crow-flies distance between them
 
     //hypotenuse of dx, dy triangle gives distance, using h^2=x^2+y^2
-    return sqrt(powf((target.position.x - currentState.odometry.x), 2)
-                 + powf((target.position.y - currentState.odometry.y), 2));;
+    return FAST_MATH::hypot(target.position.x - currentState.odometry.x,
+                            target.position.y - currentState.odometry.y);
 }
 
 float WaypointNavigation::unwrapHeading(const float targetHeading, const float currentHeading){
@@ -0,0 +1,47 @@
+#ifndef OSOD_MOTOR_2040_POSE_INTEGRATION_H
+#define OSOD_MOTOR_2040_POSE_INTEGRATION_H
+
+#include "drivetrain_config.h"
+#include "types.h"
+
+/*
+ * Lays down one tick of odometry: the rear axle centre travels distance while the heading turns by turn.
+ *
+ * The rear wheels don't steer, so with no side slip the rear axle centre moves along the chassis and
+ * follows a circular arc when the turn rate is steady. The three models differ in the direction the
+ * tick's travel is taken along:
+ * - EULER uses the heading at the end of the tick. The error is first order in the turn, and it builds
+ *   up on the inside of every bend.
+ * - MIDPOINT uses the heading halfway through the turn. That cancels the first-order error but lays the
+ *   arc's length down along its chord, which is too long by about turn²/24 of the distance.
+ * - ARC also scales the travel to the chord, so a constant turn is integrated exactly.
+ *
+ * When no new IMU heading has arrived, bicycleTurn() finds the turn from the steering angles instead.
+ * Each front wheel's angle gives the curvature of the rear axle centre's path, and the two are
+ * averaged. The angles follow the mixer's convention: the right wheel's angle has the sign of the
+ * curvature and the left wheel's the opposite sign. This doesn't hold for turning on the spot, but the
+ * distance is then near zero and so is the turn it gives.
+ */
+
+namespace WHEEL_ODOMETRY {
+    struct Displacement {
+        float dx;           // m in the odometry frame
+        float dy;           // m
+        float perMetreX;    // change in dx per metre of distance
+        float perMetreY;    // change in dy per metre of distance
+        float turnShare;    // the fraction of the turn the direction of travel follows: 1, or ½ at the midpoint
+    };
+
+    // distance is positive forwards for the chassis, so driveDirection flips it for the odometry frame.
+    // heading is the heading at the start of the tick and turn the change in heading over it, both in radians.
+    [[nodiscard]] Displacement integrate(float heading, float distance, float turn, CONFIG::PoseIntegration model,
+                                         float driveDirection);
+
+    // The heading change over distance from the steering angles. Angles past maxSteeringAngle are taken as
+    // the servos' stop.
+    [[nodiscard]] float bicycleTurn(float distance, COMMON::SteeringAngles steering,
+                                    float wheelBase = CONFIG::WHEEL_BASE, float wheelTrack = CONFIG::WHEEL_TRACK,
+                                    float maxSteeringAngle = CONFIG::MAX_STEERING_ANGLE);
+}
+
+#endif //OSOD_MOTOR_2040_POSE_INTEGRATION_H
@@ -0,0 +1,69 @@
+#ifndef OSOD_MOTOR_2040_WHEEL_ODOMETRY_H
+#define OSOD_MOTOR_2040_WHEEL_ODOMETRY_H
+
+#include <cmath>
+#include "drivetrain_config.h"
+#include "types.h"
+
+/*
+ * Odometry from all four wheels, with slipping and stalled wheels found and down-weighted.
+ *
+ * The position is reckoned at the centre of the rear axle, and the front wheels steer. With no side
+ * slip, every wheel moves along the chassis as far as the rear axle centre does, plus or minus half the
+ * track times the heading change. For a front wheel that is its rolling distance times the cosine of its
+ * steering angle. So each wheel gives its own estimate of how far the rear axle centre moved. The heading
+ * change comes from the IMU, not the wheels, so one wheel spinning can't pass itself off as a turn.
+ *
+ * Each wheel's slip ratio compares its speed with the speed the kinematics predict for it. The
+ * prediction uses the median of the four wheels, which one bad wheel can't drag. A wheel within
+ * slipTolerance keeps full weight. Beyond that its weight falls off as 1 / (1 + excess²), with the excess
+ * measured in tolerances, so a spinning or stalled wheel barely counts. Over one tick a wheel can also be
+ * a whole encoder count ahead or behind with no slip at all, so that much is allowed on top before the
+ * weight starts to fall. The ratio itself is published as measured. The distance and speed are the
+ * weighted means over the wheels.
+ *
+ * Slip that all four wheels share, such as every wheel spinning under hard acceleration, looks like
+ * motion and isn't caught here.
+ */
+
+namespace WHEEL_ODOMETRY {
+    using COMMON::MOTOR_POSITION::MOTOR_POSITION_COUNT;
+
+    struct SlipConfig {
+        float slipTolerance = 0.15f;                            // slip ratio a wheel can show and keep full weight
+        float speedFloor = 0.05f;                               // m/s; slower predictions count as this for the ratio
+        float maxSteeringAngle = CONFIG::MAX_STEERING_ANGLE;    // rad; the servos stop here whatever was asked
+        float countDistance = static_cast<float>(M_PI) * CONFIG::WHEEL_DIAMETER / CONFIG::COUNTS_PER_REV; // m per count
+    };
+
+    // Indexed by MOTOR_POSITION. Travel and speed are positive forwards for the chassis on both sides.
+    struct Input {
+        float travel[MOTOR_POSITION_COUNT];     // m rolled since the last update
+        float speed[MOTOR_POSITION_COUNT];      // m/s
+        COMMON::SteeringAngles steering;        // rad, either sign
+        float yawRate;                          // rad/s over the same interval, counter-clockwise positive
+        float dt;                               // s since the last update
+    };
+
+    struct Estimate {
+        float distance;                         // m the rear axle centre moved, positive forwards for the chassis
+        float velocity;                         // m/s
+        float spread;                           // m, weighted RMS disagreement about distance beyond a count
+        COMMON::WheelSlip slip;
+        float weight[MOTOR_POSITION_COUNT];     // 0 to 1
+    };
+
+    class FourWheelOdometry {
+    public:
+        explicit FourWheelOdometry(float wheelTrack, const SlipConfig& config = SlipConfig());
+
+        [[nodiscard]] Estimate update(const Input& input) const;
+
+        SlipConfig config;
+
+    private:
+        float lateral[MOTOR_POSITION_COUNT];    // m, each wheel's offset to the left of the centre line
+    };
+}
+
+#endif //OSOD_MOTOR_2040_WHEEL_ODOMETRY_H
@@ -0,0 +1,65 @@
+#include "pose_integration.h"
+
+#include <algorithm>
+#include <cmath>
+#include "fast_math.h"
+
+namespace WHEEL_ODOMETRY {
+    namespace {
+        // below this half turn the chord factor comes from its series, which the sine's absolute error
+        // would otherwise swamp once divided by a small angle
+        constexpr float SERIES_LIMIT = 0.1f;
+
+        // sin(h) / h for h = turn / 2: the chord of an arc over its length
+        float chordFactor(const float turn) {
+            const float half = turn / 2;
+            const float square = half * half;
+            if (std::fabs(half) < SERIES_LIMIT) {
+                return 1.0f - square / 6.0f * (1.0f - square / 20.0f);
+            }
+            return FAST_MATH::sin(half) / half;
+        }
+
+        // curvature of the rear axle centre's path, from a front wheel at lateral offset from the centre line
+        // steered so that tan(angle) = tangent, positive turning left
+        float curvature(const float tangent, const float lateral, const float wheelBase) {
+            return tangent / (wheelBase + lateral * tangent);
+        }
+
+        float tangent(const float angle, const float maxSteeringAngle) {
+            float sine;
+            float cosine;
+            FAST_MATH::sincos(std::clamp(angle, -maxSteeringAngle, maxSteeringAngle), sine, cosine);
+            return sine / cosine;
+        }
+    }
+
+    Displacement integrate(const float heading, const float distance, const float turn,
+                           const CONFIG::PoseIntegration model, const float driveDirection) {
+        float direction = heading + turn;
+        float scale = 1.0f;
+        float turnShare = 1.0f;
+        if (model == CONFIG::MIDPOINT || model == CONFIG::ARC) {
+            direction = heading + turn / 2;
+            turnShare = 0.5f;
+        }
+        if (model == CONFIG::ARC) {
+            scale = chordFactor(turn);
+        }
+        float sinDirection;
+        float cosDirection;
+        FAST_MATH::sincos(direction, sinDirection, cosDirection);
+        const float perMetreX = -driveDirection * scale * sinDirection;
+        const float perMetreY = driveDirection * scale * cosDirection;
+        return {perMetreX * distance, perMetreY * distance, perMetreX, perMetreY, turnShare};
+    }
+
+    float bicycleTurn(const float distance, const COMMON::SteeringAngles steering, const float wheelBase,
+                      const float wheelTrack, const float maxSteeringAngle) {
+        // the right wheel sits on the outside of a left turn, the left wheel on the inside. Within the servos'
+        // travel both denominators stay positive as long as the half track is shorter than the wheelbase
+        const float right = curvature(tangent(steering.right, maxSteeringAngle), -wheelTrack / 2, wheelBase);
+        const float left = curvature(-tangent(steering.left, maxSteeringAngle), wheelTrack / 2, wheelBase);
+        return distance * (left + right) / 2;
+    }
+}
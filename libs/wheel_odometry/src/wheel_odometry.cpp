@@ -0,0 +1,78 @@
+#include "wheel_odometry.h"
+
+#include <cmath>
+#include "fast_math.h"
+
+namespace WHEEL_ODOMETRY {
+    using namespace COMMON::MOTOR_POSITION;
+
+    namespace {
+        // The mean of the middle two of four values. The larger of the two pairs' minimums and the smaller of
+        // their maximums are the middle two, in some order.
+        float median(const float (&values)[MOTOR_POSITION_COUNT]) {
+            const float low = std::fmax(std::fmin(values[0], values[1]), std::fmin(values[2], values[3]));
+            const float high = std::fmin(std::fmax(values[0], values[1]), std::fmax(values[2], values[3]));
+            return (low + high) / 2;
+        }
+    }
+
+    FourWheelOdometry::FourWheelOdometry(const float wheelTrack, const SlipConfig& config)
+            : config(config), lateral{wheelTrack / 2, -wheelTrack / 2, wheelTrack / 2, -wheelTrack / 2} {
+    }
+
+    Estimate FourWheelOdometry::update(const Input& input) const {
+        // the share of each wheel's rolling that is along the chassis
+        const float along[MOTOR_POSITION_COUNT] = {
+                FAST_MATH::cos(std::fmin(std::fabs(input.steering.left), config.maxSteeringAngle)),
+                FAST_MATH::cos(std::fmin(std::fabs(input.steering.right), config.maxSteeringAngle)),
+                1.0f,
+                1.0f
+        };
+
+        // each wheel's estimate of the rear axle centre's speed and travel: a wheel at lateral offset l moves
+        // along the chassis at v - ωl
+        const float turn = input.yawRate * input.dt;
+        float axleSpeed[MOTOR_POSITION_COUNT];
+        float axleTravel[MOTOR_POSITION_COUNT];
+        for (size_t i = 0; i < MOTOR_POSITION_COUNT; i++) {
+            axleSpeed[i] = input.speed[i] * along[i] + lateral[i] * input.yawRate;
+            axleTravel[i] = input.travel[i] * along[i] + lateral[i] * turn;
+        }
+        const float reference = median(axleSpeed);
+        const float quantum = input.dt > 0.0f ? config.countDistance / input.dt : 0.0f;
+
+        Estimate estimate{};
+        float weightSum = 0.0f;
+        float speedSum = 0.0f;
+        float travelSum = 0.0f;
+        for (size_t i = 0; i < MOTOR_POSITION_COUNT; i++) {
+            // the ground speed under the wheel along the chassis, and how far the wheel is ahead of it in the
+            // direction of travel
+            const float ground = reference - lateral[i] * input.yawRate;
+            const float ahead = ground < 0.0f ? reference - axleSpeed[i] : axleSpeed[i] - reference;
+            const float scale = std::fmax(std::fabs(ground), config.speedFloor);
+            const float ratio = ahead / scale;
+            // one count either way over the tick is the encoder's resolution, not slip
+            const float allowed = config.slipTolerance * scale + quantum;
+            const float excess = std::fmax(std::fabs(ahead) - allowed, 0.0f) / (config.slipTolerance * scale);
+            const float weight = 1.0f / (1.0f + excess * excess);
+            estimate.slip.ratios[i] = ratio;
+            estimate.weight[i] = weight;
+            weightSum += weight;
+            speedSum += weight * axleSpeed[i];
+            travelSum += weight * axleTravel[i];
+        }
+        estimate.velocity = speedSum / weightSum;
+        estimate.distance = travelSum / weightSum;
+
+        float squares = 0.0f;
+        for (size_t i = 0; i < MOTOR_POSITION_COUNT; i++) {
+            const float error = axleTravel[i] - estimate.distance;
+            squares += estimate.weight[i] * error * error;
+        }
+        // wheels a count apart are within the encoders' resolution, which the filter's own noise already covers
+        const float resolution = config.countDistance * config.countDistance;
+        estimate.spread = std::sqrt(std::fmax(squares / weightSum - resolution, 0.0f));
+        return estimate;
+    }
+}
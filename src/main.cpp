@@ -13,6 +13,13 @@
 #include "balance_port.h"
 #include "bno080.h"
 #include "tf_luna.h"
+#include "i2c_engine.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "flight_recorder.h"
+#ifdef DUAL_CORE
+#include "pico/multicore.h"
+#endif
 
 
 Navigator *navigator;
@@ -41,7 +48,7 @@ TimerCallbackData timerCallbackData = {
         .navigateCount = 0,
 };
 
-extern "C" void timer_callback(repeating_timer_t *t) {
+extern "C" bool timer_callback(repeating_timer_t *t) {
     // cast t->user_data to TimerCallbackData
     auto *user_data = reinterpret_cast<TimerCallbackData *>(t->user_data);
     user_data->shouldNavigate = true;
@@ -51,33 +58,71 @@ extern "C" void timer_callback(repeating_timer_t *t) {
     } else {
         user_data->navigateCount++;
     }
+    return true;
 }
 
 bool lastBrawnStatus = false;
 
+// single-character commands on the serial console:
+// d - freeze the flight recorder and dump it into the telemetry stream
+// r - resume flight recording
+void handleConsoleCommands() {
+    int command = getchar_timeout_us(0);
+    if (command == 'd') {
+        FLIGHT_RECORDER::requestDump();
+    } else if (command == 'r') {
+        FLIGHT_RECORDER::resume();
+        printf("flight recorder: recording\n");
+    }
+}
+
+#ifdef DUAL_CORE
+// core1 owns the encoders, the state estimator and the stokers. It hands estimates to core0 through
+// StateEstimator::latestState() and picks up drive train requests through StateManager::applyRequestedState(),
+// neither of which blocks the other core.
+STATE_ESTIMATOR::StateEstimator *core1StateEstimator;
+STATEMANAGER::StateManager *core1StateManager;
+I2C_ENGINE::I2CEngine *core1I2CEngine;
+
+void core1Main() {
+    PROFILER::init();
+    while (true) {
+        core1StateEstimator->serviceEstimation();
+        core1StateManager->applyRequestedState();
+        core1I2CEngine->service();
+        tight_loop_contents();
+    }
+}
+#endif
+
 int main() {
     stdio_init_all();
+    PROFILER::init();
 
     initMotorMonitorPins();
     
     i2c_inst_t* i2c_port0;
     initI2C(i2c_port0, false);
+
+    // all I2C traffic is queued through the engine, except the balance port's ADC driver, which
+    // suspends it while it uses the bus
+    auto *i2cEngine = new I2C_ENGINE::I2CEngine(i2c_port0);
    
     //set up IMU
     BNO08x IMU;
-    while (IMU.begin(CONFIG::BNO08X_ADDR, i2c_port0)==false) {
+    while (IMU.begin(CONFIG::BNO08X_ADDR, i2c_port0, i2cEngine)==false) {
         printf("BNO08x not detected at default I2C address. Check wiring. Freezing\n");
         scan_i2c_bus();
         sleep_ms(1000);
     }
-    IMU.enableRotationVector();
+    // the state estimator enables the IMU report it reads
 
     bool adcPresent;
     BalancePort balancePort;
     adcPresent = balancePort.initADC(i2c_port0); // Initialize ADC
 
     // set up the state estimator
-    auto *pStateEstimator = new STATE_ESTIMATOR::StateEstimator(&IMU, i2c_port0, CONFIG::DRIVING_STYLE);
+    auto *pStateEstimator = new STATE_ESTIMATOR::StateEstimator(&IMU, i2c_port0, i2cEngine, CONFIG::DRIVING_STYLE);
 
     // set up the state manager
     using namespace STATEMANAGER;
@@ -96,13 +141,12 @@ int main() {
     // set up the navigator
     navigator = new Navigator(pReceiver, pStateManager, pStateEstimator, CONFIG::DRIVING_STYLE);
     printf("navigator created\n");
-    pStateEstimator->addObserver(navigator);
 
     // Initialize a hardware timer
     repeating_timer_t navigationTimer;
     add_repeating_timer_ms(
             navigationPeriodMs,
-            reinterpret_cast<repeating_timer_callback_t>(timer_callback),
+            timer_callback,
             &timerCallbackData,
             &navigationTimer
     );
@@ -111,16 +155,46 @@ int main() {
     //gpio_set_irq_enabled_with_callback(CONFIG::motorStatusPin, GPIO_IRQ_EDGE_RISE, true, &handlerMotorController);
     //printf("IRQ created");
 
+#ifdef DUAL_CORE
+    core1StateEstimator = pStateEstimator;
+    core1StateManager = pStateManager;
+    core1I2CEngine = i2cEngine;
+    pStateManager->setDeferredActuation(true);
+    multicore_launch_core1(core1Main);
+    printf("estimation and motor control running on core1\n");
+#endif
+
     while (true) {
-        // Do nothing in the main loop
+#ifndef DUAL_CORE
+        // estimation is requested by its own timer and runs here, ahead of navigation, so the
+        // navigator always works from the freshest estimate
+        pStateEstimator->serviceEstimation();
+        i2cEngine->service();
+#endif
+
         if (timerCallbackData.shouldNavigate) {
             // Call the navigate function in the interrupt handler
             navigator->navigate();
             timerCallbackData.shouldNavigate = false;
         }
 
-        if (adcPresent && timerCallbackData.shouldReadCellStatus) {
-            balancePort.raiseCellStatus();
+        // the control path queues its telemetry; send it once the time-critical work is done
+        handleConsoleCommands();
+        FLIGHT_RECORDER::serviceDump();
+        TELEMETRY::drain();
+
+        if (timerCallbackData.shouldReadCellStatus) {
+            if (adcPresent) {
+                lockI2CBus();
+                i2cEngine->suspend();
+                balancePort.raiseCellStatus();
+                i2cEngine->resume();
+                unlockI2CBus();
+            }
+            pStateEstimator->showEstimationTiming();
+            i2cEngine->showStats();
+            TELEMETRY::showStats();
+            PROFILER::dump();
             timerCallbackData.shouldReadCellStatus = false;
         }
         bool brawnSwitchStatus = gpio_get(CONFIG::motorStatusPin); // Read current status